@@ -17,6 +17,9 @@ struct TextureMapping
 	mat2 rotation;
 };
 
+// Положение вершины должно вычисляться так же, как в предварительном проходе глубины (тест глубины GL_EQUAL)
+invariant gl_Position;
+
 // Uniform-переменные матриц
 uniform mat4 model;
 uniform mat4 view;
@@ -175,6 +178,7 @@ void main()
 			gs_out.uvDiffuse = gs_in[i].uvDiffuse;
 			gs_out.uvSpecular = gs_in[i].uvSpecular;
 			gs_out.uvBump = gs_in[i].uvBump;
+			gs_out.uvDisplace = gs_in[i].uvDisplace;
 			gs_out.normal = gs_in[i].normal;
 			gs_out.fragmentPos = gs_in[i].vertexPos;
 
@@ -205,6 +209,11 @@ void main()
 /*FRAGMENT-SHADER-BEGIN*/
 #version 330 core
 
+// Вариант шейдера определяется набором текстур части меша (определения добавляются при сборке варианта)
+// HAS_SPECULAR_MAP - есть карта бликов, HAS_BUMP_MAP - есть карта нормалей, HAS_DISPLACEMENT_MAP - есть карта высот
+// PARALLAX_OFFSET_ONLY - упрощенный paralax-mapping (одна выборка вместо поиска пересечения по слоям)
+// GBUFFER_COMPACT - компактный формат G-буфера (вместо положения записывается глубина, нормаль упаковывается в 2 компонента)
+
 // Вывод в 3 разных вложения
 layout (location = 0) out vec3 gPosition;
 layout (location = 1) out vec3 gNormal;
@@ -225,75 +234,146 @@ in GS_OUT
 	vec3 viewPostT;        // Положение камеры в координатах касательного пространстве полигона
 } fs_in;
 
+// Структура описывающая параметры мапинга текстуры
+struct TextureMapping
+{
+	vec2 offset;
+	vec2 origin;
+	vec2 scale;
+	mat2 rotation;
+};
+
+// Параметры маппинга текстур (общие с вершинным шейдером, нужны для переноса смещения paralax-mapping'а)
+uniform TextureMapping diffuseTexMapping;
+uniform TextureMapping specularTexMapping;
+uniform TextureMapping bumpTexMapping;
+uniform TextureMapping displaceTextureMapping;
+
 // Текстуры
 uniform sampler2D diffuseTexture;
 uniform sampler2D specularTexture;
 uniform sampler2D bumpTexture;
 uniform sampler2D displaceTexture;
 
-// Текстурные координаты с учетом paralax-mapping смещения
-vec2 paralaxMappedUv(vec2 texCoords, vec3 viewDir)
+// Октаэдрическая упаковка единичной нормали в 2 компонента [0,1]
+vec2 encodeNormal(vec3 n)
 {
-	// количество слоев глубины
-    const float numLayers = 16;
-    // размер каждого слоя
-    float layerDepth = 1.0 / numLayers;
-    // глубина текущего слоя
-    float currentLayerDepth = 0.0;
-    // величина шага смещения текстурных координат на каждом слое
-    // расчитывается на основе вектора P
-    vec2 P = viewDir.xy * 0.1f; 
-    vec2 deltaTexCoords = P / numLayers;
+	n /= (abs(n.x) + abs(n.y) + abs(n.z));
+	if(n.z < 0.0) n.xy = (1.0 - abs(n.yx)) * vec2(n.x >= 0.0 ? 1.0 : -1.0, n.y >= 0.0 ? 1.0 : -1.0);
+	return n.xy * 0.5 + 0.5;
+}
+
+// Параметры paralax-mapping'а
+#define PARALLAX_SCALE 0.1          // Глубина рельефа (в единицах текстурных координат)
+#define PARALLAX_MIN_LAYERS 4.0     // Минимальное кол-во слоев (взгляд по нормали, большое расстояние)
+#define PARALLAX_MAX_LAYERS 32.0    // Максимальное кол-во слоев (взгляд под острым углом, вблизи)
+#define PARALLAX_LOD_DISTANCE 20.0  // Расстояние, на котором кол-во слоев снижается до минимального
+
+// Смещение текстурных координат карты высот (paralax-mapping)
+// Вычисляется один раз, в пространстве текстурных координат карты высот
+// texCoords - координаты карты высот, viewDir - направление в камеру (касательное пространство), viewDistance - расстояние до камеры
+vec2 paralaxOffset(vec2 texCoords, vec3 viewDir, float viewDistance)
+{
+#ifdef PARALLAX_OFFSET_ONLY
+	// Упрощенный вариант (offset mapping) - одна выборка, смещение пропорционально глубине в точке
+	return -viewDir.xy * texture(displaceTexture, texCoords).r * PARALLAX_SCALE;
+#else
+	// количество слоев глубины зависит от угла обзора (под острым углом нужно больше слоев) и расстояния до камеры
+	float numLayers = mix(PARALLAX_MAX_LAYERS, PARALLAX_MIN_LAYERS, abs(viewDir.z));
+	numLayers = floor(mix(numLayers, PARALLAX_MIN_LAYERS, clamp(viewDistance / PARALLAX_LOD_DISTANCE, 0.0, 1.0)));
+	// размер каждого слоя
+	float layerDepth = 1.0 / numLayers;
+	// глубина текущего слоя
+	float currentLayerDepth = 0.0;
+	// величина шага смещения текстурных координат на каждом слое
+	// расчитывается на основе вектора P
+	vec2 P = viewDir.xy * PARALLAX_SCALE;
+	vec2 deltaTexCoords = P / numLayers;
 
 	// начальная инициализация
 	vec2  currentTexCoords = texCoords;
 	float currentDepthMapValue = texture(displaceTexture, currentTexCoords).r;
-  
-	while(currentLayerDepth < currentDepthMapValue)
+
+	for(float i = 0.0; i < numLayers && currentLayerDepth < currentDepthMapValue; i += 1.0)
 	{
 		// смещаем текстурные координаты вдоль вектора P
 		currentTexCoords -= deltaTexCoords;
-		// делаем выборку из карты глубин в текущих текстурных координатах 
-		currentDepthMapValue = texture(displaceTexture, currentTexCoords).r;  
+		// делаем выборку из карты глубин в текущих текстурных координатах
+		currentDepthMapValue = texture(displaceTexture, currentTexCoords).r;
 		// рассчитываем глубину следующего слоя
-		currentLayerDepth += layerDepth;  
+		currentLayerDepth += layerDepth;
 	}
 
 	// находим текстурные координаты перед найденной точкой пересечения,
 	// т.е. делаем "шаг назад"
 	vec2 prevTexCoords = currentTexCoords + deltaTexCoords;
 
-	// находим значения глубин до и после нахождения пересечения 
+	// находим значения глубин до и после нахождения пересечения
 	// для использования в линейной интерполяции
 	float afterDepth  = currentDepthMapValue - currentLayerDepth;
 	float beforeDepth = texture(displaceTexture, prevTexCoords).r - currentLayerDepth + layerDepth;
 
-	// интерполяция текстурных координат 
+	// интерполяция текстурных координат
 	float weight = afterDepth / (afterDepth - beforeDepth);
 	vec2 finalTexCoords = prevTexCoords * weight + currentTexCoords * (1.0 - weight);
 
-	return finalTexCoords;
+	return finalTexCoords - texCoords;
+#endif
+}
+
+// Перевести смещение исходных текстурных координат в пространство координат текстуры (с учетом ее маппинга)
+vec2 mappedOffset(TextureMapping mapping, vec2 offset)
+{
+	return (mapping.rotation * offset) * mapping.scale;
 }
 
 // Основная функция фрагментного шейдера
 // Помещение значений положений фрагментов (положение,цвет,бликовость,нормаль) в цветовые вложения g-буфера
 void main()
 {
-	// Направление от фрагмента в камеру (в тангент-пространстве плоскости полигона)
-	vec3 fragToViewDirT = normalize(fs_in.viewPostT - fs_in.fragmentPosT);
-
+#ifdef HAS_DISPLACEMENT_MAP
+	// Вектор от фрагмента к камере (в тангент-пространстве плоскости полигона)
+	vec3 fragToViewT = fs_in.viewPostT - fs_in.fragmentPosT;
+
+	// Смещение считается один раз для карты высот, затем переводится в исходные координаты и в координаты остальных текстур
+	vec2 displaceOffset = paralaxOffset(fs_in.uvDisplace, normalize(fragToViewT), length(fragToViewT));
+	vec2 offset = transpose(displaceTextureMapping.rotation) * (displaceOffset / displaceTextureMapping.scale);
+	vec2 uvDiffuse = fs_in.uvDiffuse + mappedOffset(diffuseTexMapping, offset);
+	vec2 uvSpecular = fs_in.uvSpecular + mappedOffset(specularTexMapping, offset);
+	vec2 uvBump = fs_in.uvBump + mappedOffset(bumpTexMapping, offset);
+#else
+	// Без карты высот смещения нет
+	vec2 uvDiffuse = fs_in.uvDiffuse;
+	vec2 uvSpecular = fs_in.uvSpecular;
+	vec2 uvBump = fs_in.uvBump;
+#endif
+
+#ifdef HAS_BUMP_MAP
 	// Получить нормаль из карты нормалей (используя UV коордианты для текущего фрагмента)
-	vec3 normal = normalize(texture(bumpTexture,paralaxMappedUv(fs_in.uvBump, fragToViewDirT)).rgb * 2.0 - 1.0);
+	vec3 normal = normalize(texture(bumpTexture,uvBump).rgb * 2.0 - 1.0);
 	// Перевести нормаль из скасательного в мировое пространство
 	normal = fs_in.tbnMatrix * normal;
+#else
+	// Без карты нормалей используется нормаль вершины (N-столбец TBN матрицы)
+	vec3 normal = fs_in.tbnMatrix[2];
+#endif
 
-	// Положение фрагмента
-	gPosition = fs_in.fragmentPos;
+	// Положение фрагмента (в компактном формате - глубина, по ней положение восстанавливается при освещении)
 	// Нормаль фрагмента
+#ifdef GBUFFER_COMPACT
+	gPosition = vec3(gl_FragCoord.z, 0.0, 0.0);
+	gNormal = vec3(encodeNormal(normalize(normal)), 0.0);
+#else
+	gPosition = fs_in.fragmentPos;
 	gNormal = normalize(normal);
+#endif
 	// Цвет фрагмента
-	gAlbedoSpec.rgb = fs_in.color * texture(diffuseTexture, paralaxMappedUv(fs_in.uvDiffuse, fragToViewDirT)).rgb;
-	// Интенсивность отражения фрагмента
-	gAlbedoSpec.a = texture(specularTexture, paralaxMappedUv(fs_in.uvSpecular, fragToViewDirT)).r;
+	gAlbedoSpec.rgb = fs_in.color * texture(diffuseTexture, uvDiffuse).rgb;
+	// Интенсивность отражения фрагмента (без карты бликов - максимальная, как у текстуры по умолчанию)
+#ifdef HAS_SPECULAR_MAP
+	gAlbedoSpec.a = texture(specularTexture, uvSpecular).r;
+#else
+	gAlbedoSpec.a = 1.0;
+#endif
 }
 /*FRAGMENT-SHADER-END*/
\ No newline at end of file
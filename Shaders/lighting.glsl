@@ -29,11 +29,23 @@ void main()
 // Выход шейдера
 layout (location = 0) out vec4 color;
 
+// Вариант шейдера определяется типом источника (LIGHT_TYPE_POINT, LIGHT_TYPE_DIRECTIONAL, LIGHT_TYPE_SPOT)
+// и форматом G-буфера (GBUFFER_COMPACT), определения добавляются при сборке варианта
+
 // Типы источника освещения
 #define LIGHT_POINT 1
 #define LIGHT_DIRECTIONAL 2
 #define LIGHT_SPOT 3
 
+// Способы затенения картами теней
+#define SHADOW_NONE 0
+#define SHADOW_MAP_SPOT 1
+#define SHADOW_MAP_CASCADED 2
+#define SHADOW_MAP_ATLAS 3
+
+// Максимальное кол-во каскадов карт теней
+#define MAX_CASCADES 4
+
 // Структура описывающая параметры материала
 struct MaterialSettings
 {
@@ -80,11 +92,158 @@ uniform Light light;
 
 // Текстуры из G-буфера
 uniform sampler2D albedoSpecularTexture;
-uniform sampler2D positionTexture;
+uniform sampler2D positionTexture;              // Положение (в компактном формате G-буфера - глубина, R32F)
 uniform sampler2D normalTexture;
+uniform mat4 inverseViewProjection;             // Обратная матрица вида-проекции камеры
+uniform vec2 renderScale;                       // Доля текстур G-буфера, занятая кадром (при пониженном разрешении рендеринга)
+
+// Uniform-переменные для карт теней
+uniform uint shadowMode;                        // Способ затенения (карты не используются, если тени построены в stencil-буфере)
+uniform mat4 view;                              // Матрица вида камеры (для выбора каскада)
+uniform sampler2DShadow spotShadowMap;          // Карта теней прожектора
+uniform mat4 spotShadowMatrix;                  // Матрица вида-проекции прожектора
+uniform sampler2DArrayShadow cascadeShadowMap;  // Каскады направленного источника
+uniform mat4 cascadeMatrices[MAX_CASCADES];     // Матрицы вида-проекции каскадов
+uniform float cascadeSplits[MAX_CASCADES];      // Дальние границы каскадов (расстояние от камеры)
+uniform int cascadeCount;                       // Кол-во каскадов
+uniform sampler2DShadow atlasShadowMap;         // Атлас карт теней прожекторов и точечных источников
+uniform mat4 atlasMatrices[6];                  // Матрицы вида-проекции ячеек источника (у точечного - по грани куба)
+uniform vec4 atlasRects[6];                     // Области ячеек в атласе (xy - сдвиг, zw - размер)
+uniform int atlasTileCount;                     // Кол-во ячеек источника (1 - прожектор, 6 - точечный)
+
+// Выборка из карты теней с PCF-фильтрацией (3*3 выборки, каждая с аппаратной билинейной фильтрацией сравнения)
+float sampleShadowMap(vec3 coords)
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(spotShadowMap, 0));
+	float result = 0.0;
+
+	for(int x = -1; x <= 1; x++)
+	{
+		for(int y = -1; y <= 1; y++)
+		{
+			result += texture(spotShadowMap, vec3(coords.xy + vec2(x, y) * texelSize, coords.z));
+		}
+	}
+
+	return result / 9.0;
+}
+
+// Выборка из каскада карты теней с PCF-фильтрацией
+float sampleShadowCascade(vec3 coords, int cascade)
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(cascadeShadowMap, 0).xy);
+	float result = 0.0;
+
+	for(int x = -1; x <= 1; x++)
+	{
+		for(int y = -1; y <= 1; y++)
+		{
+			result += texture(cascadeShadowMap, vec4(coords.xy + vec2(x, y) * texelSize, float(cascade), coords.z));
+		}
+	}
+
+	return result / 9.0;
+}
+
+// Выборка из ячейки атласа с PCF-фильтрацией (выборки не выходят за пределы ячейки)
+float sampleShadowAtlas(vec3 coords, vec4 rect)
+{
+	vec2 texelSize = 1.0 / vec2(textureSize(atlasShadowMap, 0));
+	vec2 minUv = rect.xy + texelSize;
+	vec2 maxUv = rect.xy + rect.zw - texelSize;
+	vec2 uv = rect.xy + coords.xy * rect.zw;
+	float result = 0.0;
+
+	for(int x = -1; x <= 1; x++)
+	{
+		for(int y = -1; y <= 1; y++)
+		{
+			result += texture(atlasShadowMap, vec3(clamp(uv + vec2(x, y) * texelSize, minUv, maxUv), coords.z));
+		}
+	}
+
+	return result / 9.0;
+}
+
+// Распаковать нормаль из октаэдрической упаковки (компактный формат G-буфера)
+vec3 decodeNormal(vec2 value)
+{
+	vec2 f = value * 2.0 - 1.0;
+	vec3 n = vec3(f.x, f.y, 1.0 - abs(f.x) - abs(f.y));
+	float t = clamp(-n.z, 0.0, 1.0);
+	n.x += n.x >= 0.0 ? -t : t;
+	n.y += n.y >= 0.0 ? -t : t;
+	return normalize(n);
+}
+
+// Восстановить положение фрагмента в мировых координатах по глубине
+// uv - координаты на экране, texUv - координаты в текстуре глубины
+vec3 reconstructPosition(vec2 uv, vec2 texUv)
+{
+	float depth = texture(positionTexture, texUv).r;
+	vec4 position = inverseViewProjection * vec4(vec3(uv, depth) * 2.0 - 1.0, 1.0);
+	return position.xyz / position.w;
+}
+
+// Вычислить освещенность фрагмента с учетом карт теней (1 - освещен, 0 - в тени)
+float calculateShadow(FragmentSettings fragment, vec3 lightDir)
+{
+	// Смещение глубины зависит от угла падения света (чем более полого падает свет, тем больше смещение)
+	float bias = max(0.002 * (1.0 - dot(fragment.normal, lightDir)), 0.0002);
+
+	// Карта теней прожектора (перспективная проекция)
+	if(shadowMode == uint(SHADOW_MAP_SPOT))
+	{
+		vec4 coords = spotShadowMatrix * vec4(fragment.position, 1.0);
+		coords.xyz = (coords.xyz / coords.w) * 0.5 + 0.5;
+		if(coords.w <= 0.0 || coords.z > 1.0) return 1.0;
+		return sampleShadowMap(vec3(coords.xy, coords.z - bias));
+	}
+
+	// Каскады направленного источника (каскад выбирается по расстоянию от камеры)
+	if(shadowMode == uint(SHADOW_MAP_CASCADED))
+	{
+		float depth = -(view * vec4(fragment.position, 1.0)).z;
+
+		for(int i = 0; i < cascadeCount; i++)
+		{
+			if(depth < cascadeSplits[i])
+			{
+				vec3 coords = (cascadeMatrices[i] * vec4(fragment.position, 1.0)).xyz * 0.5 + 0.5;
+				return sampleShadowCascade(vec3(coords.xy, coords.z - bias), i);
+			}
+		}
+	}
+
+	// Ячейки атласа (у точечного источника ячейка выбирается по грани куба, в сторону которой лежит фрагмент)
+	if(shadowMode == uint(SHADOW_MAP_ATLAS))
+	{
+		int tile = 0;
+
+		if(atlasTileCount == 6)
+		{
+			vec3 v = fragment.position - light.position;
+			vec3 a = abs(v);
+			if(a.x >= a.y && a.x >= a.z) tile = v.x > 0.0 ? 0 : 1;
+			else if(a.y >= a.z) tile = v.y > 0.0 ? 2 : 3;
+			else tile = v.z > 0.0 ? 4 : 5;
+		}
+
+		// Ячейка еще не нарисована
+		if(atlasRects[tile].z <= 0.0) return 1.0;
+
+		vec4 coords = atlasMatrices[tile] * vec4(fragment.position, 1.0);
+		coords.xyz = (coords.xyz / coords.w) * 0.5 + 0.5;
+		if(coords.w <= 0.0 || coords.z > 1.0 || any(lessThan(coords.xy, vec2(0.0))) || any(greaterThan(coords.xy, vec2(1.0)))) return 1.0;
+		return sampleShadowAtlas(vec3(coords.xy, coords.z - bias), atlasRects[tile]);
+	}
+
+	// Фрагмент дальше последнего каскада (или карты теней не используются)
+	return 1.0;
+}
 
 // Вычислить освещенность фрагмента точечным источником
-vec3 calculatePointLightComponent(Light light, FragmentSettings fragment, MaterialSettings material, vec3 viewPosition)
+vec3 calculatePointLightComponent(Light light, FragmentSettings fragment, MaterialSettings material, vec3 viewPosition, float shadow)
 {
 	// Вектор из фрагмента в камеру (обратное направление взгляда)
 	vec3 fragmentToView = normalize(viewPosition - fragment.position);
@@ -106,12 +265,12 @@ vec3 calculatePointLightComponent(Light light, FragmentSettings fragment, Materi
 	float specularBrightness = pow(max(dot(fragmentToView, reflectedLightDir), 0.0), material.shininess);
 	vec3 specular = light.color * (specularBrightness * material.specularColor) * fragment.specularity;
 
-	// Вернуть сумму всех компонентов
-	return ((ambient * attenuation) + (diffuse * attenuation) + (specular * attenuation));
+	// Вернуть сумму всех компонентов (тень влияет только на рассеянный и бликовый)
+	return ((ambient * attenuation) + (diffuse * attenuation * shadow) + (specular * attenuation * shadow));
 }
 
 // Вычислить освещенность фрагмента направленным источником
-vec3 calculateDirectLightComponent(Light light, FragmentSettings fragment, MaterialSettings material, vec3 viewPosition)
+vec3 calculateDirectLightComponent(Light light, FragmentSettings fragment, MaterialSettings material, vec3 viewPosition, float shadow)
 {
 	// Вектор из фрагмента в камеру (обратное направление взгляда)
 	vec3 fragmentToView = normalize(viewPosition - fragment.position);
@@ -129,12 +288,12 @@ vec3 calculateDirectLightComponent(Light light, FragmentSettings fragment, Mater
 	float specularBrightness = pow(max(dot(fragmentToView, reflectedLightDir), 0.0), material.shininess);
 	vec3 specular = light.color * (specularBrightness * material.specularColor) * fragment.specularity;
 
-	// Вернуть сумму всех компонентов
-	return ambient + diffuse + specular;
+	// Вернуть сумму всех компонентов (тень влияет только на рассеянный и бликовый)
+	return ambient + (diffuse + specular) * shadow;
 }
 
 // Вычислить освещенность фрагмента фонариком-прожектором
-vec3 calculateSpotLightComponent(Light light, FragmentSettings fragment, MaterialSettings material, vec3 viewPosition)
+vec3 calculateSpotLightComponent(Light light, FragmentSettings fragment, MaterialSettings material, vec3 viewPosition, float shadow)
 {
 	// Вектор из фрагмента в камеру (обратное направление взгляда)
 	vec3 fragmentToView = normalize(viewPosition - fragment.position);
@@ -168,7 +327,7 @@ vec3 calculateSpotLightComponent(Light light, FragmentSettings fragment, Materia
 	float attenuation = 1.0f / (1.0f + light.linear * distance + light.quadratic * (distance * distance));
 
 	// Вернуть сумму всех компонентов
-	return ((diffuse * intensity * attenuation) + (specular * intensity * attenuation));
+	return ((diffuse * intensity * attenuation) + (specular * intensity * attenuation)) * shadow;
 }
 
 // Основная функция фрагментного шейдера
@@ -184,29 +343,53 @@ void main()
 
 	// Записать параметры текущего фрагмента в текстуру
 	FragmentSettings fragment;
-	fragment.position = texture(positionTexture,fs_in.uv).rgb;
-	fragment.color = texture(albedoSpecularTexture,fs_in.uv).rgb;
-	fragment.normal = texture(normalTexture,fs_in.uv).rgb;
-	fragment.specularity = texture(albedoSpecularTexture,fs_in.uv).a;
+	vec2 texUv = fs_in.uv * renderScale;
+	vec4 albedoSpecular = texture(albedoSpecularTexture,texUv);
+#ifdef GBUFFER_COMPACT
+	fragment.position = reconstructPosition(fs_in.uv, texUv);
+	fragment.normal = decodeNormal(texture(normalTexture,texUv).rg);
+#else
+	fragment.position = texture(positionTexture,texUv).rgb;
+	fragment.normal = texture(normalTexture,texUv).rgb;
+#endif
+	fragment.color = albedoSpecular.rgb;
+	fragment.specularity = albedoSpecular.a;
+
+	// Затенение картами теней (вектор падения света зависит от типа источника)
+	float shadow = 1.0;
+	if(shadowMode != uint(SHADOW_NONE))
+	{
+		vec3 lightDir = light.type == uint(LIGHT_DIRECTIONAL) ? normalize(-light.direction) : normalize(light.position - fragment.position);
+		shadow = calculateShadow(fragment, lightDir);
+	}
 
 	// Результирующий цвет
 	vec3 resultColor;
 
+	// Тип источника известен в варианте шейдера - ветвление не нужно
+#if defined(LIGHT_TYPE_POINT)
+	resultColor = calculatePointLightComponent(light, fragment, material, cameraPosition, shadow);
+#elif defined(LIGHT_TYPE_DIRECTIONAL)
+	resultColor = calculateDirectLightComponent(light, fragment, material, cameraPosition, shadow);
+#elif defined(LIGHT_TYPE_SPOT)
+	resultColor = calculateSpotLightComponent(light, fragment, material, cameraPosition, shadow);
+#else
 	// В зависимости от типа источника
 	switch(light.type)
 	{
 		case uint(LIGHT_POINT):
-		resultColor = calculatePointLightComponent(light, fragment, material, cameraPosition);
+		resultColor = calculatePointLightComponent(light, fragment, material, cameraPosition, shadow);
 		break;
 
 		case uint(LIGHT_DIRECTIONAL):
-		resultColor = calculateDirectLightComponent(light, fragment, material, cameraPosition);
+		resultColor = calculateDirectLightComponent(light, fragment, material, cameraPosition, shadow);
 		break;
 
 		case uint(LIGHT_SPOT):
-		resultColor = calculateSpotLightComponent(light, fragment, material, cameraPosition);
+		resultColor = calculateSpotLightComponent(light, fragment, material, cameraPosition, shadow);
 		break;
 	}
+#endif
 
 	// Итоговый цвет + альфа
 	color = vec4(resultColor,1.0f);
@@ -38,38 +38,14 @@ in VS_OUT
 // Текстуры
 uniform sampler2D screenTexture;
 
-// Сдвиг текстурных координат для выборки соседних текселей
-const float offset = 0.003;
+// Доля текстуры, занятая кадром (при пониженном разрешении рендеринга кадр занимает ее часть)
+uniform vec2 uvScale;
 
 // Основная функция фрагментного шейдера
-// Вычисление итогового цвета фрагмента с учетом пост-обработки
+// Копирование кадра в основной буфер (одна выборка на пиксель). Эффекты пост-обработки задаются цепочкой эффектов рендерера
 void main()
 {
-	// Массив сдвигов UV координат для получения соседних текселей текстуры
-	vec2 offsets[9] = vec2[](
-		vec2(-offset, offset), vec2( 0.0f, offset), vec2( offset, offset),
-		vec2(-offset, 0.0f), vec2( 0.0f, 0.0f), vec2( offset, 0.0f),
-		vec2(-offset, -offset), vec2( 0.0f, -offset), vec2( offset, -offset)
-	);
-
-	// Коэфициенты умножения (сверточное ядро)
-	// Без изменений (исходная картинка)
-	float kernel[9] = float[](
-		0, 0, 0,
-		0, 1, 0,
-		0, 0, 0
-	);
-
-	// Результирующий цвет
-	vec3 result;
-
-	// Подсчет результирующего цвета (среднее значение из выборки)
-	for(int i = 0; i < 9; i++){
-		result += texture(screenTexture, fs_in.uv + offsets[i]).rgb * kernel[i];
-	}
-
-	// Выход шейдера
-	color = vec4(result, 1.0);
+	color = vec4(texture(screenTexture, fs_in.uv * uvScale).rgb, 1.0);
 }
 
 /*FRAGMENT-SHADER-END*/
\ No newline at end of file
@@ -39,7 +39,8 @@ layout (triangle_strip, max_vertices = 21) out;
 uniform mat4 model;
 uniform mat4 view;
 uniform mat4 projection;
-uniform vec3 lightPosition;
+uniform vec4 lightPosition; // Положение источника (w = 0 для направленного источника - тогда это вектор к источнику)
+uniform bool caps;          // Строить крышки объема (нужны для метода Z-fail, для Z-pass не нужны)
 
 // Входные значения шейдера
 // Значения для каждой вершины треугольника (из вершинного шейдера)
@@ -58,7 +59,7 @@ out GS_OUT
 } gs_out;
 
 // Подсчет нормали полигона
-vec3 CalcNormal(vec3 v0, vec3 v1, vec3 v2, bool ccw = false)
+vec3 CalcNormal(vec3 v0, vec3 v1, vec3 v2, bool ccw)
 {
 	vec3 edge1 = v1 - v0;
 	vec3 edge2 = v2 - v0;
@@ -66,13 +67,11 @@ vec3 CalcNormal(vec3 v0, vec3 v1, vec3 v2, bool ccw = false)
 }
 
 // Обращен ли полигон к источнику освещения
-bool IsPolygonFacingLight(vec3 lightPosition, vec3 v0, vec3 v1, vec3 v2, bool ccw = false)
+bool IsPolygonFacingLight(vec4 lightPosition, vec3 v0, vec3 v1, vec3 v2, bool ccw)
 {
 	// Получить вектор межу светом и полигонов (используются сумма векторов между всеми его точками)
-	vec3 v0toLight = lightPosition - v0;
-	vec3 v1toLight = lightPosition - v1;
-	vec3 v2toLight = lightPosition - v2;
-	vec3 polygonToLight = normalize(v0toLight + v1toLight + v2toLight);
+	// Для направленного источника (w = 0) вектор одинаков для всех точек
+	vec3 polygonToLight = normalize(lightPosition.xyz * 3.0f - (v0 + v1 + v2) * lightPosition.w);
 
 	// Получить нормаль
 	vec3 normal = CalcNormal(v0,v1,v2,ccw);
@@ -88,7 +87,7 @@ bool HasPhantomVertex(uint v0, uint v1, uint v2)
 }
 
 // Примитив линии
-void EmitLine(uint v0, uint v1, vec3 color = vec3(1.0f,1.0f,1.0f))
+void EmitLine(uint v0, uint v1, vec3 color)
 {
 	gl_Position = projection * view * model * vec4(gs_in[v0].vertexPosLoc, 1.0);
 	gs_out.color = vec3(1.0f,1.0f,1.0f);
@@ -101,8 +100,14 @@ void EmitLine(uint v0, uint v1, vec3 color = vec3(1.0f,1.0f,1.0f))
 	EmitVertex();
 }
 
+// Направление вытягивания вершины от источника света
+vec3 ExtrusionDirection(vec4 lightPosition, vec3 v)
+{
+	return lightPosition.w == 0.0f ? -lightPosition.xyz : v - lightPosition.xyz;
+}
+
 // Полигон передней крышки теневого объема
-void ShadowVolumeFrontCapPolygon(vec3 color = vec3(0.6f,0.6f,0.6f))
+void ShadowVolumeFrontCapPolygon(vec3 color)
 {
 	vec3 positions[3];
 	positions[0] = gs_in[0].vertexPosLoc;
@@ -124,14 +129,13 @@ void ShadowVolumeFrontCapPolygon(vec3 color = vec3(0.6f,0.6f,0.6f))
 }
 
 // Полигон дальней крышки теневого объема
-void ShadowVolumeBackCapPolygon(vec3 lightPosition, vec3 color = vec3(0.6f,0.6f,0.6f))
+void ShadowVolumeBackCapPolygon(vec4 lightPosition, vec3 color)
 {
-	// Вершины полигона сдвигаются вперед по вектор от источка света
+	// Вершины полигона сдвигаются вперед по вектору от источка света
 	vec3 positions[3];
-	float lengthMul = 1000.0f;
-	positions[0] = (normalize(gs_in[0].vertexPosLoc - lightPosition) * lengthMul) + gs_in[0].vertexPosLoc;
-	positions[1] = (normalize(gs_in[4].vertexPosLoc - lightPosition) * lengthMul) + gs_in[4].vertexPosLoc;
-	positions[2] = (normalize(gs_in[2].vertexPosLoc - lightPosition) * lengthMul) + gs_in[2].vertexPosLoc;
+	positions[0] = ExtrusionDirection(lightPosition, gs_in[0].vertexPosLoc);
+	positions[1] = ExtrusionDirection(lightPosition, gs_in[4].vertexPosLoc);
+	positions[2] = ExtrusionDirection(lightPosition, gs_in[2].vertexPosLoc);
 
 	for(int i = 0; i < 3; i++)
 	{
@@ -148,12 +152,11 @@ void ShadowVolumeBackCapPolygon(vec3 lightPosition, vec3 color = vec3(0.6f,0.6f,
 }
 
 // Вытянуть ребро вдаль от источника (создать дополнительные грани)
-void ShadowVolumePolygon(vec3 lightPosition, vec3 v0, vec3 v1)
+void ShadowVolumePolygon(vec4 lightPosition, vec3 v0, vec3 v1)
 {
-	// Вычислить "сдвинутые" вершины
-	float lengthMul = 1000.0f;
-	vec3 v2 = (normalize(v0 - lightPosition) * lengthMul) + v0;
-	vec3 v3 = (normalize(v1 - lightPosition) * lengthMul) + v1;
+	// Вычислить "сдвинутые" вершины (направления вытягивания, вершины проецируются в бесконечность)
+	vec3 v2 = ExtrusionDirection(lightPosition, v0);
+	vec3 v3 = ExtrusionDirection(lightPosition, v1);
 	
 	// Последовательность отсрисовки вершин полигона "теневого объема"
 	vec3 positions[6];
@@ -187,35 +190,39 @@ void ShadowVolumePolygon(vec3 lightPosition, vec3 v0, vec3 v1)
 void main() 
 {
     // Получить положение источника света в локальном пространстве (пространстве модели)
-	vec3 lightPositionLoc = (inverse(model) * vec4(lightPosition, 1.0f)).xyz;
+	vec4 lightPositionLoc = inverse(model) * lightPosition;
 
 	// Направлен ли данный полигон к источнику света
-	if(IsPolygonFacingLight(lightPositionLoc, gs_in[0].vertexPosLoc, gs_in[2].vertexPosLoc, gs_in[4].vertexPosLoc))
+	if(IsPolygonFacingLight(lightPositionLoc, gs_in[0].vertexPosLoc, gs_in[2].vertexPosLoc, gs_in[4].vertexPosLoc, false))
 	{
 		// Отрисовка полигонов теневого объема
 		// Определение силуэтных ребер, вытягивание их в бесконечность от источника света
-		if(bool(gs_in[1].isPhantom) || IsPolygonFacingLight(lightPositionLoc, gs_in[0].vertexPosLoc, gs_in[1].vertexPosLoc, gs_in[2].vertexPosLoc) == false)
+		if(bool(gs_in[1].isPhantom) || IsPolygonFacingLight(lightPositionLoc, gs_in[0].vertexPosLoc, gs_in[1].vertexPosLoc, gs_in[2].vertexPosLoc, false) == false)
 		{
 			//Ребро 0-2 - силуэтное
 			ShadowVolumePolygon(lightPositionLoc, gs_in[0].vertexPosLoc, gs_in[2].vertexPosLoc);
 		}
-		if(bool(gs_in[3].isPhantom) || IsPolygonFacingLight(lightPositionLoc, gs_in[2].vertexPosLoc, gs_in[3].vertexPosLoc, gs_in[4].vertexPosLoc) == false)
+		if(bool(gs_in[3].isPhantom) || IsPolygonFacingLight(lightPositionLoc, gs_in[2].vertexPosLoc, gs_in[3].vertexPosLoc, gs_in[4].vertexPosLoc, false) == false)
 		{
 			//Ребро 2-4 - силуэтное
 			ShadowVolumePolygon(lightPositionLoc, gs_in[2].vertexPosLoc, gs_in[4].vertexPosLoc);
 		}
-		if(bool(gs_in[5].isPhantom) || IsPolygonFacingLight(lightPositionLoc, gs_in[4].vertexPosLoc, gs_in[5].vertexPosLoc, gs_in[0].vertexPosLoc) == false)
+		if(bool(gs_in[5].isPhantom) || IsPolygonFacingLight(lightPositionLoc, gs_in[4].vertexPosLoc, gs_in[5].vertexPosLoc, gs_in[0].vertexPosLoc, false) == false)
 		{
 			//Ребро 4-0 - силуэтное
 			ShadowVolumePolygon(lightPositionLoc, gs_in[4].vertexPosLoc, gs_in[0].vertexPosLoc);
 		}
 
-		// Полигон, который направлен к источнику может служить передней крышкой теневого ообъема (выводим его как есть)
-		ShadowVolumeFrontCapPolygon();
+		// Крышки нужны только для метода Z-fail (рендерер выбирает метод для каждого источника в каждом кадре)
+		if(caps)
+		{
+			// Полигон, который направлен к источнику может служить передней крышкой теневого ообъема (выводим его как есть)
+			ShadowVolumeFrontCapPolygon(vec3(0.6f,0.6f,0.6f));
 
-		// Тот же полигон, который является частью передней крышки, может быть и частью задней, 
-		// если его спроецировать вперед и обойти вершины в обратном порядке
-		ShadowVolumeBackCapPolygon(lightPositionLoc);
+			// Тот же полигон, который является частью передней крышки, может быть и частью задней, 
+			// если его спроецировать вперед и обойти вершины в обратном порядке
+			ShadowVolumeBackCapPolygon(lightPositionLoc, vec3(0.6f,0.6f,0.6f));
+		}
 	}
 
 	EndPrimitive();
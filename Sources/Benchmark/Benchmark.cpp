@@ -0,0 +1,435 @@
+﻿#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+
+#include "../Engine/RendererOgl/Context.h"
+#include "../Engine/RendererOgl/Renderer.h"
+#include "../Engine/RendererOgl/Profiler.h"
+#include "../Engine/RendererOgl/GpuMemory.h"
+#include "../Engine/RendererOgl/FrameReplayer.h"
+#include "../Engine/RendererOgl/FrameCapture.h"
+
+#include "SceneGenerator.h"
+#include "BenchmarkReport.h"
+
+#define BENCHMARK_CAPTURE_BUDGET 0.05f
+
+/**
+ * \brief Параметры запуска замера
+ */
+struct BenchmarkOptions
+{
+	SceneSettings scene;                   // Параметры сцены
+	GLuint width;                          // Ширина кадра
+	GLuint height;                         // Высота кадра
+	GLuint frames;                         // Кол-во измеряемых кадров (полный облет камеры)
+	GLuint warmupFrames;                   // Кол-во кадров прогрева (не измеряются)
+	ogl::ShadowTechnique shadowTechnique;  // Способ построения теней
+	std::string shadersDir;                // Каталог с шейдерами
+	std::string csvPath;                   // Файл замеров по кадрам (пусто - не сохранять)
+	std::string jsonPath;                  // Файл сводки (пусто - не сохранять)
+	std::string baselinePath;              // Файл базовой сводки (пусто - не сравнивать)
+	std::string tracePath;                 // Файл трассы профилировщика (пусто - профилировщик выключен)
+	GLfloat tolerance;                     // Допустимое ухудшение относительно базовой сводки (доля)
+	bool hud;                              // Рисовать панель производительности (ее стоимость видна в проходе "hud")
+	GLuint64 budget;                       // Бюджет памяти GPU (байт, 0 - не ограничен)
+	std::string replayPath;                // Файл записанного сеанса (пусто - сгенерированная сцена и облет камеры)
+	bool paced;                            // Воспроизводить сеанс в темпе записи
+	std::string capturePrefix;             // Начало пути PNG файлов измеряемых кадров (пусто - кадры не сохраняются)
+};
+
+/**
+ * \brief Вывести справку по параметрам запуска
+ */
+void PrintUsage()
+{
+	std::cout <<
+		"Usage: Benchmark [options]\n"
+		"  --meshes N          objects in the scene (64)\n"
+		"  --point N           point lights (4)\n"
+		"  --spot N            spot lights (2)\n"
+		"  --directional N     directional lights (1)\n"
+		"  --shadowed N        lights casting shadows (3)\n"
+		"  --density N         sphere segments / ground cells per side (32)\n"
+		"  --diffuse F         share of objects with diffuse maps, 0..1 (1.0)\n"
+		"  --specular F        share of objects with specular maps (0.5)\n"
+		"  --bump F            share of objects with bump maps (0.5)\n"
+		"  --displacement F    share of objects with displacement maps (0.25)\n"
+		"  --seed N            scene generator seed (1)\n"
+		"  --shadows T         volumes | maps | atlas (atlas)\n"
+		"  --size WxH          frame size (1280x720)\n"
+		"  --frames N          measured frames, one camera orbit (600)\n"
+		"  --warmup N          frames rendered before measuring (60)\n"
+		"  --shaders DIR       shader directory (../Shaders/)\n"
+		"  --csv FILE          per-frame and per-pass timings\n"
+		"  --json FILE         summary\n"
+		"  --baseline FILE     summary to compare with (exit code 2 on regression)\n"
+		"  --tolerance F       allowed regression against baseline (0.1)\n"
+		"  --trace FILE        profiler zones of the last frames in Chrome trace format\n"
+		"  --hud N             draw the performance HUD, 0 or 1 (0)\n"
+		"  --budget N          GPU memory budget in MB, 0 - unlimited (0)\n"
+		"  --replay FILE       replay a recorded session instead of the generated scene\n"
+		"  --paced N           replay at the recorded frame times, 0 or 1 (0)\n"
+		"  --capture PREFIX    save every measured frame as PREFIX000000.png\n"
+		"                      (exit code 3 if capture costs over 5% of the mean frame time)\n";
+}
+
+/**
+ * \brief Разбор параметров запуска
+ * \param argc Кол-во аргументов
+ * \param argv Аргументы
+ * \param options Параметры (заполняются)
+ * \return Удалось ли разобрать параметры
+ */
+bool ParseOptions(int argc, char* argv[], BenchmarkOptions& options)
+{
+	options.scene = { 64, 4, 2, 1, 3, 32, 1.0f, 0.5f, 0.5f, 0.25f, 8.0f, 1 };
+	options.width = 1280;
+	options.height = 720;
+	options.frames = 600;
+	options.warmupFrames = 60;
+	options.shadowTechnique = ogl::ShadowTechnique::SHADOW_ATLAS;
+	options.shadersDir = "../Shaders/";
+	options.tolerance = 0.1f;
+	options.hud = false;
+	options.budget = 0;
+	options.paced = false;
+
+	for (int i = 1; i < argc; i++)
+	{
+		std::string name = argv[i];
+		if (name == "--help" || name == "-h") return false;
+
+		if (i + 1 >= argc) {
+			std::cout << "Missing value for " << name << std::endl;
+			return false;
+		}
+
+		const char* value = argv[++i];
+		GLuint number = static_cast<GLuint>(strtoul(value, nullptr, 10));
+		GLfloat share = static_cast<GLfloat>(strtod(value, nullptr));
+
+		if (name == "--meshes") options.scene.meshCount = number;
+		else if (name == "--point") options.scene.pointLights = number;
+		else if (name == "--spot") options.scene.spotLights = number;
+		else if (name == "--directional") options.scene.directionalLights = number;
+		else if (name == "--shadowed") options.scene.shadowedLights = number;
+		else if (name == "--density") options.scene.triangleDensity = number;
+		else if (name == "--diffuse") options.scene.diffuseShare = share;
+		else if (name == "--specular") options.scene.specularShare = share;
+		else if (name == "--bump") options.scene.bumpShare = share;
+		else if (name == "--displacement") options.scene.displacementShare = share;
+		else if (name == "--seed") options.scene.seed = number;
+		else if (name == "--frames") options.frames = glm::max(number, 1u);
+		else if (name == "--warmup") options.warmupFrames = number;
+		else if (name == "--shaders") options.shadersDir = value;
+		else if (name == "--csv") options.csvPath = value;
+		else if (name == "--json") options.jsonPath = value;
+		else if (name == "--baseline") options.baselinePath = value;
+		else if (name == "--tolerance") options.tolerance = share;
+		else if (name == "--trace") options.tracePath = value;
+		else if (name == "--hud") options.hud = number != 0;
+		else if (name == "--budget") options.budget = static_cast<GLuint64>(number) * 1024 * 1024;
+		else if (name == "--replay") options.replayPath = value;
+		else if (name == "--paced") options.paced = number != 0;
+		else if (name == "--capture") options.capturePrefix = value;
+		else if (name == "--size") {
+			const char* separator = strchr(value, 'x');
+			if (separator == nullptr) return false;
+			options.width = static_cast<GLuint>(strtoul(value, nullptr, 10));
+			options.height = static_cast<GLuint>(strtoul(separator + 1, nullptr, 10));
+		}
+		else if (name == "--shadows") {
+			std::string technique = value;
+			if (technique == "volumes") options.shadowTechnique = ogl::ShadowTechnique::STENCIL_VOLUMES;
+			else if (technique == "maps") options.shadowTechnique = ogl::ShadowTechnique::SHADOW_MAPS;
+			else if (technique == "atlas") options.shadowTechnique = ogl::ShadowTechnique::SHADOW_ATLAS;
+			else return false;
+		}
+		else {
+			std::cout << "Unknown option " << name << std::endl;
+			return false;
+		}
+	}
+
+	return options.width > 0 && options.height > 0;
+}
+
+/**
+ * \brief Загрузка текстового файла в строку
+ * \param path Путь к файлу
+ * \return Строка с содержимым файла
+ */
+std::string LoadText(const std::string& path)
+{
+	std::ifstream file(path);
+	if (file.fail()) {
+		throw std::runtime_error("Benchmark: Can't read file " + path);
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	return stream.str();
+}
+
+/**
+ * \brief Создание контекста без видимого окна
+ * \param width Ширина кадра
+ * \param height Высота кадра
+ * \return Умный указатель на контекст
+ */
+ogl::ContextPtr CreateBenchmarkContext(GLuint width, GLuint height)
+{
+#ifdef OGL_EGL
+	return ogl::MakeHeadlessContext(width, height);
+#else
+	// Без EGL - контекст скрытого окна (не показывается), размер клиентской области - размер кадра
+	// Буфер невидимого окна не определен, поэтому кадр выводится во внеэкранный буфер контекста
+	HINSTANCE hInstance = GetModuleHandle(nullptr);
+
+	WNDCLASSEX classInfo = {};
+	classInfo.cbSize = sizeof(WNDCLASSEX);
+	classInfo.style = CS_OWNDC;
+	classInfo.hInstance = hInstance;
+	classInfo.lpszClassName = L"BenchmarkWndClass";
+	classInfo.lpfnWndProc = DefWindowProc;
+
+	if (!RegisterClassEx(&classInfo)) {
+		throw std::runtime_error("Benchmark: Can't register window class");
+	}
+
+	RECT rect = { 0, 0, static_cast<LONG>(width), static_cast<LONG>(height) };
+	AdjustWindowRect(&rect, WS_OVERLAPPEDWINDOW, FALSE);
+
+	HWND hWnd = CreateWindow(classInfo.lpszClassName, L"Benchmark", WS_OVERLAPPEDWINDOW, 0, 0,
+		rect.right - rect.left, rect.bottom - rect.top, nullptr, nullptr, hInstance, nullptr);
+
+	if (!hWnd) {
+		throw std::runtime_error("Benchmark: Can't create window");
+	}
+
+	return ogl::MakeWindowContext(hWnd, true);
+#endif
+}
+
+/**
+ * \brief Точка входа
+ * \param argc Кол-во аргументов запуска
+ * \param argv Аргументы запуска (строки)
+ * \return Код завершения (0 - успех, 1 - ошибка, 2 - ухудшение относительно базовой сводки, 3 - захват кадров превысил бюджет)
+ */
+int main(int argc, char* argv[])
+{
+	BenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		PrintUsage();
+		return 1;
+	}
+
+	try
+	{
+		// Бюджет памяти GPU (при превышении замер завершается ошибкой)
+		ogl::GpuMemory::get().setBudget(options.budget);
+
+		// Записанный сеанс задает размер кадра и кол-во кадров (прогрев не выполняется - кадры сеанса не повторяются)
+		std::shared_ptr<ogl::FrameReplayer> replayer;
+		if (!options.replayPath.empty()) {
+			replayer = std::make_shared<ogl::FrameReplayer>(options.replayPath);
+			options.width = replayer->getWidth();
+			options.height = replayer->getHeight();
+			options.frames = glm::max(replayer->getFrameCount(), 1u);
+			options.warmupFrames = 0;
+		}
+
+		// Контекст без окна и без вертикальной синхронизации
+		ogl::ContextPtr context = CreateBenchmarkContext(options.width, options.height);
+		context->setVSync(false);
+
+		// Шейдеры
+		std::vector<ogl::ShaderResourcePtr> shaders = ogl::MakeShaderResources({
+			LoadText(options.shadersDir + "geometry.glsl"),
+			LoadText(options.shadersDir + "lighting.glsl"),
+			LoadText(options.shadersDir + "post.glsl"),
+			LoadText(options.shadersDir + "shadows.glsl")
+		});
+
+		for (const ogl::ShaderResourcePtr& shader : shaders) {
+			shader->wait();
+		}
+
+		// Рендерер и сцена (рендерер удаляется раньше контекста)
+		BenchmarkReport report;
+		GLfloat captureShare = 0.0f;
+		{
+			ogl::Renderer renderer(context, shaders[0], shaders[1], shaders[2], shaders[3]);
+			renderer.shadowTechnique = options.shadowTechnique;
+			renderer.passProfiling = true;
+			renderer.showHud = options.hud;
+
+			SceneGenerator generator(options.scene);
+			if (replayer) {
+				std::cout << "Replay: " << options.replayPath << ", " << replayer->getFrameCount() << " frames, "
+					<< options.width << "x" << options.height << (options.paced ? ", paced" : "") << std::endl;
+			}
+			else {
+				generator.generate(&renderer);
+
+				std::cout << "Scene: " << options.scene.meshCount << " meshes, "
+					<< renderer.getLights().size() << " lights, "
+					<< generator.getTriangleCount() << " triangles, "
+					<< options.width << "x" << options.height << std::endl;
+			}
+
+			// Прогрев (сборка вариантов шейдеров, размещение текстур графа, кеши теней)
+			for (GLuint i = 0; i < options.warmupFrames; i++) {
+				generator.placeCamera(&renderer, 0, options.frames);
+				renderer.drawFrame();
+			}
+
+			// Счетчики рендерера усредняются по всем измеряемым кадрам
+			renderer.setRenderStatsFrames(options.frames);
+
+			// Захват кадров (чтение через кольцо буферов, PNG кодируются в других потоках - стоимость входит во время кадра)
+			ogl::FrameCapturePtr capture = options.capturePrefix.empty() ? nullptr : ogl::MakeFrameCapture(options.width, options.height, options.capturePrefix);
+
+			// Результаты GPU приходят с задержкой в несколько кадров - они сохраняются по номеру кадра профилировщика
+			// и сопоставляются с замерами кадров после цикла
+			std::vector<FrameSample> samples;
+			std::vector<unsigned long long> sampleFrames;
+			std::map<unsigned long long, ogl::ProfilerFrameResult> gpuFrames;
+			auto collectGpuFrames = [&gpuFrames]() {
+				for (const ogl::ProfilerFrameResult& frame : ogl::Profiler::get().getResolvedFrames()) {
+					gpuFrames[frame.index] = frame;
+				}
+			};
+
+			// Замер - облет камеры по фиксированному пути
+			auto previousEnd = std::chrono::high_resolution_clock::now();
+			for (GLuint i = 0; i < options.frames; i++)
+			{
+				// Сеанс применяет записанные изменения сцены и рисует кадр (в темпе записи время CPU включает ожидание)
+				auto start = std::chrono::high_resolution_clock::now();
+				if (replayer) {
+					if (!replayer->nextFrame(&renderer, options.paced)) break;
+				}
+				else {
+					generator.placeCamera(&renderer, i, options.frames);
+					start = std::chrono::high_resolution_clock::now();
+					renderer.drawFrame();
+				}
+
+				if (capture) capture->capture(context->getFrameBufferId(), i);
+				auto end = std::chrono::high_resolution_clock::now();
+
+				FrameSample sample = {};
+				sample.frameTime = std::chrono::duration<GLfloat, std::milli>(end - previousEnd).count();
+				sample.cpuTime = std::chrono::duration<GLfloat, std::milli>(end - start).count();
+				samples.push_back(sample);
+				sampleFrames.push_back(ogl::Profiler::get().getFrameIndex());
+				collectGpuFrames();
+
+				previousEnd = end;
+			}
+
+			// Дождаться результатов последних кадров и дополнить замеры временем GPU того же кадра
+			ogl::Profiler::get().flush();
+			collectGpuFrames();
+
+			for (size_t i = 0; i < samples.size(); i++)
+			{
+				auto gpuFrame = gpuFrames.find(sampleFrames[i]);
+				if (gpuFrame != gpuFrames.end()) {
+					samples[i].gpuTime = ogl::RenderGraphGpuTime(gpuFrame->second);
+					samples[i].passes = ogl::RenderGraphPassTimings(gpuFrame->second);
+				}
+
+				report.addFrame(samples[i]);
+			}
+
+			// Запись оставшихся кадров (вне замера)
+			// Стоимость захвата на потоке рендеринга - доля среднего времени кадра (бюджет BENCHMARK_CAPTURE_BUDGET)
+			if (capture)
+			{
+				capture->flush();
+				ogl::FrameCaptureStats captureStats = capture->getStats();
+				GLfloat captureTime = captureStats.captureTime / glm::max(captureStats.framesCaptured, 1u);
+				captureShare = captureTime / glm::max(report.getFrameTime().mean, 0.001f);
+				std::cout << "Capture: " << captureStats.framesWritten << " frames written, "
+					<< captureStats.framesFailed << " failed, "
+					<< captureTime << " ms per frame on the render thread ("
+					<< captureShare * 100.0f << "% of mean frame time, budget " << BENCHMARK_CAPTURE_BUDGET * 100.0f << "%), "
+					<< captureStats.readbackStalls << " readback stalls, "
+					<< captureStats.encoderStalls << " encoder stalls" << std::endl;
+			}
+
+			// Средние счетчики кадра (много вызовов и привязок при низком времени GPU - упор в отправку команд)
+			ogl::RenderStats stats = renderer.getRenderStatsAverage();
+			std::cout << "Per frame: " << ogl::RenderStatsTotalDrawCalls(stats) << " draw calls, "
+				<< ogl::RenderStatsTotalTriangles(stats) << " triangles, "
+				<< stats.programBinds << " program binds, "
+				<< stats.vaoBinds << " VAO binds, "
+				<< stats.textureBinds << " texture binds, "
+				<< stats.uniformUploads << " uniform uploads, "
+				<< stats.frameBufferBinds << " framebuffer binds, "
+				<< stats.bytesUploaded << " bytes uploaded" << std::endl;
+
+			// Память GPU по категориям (текущий объем и максимум с начала работы)
+			const char* memoryCategories[GPU_MEMORY_CATEGORY_COUNT] = { "geometry", "textures", "cubemaps", "render targets", "shadow maps", "dynamic buffers" };
+			ogl::GpuMemoryStats memory = ogl::GpuMemory::get().getStats();
+			std::cout << "GPU memory: " << memory.totalBytes / 1024 << " KB (peak " << memory.totalPeakBytes / 1024 << " KB)" << std::endl;
+			for (GLuint i = 0; i < GPU_MEMORY_CATEGORY_COUNT; i++) {
+				std::cout << "  " << memoryCategories[i] << ": " << memory.bytes[i] / 1024 << " KB (peak " << memory.peakBytes[i] / 1024
+					<< " KB), " << memory.allocations[i] << " allocations" << std::endl;
+			}
+
+			// Статистика зон и трасса
+			if (!options.tracePath.empty())
+			{
+				for (const ogl::ProfilerZoneStats& zone : ogl::Profiler::get().getZoneStats()) {
+					std::cout << std::string(zone.depth * 2, ' ') << zone.name << ": cpu " << zone.cpuAverage << " ms (max " << zone.cpuMax
+						<< "), gpu " << zone.gpuAverage << " ms (max " << zone.gpuMax << "), x" << zone.samples << std::endl;
+				}
+
+				ogl::Profiler::get().writeChromeTrace(options.tracePath);
+			}
+		}
+
+		// Результат
+		TimePercentiles frame = report.getFrameTime();
+		TimePercentiles gpu = report.getGpuTime();
+		std::cout << "Frame ms: p50 " << frame.p50 << ", p95 " << frame.p95 << ", p99 " << frame.p99 << std::endl;
+		std::cout << "GPU ms:   p50 " << gpu.p50 << ", p95 " << gpu.p95 << ", p99 " << gpu.p99 << std::endl;
+
+		if (!options.csvPath.empty()) report.writeCsv(options.csvPath);
+		if (!options.jsonPath.empty()) report.writeJson(options.jsonPath, options.scene, options.width, options.height);
+
+		// Захват кадров дороже бюджета - замер с захватом не отражает производительность без него
+		if (captureShare > BENCHMARK_CAPTURE_BUDGET) {
+			std::cout << "Capture cost " << captureShare * 100.0f << "% of mean frame time exceeds the "
+				<< BENCHMARK_CAPTURE_BUDGET * 100.0f << "% budget" << std::endl;
+			return 3;
+		}
+
+		// Сравнение с базовой сводкой
+		if (!options.baselinePath.empty())
+		{
+			std::string message;
+			if (report.isRegressed(options.baselinePath, options.tolerance, message)) {
+				std::cout << "Regression against " << options.baselinePath << ":\n" << message;
+				return 2;
+			}
+		}
+
+		return 0;
+	}
+	catch (std::exception const &ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return 1;
+	}
+}
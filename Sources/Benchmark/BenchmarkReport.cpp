@@ -0,0 +1,246 @@
+﻿#include "BenchmarkReport.h"
+
+#include <algorithm>
+#include <stdexcept>
+#include <fstream>
+#include <sstream>
+#include <map>
+#include <cstring>
+#include <cstdlib>
+
+/**
+* \brief Найти число в сводке JSON
+* \param json Текст сводки
+* \param section Название раздела
+* \param key Название поля раздела
+* \param value Значение (если найдено)
+* \return Найдено ли поле
+* \details Разбор рассчитан только на формат writeJson (разделы без вложенных объектов)
+*/
+static bool FindJsonNumber(const std::string& json, const std::string& section, const std::string& key, GLfloat& value)
+{
+	size_t sectionPos = json.find("\"" + section + "\"");
+	if (sectionPos == std::string::npos) return false;
+
+	size_t sectionEnd = json.find('}', sectionPos);
+	size_t keyPos = json.find("\"" + key + "\"", sectionPos);
+	if (keyPos == std::string::npos || keyPos > sectionEnd) return false;
+
+	size_t colon = json.find(':', keyPos);
+	if (colon == std::string::npos) return false;
+
+	value = static_cast<GLfloat>(strtod(json.c_str() + colon + 1, nullptr));
+	return true;
+}
+
+/**
+* \brief Процентили выборки
+* \param values Выборка
+* \return Процентили (нули, если выборка пуста)
+*/
+TimePercentiles BenchmarkReport::GetPercentiles(std::vector<GLfloat> values)
+{
+	TimePercentiles result = {};
+	if (values.empty()) return result;
+
+	std::sort(values.begin(), values.end());
+
+	// Метод ближайшего ранга
+	auto percentile = [&values](GLfloat p) {
+		size_t rank = static_cast<size_t>(p * static_cast<GLfloat>(values.size()) + 0.999f);
+		return values[std::min(std::max(rank, static_cast<size_t>(1)), values.size()) - 1];
+	};
+
+	result.p50 = percentile(0.50f);
+	result.p95 = percentile(0.95f);
+	result.p99 = percentile(0.99f);
+
+	double sum = 0.0;
+	for (GLfloat value : values) sum += value;
+	result.mean = static_cast<GLfloat>(sum / static_cast<double>(values.size()));
+
+	return result;
+}
+
+/**
+* \brief Добавить замер кадра
+* \param sample Замер
+*/
+void BenchmarkReport::addFrame(const FrameSample& sample)
+{
+	this->frames_.push_back(sample);
+}
+
+/**
+* \brief Процентили времени кадра
+* \return Процентили
+*/
+TimePercentiles BenchmarkReport::getFrameTime() const
+{
+	std::vector<GLfloat> values;
+	for (const FrameSample& frame : this->frames_) values.push_back(frame.frameTime);
+	return GetPercentiles(values);
+}
+
+/**
+* \brief Процентили времени на CPU
+* \return Процентили
+*/
+TimePercentiles BenchmarkReport::getCpuTime() const
+{
+	std::vector<GLfloat> values;
+	for (const FrameSample& frame : this->frames_) values.push_back(frame.cpuTime);
+	return GetPercentiles(values);
+}
+
+/**
+* \brief Процентили времени на GPU (кадры без замера не учитываются)
+* \return Процентили
+*/
+TimePercentiles BenchmarkReport::getGpuTime() const
+{
+	std::vector<GLfloat> values;
+	for (const FrameSample& frame : this->frames_) {
+		if (frame.gpuTime > 0.0f) values.push_back(frame.gpuTime);
+	}
+	return GetPercentiles(values);
+}
+
+/**
+* \brief Сохранить замеры кадров и проходов в CSV
+* \param path Путь к файлу
+* \details Строка на кадр (pass = frame) и строка на каждый проход кадра
+*/
+void BenchmarkReport::writeCsv(const std::string& path) const
+{
+	std::ofstream file(path);
+	if (file.fail()) {
+		throw std::runtime_error("Benchmark: Can't write file " + path);
+	}
+
+	file << "frame,pass,frame_ms,cpu_ms,gpu_ms\n";
+	for (size_t i = 0; i < this->frames_.size(); i++)
+	{
+		const FrameSample& frame = this->frames_[i];
+		file << i << ",frame," << frame.frameTime << "," << frame.cpuTime << "," << frame.gpuTime << "\n";
+
+		for (const ogl::RenderGraphPassTiming& pass : frame.passes) {
+			file << i << "," << pass.name << ",," << pass.cpuTime << "," << pass.gpuTime << "\n";
+		}
+	}
+}
+
+/**
+* \brief Сохранить сводку в JSON
+* \param path Путь к файлу
+* \param scene Параметры сцены
+* \param width Ширина кадра
+* \param height Высота кадра
+*/
+void BenchmarkReport::writeJson(const std::string& path, const SceneSettings& scene, GLuint width, GLuint height) const
+{
+	std::ofstream file(path);
+	if (file.fail()) {
+		throw std::runtime_error("Benchmark: Can't write file " + path);
+	}
+
+	auto writePercentiles = [&file](const char* name, const TimePercentiles& p) {
+		file << "  \"" << name << "\": { \"p50\": " << p.p50 << ", \"p95\": " << p.p95 << ", \"p99\": " << p.p99 << ", \"mean\": " << p.mean << " },\n";
+	};
+
+	file << "{\n";
+	file << "  \"scene\": { \"meshes\": " << scene.meshCount
+		<< ", \"pointLights\": " << scene.pointLights
+		<< ", \"spotLights\": " << scene.spotLights
+		<< ", \"directionalLights\": " << scene.directionalLights
+		<< ", \"shadowedLights\": " << scene.shadowedLights
+		<< ", \"density\": " << scene.triangleDensity
+		<< ", \"diffuse\": " << scene.diffuseShare
+		<< ", \"specular\": " << scene.specularShare
+		<< ", \"bump\": " << scene.bumpShare
+		<< ", \"displacement\": " << scene.displacementShare
+		<< ", \"seed\": " << scene.seed << " },\n";
+	file << "  \"output\": { \"width\": " << width << ", \"height\": " << height << ", \"frames\": " << this->frames_.size() << " },\n";
+
+	writePercentiles("frame", this->getFrameTime());
+	writePercentiles("cpu", this->getCpuTime());
+	writePercentiles("gpu", this->getGpuTime());
+
+	// Среднее время проходов (по кадрам, в которых проход выполнялся), порядок - порядок первого появления
+	std::vector<std::string> order;
+	std::map<std::string, std::vector<GLfloat>> cpuTimes;
+	std::map<std::string, std::vector<GLfloat>> gpuTimes;
+
+	for (const FrameSample& frame : this->frames_)
+	{
+		for (const ogl::RenderGraphPassTiming& pass : frame.passes)
+		{
+			if (cpuTimes.find(pass.name) == cpuTimes.end()) order.push_back(pass.name);
+			cpuTimes[pass.name].push_back(pass.cpuTime);
+			gpuTimes[pass.name].push_back(pass.gpuTime);
+		}
+	}
+
+	file << "  \"passes\": [\n";
+	for (size_t i = 0; i < order.size(); i++)
+	{
+		TimePercentiles cpu = GetPercentiles(cpuTimes[order[i]]);
+		TimePercentiles gpu = GetPercentiles(gpuTimes[order[i]]);
+		file << "    { \"name\": \"" << order[i] << "\", \"samples\": " << cpuTimes[order[i]].size()
+			<< ", \"cpu\": " << cpu.mean << ", \"gpu\": " << gpu.mean
+			<< ", \"gpuP95\": " << gpu.p95 << " }" << (i + 1 < order.size() ? "," : "") << "\n";
+	}
+	file << "  ]\n";
+	file << "}\n";
+}
+
+/**
+* \brief Сравнить со сводкой, сохраненной ранее (writeJson)
+* \param path Путь к файлу базовой сводки
+* \param tolerance Допустимое ухудшение (доля, 0.1 - на 10%)
+* \param message Описание ухудшений (заполняется, если они есть)
+* \return Есть ли ухудшение сверх допустимого
+*/
+bool BenchmarkReport::isRegressed(const std::string& path, GLfloat tolerance, std::string& message) const
+{
+	std::ifstream file(path);
+	if (file.fail()) {
+		throw std::runtime_error("Benchmark: Can't read baseline " + path);
+	}
+
+	std::stringstream stream;
+	stream << file.rdbuf();
+	std::string json = stream.str();
+
+	std::stringstream report;
+	bool regressed = false;
+
+	// Сравниваются процентили времени кадра и GPU (время CPU зависит от загрузки машины и только сохраняется)
+	const std::pair<const char*, TimePercentiles> sections[] = {
+		{ "frame", this->getFrameTime() },
+		{ "gpu", this->getGpuTime() }
+	};
+
+	for (const auto& section : sections)
+	{
+		const std::pair<const char*, GLfloat> keys[] = {
+			{ "p50", section.second.p50 },
+			{ "p95", section.second.p95 },
+			{ "p99", section.second.p99 }
+		};
+
+		for (const auto& key : keys)
+		{
+			GLfloat baseline = 0.0f;
+			if (!FindJsonNumber(json, section.first, key.first, baseline) || baseline <= 0.0f) continue;
+
+			if (key.second > baseline * (1.0f + tolerance)) {
+				report << section.first << "." << key.first << ": " << key.second << " ms (baseline " << baseline << " ms)\n";
+				regressed = true;
+			}
+		}
+	}
+
+	message = report.str();
+	return regressed;
+}
@@ -0,0 +1,96 @@
+﻿#pragma once
+
+#include <vector>
+#include <string>
+
+#include "SceneGenerator.h"
+
+/**
+ * \brief Процентили выборки времени
+ */
+struct TimePercentiles
+{
+	GLfloat p50;    // Медиана (мс)
+	GLfloat p95;    // 95-й процентиль (мс)
+	GLfloat p99;    // 99-й процентиль (мс)
+	GLfloat mean;   // Среднее (мс)
+};
+
+/**
+ * \brief Замер одного кадра
+ */
+struct FrameSample
+{
+	GLfloat frameTime;  // Время между окончаниями соседних кадров (мс)
+	GLfloat cpuTime;    // Время вызова drawFrame (мс)
+	GLfloat gpuTime;    // Время выполнения кадра на GPU (мс, 0 - результат не получен)
+	std::vector<ogl::RenderGraphPassTiming> passes; // Время проходов этого же кадра
+};
+
+/**
+ * \brief Результат замеров производительности
+ * \details Накапливает замеры кадров, считает процентили, сохраняет результат в CSV (по кадрам и проходам)
+ * и JSON (сводка), сравнивает сводку с базовой
+ */
+class BenchmarkReport
+{
+private:
+	std::vector<FrameSample> frames_;   // Замеры кадров
+
+	/**
+	 * \brief Процентили выборки
+	 * \param values Выборка
+	 * \return Процентили (нули, если выборка пуста)
+	 */
+	static TimePercentiles GetPercentiles(std::vector<GLfloat> values);
+
+public:
+	/**
+	 * \brief Добавить замер кадра
+	 * \param sample Замер
+	 */
+	void addFrame(const FrameSample& sample);
+
+	/**
+	 * \brief Процентили времени кадра
+	 * \return Процентили
+	 */
+	TimePercentiles getFrameTime() const;
+
+	/**
+	 * \brief Процентили времени на CPU
+	 * \return Процентили
+	 */
+	TimePercentiles getCpuTime() const;
+
+	/**
+	 * \brief Процентили времени на GPU (кадры без замера не учитываются)
+	 * \return Процентили
+	 */
+	TimePercentiles getGpuTime() const;
+
+	/**
+	 * \brief Сохранить замеры кадров и проходов в CSV
+	 * \param path Путь к файлу
+	 * \details Строка на кадр (pass = frame) и строка на каждый проход кадра
+	 */
+	void writeCsv(const std::string& path) const;
+
+	/**
+	 * \brief Сохранить сводку в JSON
+	 * \param path Путь к файлу
+	 * \param scene Параметры сцены
+	 * \param width Ширина кадра
+	 * \param height Высота кадра
+	 */
+	void writeJson(const std::string& path, const SceneSettings& scene, GLuint width, GLuint height) const;
+
+	/**
+	 * \brief Сравнить со сводкой, сохраненной ранее (writeJson)
+	 * \param path Путь к файлу базовой сводки
+	 * \param tolerance Допустимое ухудшение (доля, 0.1 - на 10%)
+	 * \param message Описание ухудшений (заполняется, если они есть)
+	 * \return Есть ли ухудшение сверх допустимого
+	 */
+	bool isRegressed(const std::string& path, GLfloat tolerance, std::string& message) const;
+};
@@ -0,0 +1,267 @@
+﻿#include "SceneGenerator.h"
+
+#include <glm/gtc/matrix_transform.hpp>
+#include <glm/gtc/constants.hpp>
+
+#include "../Engine/RendererOgl/Defaults.h"
+
+/**
+* \brief Конструктор
+* \param settings Параметры сцены
+*/
+SceneGenerator::SceneGenerator(const SceneSettings& settings) :
+	settings_(settings),
+	random_(settings.seed)
+{
+	this->settings_.triangleDensity = glm::max(this->settings_.triangleDensity, 4u);
+}
+
+/**
+* \brief Случайное число в диапазоне
+* \param min Минимум
+* \param max Максимум
+* \return Число
+*/
+GLfloat SceneGenerator::random(GLfloat min, GLfloat max)
+{
+	// Преобразование выполняется вручную - распределения стандартной библиотеки не одинаковы на разных платформах
+	GLfloat unit = static_cast<GLfloat>(this->random_() % 1000000u) / 1000000.0f;
+	return min + (max - min) * unit;
+}
+
+/**
+* \brief Создать геометрию сферы
+* \param segments Кол-во сегментов по долготе (по широте - вдвое меньше)
+* \return Ресурс геометрии
+*/
+ogl::StaticGeometryResourcePtr SceneGenerator::MakeSphere(GLuint segments)
+{
+	GLuint rings = segments / 2;
+	std::vector<ogl::Vertex> vertices;
+	std::vector<GLuint> indices;
+
+	for (GLuint ring = 0; ring <= rings; ring++)
+	{
+		GLfloat theta = glm::pi<GLfloat>() * static_cast<GLfloat>(ring) / static_cast<GLfloat>(rings);
+		for (GLuint segment = 0; segment <= segments; segment++)
+		{
+			GLfloat phi = glm::two_pi<GLfloat>() * static_cast<GLfloat>(segment) / static_cast<GLfloat>(segments);
+			glm::vec3 position = { glm::sin(theta) * glm::cos(phi), glm::cos(theta), glm::sin(theta) * glm::sin(phi) };
+			glm::vec2 uv = { static_cast<GLfloat>(segment) / static_cast<GLfloat>(segments), 1.0f - static_cast<GLfloat>(ring) / static_cast<GLfloat>(rings) };
+			vertices.push_back({ position, { 1.0f,1.0f,1.0f }, uv, position, {}, 0 });
+		}
+	}
+
+	for (GLuint ring = 0; ring < rings; ring++)
+	{
+		for (GLuint segment = 0; segment < segments; segment++)
+		{
+			GLuint current = ring * (segments + 1) + segment;
+			GLuint below = current + segments + 1;
+			indices.insert(indices.end(), { current, current + 1, below, current + 1, below + 1, below });
+		}
+	}
+
+	// Нормали заданы, тангенты считаются, смежность нужна теневым объемам
+	return ogl::MakeStaticGeometryResource(vertices, indices, false, false, true, true);
+}
+
+/**
+* \brief Создать геометрию пола (квадратная сетка)
+* \param size Половина стороны
+* \param cells Кол-во ячеек по стороне
+* \return Ресурс геометрии
+*/
+ogl::StaticGeometryResourcePtr SceneGenerator::MakeGround(GLfloat size, GLuint cells)
+{
+	std::vector<ogl::Vertex> vertices;
+	std::vector<GLuint> indices;
+
+	for (GLuint z = 0; z <= cells; z++)
+	{
+		for (GLuint x = 0; x <= cells; x++)
+		{
+			glm::vec2 uv = { static_cast<GLfloat>(x) / static_cast<GLfloat>(cells), static_cast<GLfloat>(z) / static_cast<GLfloat>(cells) };
+			glm::vec3 position = { (uv.x * 2.0f - 1.0f) * size, 0.0f, (1.0f - uv.y * 2.0f) * size };
+			vertices.push_back({ position, { 1.0f,1.0f,1.0f }, uv, { 0.0f,1.0f,0.0f }, {}, 0 });
+		}
+	}
+
+	for (GLuint z = 0; z < cells; z++)
+	{
+		for (GLuint x = 0; x < cells; x++)
+		{
+			GLuint current = z * (cells + 1) + x;
+			GLuint next = current + cells + 1;
+			indices.insert(indices.end(), { current, next + 1, current + 1, current, next, next + 1 });
+		}
+	}
+
+	return ogl::MakeStaticGeometryResource(vertices, indices, false, false, true, true);
+}
+
+/**
+* \brief Создать процедурные текстуры (шум, шахматная доска, волны)
+*/
+void SceneGenerator::makeTextures()
+{
+	const GLuint size = 256;
+	std::vector<unsigned char> diffuse(size * size * 3);
+	std::vector<unsigned char> specular(size * size * 3);
+	std::vector<unsigned char> bump(size * size * 3);
+	std::vector<unsigned char> displacement(size * size * 3);
+
+	for (GLuint y = 0; y < size; y++)
+	{
+		for (GLuint x = 0; x < size; x++)
+		{
+			size_t i = (y * size + x) * 3;
+
+			// Шахматная доска с шумом
+			bool odd = ((x / 32) + (y / 32)) % 2 == 1;
+			GLfloat noise = this->random(0.85f, 1.0f);
+			diffuse[i + 0] = static_cast<unsigned char>((odd ? 200.0f : 90.0f) * noise);
+			diffuse[i + 1] = static_cast<unsigned char>((odd ? 180.0f : 110.0f) * noise);
+			diffuse[i + 2] = static_cast<unsigned char>((odd ? 160.0f : 130.0f) * noise);
+
+			// Блеск - шум
+			unsigned char shine = static_cast<unsigned char>(this->random(0.0f, 255.0f));
+			specular[i + 0] = specular[i + 1] = specular[i + 2] = shine;
+
+			// Высоты - волны, нормали - производные волн
+			GLfloat u = glm::two_pi<GLfloat>() * static_cast<GLfloat>(x) / 64.0f;
+			GLfloat v = glm::two_pi<GLfloat>() * static_cast<GLfloat>(y) / 64.0f;
+			GLfloat height = (glm::sin(u) * glm::sin(v) + 1.0f) * 0.5f;
+			glm::vec3 normal = glm::normalize(glm::vec3(-glm::cos(u) * glm::sin(v) * 0.5f, -glm::sin(u) * glm::cos(v) * 0.5f, 1.0f));
+
+			bump[i + 0] = static_cast<unsigned char>((normal.x * 0.5f + 0.5f) * 255.0f);
+			bump[i + 1] = static_cast<unsigned char>((normal.y * 0.5f + 0.5f) * 255.0f);
+			bump[i + 2] = static_cast<unsigned char>((normal.z * 0.5f + 0.5f) * 255.0f);
+			displacement[i + 0] = displacement[i + 1] = displacement[i + 2] = static_cast<unsigned char>(height * 255.0f);
+		}
+	}
+
+	this->textures_.diffuse = ogl::MakeTextureResource(diffuse.data(), size, size, 3, true);
+	this->textures_.specular = ogl::MakeTextureResource(specular.data(), size, size, 3, true);
+	this->textures_.bump = ogl::MakeTextureResource(bump.data(), size, size, 3, true);
+	this->textures_.displacement = ogl::MakeTextureResource(displacement.data(), size, size, 3, true);
+}
+
+/**
+* \brief Создать ресурсы и добавить объекты и источники в рендерер
+* \param pRenderer Указатель на рендерер
+*/
+void SceneGenerator::generate(ogl::Renderer* pRenderer)
+{
+	const SceneSettings& s = this->settings_;
+
+	// Р Е С У Р С Ы
+
+	this->sphere_ = MakeSphere(s.triangleDensity);
+	this->ground_ = MakeGround(s.areaSize * 1.5f, s.triangleDensity);
+	this->makeTextures();
+
+	// О Б Ъ Е К Т Ы
+
+	ogl::StaticMeshPtr ground = pRenderer->addStaticMesh(ogl::StaticMesh(ogl::StaticMeshPart(this->ground_)));
+	ground->getParts()[0].diffuseTexture.resource = this->textures_.diffuse;
+	ground->getParts()[0].diffuseTexture.scale = { 8.0f, 8.0f };
+	ground->getParts()[0].material = ogl::defaults::GetMaterialSetings(ogl::defaults::DefaultMaterialType::DEFAULT);
+
+	const ogl::defaults::DefaultMaterialType materials[] = {
+		ogl::defaults::DefaultMaterialType::DEFAULT,
+		ogl::defaults::DefaultMaterialType::GOLD,
+		ogl::defaults::DefaultMaterialType::CHROME,
+		ogl::defaults::DefaultMaterialType::BRONZE,
+		ogl::defaults::DefaultMaterialType::CYAN_PLASTIC,
+		ogl::defaults::DefaultMaterialType::YELLOW_RUBBER
+	};
+
+	for (GLuint i = 0; i < s.meshCount; i++)
+	{
+		ogl::StaticMeshPtr mesh = pRenderer->addStaticMesh(ogl::StaticMesh(ogl::StaticMeshPart(this->sphere_)));
+		GLfloat scale = this->random(0.2f, 0.6f);
+		mesh->position = { this->random(-s.areaSize, s.areaSize), scale, this->random(-s.areaSize, s.areaSize) };
+		mesh->rotation = { 0.0f, this->random(0.0f, 360.0f), 0.0f };
+		mesh->scale = { scale, scale, scale };
+
+		ogl::StaticMeshPart& part = mesh->getParts()[0];
+		part.material = ogl::defaults::GetMaterialSetings(materials[this->random_() % 6]);
+
+		// Набор текстур определяется долями (случайные числа берутся всегда - набор не влияет на остальную сцену)
+		GLfloat chances[4] = { this->random(0.0f, 1.0f), this->random(0.0f, 1.0f), this->random(0.0f, 1.0f), this->random(0.0f, 1.0f) };
+		if (chances[0] < s.diffuseShare) part.diffuseTexture.resource = this->textures_.diffuse;
+		if (chances[1] < s.specularShare) part.specularTexture.resource = this->textures_.specular;
+		if (chances[2] < s.bumpShare) part.bumpTexture.resource = this->textures_.bump;
+		if (chances[3] < s.displacementShare) part.displacementTexture.resource = this->textures_.displacement;
+	}
+
+	// И С Т О Ч Н И К И  С В Е Т А
+
+	GLuint lightIndex = 0;
+
+	for (GLuint i = 0; i < s.directionalLights; i++, lightIndex++)
+	{
+		glm::vec3 rotation = { this->random(-70.0f, -30.0f), this->random(0.0f, 360.0f), 0.0f };
+		ogl::LightPtr light = pRenderer->addLight(ogl::Light(ogl::LightType::DIRECTIONAL_LIGHT, {}, rotation, { 0.6f,0.6f,0.55f }));
+		light->shadows = lightIndex < s.shadowedLights;
+	}
+
+	for (GLuint i = 0; i < s.spotLights; i++, lightIndex++)
+	{
+		glm::vec3 position = { this->random(-s.areaSize, s.areaSize), this->random(2.0f, 4.0f), this->random(-s.areaSize, s.areaSize) };
+		glm::vec3 rotation = { this->random(-90.0f, -50.0f), this->random(0.0f, 360.0f), 0.0f };
+		glm::vec3 color = { this->random(0.5f, 1.0f), this->random(0.5f, 1.0f), this->random(0.5f, 1.0f) };
+		ogl::LightPtr light = pRenderer->addLight(ogl::Light(ogl::LightType::SPOT_LIGHT, position, rotation, color));
+		light->shadows = lightIndex < s.shadowedLights;
+	}
+
+	for (GLuint i = 0; i < s.pointLights; i++, lightIndex++)
+	{
+		glm::vec3 position = { this->random(-s.areaSize, s.areaSize), this->random(0.5f, 2.5f), this->random(-s.areaSize, s.areaSize) };
+		glm::vec3 color = { this->random(0.5f, 1.0f), this->random(0.5f, 1.0f), this->random(0.5f, 1.0f) };
+		ogl::LightPtr light = pRenderer->addLight(ogl::Light(ogl::LightType::POINT_LIGHT, position, {}, color));
+		light->shadows = lightIndex < s.shadowedLights;
+	}
+}
+
+/**
+* \brief Установить камеру на пути облета
+* \param pRenderer Указатель на рендерер
+* \param frame Номер кадра
+* \param frameCount Кол-во кадров на полный облет
+*/
+void SceneGenerator::placeCamera(ogl::Renderer* pRenderer, GLuint frame, GLuint frameCount) const
+{
+	// Окружность вокруг центра сцены, высота камеры плавно меняется (разная глубина и кол-во объектов в кадре)
+	GLfloat t = static_cast<GLfloat>(frame) / static_cast<GLfloat>(glm::max(frameCount, 1u));
+	GLfloat angle = glm::two_pi<GLfloat>() * t;
+	GLfloat radius = this->settings_.areaSize * 1.3f;
+	glm::vec3 position = { glm::cos(angle) * radius, 2.0f + glm::sin(angle * 2.0f) * 1.5f, glm::sin(angle) * radius };
+
+	GLfloat aspectRatio = pRenderer->viewPort.getAspectRatio();
+	pRenderer->setProjectionMatrix(glm::perspective(glm::radians(45.0f), aspectRatio, 0.1f, 1000.0f));
+	pRenderer->setViewMatrix(glm::lookAt(position, { 0.0f, 0.0f, 0.0f }, { 0.0f, 1.0f, 0.0f }));
+	pRenderer->cameraPosition = position;
+}
+
+/**
+* \brief Получить параметры сцены
+* \return Константная ссылка на параметры
+*/
+const SceneSettings& SceneGenerator::getSettings() const
+{
+	return this->settings_;
+}
+
+/**
+* \brief Кол-во треугольников сцены (без теневых объемов и полноэкранных проходов)
+* \return Кол-во треугольников
+*/
+size_t SceneGenerator::getTriangleCount() const
+{
+	size_t density = this->settings_.triangleDensity;
+	size_t sphere = density * (density / 2) * 2;
+	size_t ground = density * density * 2;
+	return sphere * this->settings_.meshCount + ground;
+}
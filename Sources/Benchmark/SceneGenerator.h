@@ -0,0 +1,110 @@
+﻿#pragma once
+
+#include <vector>
+#include <random>
+#include <glm/glm.hpp>
+
+#include "../Engine/RendererOgl/Renderer.h"
+
+/**
+ * \brief Параметры генерируемой сцены
+ * \details Сцена полностью определяется параметрами и зерном генератора - одинаковые параметры дают одинаковую сцену
+ */
+struct SceneSettings
+{
+	GLuint meshCount;           // Кол-во объектов (сфер) на полу
+	GLuint pointLights;         // Кол-во точечных источников
+	GLuint spotLights;          // Кол-во прожекторов
+	GLuint directionalLights;   // Кол-во направленных источников
+	GLuint shadowedLights;      // Кол-во источников, создающих тени (первые по порядку добавления)
+	GLuint triangleDensity;     // Плотность геометрии (кол-во сегментов сферы и ячеек пола по стороне)
+	GLfloat diffuseShare;       // Доля объектов с diffuse текстурой (0..1)
+	GLfloat specularShare;      // Доля объектов со specular текстурой (0..1)
+	GLfloat bumpShare;          // Доля объектов с bump текстурой (0..1)
+	GLfloat displacementShare;  // Доля объектов с displacement текстурой (0..1)
+	GLfloat areaSize;           // Половина стороны области, в которой размещаются объекты
+	GLuint seed;                // Зерно генератора случайных чисел
+};
+
+/**
+ * \brief Генератор сцен для замеров производительности
+ * \details Создает геометрию и текстуры процедурно (без чтения файлов), размещает объекты и источники света
+ * случайным образом, но воспроизводимо. Также задает путь камеры - облет сцены по окружности
+ */
+class SceneGenerator
+{
+private:
+	SceneSettings settings_;                  // Параметры сцены
+	std::mt19937 random_;                     // Генератор случайных чисел
+
+	ogl::StaticGeometryResourcePtr sphere_;   // Геометрия объектов
+	ogl::StaticGeometryResourcePtr ground_;   // Геометрия пола
+
+	struct {
+		ogl::TextureResourcePtr diffuse;
+		ogl::TextureResourcePtr specular;
+		ogl::TextureResourcePtr bump;
+		ogl::TextureResourcePtr displacement;
+	} textures_;
+
+	/**
+	 * \brief Случайное число в диапазоне
+	 * \param min Минимум
+	 * \param max Максимум
+	 * \return Число
+	 */
+	GLfloat random(GLfloat min, GLfloat max);
+
+	/**
+	 * \brief Создать геометрию сферы
+	 * \param segments Кол-во сегментов по долготе (по широте - вдвое меньше)
+	 * \return Ресурс геометрии
+	 */
+	static ogl::StaticGeometryResourcePtr MakeSphere(GLuint segments);
+
+	/**
+	 * \brief Создать геометрию пола (квадратная сетка)
+	 * \param size Половина стороны
+	 * \param cells Кол-во ячеек по стороне
+	 * \return Ресурс геометрии
+	 */
+	static ogl::StaticGeometryResourcePtr MakeGround(GLfloat size, GLuint cells);
+
+	/**
+	 * \brief Создать процедурные текстуры (шум, шахматная доска, волны)
+	 */
+	void makeTextures();
+
+public:
+	/**
+	 * \brief Конструктор
+	 * \param settings Параметры сцены
+	 */
+	explicit SceneGenerator(const SceneSettings& settings);
+
+	/**
+	 * \brief Создать ресурсы и добавить объекты и источники в рендерер
+	 * \param pRenderer Указатель на рендерер
+	 */
+	void generate(ogl::Renderer* pRenderer);
+
+	/**
+	 * \brief Установить камеру на пути облета
+	 * \param pRenderer Указатель на рендерер
+	 * \param frame Номер кадра
+	 * \param frameCount Кол-во кадров на полный облет
+	 */
+	void placeCamera(ogl::Renderer* pRenderer, GLuint frame, GLuint frameCount) const;
+
+	/**
+	 * \brief Получить параметры сцены
+	 * \return Константная ссылка на параметры
+	 */
+	const SceneSettings& getSettings() const;
+
+	/**
+	 * \brief Кол-во треугольников сцены (без теневых объемов и полноэкранных проходов)
+	 * \return Кол-во треугольников
+	 */
+	size_t getTriangleCount() const;
+};
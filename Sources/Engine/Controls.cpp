@@ -1,9 +1,13 @@
 ﻿#include "Controls.h"
 #include "CameraControllable.h"
+#include "RendererOgl/Renderer.h"
 
 // Камера
 extern CameraControllable * _pCamera;
 
+// OpenGL рендерер
+extern ogl::Renderer * _pRenderer;
+
 // Положение мыши
 static glm::ivec2 _mousePositions;
 
@@ -47,6 +51,12 @@ LRESULT CALLBACK WndProc(HWND hWnd, UINT message, WPARAM wParam, LPARAM lParam)
 		case 0x43: // C
 			_pCamera->movement.y = -1.0f;
 			break;
+		case VK_F1: // Панель производительности
+			_pRenderer->showHud = !_pRenderer->showHud;
+			break;
+		case VK_F2: // Запись сеанса (воспроизводится Benchmark --replay)
+			_pRenderer->setRecorder(_pRenderer->getRecorder() ? nullptr : ogl::MakeFrameRecorder("session.ogltrace"));
+			break;
 		default:
 			break;
 		}
@@ -7,7 +7,7 @@
 #include <clocale>
 
 #include "RendererOgl/Renderer.h"
-#include "RendererOgl/Tools.h"
+#include "RendererOgl/Context.h"
 
 #include "CameraControllable.h"
 #include "Controls.h"
@@ -22,6 +22,9 @@ std::chrono::time_point<std::chrono::high_resolution_clock> _lastFrameTime;
 // Камера
 CameraControllable * _pCamera;
 
+// OpenGL контекст (объявлен раньше ресурсов сцены - уничтожается после них)
+ogl::ContextPtr _context;
+
 // OpenGL рендерер
 ogl::Renderer * _pRenderer;
 
@@ -134,23 +137,34 @@ int main(int argc, char* argv[])
 
 		// Создание OpenGL контекста
 		// Необходимо для инициализации GLEW
-		ogl::CreateContext(hWnd);
+		_context = ogl::MakeWindowContext(hWnd);
 
 		// Вертикальная синхронизация (отключить)
-		ogl::EnableVSync(false);
+		_context->setVSync(false);
+
+		// Кеш собранных шейдерных программ (ускоряет повторный запуск)
+		std::string shaderCacheDir = ExeDir().append("..\\ShaderCache\\");
+		CreateDirectoryA(shaderCacheDir.c_str(), nullptr);
+		ogl::ShaderResource::setBinaryCacheDir(shaderCacheDir);
 
 		// Загрузить необходимые ресурсы (шейдеры, текстуры, прочее)
 		Load();
 
 		// Создать рендерер
 		_pRenderer = new ogl::Renderer(
-			hWnd, 
+			_context, 
 			_sceneResources.shaders.geometry, 
 			_sceneResources.shaders.lighting, 
 			_sceneResources.shaders.postProcessing,
 			_sceneResources.shaders.shadows
 		);
 
+		// Сцена статична - теневые объемы выгоднее строить на CPU и кешировать
+		_pRenderer->shadowVolumeMode = ogl::ShadowVolumeMode::CPU_CACHED;
+
+		// Предварительный проход глубины - только если перекрытие геометрии оправдывает его стоимость
+		_pRenderer->depthPrePassMode = ogl::DepthPrePassMode::DEPTH_PREPASS_AUTO;
+
 		// Создать камеру
 		_pCamera = new CameraControllable(1.5f, 0.3f, _pRenderer->viewPort.getAspectRatio(),0.1f,1000.0f);
 		_pCamera->position = { 0.0f,0.0f,3.0f };
@@ -225,11 +239,17 @@ void Load()
 	std::string postProcessingShaderSource = LoadStringFromFile(ShadersDir().append("post.glsl"));
 	std::string shadowVolumeSource = LoadStringFromFile(ShadersDir().append("shadows.glsl"));
 
-	// Создать шейдерные программы
-	_sceneResources.shaders.geometry = ogl::MakeShaderResource(geometryShaderSource);
-	_sceneResources.shaders.lighting = ogl::MakeShaderResource(lightingShaderSource);
-	_sceneResources.shaders.postProcessing = ogl::MakeShaderResource(postProcessingShaderSource);
-	_sceneResources.shaders.shadows = ogl::MakeShaderResource(shadowVolumeSource);
+	// Создать шейдерные программы (сборка идет в драйвере, пока загружаются остальные ресурсы)
+	std::vector<ogl::ShaderResourcePtr> shaders = ogl::MakeShaderResources({
+		geometryShaderSource,
+		lightingShaderSource,
+		postProcessingShaderSource,
+		shadowVolumeSource
+	});
+	_sceneResources.shaders.geometry = shaders[0];
+	_sceneResources.shaders.lighting = shaders[1];
+	_sceneResources.shaders.postProcessing = shaders[2];
+	_sceneResources.shaders.shadows = shaders[3];
 
 	// Г Е О М Е Т Р И Я
 
@@ -291,6 +311,12 @@ void Load()
 	_sceneResources.textures.wallDisplace = ogl::MakeTextureResource(textureBytes, static_cast<GLuint>(width), static_cast<GLuint>(height), static_cast<GLuint>(bpp), true);
 	stbi_image_free(textureBytes);
 
+	// Ш Е Й Д Е Р Ы (завершение)
+
+	// Дождаться сборки шейдерных программ (ошибки компиляции будут выброшены здесь)
+	for (const ogl::ShaderResourcePtr& shader : shaders) {
+		shader->wait();
+	}
 }
 
 /**
@@ -0,0 +1,457 @@
+﻿#include "Context.h"
+#include "Tools.h"
+#include "GpuMemory.h"
+#include <stdexcept>
+#include <cstring>
+
+#ifdef OGL_EGL
+#define EGL_NO_X11
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
+
+namespace ogl
+{
+	/**
+	* \brief Проинициализирован ли GLEW
+	*/
+	extern bool _isGlewInitialised;
+
+	/**
+	* \brief Прочитать содержимое основного буфера
+	* \return Пиксели в формате RGBA8 (строки снизу вверх)
+	* \details Ожидает завершения рендеринга - предназначено для тестов и сохранения кадров, а не для каждого кадра
+	*/
+	std::vector<unsigned char> Context::readPixels() const
+	{
+		std::vector<unsigned char> pixels(static_cast<size_t>(this->getWidth()) * static_cast<size_t>(this->getHeight()) * 4);
+
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, this->getFrameBufferId());
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, this->getWidth(), this->getHeight(), GL_RGBA, GL_UNSIGNED_BYTE, pixels.data());
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		return pixels;
+	}
+
+	/**
+	* \brief Создание буфера в текущем контексте
+	* \param width Ширина
+	* \param height Высота
+	*/
+	OffscreenBuffer::OffscreenBuffer(GLuint width, GLuint height) :
+		frameBufferId_(0),
+		colorRenderBufferId_(0),
+		depthRenderBufferId_(0),
+		width_(width),
+		height_(height)
+	{
+		// Цвет и глубина-трафарет - по 4 байта на пиксель (при превышении бюджета объекты не создаются)
+		GpuMemory::get().allocate(GPU_MEMORY_RENDER_TARGETS, static_cast<GLuint64>(width) * height * 8);
+
+		try
+		{
+			glGenRenderbuffers(1, &(this->colorRenderBufferId_));
+			glBindRenderbuffer(GL_RENDERBUFFER, this->colorRenderBufferId_);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+
+			glGenRenderbuffers(1, &(this->depthRenderBufferId_));
+			glBindRenderbuffer(GL_RENDERBUFFER, this->depthRenderBufferId_);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+
+			glGenFramebuffers(1, &(this->frameBufferId_));
+			glBindFramebuffer(GL_FRAMEBUFFER, this->frameBufferId_);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, this->colorRenderBufferId_);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, this->depthRenderBufferId_);
+
+			GLenum status = glCheckFramebufferStatus(GL_FRAMEBUFFER);
+			glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+			if (status != GL_FRAMEBUFFER_COMPLETE) {
+				throw std::runtime_error("OpenGL:OffscreenBuffer: Frame buffer can't be initialized");
+			}
+		}
+		catch (...)
+		{
+			this->release();
+			throw;
+		}
+	}
+
+	/**
+	* \brief Уничтожение буфера (контекст должен быть текущим)
+	*/
+	OffscreenBuffer::~OffscreenBuffer()
+	{
+		this->release();
+	}
+
+	/**
+	* \brief Удаление объектов OpenGL и учета памяти
+	*/
+	void OffscreenBuffer::release()
+	{
+		if (this->frameBufferId_ != 0) glDeleteFramebuffers(1, &(this->frameBufferId_));
+		if (this->colorRenderBufferId_ != 0) glDeleteRenderbuffers(1, &(this->colorRenderBufferId_));
+		if (this->depthRenderBufferId_ != 0) glDeleteRenderbuffers(1, &(this->depthRenderBufferId_));
+		GpuMemory::get().release(GPU_MEMORY_RENDER_TARGETS, static_cast<GLuint64>(this->width_) * this->height_ * 8);
+
+		this->frameBufferId_ = 0;
+		this->colorRenderBufferId_ = 0;
+		this->depthRenderBufferId_ = 0;
+	}
+
+	/**
+	* \brief ID кадрового буфера
+	* \return ID буфера
+	*/
+	GLuint OffscreenBuffer::getId() const
+	{
+		return this->frameBufferId_;
+	}
+
+#ifdef _WIN32
+	/**
+	* \brief Создание контекста для окна (контекст становится текущим)
+	* \param hwnd Хендл окна
+	* \param offscreen Выводить кадр во внеэкранный буфер размером с клиентскую область
+	*/
+	WindowContext::WindowContext(HWND hwnd, bool offscreen) :
+		hwnd_(hwnd),
+		hdc_(GetDC(hwnd)),
+		context_(CreateContext(hwnd)),
+		width_(0),
+		height_(0)
+	{
+		if (offscreen)
+		{
+			RECT clientRect;
+			GetClientRect(this->hwnd_, &clientRect);
+			this->width_ = static_cast<GLuint>(clientRect.right);
+			this->height_ = static_cast<GLuint>(clientRect.bottom);
+
+			try
+			{
+				this->frameBuffer_.reset(new OffscreenBuffer(this->width_, this->height_));
+			}
+			catch (...)
+			{
+				DeleteContext(&(this->context_));
+				throw;
+			}
+		}
+	}
+
+	/**
+	* \brief Уничтожение контекста
+	*/
+	WindowContext::~WindowContext()
+	{
+		// Объекты внеэкранного буфера удаляются в своем контексте
+		if (this->frameBuffer_) {
+			this->makeCurrent();
+			this->frameBuffer_.reset();
+		}
+
+		DeleteContext(&(this->context_));
+	}
+
+	/**
+	* \brief Сделать контекст текущим для вызывающего потока
+	*/
+	void WindowContext::makeCurrent()
+	{
+		wglMakeCurrent(this->hdc_, this->context_);
+	}
+
+	/**
+	* \brief Представить кадр (смена буферов окна, либо отправка команд для внеэкранного буфера)
+	*/
+	void WindowContext::swapBuffers()
+	{
+		if (this->frameBuffer_) glFlush();
+		else SwapBuffers(this->hdc_);
+	}
+
+	/**
+	* \brief Управление вертикальной синхронизацией
+	* \param sync Состояние
+	*/
+	void WindowContext::setVSync(bool sync)
+	{
+		EnableVSync(sync);
+	}
+
+	/**
+	* \brief Ширина основного буфера (клиентской области окна)
+	* \return Кол-во пикселей
+	*/
+	GLuint WindowContext::getWidth() const
+	{
+		if (this->frameBuffer_) return this->width_;
+
+		RECT clientRect;
+		GetClientRect(this->hwnd_, &clientRect);
+		return static_cast<GLuint>(clientRect.right);
+	}
+
+	/**
+	* \brief Высота основного буфера (клиентской области окна)
+	* \return Кол-во пикселей
+	*/
+	GLuint WindowContext::getHeight() const
+	{
+		if (this->frameBuffer_) return this->height_;
+
+		RECT clientRect;
+		GetClientRect(this->hwnd_, &clientRect);
+		return static_cast<GLuint>(clientRect.bottom);
+	}
+
+	/**
+	* \brief ID кадрового буфера, в который выводится кадр
+	* \return ID буфера (0 - буфер окна)
+	*/
+	GLuint WindowContext::getFrameBufferId() const
+	{
+		return this->frameBuffer_ ? this->frameBuffer_->getId() : 0;
+	}
+
+	/**
+	* \brief Создание контекста окна
+	* \param hwnd Хендл окна
+	* \param offscreen Выводить кадр во внеэкранный буфер размером с клиентскую область
+	* \return Умный указатель на контекст
+	*/
+	ContextPtr MakeWindowContext(HWND hwnd, bool offscreen)
+	{
+		return std::make_shared<WindowContext>(hwnd, offscreen);
+	}
+#endif
+
+#ifdef OGL_EGL
+	/**
+	* \brief Есть ли расширение в строке расширений EGL
+	* \param extensions Строка расширений (через пробел, может быть nullptr)
+	* \param name Название расширения
+	* \return Да или нет
+	*/
+	static bool HasEglExtension(const char* extensions, const char* name)
+	{
+		if (extensions == nullptr) return false;
+
+		size_t length = strlen(name);
+		for (const char* found = strstr(extensions, name); found != nullptr; found = strstr(found + length, name)) {
+			bool start = found == extensions || found[-1] == ' ';
+			bool end = found[length] == ' ' || found[length] == '\0';
+			if (start && end) return true;
+		}
+
+		return false;
+	}
+
+	/**
+	* \brief Создание внеэкранного контекста (контекст становится текущим)
+	* \param width Ширина кадрового буфера
+	* \param height Высота кадрового буфера
+	*/
+	HeadlessContext::HeadlessContext(GLuint width, GLuint height) :
+		display_(EGL_NO_DISPLAY),
+		context_(EGL_NO_CONTEXT),
+		surface_(EGL_NO_SURFACE),
+		width_(width),
+		height_(height)
+	{
+		try
+		{
+			// Дисплей без оконной системы (если есть платформа surfaceless), иначе - дисплей по умолчанию
+			const char* clientExtensions = eglQueryString(EGL_NO_DISPLAY, EGL_EXTENSIONS);
+			EGLDisplay display = EGL_NO_DISPLAY;
+
+			if (HasEglExtension(clientExtensions, "EGL_MESA_platform_surfaceless")) {
+				auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(eglGetProcAddress("eglGetPlatformDisplayEXT"));
+				if (getPlatformDisplay != nullptr) display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+			}
+
+			if (display == EGL_NO_DISPLAY) {
+				display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+			}
+
+			if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+				throw std::runtime_error("OpenGL:HeadlessContext: Can't initialize EGL display");
+			}
+
+			this->display_ = display;
+
+			// Рендеринг через OpenGL (не OpenGL ES)
+			if (!eglBindAPI(EGL_OPENGL_API)) {
+				throw std::runtime_error("OpenGL:HeadlessContext: OpenGL API is not supported by EGL");
+			}
+
+			// Поверхность не нужна, если контекст может быть текущим без нее (кадр выводится в кадровый буфер контекста)
+			bool surfaceless = HasEglExtension(eglQueryString(display, EGL_EXTENSIONS), "EGL_KHR_surfaceless_context");
+
+			const EGLint configAttributes[] = {
+				EGL_SURFACE_TYPE, surfaceless ? 0 : EGL_PBUFFER_BIT,
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_RED_SIZE, 8,
+				EGL_GREEN_SIZE, 8,
+				EGL_BLUE_SIZE, 8,
+				EGL_ALPHA_SIZE, 8,
+				EGL_NONE
+			};
+
+			EGLConfig config = nullptr;
+			EGLint configCount = 0;
+			if (!eglChooseConfig(display, configAttributes, &config, 1, &configCount) || configCount == 0) {
+				throw std::runtime_error("OpenGL:HeadlessContext: Can't find suitable EGL config");
+			}
+
+			// Контекст OpenGL 3.3 core (если версия не поддерживается - контекст по умолчанию)
+			const EGLint contextAttributes[] = {
+				EGL_CONTEXT_MAJOR_VERSION, 3,
+				EGL_CONTEXT_MINOR_VERSION, 3,
+				EGL_CONTEXT_OPENGL_PROFILE_MASK, EGL_CONTEXT_OPENGL_CORE_PROFILE_BIT,
+				EGL_NONE
+			};
+
+			EGLContext context = eglCreateContext(display, config, EGL_NO_CONTEXT, contextAttributes);
+			if (context == EGL_NO_CONTEXT) {
+				context = eglCreateContext(display, config, EGL_NO_CONTEXT, nullptr);
+			}
+
+			if (context == EGL_NO_CONTEXT) {
+				throw std::runtime_error("OpenGL:HeadlessContext: Can't create EGL context");
+			}
+
+			this->context_ = context;
+
+			// Поверхность-заглушка (рендеринг в нее не выполняется)
+			if (!surfaceless)
+			{
+				const EGLint surfaceAttributes[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+				this->surface_ = eglCreatePbufferSurface(display, config, surfaceAttributes);
+
+				if (this->surface_ == EGL_NO_SURFACE) {
+					throw std::runtime_error("OpenGL:HeadlessContext: Can't create EGL pbuffer surface");
+				}
+			}
+
+			this->makeCurrent();
+
+			// Инициализация GLEW (функции OpenGL загружаются через eglGetProcAddress, если GLEW собран с GLEW_EGL)
+			if (!_isGlewInitialised) {
+				glewExperimental = GL_TRUE;
+				_isGlewInitialised = glewInit() == GLEW_OK;
+			}
+
+			if (!_isGlewInitialised) {
+				throw std::runtime_error("OpenGL:HeadlessContext: Glew is not initialised");
+			}
+
+			// Внеэкранный кадровый буфер (заменяет буфер окна)
+			this->frameBuffer_.reset(new OffscreenBuffer(width, height));
+		}
+		catch (...)
+		{
+			this->release();
+			throw;
+		}
+	}
+
+	/**
+	* \brief Уничтожение контекста и внеэкранного буфера
+	*/
+	HeadlessContext::~HeadlessContext()
+	{
+		this->release();
+	}
+
+	/**
+	* \brief Освобождение буфера и объектов EGL (в т.ч. созданных частично)
+	*/
+	void HeadlessContext::release()
+	{
+		if (this->display_ == EGL_NO_DISPLAY) return;
+
+		// Объекты буфера удаляются в своем контексте
+		if (this->frameBuffer_) {
+			eglMakeCurrent(this->display_, this->surface_, this->surface_, this->context_);
+			this->frameBuffer_.reset();
+		}
+
+		eglMakeCurrent(this->display_, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+		if (this->surface_ != EGL_NO_SURFACE) eglDestroySurface(this->display_, this->surface_);
+		if (this->context_ != EGL_NO_CONTEXT) eglDestroyContext(this->display_, this->context_);
+		eglTerminate(this->display_);
+
+		this->surface_ = EGL_NO_SURFACE;
+		this->context_ = EGL_NO_CONTEXT;
+		this->display_ = EGL_NO_DISPLAY;
+	}
+
+	/**
+	* \brief Сделать контекст текущим для вызывающего потока
+	*/
+	void HeadlessContext::makeCurrent()
+	{
+		if (!eglMakeCurrent(this->display_, this->surface_, this->surface_, this->context_)) {
+			throw std::runtime_error("OpenGL:HeadlessContext: Can't make EGL context current");
+		}
+	}
+
+	/**
+	* \brief Представить кадр (отправка накопленных команд, показывать кадр некому)
+	*/
+	void HeadlessContext::swapBuffers()
+	{
+		glFlush();
+	}
+
+	/**
+	* \brief Управление вертикальной синхронизацией (у внеэкранного буфера ее нет)
+	* \param sync Состояние
+	*/
+	void HeadlessContext::setVSync(bool)
+	{}
+
+	/**
+	* \brief Ширина основного буфера
+	* \return Кол-во пикселей
+	*/
+	GLuint HeadlessContext::getWidth() const
+	{
+		return this->width_;
+	}
+
+	/**
+	* \brief Высота основного буфера
+	* \return Кол-во пикселей
+	*/
+	GLuint HeadlessContext::getHeight() const
+	{
+		return this->height_;
+	}
+
+	/**
+	* \brief ID кадрового буфера, в который выводится кадр
+	* \return ID внеэкранного буфера
+	*/
+	GLuint HeadlessContext::getFrameBufferId() const
+	{
+		return this->frameBuffer_->getId();
+	}
+
+	/**
+	* \brief Создание внеэкранного контекста
+	* \param width Ширина кадрового буфера
+	* \param height Высота кадрового буфера
+	* \return Умный указатель на контекст
+	*/
+	ContextPtr MakeHeadlessContext(GLuint width, GLuint height)
+	{
+		return std::make_shared<HeadlessContext>(width, height);
+	}
+#endif
+}
@@ -0,0 +1,251 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <GL/glew.h>
+
+#ifdef _WIN32
+#include <Windows.h>
+#endif
+
+// Внеэкранный контекст EGL собирается на платформах без WGL (либо принудительно, при объявлении OGL_EGL)
+// GLEW должен быть собран с поддержкой EGL (GLEW_EGL), иначе glewInit ищет функции через GLX и требует X-сервер
+#if !defined(_WIN32) && !defined(OGL_EGL)
+#define OGL_EGL
+#endif
+
+namespace ogl
+{
+	/**
+	 * \brief Контекст OpenGL и основной буфер, в который рендерер выводит кадр
+	 * \details Абстракция платформы: реализации создают контекст своей оконной системы (WGL, либо EGL без окна). Для рендерера
+	 * основной буфер - это кадровый буфер контекста (0 - буфер окна, иначе - внеэкранный буфер)
+	 */
+	class Context
+	{
+	public:
+		/**
+		 * \brief Освобождение контекста
+		 */
+		virtual ~Context() = default;
+
+		/**
+		 * \brief Сделать контекст текущим для вызывающего потока
+		 */
+		virtual void makeCurrent() = 0;
+
+		/**
+		 * \brief Представить кадр (смена буферов окна, либо отправка команд для внеэкранного буфера)
+		 */
+		virtual void swapBuffers() = 0;
+
+		/**
+		 * \brief Управление вертикальной синхронизацией
+		 * \param sync Состояние
+		 */
+		virtual void setVSync(bool sync) = 0;
+
+		/**
+		 * \brief Ширина основного буфера
+		 * \return Кол-во пикселей
+		 */
+		virtual GLuint getWidth() const = 0;
+
+		/**
+		 * \brief Высота основного буфера
+		 * \return Кол-во пикселей
+		 */
+		virtual GLuint getHeight() const = 0;
+
+		/**
+		 * \brief ID кадрового буфера, в который выводится кадр
+		 * \return ID буфера (0 - буфер окна)
+		 */
+		virtual GLuint getFrameBufferId() const = 0;
+
+		/**
+		 * \brief Прочитать содержимое основного буфера
+		 * \return Пиксели в формате RGBA8 (строки снизу вверх)
+		 * \details Ожидает завершения рендеринга - предназначено для тестов и сохранения кадров, а не для каждого кадра
+		 */
+		std::vector<unsigned char> readPixels() const;
+	};
+
+	/**
+	 * \brief Умный указатель на контекст
+	 */
+	typedef std::shared_ptr<Context> ContextPtr;
+
+	/**
+	 * \brief Внеэкранный кадровый буфер контекста (цвет RGBA8 и глубина-трафарет)
+	 * \details Заменяет буфер окна, если его нет (или если кадр не должен зависеть от видимости окна).
+	 * Объекты создаются и удаляются в текущем контексте, при ошибке создания уже созданное освобождается
+	 */
+	class OffscreenBuffer
+	{
+	private:
+		GLuint frameBufferId_;        // ID кадрового буфера
+		GLuint colorRenderBufferId_;  // ID буфера цвета
+		GLuint depthRenderBufferId_;  // ID буфера глубины-трафарета
+		GLuint width_;                // Ширина
+		GLuint height_;               // Высота
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		OffscreenBuffer(const OffscreenBuffer& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const OffscreenBuffer& other) = delete;
+
+		/**
+		 * \brief Удаление объектов OpenGL и учета памяти
+		 */
+		void release();
+
+	public:
+		/**
+		 * \brief Создание буфера в текущем контексте
+		 * \param width Ширина
+		 * \param height Высота
+		 */
+		OffscreenBuffer(GLuint width, GLuint height);
+
+		/**
+		 * \brief Уничтожение буфера (контекст должен быть текущим)
+		 */
+		~OffscreenBuffer();
+
+		/**
+		 * \brief ID кадрового буфера
+		 * \return ID буфера
+		 */
+		GLuint getId() const;
+	};
+
+#ifdef _WIN32
+	/**
+	 * \brief Контекст окна WinAPI (WGL)
+	 * \details Кадр выводится в буфер окна, либо во внеэкранный буфер размером с клиентскую область. Содержимое буфера
+	 * невидимого окна не определено, поэтому для скрытых окон (тесты, бенчмарки) нужен внеэкранный буфер
+	 */
+	class WindowContext : public Context
+	{
+	private:
+		HWND hwnd_;                                     // Хендл окна
+		HDC hdc_;                                       // Контекст устройства окна
+		HGLRC context_;                                 // Контекст OpenGL
+		std::unique_ptr<OffscreenBuffer> frameBuffer_;  // Внеэкранный буфер (nullptr - вывод в буфер окна)
+		GLuint width_;                                  // Ширина внеэкранного буфера
+		GLuint height_;                                 // Высота внеэкранного буфера
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		WindowContext(const WindowContext& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const WindowContext& other) = delete;
+
+	public:
+		/**
+		 * \brief Создание контекста для окна (контекст становится текущим)
+		 * \param hwnd Хендл окна
+		 * \param offscreen Выводить кадр во внеэкранный буфер размером с клиентскую область
+		 */
+		explicit WindowContext(HWND hwnd, bool offscreen = false);
+
+		/**
+		 * \brief Уничтожение контекста
+		 */
+		~WindowContext() override;
+
+		void makeCurrent() override;
+		void swapBuffers() override;
+		void setVSync(bool sync) override;
+		GLuint getWidth() const override;
+		GLuint getHeight() const override;
+		GLuint getFrameBufferId() const override;
+	};
+
+	/**
+	 * \brief Создание контекста окна
+	 * \param hwnd Хендл окна
+	 * \param offscreen Выводить кадр во внеэкранный буфер размером с клиентскую область
+	 * \return Умный указатель на контекст
+	 */
+	ContextPtr MakeWindowContext(HWND hwnd, bool offscreen = false);
+#endif
+
+#ifdef OGL_EGL
+	/**
+	 * \brief Внеэкранный контекст EGL (без окна и оконной системы)
+	 * \details Дисплей платформы EGL_MESA_platform_surfaceless, контекст без поверхности (EGL_KHR_surfaceless_context),
+	 * либо с pbuffer 1*1, если расширения нет. Кадр выводится во внеэкранный буфер контекста. Работает и на программном
+	 * рендеринге (llvmpipe), что позволяет запускать тесты и бенчмарки на серверах без GPU и дисплея
+	 */
+	class HeadlessContext : public Context
+	{
+	private:
+		void* display_;                                 // Дисплей EGL (EGLDisplay)
+		void* context_;                                 // Контекст EGL (EGLContext)
+		void* surface_;                                 // Поверхность-заглушка (EGLSurface, может отсутствовать)
+		std::unique_ptr<OffscreenBuffer> frameBuffer_;  // Внеэкранный кадровый буфер
+		GLuint width_;                                  // Ширина кадрового буфера
+		GLuint height_;                                 // Высота кадрового буфера
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		HeadlessContext(const HeadlessContext& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const HeadlessContext& other) = delete;
+
+		/**
+		 * \brief Освобождение буфера и объектов EGL (в т.ч. созданных частично)
+		 */
+		void release();
+
+	public:
+		/**
+		 * \brief Создание внеэкранного контекста (контекст становится текущим)
+		 * \param width Ширина кадрового буфера
+		 * \param height Высота кадрового буфера
+		 */
+		HeadlessContext(GLuint width, GLuint height);
+
+		/**
+		 * \brief Уничтожение контекста и внеэкранного буфера
+		 */
+		~HeadlessContext() override;
+
+		void makeCurrent() override;
+		void swapBuffers() override;
+		void setVSync(bool sync) override;
+		GLuint getWidth() const override;
+		GLuint getHeight() const override;
+		GLuint getFrameBufferId() const override;
+	};
+
+	/**
+	 * \brief Создание внеэкранного контекста
+	 * \param width Ширина кадрового буфера
+	 * \param height Высота кадрового буфера
+	 * \return Умный указатель на контекст
+	 */
+	ContextPtr MakeHeadlessContext(GLuint width, GLuint height);
+#endif
+}
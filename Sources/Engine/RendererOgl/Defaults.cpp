@@ -254,6 +254,116 @@ namespace ogl
 				"#version 330 core\n"
 				"void main(){gl_FragDepth = gl_FragCoord.z;}\n"
 				"/*FRAGMENT-SHADER-END*/\n";
+		case ogl::defaults::DefaultShaderType::SHADOW_VOLUME:
+			return
+				"/*VERTEX-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"layout (location = 0) in vec4 position;\n"
+				"uniform mat4 model;\n"
+				"uniform mat4 view;\n"
+				"uniform mat4 projection;\n"
+				"void main(){gl_Position = projection * view * model * position;}\n"
+				"/*VERTEX-SHADER-END*/\n"
+				"/*FRAGMENT-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"out vec4 color;\n"
+				"void main(){color = vec4(1.0);}\n"
+				"/*FRAGMENT-SHADER-END*/\n";
+		case ogl::defaults::DefaultShaderType::DEPTH_ONLY:
+			return
+				"/*VERTEX-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"layout (location = 0) in vec3 position;\n"
+				"uniform mat4 model;\n"
+				"uniform mat4 view;\n"
+				"uniform mat4 projection;\n"
+				"invariant gl_Position;\n"
+				"void main(){gl_Position = projection * view * model * vec4(position, 1.0);}\n"
+				"/*VERTEX-SHADER-END*/\n"
+				"/*FRAGMENT-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"void main(){}\n"
+				"/*FRAGMENT-SHADER-END*/\n";
+		case ogl::defaults::DefaultShaderType::SEPARABLE_KERNEL:
+			return
+				"/*VERTEX-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"layout (location = 0) in vec3 position;\n"
+				"layout (location = 2) in vec2 uv;\n"
+				"out vec2 screenUv;\n"
+				"void main(){gl_Position = vec4(position.x, position.y, 0.0, 1.0); screenUv = uv;}\n"
+				"/*VERTEX-SHADER-END*/\n"
+				"/*FRAGMENT-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"layout (location = 0) out vec4 fragColor;\n"
+				"in vec2 screenUv;\n"
+				"uniform sampler2D screenTexture;\n"
+				"uniform vec2 uvScale;\n"
+				"uniform vec2 uvMax;\n"
+				"uniform vec2 texelStep;\n"
+				"uniform float tapOffsets[16];\n"
+				"uniform float tapWeights[16];\n"
+				"uniform int tapCount;\n"
+				"void main(){\n"
+				"vec2 uv = screenUv * uvScale;\n"
+				"vec3 result = texture(screenTexture, uv).rgb * tapWeights[0];\n"
+				"for(int i = 1; i < tapCount; i++){\n"
+				"vec2 offset = texelStep * tapOffsets[i];\n"
+				"result += (texture(screenTexture, min(uv + offset, uvMax)).rgb + texture(screenTexture, min(uv - offset, uvMax)).rgb) * tapWeights[i];}\n"
+				"fragColor = vec4(result, 1.0);}\n"
+				"/*FRAGMENT-SHADER-END*/\n";
+		case ogl::defaults::DefaultShaderType::UPSCALE:
+			return
+				"/*VERTEX-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"layout (location = 0) in vec3 position;\n"
+				"layout (location = 2) in vec2 uv;\n"
+				"out vec2 screenUv;\n"
+				"void main(){gl_Position = vec4(position.x, position.y, 0.0, 1.0); screenUv = uv;}\n"
+				"/*VERTEX-SHADER-END*/\n"
+				"/*FRAGMENT-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"layout (location = 0) out vec4 fragColor;\n"
+				"in vec2 screenUv;\n"
+				"uniform sampler2D screenTexture;\n"
+				"uniform vec2 uvScale;\n"
+				"uniform vec2 uvMax;\n"
+				"uniform vec2 texelSize;\n"
+				"uniform float sharpness;\n"
+				"vec3 fetch(vec2 uv){return texture(screenTexture, clamp(uv, vec2(0.0), uvMax)).rgb;}\n"
+				"void main(){\n"
+				"vec2 uv = screenUv * uvScale;\n"
+				"vec3 color = fetch(uv);\n"
+				"#ifdef EDGE_AWARE\n"
+				"vec3 n = fetch(uv - vec2(0.0, texelSize.y));\n"
+				"vec3 s = fetch(uv + vec2(0.0, texelSize.y));\n"
+				"vec3 w = fetch(uv - vec2(texelSize.x, 0.0));\n"
+				"vec3 e = fetch(uv + vec2(texelSize.x, 0.0));\n"
+				"vec3 minColor = min(color, min(min(n, s), min(w, e)));\n"
+				"vec3 maxColor = max(color, max(max(n, s), max(w, e)));\n"
+				"vec3 amount = sqrt(clamp(min(minColor, 1.0 - maxColor) / max(maxColor, vec3(0.0001)), 0.0, 1.0));\n"
+				"vec3 weight = -amount * mix(0.125, 0.2, sharpness);\n"
+				"color = clamp((color + (n + s + w + e) * weight) / (1.0 + 4.0 * weight), 0.0, 1.0);\n"
+				"#endif\n"
+				"fragColor = vec4(color, 1.0);}\n"
+				"/*FRAGMENT-SHADER-END*/\n";
+		case ogl::defaults::DefaultShaderType::HUD:
+			return
+				"/*VERTEX-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"layout (location = 0) in vec3 position;\n"
+				"layout (location = 1) in vec4 color;\n"
+				"out vec4 vertexColor;\n"
+				"uniform vec2 screenSize;\n"
+				"uniform float scale;\n"
+				"void main(){vec2 p = position.xy * scale / screenSize * 2.0 - 1.0; gl_Position = vec4(p.x, -p.y, 0.0, 1.0); vertexColor = color;}\n"
+				"/*VERTEX-SHADER-END*/\n"
+				"/*FRAGMENT-SHADER-BEGIN*/\n"
+				"#version 330 core\n"
+				"layout (location = 0) out vec4 fragColor;\n"
+				"in vec4 vertexColor;\n"
+				"void main(){fragColor = vertexColor;}\n"
+				"/*FRAGMENT-SHADER-END*/\n";
 		}
 	}
 }
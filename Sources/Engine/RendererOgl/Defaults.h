@@ -44,6 +44,11 @@ namespace ogl
 			FULL_BRIGHT_TEXTURED,
 			SKYBOX,
 			LIGHT_SHADOW_MAP,
+			SHADOW_VOLUME,
+			DEPTH_ONLY,
+			SEPARABLE_KERNEL,
+			UPSCALE,
+			HUD,
 		};
 
 		/**
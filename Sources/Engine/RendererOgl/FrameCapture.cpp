@@ -0,0 +1,288 @@
+﻿#include "FrameCapture.h"
+#include "GpuMemory.h"
+#include "Profiler.h"
+#include <chrono>
+#include <cstring>
+#include <stdexcept>
+#include <glm/glm.hpp>
+
+#define STB_IMAGE_WRITE_STATIC
+#define STB_IMAGE_WRITE_IMPLEMENTATION
+#include <STB/stb_image_write.h>
+
+#define FRAME_CAPTURE_PNG_COMPRESSION 1
+
+namespace ogl
+{
+	/**
+	* \brief Конструктор
+	* \param width Ширина кадра
+	* \param height Высота кадра
+	* \param pathPrefix Начало пути файлов (например "capture/frame_" - файлы "capture/frame_000001.png" и т.д.)
+	* \param ringSize Кол-во буферов кольца (задержка чтения в кадрах)
+	* \param threadCount Кол-во потоков кодирования (0 - по кол-ву ядер, не считая поток рендеринга)
+	*/
+	FrameCapture::FrameCapture(GLuint width, GLuint height, const std::string& pathPrefix, GLuint ringSize, GLuint threadCount) :
+		width_(width),
+		height_(height),
+		pathPrefix_(pathPrefix),
+		slots_(glm::max(ringSize, 1u)),
+		nextSlot_(0),
+		activeJobs_(0),
+		stop_(false),
+		stats_({})
+	{
+		// Память буферов кольца учитывается до их создания (при превышении бюджета - исключение)
+		GLuint64 frameSize = static_cast<GLuint64>(this->width_) * this->height_ * 4;
+		GpuMemory::get().allocate(GPU_MEMORY_DYNAMIC_BUFFERS, frameSize * this->slots_.size());
+
+		for (Slot& slot : this->slots_) {
+			glGenBuffers(1, &(slot.pboId));
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pboId);
+			glBufferData(GL_PIXEL_PACK_BUFFER, static_cast<GLsizeiptr>(frameSize), nullptr, GL_STREAM_READ);
+			slot.fence = nullptr;
+			slot.frameIndex = 0;
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		// OpenGL хранит строки снизу вверх, PNG - сверху вниз (параметры stb_image_write общие для всех потоков, задаются до их запуска)
+		stbi_flip_vertically_on_write(1);
+		stbi_write_png_compression_level = FRAME_CAPTURE_PNG_COMPRESSION;
+
+		if (threadCount == 0) {
+			threadCount = glm::max(std::thread::hardware_concurrency(), 2u) - 1;
+		}
+
+		for (GLuint i = 0; i < threadCount; i++) {
+			this->workers_.push_back(std::thread(&FrameCapture::workerLoop, this));
+		}
+	}
+
+	/**
+	* \brief Деструктор (дожидается записи всех захваченных кадров)
+	*/
+	FrameCapture::~FrameCapture()
+	{
+		this->flush();
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->stop_ = true;
+		}
+		this->jobAdded_.notify_all();
+
+		for (std::thread& worker : this->workers_) {
+			worker.join();
+		}
+
+		for (Slot& slot : this->slots_) {
+			glDeleteBuffers(1, &(slot.pboId));
+		}
+
+		GpuMemory::get().release(GPU_MEMORY_DYNAMIC_BUFFERS, static_cast<GLuint64>(this->width_) * this->height_ * 4 * this->slots_.size());
+	}
+
+	/**
+	* \brief Забрать пиксели из буфера кольца и поставить кадр в очередь записи
+	* \param slot Буфер (чтение в него должно быть завершено)
+	*/
+	void FrameCapture::resolve(Slot& slot)
+	{
+		size_t frameSize = static_cast<size_t>(this->width_) * this->height_ * 4;
+		Job job;
+		job.frameIndex = slot.frameIndex;
+
+		// Дождаться места в очереди и взять массив из освободившихся
+		{
+			std::unique_lock<std::mutex> lock(this->mutex_);
+			if (this->jobs_.size() >= FRAME_CAPTURE_MAX_QUEUED) {
+				this->stats_.encoderStalls++;
+				this->jobDone_.wait(lock, [this]() { return this->jobs_.size() < FRAME_CAPTURE_MAX_QUEUED; });
+			}
+
+			if (!this->freeBuffers_.empty()) {
+				job.pixels = std::move(this->freeBuffers_.back());
+				this->freeBuffers_.pop_back();
+			}
+		}
+
+		job.pixels.resize(frameSize);
+
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pboId);
+		const void* pixels = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, static_cast<GLsizeiptr>(frameSize), GL_MAP_READ_BIT);
+		if (pixels != nullptr) {
+			memcpy(job.pixels.data(), pixels, frameSize);
+			glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+		}
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+
+		glDeleteSync(slot.fence);
+		slot.fence = nullptr;
+
+		if (pixels == nullptr) {
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->stats_.framesFailed++;
+			this->freeBuffers_.push_back(std::move(job.pixels));
+			return;
+		}
+
+		{
+			std::lock_guard<std::mutex> lock(this->mutex_);
+			this->jobs_.push_back(std::move(job));
+		}
+		this->jobAdded_.notify_one();
+	}
+
+	/**
+	* \brief Забрать все кадры, чтение которых завершено
+	* \param wait Ждать завершения чтения всех занятых буферов
+	*/
+	void FrameCapture::collect(bool wait)
+	{
+		// Обход от самого старого буфера (барьеры проходятся в порядке постановки)
+		for (size_t i = 0; i < this->slots_.size(); i++)
+		{
+			Slot& slot = this->slots_[(this->nextSlot_ + i) % this->slots_.size()];
+			if (slot.fence == nullptr) continue;
+
+			GLenum status = glClientWaitSync(slot.fence, wait ? GL_SYNC_FLUSH_COMMANDS_BIT : 0, 0);
+			while (wait && status == GL_TIMEOUT_EXPIRED) {
+				status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			}
+
+			if (status == GL_WAIT_FAILED) {
+				throw std::runtime_error("OpenGL:FrameCapture: Fence wait failed");
+			}
+
+			if (status == GL_TIMEOUT_EXPIRED) break;
+			this->resolve(slot);
+		}
+	}
+
+	/**
+	* \brief Цикл потока кодирования
+	*/
+	void FrameCapture::workerLoop()
+	{
+		for (;;)
+		{
+			Job job;
+			{
+				std::unique_lock<std::mutex> lock(this->mutex_);
+				this->jobAdded_.wait(lock, [this]() { return this->stop_ || !this->jobs_.empty(); });
+				if (this->jobs_.empty()) return;
+
+				job = std::move(this->jobs_.front());
+				this->jobs_.pop_front();
+				this->activeJobs_++;
+			}
+
+			// Номер кадра дополняется нулями до 6 знаков (файлы сортируются по имени в порядке кадров)
+			std::string number = std::to_string(job.frameIndex);
+			if (number.size() < 6) number.insert(0, 6 - number.size(), '0');
+			std::string path = this->pathPrefix_ + number + ".png";
+
+			bool written = stbi_write_png(path.c_str(), this->width_, this->height_, 4, job.pixels.data(), this->width_ * 4) != 0;
+
+			{
+				std::lock_guard<std::mutex> lock(this->mutex_);
+				if (written) this->stats_.framesWritten++;
+				else this->stats_.framesFailed++;
+				this->activeJobs_--;
+				this->freeBuffers_.push_back(std::move(job.pixels));
+			}
+			this->jobDone_.notify_all();
+		}
+	}
+
+	/**
+	* \brief Захватить кадр
+	* \param frameBufferId Кадровый буфер, из которого читается кадр (основной буфер контекста)
+	* \param frameIndex Номер кадра (используется в имени файла)
+	* \details Вызывается после рисования кадра и до смены буферов окна
+	*/
+	void FrameCapture::capture(GLuint frameBufferId, GLuint frameIndex)
+	{
+		OGL_PROFILE_ZONE("frame-capture");
+		auto start = std::chrono::high_resolution_clock::now();
+
+		// Забрать готовые кадры предыдущих вызовов
+		this->collect(false);
+
+		// Следующий буфер кольца еще занят - чтение отстает на весь размер кольца, приходится ждать GPU
+		Slot& slot = this->slots_[this->nextSlot_];
+		if (slot.fence != nullptr)
+		{
+			GLenum status = GL_TIMEOUT_EXPIRED;
+			while (status == GL_TIMEOUT_EXPIRED) {
+				status = glClientWaitSync(slot.fence, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000);
+			}
+
+			if (status == GL_WAIT_FAILED) {
+				throw std::runtime_error("OpenGL:FrameCapture: Fence wait failed");
+			}
+
+			{
+				std::lock_guard<std::mutex> lock(this->mutex_);
+				this->stats_.readbackStalls++;
+			}
+
+			this->resolve(slot);
+		}
+
+		// Копирование кадра в буфер выполняется GPU после команд кадра (glReadPixels в буфер не ждет завершения)
+		// Выравнивание строк восстанавливается - остальной код читает пиксели со своим выравниванием
+		GLint packAlignment = 4;
+		glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, frameBufferId);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.pboId);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glReadPixels(0, 0, this->width_, this->height_, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
+		glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+		glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		glBindFramebuffer(GL_READ_FRAMEBUFFER, 0);
+
+		slot.fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+		slot.frameIndex = frameIndex;
+		this->nextSlot_ = (this->nextSlot_ + 1) % this->slots_.size();
+
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		this->stats_.framesCaptured++;
+		this->stats_.captureTime += std::chrono::duration<GLfloat, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	/**
+	* \brief Дождаться записи всех захваченных кадров
+	*/
+	void FrameCapture::flush()
+	{
+		this->collect(true);
+
+		std::unique_lock<std::mutex> lock(this->mutex_);
+		this->jobDone_.wait(lock, [this]() { return this->jobs_.empty() && this->activeJobs_ == 0; });
+	}
+
+	/**
+	* \brief Статистика захвата
+	* \return Копия статистики
+	*/
+	FrameCaptureStats FrameCapture::getStats()
+	{
+		std::lock_guard<std::mutex> lock(this->mutex_);
+		return this->stats_;
+	}
+
+	/**
+	* \brief Создание захвата кадров
+	* \param width Ширина кадра
+	* \param height Высота кадра
+	* \param pathPrefix Начало пути файлов
+	* \param ringSize Кол-во буферов кольца
+	* \param threadCount Кол-во потоков кодирования (0 - по кол-ву ядер)
+	* \return Умный указатель на захват
+	*/
+	FrameCapturePtr MakeFrameCapture(GLuint width, GLuint height, const std::string& pathPrefix, GLuint ringSize, GLuint threadCount)
+	{
+		return std::make_shared<FrameCapture>(width, height, pathPrefix, ringSize, threadCount);
+	}
+}
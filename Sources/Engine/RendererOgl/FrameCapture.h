@@ -0,0 +1,156 @@
+﻿#pragma once
+
+#include <deque>
+#include <vector>
+#include <string>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <GL/glew.h>
+
+#define FRAME_CAPTURE_RING_SIZE 3
+#define FRAME_CAPTURE_MAX_QUEUED 16
+
+namespace ogl
+{
+	/**
+	 * \brief Статистика захвата кадров
+	 */
+	struct FrameCaptureStats
+	{
+		GLuint framesCaptured;      // Кол-во кадров, чтение которых поставлено в очередь GPU
+		GLuint framesWritten;       // Кол-во записанных файлов
+		GLuint framesFailed;        // Кол-во файлов, которые не удалось записать
+		GLuint readbackStalls;      // Кол-во ожиданий GPU (буфер кольца понадобился до завершения чтения в него)
+		GLuint encoderStalls;       // Кол-во ожиданий кодировщиков (очередь кадров на запись заполнена)
+		GLfloat captureTime;        // Суммарное время захвата на потоке рендеринга (мс)
+	};
+
+	/**
+	 * \brief Асинхронный захват кадров в PNG файлы
+	 * \details Кадр копируется из кадрового буфера в один из буферов кольца (GL_PIXEL_PACK_BUFFER) без ожидания GPU,
+	 * после копирования ставится барьер синхронизации. Буфер отображается в память, когда барьер пройден (обычно через
+	 * несколько кадров), пиксели копируются в очередь, а кодирование PNG (stb_image_write) выполняется рабочими потоками.
+	 * Поток рендеринга ждет только если кольцо или очередь заполнены. Методы вызываются из потока контекста OpenGL
+	 */
+	class FrameCapture
+	{
+	private:
+		/**
+		 * \brief Буфер кольца
+		 */
+		struct Slot
+		{
+			GLuint pboId;           // Буфер чтения пикселей
+			GLsync fence;           // Барьер завершения чтения (nullptr - буфер свободен)
+			GLuint frameIndex;      // Номер кадра в буфере
+		};
+
+		/**
+		 * \brief Кадр, ожидающий записи
+		 */
+		struct Job
+		{
+			GLuint frameIndex;                  // Номер кадра
+			std::vector<unsigned char> pixels;  // Пиксели RGBA (строки снизу вверх)
+		};
+
+		GLuint width_;                          // Ширина кадра
+		GLuint height_;                         // Высота кадра
+		std::string pathPrefix_;                // Начало пути файлов (к нему добавляется номер кадра и расширение)
+		std::vector<Slot> slots_;               // Кольцо буферов
+		GLuint nextSlot_;                       // Следующий буфер кольца (он же самый старый из занятых)
+
+		std::vector<std::thread> workers_;      // Потоки кодирования
+		std::deque<Job> jobs_;                  // Очередь кадров на запись
+		std::vector<std::vector<unsigned char>> freeBuffers_; // Освободившиеся массивы пикселей (для повторного использования)
+		GLuint activeJobs_;                     // Кол-во кадров, кодируемых в данный момент
+		bool stop_;                             // Завершение работы потоков
+		std::mutex mutex_;                      // Защита очереди, массивов и статистики
+		std::condition_variable jobAdded_;      // Появился кадр на запись (или завершение работы)
+		std::condition_variable jobDone_;       // Кадр записан
+
+		FrameCaptureStats stats_;               // Статистика
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		FrameCapture(const FrameCapture& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const FrameCapture& other) = delete;
+
+		/**
+		 * \brief Забрать пиксели из буфера кольца и поставить кадр в очередь записи
+		 * \param slot Буфер (чтение в него должно быть завершено)
+		 */
+		void resolve(Slot& slot);
+
+		/**
+		 * \brief Забрать все кадры, чтение которых завершено
+		 * \param wait Ждать завершения чтения всех занятых буферов
+		 */
+		void collect(bool wait);
+
+		/**
+		 * \brief Цикл потока кодирования
+		 */
+		void workerLoop();
+
+	public:
+		/**
+		 * \brief Конструктор
+		 * \param width Ширина кадра
+		 * \param height Высота кадра
+		 * \param pathPrefix Начало пути файлов (например "capture/frame_" - файлы "capture/frame_000001.png" и т.д.)
+		 * \param ringSize Кол-во буферов кольца (задержка чтения в кадрах)
+		 * \param threadCount Кол-во потоков кодирования (0 - по кол-ву ядер, не считая поток рендеринга)
+		 */
+		FrameCapture(GLuint width, GLuint height, const std::string& pathPrefix, GLuint ringSize = FRAME_CAPTURE_RING_SIZE, GLuint threadCount = 0);
+
+		/**
+		 * \brief Деструктор (дожидается записи всех захваченных кадров)
+		 */
+		~FrameCapture();
+
+		/**
+		 * \brief Захватить кадр
+		 * \param frameBufferId Кадровый буфер, из которого читается кадр (основной буфер контекста)
+		 * \param frameIndex Номер кадра (используется в имени файла)
+		 * \details Вызывается после рисования кадра и до смены буферов окна
+		 */
+		void capture(GLuint frameBufferId, GLuint frameIndex);
+
+		/**
+		 * \brief Дождаться записи всех захваченных кадров
+		 */
+		void flush();
+
+		/**
+		 * \brief Статистика захвата
+		 * \return Копия статистики
+		 */
+		FrameCaptureStats getStats();
+	};
+
+	/**
+	 * \brief Тип для умного указателя на захват кадров
+	 */
+	typedef std::shared_ptr<FrameCapture> FrameCapturePtr;
+
+	/**
+	 * \brief Создание захвата кадров
+	 * \param width Ширина кадра
+	 * \param height Высота кадра
+	 * \param pathPrefix Начало пути файлов
+	 * \param ringSize Кол-во буферов кольца
+	 * \param threadCount Кол-во потоков кодирования (0 - по кол-ву ядер)
+	 * \return Умный указатель на захват
+	 */
+	FrameCapturePtr MakeFrameCapture(GLuint width, GLuint height, const std::string& pathPrefix, GLuint ringSize = FRAME_CAPTURE_RING_SIZE, GLuint threadCount = 0);
+}
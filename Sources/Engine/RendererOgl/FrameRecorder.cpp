@@ -0,0 +1,455 @@
+﻿#include "FrameRecorder.h"
+#include "Renderer.h"
+#include <cstring>
+#include <stdexcept>
+
+namespace ogl
+{
+	/**
+	* \brief Хеш содержимого ресурса (FNV-1a)
+	* \param data Данные
+	* \param size Кол-во байт
+	* \param hash Хеш предыдущей части данных (для хеширования по частям)
+	* \return Хеш (не бывает нулевым - ноль означает отсутствие ресурса)
+	*/
+	GLuint64 FrameTraceHash(const void* data, size_t size, GLuint64 hash)
+	{
+		const unsigned char* bytes = static_cast<const unsigned char*>(data);
+		for (size_t i = 0; i < size; i++) {
+			hash ^= bytes[i];
+			hash *= 0x100000001b3ull;
+		}
+
+		return hash != 0 ? hash : 1;
+	}
+
+	/**
+	* \brief Положение меша
+	* \param mesh Меш
+	* \return Положение в формате трассы
+	*/
+	static FrameTraceMeshState GetMeshState(const StaticMesh& mesh)
+	{
+		FrameTraceMeshState state = {};
+		state.origin = mesh.origin;
+		state.rotation = mesh.rotation;
+		state.position = mesh.position;
+		state.scale = mesh.scale;
+		state.isRendering = mesh.isRendering ? 1 : 0;
+		return state;
+	}
+
+	/**
+	* \brief Состояние источника
+	* \param light Источник
+	* \return Состояние в формате трассы
+	*/
+	static FrameTraceLightState GetLightState(const Light& light)
+	{
+		FrameTraceLightState state = {};
+		state.render = light.render ? 1 : 0;
+		state.shadows = light.shadows ? 1 : 0;
+		state.renderScale = light.renderScale;
+		state.position = light.position;
+		state.rotation = light.rotation;
+		state.color = light.color;
+		state.cutOffAngle = light.cutOffAngle;
+		state.cutOffOuterAngle = light.cutOffOuterAngle;
+		state.attenuationLinear = light.attenuation.linear;
+		state.attenuationQuadratic = light.attenuation.quadratic;
+		return state;
+	}
+
+	/**
+	* \brief Параметры рендерера
+	* \param renderer Рендерер
+	* \return Параметры в формате трассы
+	*/
+	static FrameTraceSettings GetSettings(Renderer& renderer)
+	{
+		FrameTraceSettings settings = {};
+		settings.cameraPosition = renderer.cameraPosition;
+		settings.shadowVolumeMode = static_cast<GLuint>(renderer.shadowVolumeMode);
+		settings.shadowTechnique = static_cast<GLuint>(renderer.shadowTechnique);
+		settings.depthPrePassMode = static_cast<GLuint>(renderer.depthPrePassMode);
+		settings.depthPrePassThreshold = renderer.depthPrePassThreshold;
+		settings.showOverdraw = renderer.showOverdraw ? 1 : 0;
+		settings.gBufferLayout = static_cast<GLuint>(renderer.getGBufferLayout());
+		settings.cascadeCount = renderer.shadowCascades.cascadeCount;
+		settings.cascadeSplitLambda = renderer.shadowCascades.splitLambda;
+		settings.cascadeMaxDistance = renderer.shadowCascades.maxDistance;
+		settings.dynamicResolution = renderer.dynamicResolution.enabled ? 1 : 0;
+		settings.targetFrameTime = renderer.dynamicResolution.targetFrameTime;
+		settings.minScale = renderer.dynamicResolution.minScale;
+		settings.maxScale = renderer.dynamicResolution.maxScale;
+		settings.upscaleFilter = static_cast<GLuint>(renderer.dynamicResolution.filter);
+		settings.sharpness = renderer.dynamicResolution.sharpness;
+		settings.atlasSize = renderer.shadowAtlasSettings.size;
+		settings.atlasMinTileSize = renderer.shadowAtlasSettings.minTileSize;
+		settings.atlasMaxTileSize = renderer.shadowAtlasSettings.maxTileSize;
+		settings.atlasTilesPerFrame = renderer.shadowAtlasSettings.tilesPerFrame;
+		return settings;
+	}
+
+	/**
+	* \brief Открыть файл трассы
+	* \param path Путь к файлу
+	*/
+	FrameRecorder::FrameRecorder(const std::string& path) :
+		file_(path, std::ios::binary | std::ios::trunc),
+		start_(std::chrono::high_resolution_clock::now()),
+		nextId_(1),
+		frameCount_(0),
+		settings_({}),
+		settingsWritten_(false)
+	{
+		if (this->file_.fail()) {
+			throw std::runtime_error("OpenGL:FrameRecorder: Can't write trace file " + path);
+		}
+	}
+
+	/**
+	* \brief Завершить трассу и закрыть файл
+	*/
+	FrameRecorder::~FrameRecorder()
+	{
+		// Сеанс не начинался - трасса остается пустой
+		if (this->file_.tellp() <= 0) return;
+
+		this->write(static_cast<GLubyte>(FRAME_TRACE_END));
+
+		// Кол-во кадров в заголовке (после сигнатуры, версии и размеров кадра)
+		this->file_.seekp(sizeof(GLuint64) + sizeof(GLuint) * 3);
+		this->write(this->frameCount_);
+	}
+
+	/**
+	* \brief Записать содержимое ресурса (если оно еще не записано)
+	* \param kind Тип содержимого
+	* \param blob Данные
+	* \return Хеш содержимого
+	*/
+	GLuint64 FrameRecorder::writeBlob(FrameTraceBlob kind, const std::vector<char>& blob)
+	{
+		GLuint64 hash = FrameTraceHash(blob.data(), blob.size());
+		if (this->writtenBlobs_.insert(hash).second)
+		{
+			this->write(static_cast<GLubyte>(FRAME_TRACE_BLOB));
+			this->write(hash);
+			this->write(static_cast<GLuint>(kind));
+			this->write(static_cast<GLuint64>(blob.size()));
+			this->file_.write(blob.data(), blob.size());
+		}
+
+		return hash;
+	}
+
+	/**
+	* \brief Записать содержимое геометрии (вершины и индексы читаются из буферов)
+	* \param geometry Ресурс геометрии
+	* \return Хеш содержимого
+	*/
+	GLuint64 FrameRecorder::writeGeometry(const StaticGeometryResourcePtr& geometry)
+	{
+		auto cached = this->resourceHashes_.find(geometry.get());
+		if (cached != this->resourceHashes_.end() && !cached->second.first.expired()) return cached->second.second;
+
+		// Вершины и индексы в том виде, в котором они загружены (с рассчитанными нормалями, фантомными вершинами и смежностями)
+		std::vector<Vertex> vertices(geometry->getVertexCount());
+		std::vector<GLuint> indices(geometry->getIndexCount());
+
+		glBindBuffer(GL_COPY_READ_BUFFER, geometry->getVboId());
+		glGetBufferSubData(GL_COPY_READ_BUFFER, 0, vertices.size() * sizeof(Vertex), vertices.data());
+		if (!indices.empty()) {
+			glBindBuffer(GL_COPY_READ_BUFFER, geometry->getEboId());
+			glGetBufferSubData(GL_COPY_READ_BUFFER, 0, indices.size() * sizeof(GLuint), indices.data());
+		}
+		glBindBuffer(GL_COPY_READ_BUFFER, 0);
+
+		// Для геометрии со смежностями записываются исходные данные (смежности детерминированно строятся заново при воспроизведении)
+		GLuint adjacency = geometry->getShadowCasterData().positions.empty() ? 0 : 1;
+		if (adjacency)
+		{
+			size_t firstPhantom = 0;
+			while (firstPhantom < vertices.size() && !vertices[firstPhantom].phantom) firstPhantom++;
+			vertices.resize(firstPhantom);
+
+			for (size_t i = 0; i < indices.size() / 2; i++) {
+				indices[i] = indices[i * 2];
+			}
+			indices.resize(indices.size() / 2);
+		}
+
+		GLuint vertexCount = static_cast<GLuint>(vertices.size());
+		GLuint indexCount = static_cast<GLuint>(indices.size());
+		std::vector<char> blob(sizeof(GLuint) * 3 + vertices.size() * sizeof(Vertex) + indices.size() * sizeof(GLuint));
+		char* cursor = blob.data();
+		memcpy(cursor, &vertexCount, sizeof(GLuint)); cursor += sizeof(GLuint);
+		memcpy(cursor, &indexCount, sizeof(GLuint)); cursor += sizeof(GLuint);
+		memcpy(cursor, &adjacency, sizeof(GLuint)); cursor += sizeof(GLuint);
+		if (!vertices.empty()) memcpy(cursor, vertices.data(), vertices.size() * sizeof(Vertex));
+		cursor += vertices.size() * sizeof(Vertex);
+		if (!indices.empty()) memcpy(cursor, indices.data(), indices.size() * sizeof(GLuint));
+
+		GLuint64 hash = this->writeBlob(FRAME_TRACE_BLOB_GEOMETRY, blob);
+		this->resourceHashes_[geometry.get()] = { std::weak_ptr<void>(geometry), hash };
+		return hash;
+	}
+
+	/**
+	* \brief Записать содержимое текстуры (нулевой уровень читается из текстуры)
+	* \param texture Ресурс текстуры
+	* \return Хеш содержимого (0 - текстуры нет)
+	*/
+	GLuint64 FrameRecorder::writeTexture(const TextureResourcePtr& texture)
+	{
+		if (!texture) return 0;
+
+		auto cached = this->resourceHashes_.find(texture.get());
+		if (cached != this->resourceHashes_.end() && !cached->second.first.expired()) return cached->second.second;
+
+		// Пиксели читаются в формате и типе самой текстуры (без потери точности), строки читаются без выравнивания
+		GLuint header[6] = {
+			texture->getWidth(),
+			texture->getHeight(),
+			texture->getBpp(),
+			texture->getFormat(),
+			texture->getType(),
+			texture->hasMipmaps() ? 1u : 0u
+		};
+
+		std::vector<char> blob(sizeof(header) + static_cast<size_t>(header[0]) * header[1] * texture->getPixelSize());
+		memcpy(blob.data(), header, sizeof(header));
+
+		GLint packAlignment = 4;
+		glGetIntegerv(GL_PACK_ALIGNMENT, &packAlignment);
+		glPixelStorei(GL_PACK_ALIGNMENT, 1);
+		glBindTexture(GL_TEXTURE_2D, texture->getId());
+		glGetTexImage(GL_TEXTURE_2D, 0, texture->getFormat(), texture->getType(), blob.data() + sizeof(header));
+		glBindTexture(GL_TEXTURE_2D, 0);
+		glPixelStorei(GL_PACK_ALIGNMENT, packAlignment);
+
+		GLuint64 hash = this->writeBlob(FRAME_TRACE_BLOB_TEXTURE, blob);
+		this->resourceHashes_[texture.get()] = { std::weak_ptr<void>(texture), hash };
+		return hash;
+	}
+
+	/**
+	* \brief Записать параметры текстуры части меша
+	* \param parameters Параметры
+	* \param hash Хеш содержимого текстуры
+	*/
+	void FrameRecorder::writeTextureParameters(const TextureParameters& parameters, GLuint64 hash)
+	{
+		this->write(hash);
+		this->write(parameters.offset);
+		this->write(parameters.scale);
+		this->write(parameters.rotation);
+		this->write(parameters.wrapS);
+		this->write(parameters.wrapT);
+	}
+
+	/**
+	* \brief Начать сеанс (записываются заголовок трассы и уже добавленные меши и источники)
+	* \param renderer Рендерер
+	*/
+	void FrameRecorder::beginSession(Renderer& renderer)
+	{
+		// Заголовок (кол-во кадров дописывается при закрытии)
+		this->write(static_cast<GLuint64>(FRAME_TRACE_MAGIC));
+		this->write(static_cast<GLuint>(FRAME_TRACE_VERSION));
+		this->write(renderer.viewPort.width);
+		this->write(renderer.viewPort.height);
+		this->write(static_cast<GLuint>(0));
+		this->start_ = std::chrono::high_resolution_clock::now();
+
+		for (const StaticMeshPtr& mesh : renderer.getStaticMeshes()) {
+			this->onAddStaticMesh(mesh);
+		}
+
+		for (const LightPtr& light : renderer.getLights()) {
+			this->onAddLight(light);
+		}
+	}
+
+	/**
+	* \brief Меш добавлен в рендерер
+	* \param mesh Меш
+	*/
+	void FrameRecorder::onAddStaticMesh(const StaticMeshPtr& mesh)
+	{
+		// Содержимое ресурсов записывается до ссылающейся на него записи
+		std::vector<StaticMeshPart>& parts = mesh->getParts();
+		std::vector<GLuint64> hashes;
+		for (const StaticMeshPart& part : parts) {
+			hashes.push_back(this->writeGeometry(part.getGeometry()));
+			hashes.push_back(this->writeTexture(part.diffuseTexture.resource));
+			hashes.push_back(this->writeTexture(part.detailTexture.resource));
+			hashes.push_back(this->writeTexture(part.specularTexture.resource));
+			hashes.push_back(this->writeTexture(part.bumpTexture.resource));
+			hashes.push_back(this->writeTexture(part.displacementTexture.resource));
+		}
+
+		MeshEntry entry = { this->nextId_++, GetMeshState(*mesh) };
+		this->meshes_[mesh.get()] = entry;
+
+		this->write(static_cast<GLubyte>(FRAME_TRACE_ADD_MESH));
+		this->write(entry.id);
+		this->write(entry.state);
+		this->write(static_cast<GLuint>(parts.size()));
+
+		for (size_t i = 0; i < parts.size(); i++)
+		{
+			const StaticMeshPart& part = parts[i];
+			const GLuint64* partHashes = &hashes[i * 6];
+
+			this->write(partHashes[0]);
+			this->write(part.material);
+			this->writeTextureParameters(part.diffuseTexture, partHashes[1]);
+			this->writeTextureParameters(part.detailTexture, partHashes[2]);
+			this->writeTextureParameters(part.specularTexture, partHashes[3]);
+			this->writeTextureParameters(part.bumpTexture, partHashes[4]);
+			this->writeTextureParameters(part.displacementTexture, partHashes[5]);
+			this->write(static_cast<GLuint>(part.parallaxQuality));
+		}
+	}
+
+	/**
+	* \brief Меш удаляется из рендерера
+	* \param mesh Меш
+	*/
+	void FrameRecorder::onRemoveStaticMesh(const StaticMeshPtr& mesh)
+	{
+		auto entry = this->meshes_.find(mesh.get());
+		if (entry == this->meshes_.end()) return;
+
+		this->write(static_cast<GLubyte>(FRAME_TRACE_REMOVE_MESH));
+		this->write(entry->second.id);
+		this->meshes_.erase(entry);
+	}
+
+	/**
+	* \brief Источник добавлен в рендерер
+	* \param light Источник
+	*/
+	void FrameRecorder::onAddLight(const LightPtr& light)
+	{
+		LightEntry entry = { this->nextId_++, GetLightState(*light) };
+		this->lights_[light.get()] = entry;
+
+		this->write(static_cast<GLubyte>(FRAME_TRACE_ADD_LIGHT));
+		this->write(entry.id);
+		this->write(static_cast<GLuint>(light->getType()));
+		this->write(entry.state);
+	}
+
+	/**
+	* \brief Источник удаляется из рендерера
+	* \param light Источник
+	*/
+	void FrameRecorder::onRemoveLight(const LightPtr& light)
+	{
+		auto entry = this->lights_.find(light.get());
+		if (entry == this->lights_.end()) return;
+
+		this->write(static_cast<GLubyte>(FRAME_TRACE_REMOVE_LIGHT));
+		this->write(entry->second.id);
+		this->lights_.erase(entry);
+	}
+
+	/**
+	* \brief Установлена матрица вида
+	* \param matrix Матрица
+	*/
+	void FrameRecorder::onViewMatrix(const glm::mat4& matrix)
+	{
+		this->write(static_cast<GLubyte>(FRAME_TRACE_VIEW));
+		this->write(matrix);
+	}
+
+	/**
+	* \brief Установлена матрица проекции
+	* \param matrix Матрица
+	*/
+	void FrameRecorder::onProjectionMatrix(const glm::mat4& matrix)
+	{
+		this->write(static_cast<GLubyte>(FRAME_TRACE_PROJECTION));
+		this->write(matrix);
+	}
+
+	/**
+	* \brief Начало кадра (записываются изменения положений и параметров, затем сам кадр)
+	* \param renderer Рендерер
+	* \param clearColor Цвет очистки
+	* \param clearMask Маска очистки
+	*/
+	void FrameRecorder::onDrawFrame(Renderer& renderer, const glm::vec4& clearColor, GLbitfield clearMask)
+	{
+		// Изменившиеся положения мешей (побайтовое сравнение - любое изменение значения попадает в трассу)
+		for (const StaticMeshPtr& mesh : renderer.getStaticMeshes())
+		{
+			auto entry = this->meshes_.find(mesh.get());
+			if (entry == this->meshes_.end()) continue;
+
+			FrameTraceMeshState state = GetMeshState(*mesh);
+			if (memcmp(&state, &(entry->second.state), sizeof(state)) == 0) continue;
+
+			entry->second.state = state;
+			this->write(static_cast<GLubyte>(FRAME_TRACE_MESH_STATE));
+			this->write(entry->second.id);
+			this->write(state);
+		}
+
+		// Изменившиеся источники
+		for (const LightPtr& light : renderer.getLights())
+		{
+			auto entry = this->lights_.find(light.get());
+			if (entry == this->lights_.end()) continue;
+
+			FrameTraceLightState state = GetLightState(*light);
+			if (memcmp(&state, &(entry->second.state), sizeof(state)) == 0) continue;
+
+			entry->second.state = state;
+			this->write(static_cast<GLubyte>(FRAME_TRACE_LIGHT_STATE));
+			this->write(entry->second.id);
+			this->write(state);
+		}
+
+		// Параметры рендерера
+		FrameTraceSettings settings = GetSettings(renderer);
+		if (!this->settingsWritten_ || memcmp(&settings, &(this->settings_), sizeof(settings)) != 0)
+		{
+			this->settings_ = settings;
+			this->settingsWritten_ = true;
+			this->write(static_cast<GLubyte>(FRAME_TRACE_SETTINGS));
+			this->write(settings);
+		}
+
+		// Кадр
+		this->write(static_cast<GLubyte>(FRAME_TRACE_FRAME));
+		this->write(static_cast<GLuint64>(std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::high_resolution_clock::now() - this->start_).count()));
+		this->write(clearColor);
+		this->write(static_cast<GLuint>(clearMask));
+		this->write(renderer.getRenderScale());
+		this->frameCount_++;
+	}
+
+	/**
+	* \brief Кол-во записанных кадров
+	* \return Кол-во кадров
+	*/
+	GLuint FrameRecorder::getFrameCount() const
+	{
+		return this->frameCount_;
+	}
+
+	/**
+	* \brief Создание записи сеанса
+	* \param path Путь к файлу трассы
+	* \return Умный указатель на запись
+	*/
+	FrameRecorderPtr MakeFrameRecorder(const std::string& path)
+	{
+		return std::make_shared<FrameRecorder>(path);
+	}
+}
@@ -0,0 +1,287 @@
+﻿#pragma once
+
+#include <map>
+#include <set>
+#include <vector>
+#include <string>
+#include <memory>
+#include <fstream>
+#include <chrono>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "StaticMesh.h"
+#include "Light.h"
+
+#define FRAME_TRACE_MAGIC 0x45434152544C474Full // "OGLTRACE"
+#define FRAME_TRACE_VERSION 3
+
+namespace ogl
+{
+	class Renderer;
+
+	/**
+	 * \brief Тип записи трассы сеанса
+	 */
+	enum FrameTraceRecord
+	{
+		FRAME_TRACE_END = 0,            // Конец трассы
+		FRAME_TRACE_BLOB = 1,           // Содержимое ресурса (хеш, тип, размер, данные)
+		FRAME_TRACE_ADD_MESH = 2,       // Добавление меша (идентификатор, положение, части)
+		FRAME_TRACE_REMOVE_MESH = 3,    // Удаление меша (идентификатор)
+		FRAME_TRACE_ADD_LIGHT = 4,      // Добавление источника (идентификатор, тип, состояние)
+		FRAME_TRACE_REMOVE_LIGHT = 5,   // Удаление источника (идентификатор)
+		FRAME_TRACE_MESH_STATE = 6,     // Изменение положения меша (идентификатор, положение)
+		FRAME_TRACE_LIGHT_STATE = 7,    // Изменение источника (идентификатор, состояние)
+		FRAME_TRACE_VIEW = 8,           // Матрица вида
+		FRAME_TRACE_PROJECTION = 9,     // Матрица проекции
+		FRAME_TRACE_SETTINGS = 10,      // Параметры рендерера
+		FRAME_TRACE_FRAME = 11          // Вызов drawFrame (время от начала записи, цвет и маска очистки, масштаб разрешения)
+	};
+
+	/**
+	 * \brief Тип содержимого ресурса
+	 */
+	enum FrameTraceBlob
+	{
+		FRAME_TRACE_BLOB_GEOMETRY = 1,  // Вершины и индексы геометрии
+		FRAME_TRACE_BLOB_TEXTURE = 2    // Размеры, формат и тип пикселей, пиксели нулевого уровня текстуры
+	};
+
+	/**
+	 * \brief Положение меша в трассе
+	 */
+	struct FrameTraceMeshState
+	{
+		glm::vec3 origin;
+		glm::vec3 rotation;
+		glm::vec3 position;
+		glm::vec3 scale;
+		GLuint isRendering;
+	};
+
+	/**
+	 * \brief Состояние источника в трассе
+	 */
+	struct FrameTraceLightState
+	{
+		GLuint render;
+		GLuint shadows;
+		GLfloat renderScale;
+		glm::vec3 position;
+		glm::vec3 rotation;
+		glm::vec3 color;
+		GLfloat cutOffAngle;
+		GLfloat cutOffOuterAngle;
+		GLfloat attenuationLinear;
+		GLfloat attenuationQuadratic;
+	};
+
+	/**
+	 * \brief Параметры рендерера в трассе (записываются только при изменении)
+	 */
+	struct FrameTraceSettings
+	{
+		glm::vec3 cameraPosition;
+		GLuint shadowVolumeMode;
+		GLuint shadowTechnique;
+		GLuint depthPrePassMode;
+		GLfloat depthPrePassThreshold;
+		GLuint showOverdraw;
+		GLuint gBufferLayout;
+		GLuint cascadeCount;
+		GLfloat cascadeSplitLambda;
+		GLfloat cascadeMaxDistance;
+		GLuint dynamicResolution;
+		GLfloat targetFrameTime;
+		GLfloat minScale;
+		GLfloat maxScale;
+		GLuint upscaleFilter;
+		GLfloat sharpness;
+		GLuint atlasSize;
+		GLuint atlasMinTileSize;
+		GLuint atlasMaxTileSize;
+		GLuint atlasTilesPerFrame;
+	};
+
+	/**
+	 * \brief Хеш содержимого ресурса (FNV-1a)
+	 * \param data Данные
+	 * \param size Кол-во байт
+	 * \param hash Хеш предыдущей части данных (для хеширования по частям)
+	 * \return Хеш (не бывает нулевым - ноль означает отсутствие ресурса)
+	 */
+	GLuint64 FrameTraceHash(const void* data, size_t size, GLuint64 hash = 0xcbf29ce484222325ull);
+
+	/**
+	 * \brief Запись сеанса рендерера в двоичную трассу
+	 * \details Рендерер сообщает о добавлении и удалении мешей и источников, матрицах камеры и кадрах. Перед каждым
+	 * кадром записываются изменившиеся положения мешей, состояния источников и параметры рендерера. Содержимое
+	 * геометрии и текстур читается из видеопамяти и записывается один раз (ресурсы ссылаются на него по хешу),
+	 * числа с плавающей точкой записываются без преобразований - воспроизведение получает те же входные данные.
+	 * Эффекты пост-обработки и шейдеры рендерера не записываются
+	 */
+	class FrameRecorder
+	{
+	private:
+		/**
+		 * \brief Записанный меш
+		 */
+		struct MeshEntry
+		{
+			GLuint id;                    // Идентификатор в трассе
+			FrameTraceMeshState state;    // Последнее записанное положение
+		};
+
+		/**
+		 * \brief Записанный источник
+		 */
+		struct LightEntry
+		{
+			GLuint id;                    // Идентификатор в трассе
+			FrameTraceLightState state;   // Последнее записанное состояние
+		};
+
+		std::ofstream file_;                                  // Файл трассы
+		std::chrono::high_resolution_clock::time_point start_; // Начало записи
+		GLuint nextId_;                                       // Следующий идентификатор меша или источника
+		GLuint frameCount_;                                   // Кол-во записанных кадров
+		std::map<const StaticMesh*, MeshEntry> meshes_;       // Меши сеанса
+		std::map<const Light*, LightEntry> lights_;           // Источники сеанса
+		std::map<const void*, std::pair<std::weak_ptr<void>, GLuint64>> resourceHashes_; // Хеши записанных ресурсов (по адресу ресурса)
+		std::set<GLuint64> writtenBlobs_;                     // Записанное содержимое (хеши)
+		FrameTraceSettings settings_;                         // Последние записанные параметры
+		bool settingsWritten_;                                // Параметры уже записаны
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		FrameRecorder(const FrameRecorder& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const FrameRecorder& other) = delete;
+
+		/**
+		 * \brief Записать значение без преобразований
+		 * \param value Значение
+		 */
+		template <typename T>
+		void write(const T& value)
+		{
+			this->file_.write(reinterpret_cast<const char*>(&value), sizeof(T));
+		}
+
+		/**
+		 * \brief Записать содержимое ресурса (если оно еще не записано)
+		 * \param kind Тип содержимого
+		 * \param blob Данные
+		 * \return Хеш содержимого
+		 */
+		GLuint64 writeBlob(FrameTraceBlob kind, const std::vector<char>& blob);
+
+		/**
+		 * \brief Записать содержимое геометрии (вершины и индексы читаются из буферов)
+		 * \param geometry Ресурс геометрии
+		 * \return Хеш содержимого
+		 */
+		GLuint64 writeGeometry(const StaticGeometryResourcePtr& geometry);
+
+		/**
+		 * \brief Записать содержимое текстуры (нулевой уровень читается из текстуры)
+		 * \param texture Ресурс текстуры
+		 * \return Хеш содержимого (0 - текстуры нет)
+		 */
+		GLuint64 writeTexture(const TextureResourcePtr& texture);
+
+		/**
+		 * \brief Записать параметры текстуры части меша
+		 * \param parameters Параметры
+		 * \param hash Хеш содержимого текстуры
+		 */
+		void writeTextureParameters(const TextureParameters& parameters, GLuint64 hash);
+
+	public:
+		/**
+		 * \brief Открыть файл трассы
+		 * \param path Путь к файлу
+		 */
+		explicit FrameRecorder(const std::string& path);
+
+		/**
+		 * \brief Завершить трассу и закрыть файл
+		 */
+		~FrameRecorder();
+
+		/**
+		 * \brief Начать сеанс (записываются заголовок трассы и уже добавленные меши и источники)
+		 * \param renderer Рендерер
+		 */
+		void beginSession(Renderer& renderer);
+
+		/**
+		 * \brief Меш добавлен в рендерер
+		 * \param mesh Меш
+		 */
+		void onAddStaticMesh(const StaticMeshPtr& mesh);
+
+		/**
+		 * \brief Меш удаляется из рендерера
+		 * \param mesh Меш
+		 */
+		void onRemoveStaticMesh(const StaticMeshPtr& mesh);
+
+		/**
+		 * \brief Источник добавлен в рендерер
+		 * \param light Источник
+		 */
+		void onAddLight(const LightPtr& light);
+
+		/**
+		 * \brief Источник удаляется из рендерера
+		 * \param light Источник
+		 */
+		void onRemoveLight(const LightPtr& light);
+
+		/**
+		 * \brief Установлена матрица вида
+		 * \param matrix Матрица
+		 */
+		void onViewMatrix(const glm::mat4& matrix);
+
+		/**
+		 * \brief Установлена матрица проекции
+		 * \param matrix Матрица
+		 */
+		void onProjectionMatrix(const glm::mat4& matrix);
+
+		/**
+		 * \brief Начало кадра (записываются изменения положений и параметров, затем сам кадр)
+		 * \param renderer Рендерер
+		 * \param clearColor Цвет очистки
+		 * \param clearMask Маска очистки
+		 */
+		void onDrawFrame(Renderer& renderer, const glm::vec4& clearColor, GLbitfield clearMask);
+
+		/**
+		 * \brief Кол-во записанных кадров
+		 * \return Кол-во кадров
+		 */
+		GLuint getFrameCount() const;
+	};
+
+	/**
+	 * \brief Тип для умного указателя на запись сеанса
+	 */
+	typedef std::shared_ptr<FrameRecorder> FrameRecorderPtr;
+
+	/**
+	 * \brief Создание записи сеанса
+	 * \param path Путь к файлу трассы
+	 * \return Умный указатель на запись
+	 */
+	FrameRecorderPtr MakeFrameRecorder(const std::string& path);
+}
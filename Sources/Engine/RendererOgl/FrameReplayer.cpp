@@ -0,0 +1,364 @@
+﻿#include "FrameReplayer.h"
+#include "Renderer.h"
+#include <cstring>
+#include <fstream>
+#include <thread>
+#include <stdexcept>
+
+namespace ogl
+{
+	/**
+	* \brief Загрузить трассу
+	* \param path Путь к файлу трассы
+	*/
+	FrameReplayer::FrameReplayer(const std::string& path) :
+		cursor_(0),
+		width_(0),
+		height_(0),
+		frameCount_(0),
+		framesPlayed_(0)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (file.fail()) {
+			throw std::runtime_error("OpenGL:FrameReplayer: Can't read trace file " + path);
+		}
+
+		this->data_.assign(std::istreambuf_iterator<char>(file), std::istreambuf_iterator<char>());
+
+		// Заголовок: сигнатура, версия, размеры кадра, кол-во кадров
+		if (this->data_.size() < sizeof(GLuint64) + sizeof(GLuint) * 4 || this->read<GLuint64>() != FRAME_TRACE_MAGIC) {
+			throw std::runtime_error("OpenGL:FrameReplayer: Not a trace file " + path);
+		}
+
+		if (this->read<GLuint>() != FRAME_TRACE_VERSION) {
+			throw std::runtime_error("OpenGL:FrameReplayer: Unsupported trace version " + path);
+		}
+
+		this->width_ = this->read<GLuint>();
+		this->height_ = this->read<GLuint>();
+		this->frameCount_ = this->read<GLuint>();
+	}
+
+	/**
+	* \brief Прочитать байты (конец трассы посреди записи - исключение)
+	* \param destination Куда копировать
+	* \param size Кол-во байт
+	*/
+	void FrameReplayer::readBytes(void* destination, size_t size)
+	{
+		if (this->data_.size() - this->cursor_ < size) {
+			throw std::runtime_error("OpenGL:FrameReplayer: Unexpected end of trace");
+		}
+
+		if (size > 0) memcpy(destination, this->data_.data() + this->cursor_, size);
+		this->cursor_ += size;
+	}
+
+	/**
+	* \brief Создать ресурс из записанного содержимого
+	*/
+	void FrameReplayer::readBlob()
+	{
+		GLuint64 hash = this->read<GLuint64>();
+		GLuint kind = this->read<GLuint>();
+		GLuint64 size = this->read<GLuint64>();
+		size_t end = this->cursor_ + static_cast<size_t>(size);
+
+		if (kind == FRAME_TRACE_BLOB_GEOMETRY)
+		{
+			GLuint vertexCount = this->read<GLuint>();
+			GLuint indexCount = this->read<GLuint>();
+			GLuint adjacency = this->read<GLuint>();
+
+			std::vector<Vertex> vertices(vertexCount);
+			std::vector<GLuint> indices(indexCount);
+			this->readBytes(vertices.data(), vertices.size() * sizeof(Vertex));
+			this->readBytes(indices.data(), indices.size() * sizeof(GLuint));
+
+			// Нормали и тангенты уже рассчитаны при записи, смежности строятся заново
+			this->geometries_[hash] = MakeStaticGeometryResource(vertices, indices, false, false, false, adjacency != 0);
+		}
+		else if (kind == FRAME_TRACE_BLOB_TEXTURE)
+		{
+			GLuint width = this->read<GLuint>();
+			GLuint height = this->read<GLuint>();
+			GLuint bpp = this->read<GLuint>();
+			GLuint format = this->read<GLuint>();
+			GLuint type = this->read<GLuint>();
+			GLuint mipmaps = this->read<GLuint>();
+
+			std::vector<char> pixels(static_cast<size_t>(width) * height * TextureResource::calculatePixelSize(format, type));
+			this->readBytes(pixels.data(), pixels.size());
+
+			// Строки записаны без выравнивания, в формате и типе исходной текстуры
+			GLint unpackAlignment = 4;
+			glGetIntegerv(GL_UNPACK_ALIGNMENT, &unpackAlignment);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, 1);
+			this->textures_[hash] = MakeTextureResource(pixels.data(), width, height, bpp, mipmaps != 0, type);
+			glPixelStorei(GL_UNPACK_ALIGNMENT, unpackAlignment);
+
+			if (this->textures_[hash]->getFormat() != format) {
+				throw std::runtime_error("OpenGL:FrameReplayer: Texture format mismatch");
+			}
+		}
+
+		// Неизвестное содержимое пропускается
+		if (end > this->data_.size()) {
+			throw std::runtime_error("OpenGL:FrameReplayer: Unexpected end of trace");
+		}
+		this->cursor_ = end;
+	}
+
+	/**
+	* \brief Прочитать параметры текстуры части меша
+	* \param parameters Параметры
+	*/
+	void FrameReplayer::readTextureParameters(TextureParameters* parameters)
+	{
+		GLuint64 hash = this->read<GLuint64>();
+		parameters->resource = hash != 0 ? this->textures_.at(hash) : nullptr;
+		parameters->offset = this->read<glm::vec2>();
+		parameters->scale = this->read<glm::vec2>();
+		parameters->rotation = this->read<GLfloat>();
+		parameters->wrapS = this->read<GLint>();
+		parameters->wrapT = this->read<GLint>();
+	}
+
+	/**
+	* \brief Прочитать добавление меша
+	* \param renderer Рендерер
+	*/
+	void FrameReplayer::readAddMesh(Renderer* renderer)
+	{
+		GLuint id = this->read<GLuint>();
+		FrameTraceMeshState state = this->read<FrameTraceMeshState>();
+		GLuint partCount = this->read<GLuint>();
+
+		std::vector<StaticMeshPart> parts;
+		for (GLuint i = 0; i < partCount; i++)
+		{
+			StaticMeshPart part(this->geometries_.at(this->read<GLuint64>()));
+			part.material = this->read<MaterialSettings>();
+			this->readTextureParameters(&(part.diffuseTexture));
+			this->readTextureParameters(&(part.detailTexture));
+			this->readTextureParameters(&(part.specularTexture));
+			this->readTextureParameters(&(part.bumpTexture));
+			this->readTextureParameters(&(part.displacementTexture));
+			part.parallaxQuality = static_cast<ParallaxQuality>(this->read<GLuint>());
+			parts.push_back(part);
+		}
+
+		StaticMesh mesh(parts);
+		FrameReplayer::applyMeshState(&mesh, state);
+		this->meshes_[id] = renderer->addStaticMesh(mesh);
+	}
+
+	/**
+	* \brief Применить записанные параметры рендерера
+	* \param renderer Рендерер
+	* \param settings Параметры
+	*/
+	void FrameReplayer::applySettings(Renderer* renderer, const FrameTraceSettings& settings)
+	{
+		renderer->cameraPosition = settings.cameraPosition;
+		renderer->shadowVolumeMode = static_cast<ShadowVolumeMode>(settings.shadowVolumeMode);
+		renderer->shadowTechnique = static_cast<ShadowTechnique>(settings.shadowTechnique);
+		renderer->depthPrePassMode = static_cast<DepthPrePassMode>(settings.depthPrePassMode);
+		renderer->depthPrePassThreshold = settings.depthPrePassThreshold;
+		renderer->showOverdraw = settings.showOverdraw != 0;
+		renderer->shadowCascades.cascadeCount = settings.cascadeCount;
+		renderer->shadowCascades.splitLambda = settings.cascadeSplitLambda;
+		renderer->shadowCascades.maxDistance = settings.cascadeMaxDistance;
+		renderer->dynamicResolution.enabled = settings.dynamicResolution != 0;
+		renderer->dynamicResolution.targetFrameTime = settings.targetFrameTime;
+		renderer->dynamicResolution.minScale = settings.minScale;
+		renderer->dynamicResolution.maxScale = settings.maxScale;
+		renderer->dynamicResolution.filter = static_cast<UpscaleFilter>(settings.upscaleFilter);
+		renderer->dynamicResolution.sharpness = settings.sharpness;
+		renderer->shadowAtlasSettings.size = settings.atlasSize;
+		renderer->shadowAtlasSettings.minTileSize = settings.atlasMinTileSize;
+		renderer->shadowAtlasSettings.maxTileSize = settings.atlasMaxTileSize;
+		renderer->shadowAtlasSettings.tilesPerFrame = settings.atlasTilesPerFrame;
+
+		if (renderer->getGBufferLayout() != static_cast<GBufferLayout>(settings.gBufferLayout)) {
+			renderer->setGBufferLayout(static_cast<GBufferLayout>(settings.gBufferLayout));
+		}
+	}
+
+	/**
+	* \brief Применить записанное состояние источника
+	* \param light Источник
+	* \param state Состояние
+	*/
+	void FrameReplayer::applyLightState(Light* light, const FrameTraceLightState& state)
+	{
+		light->render = state.render != 0;
+		light->shadows = state.shadows != 0;
+		light->renderScale = state.renderScale;
+		light->position = state.position;
+		light->rotation = state.rotation;
+		light->color = state.color;
+		light->cutOffAngle = state.cutOffAngle;
+		light->cutOffOuterAngle = state.cutOffOuterAngle;
+		light->attenuation.linear = state.attenuationLinear;
+		light->attenuation.quadratic = state.attenuationQuadratic;
+	}
+
+	/**
+	* \brief Применить записанное положение меша
+	* \param mesh Меш
+	* \param state Положение
+	*/
+	void FrameReplayer::applyMeshState(StaticMesh* mesh, const FrameTraceMeshState& state)
+	{
+		mesh->origin = state.origin;
+		mesh->rotation = state.rotation;
+		mesh->position = state.position;
+		mesh->scale = state.scale;
+		mesh->isRendering = state.isRendering != 0;
+	}
+
+	/**
+	* \brief Ширина кадра при записи
+	* \return Целое число
+	*/
+	GLuint FrameReplayer::getWidth() const
+	{
+		return this->width_;
+	}
+
+	/**
+	* \brief Высота кадра при записи
+	* \return Целое число
+	*/
+	GLuint FrameReplayer::getHeight() const
+	{
+		return this->height_;
+	}
+
+	/**
+	* \brief Кол-во кадров в трассе
+	* \return Целое число
+	*/
+	GLuint FrameReplayer::getFrameCount() const
+	{
+		return this->frameCount_;
+	}
+
+	/**
+	* \brief Воспроизвести следующий кадр
+	* \param renderer Рендерер
+	* \param paced Соблюдать темп записи (ожидать момента кадра), иначе - рисовать сразу
+	* \return Был ли нарисован кадр (false - трасса закончилась)
+	*/
+	bool FrameReplayer::nextFrame(Renderer* renderer, bool paced)
+	{
+		while (this->cursor_ < this->data_.size())
+		{
+			GLubyte record = this->read<GLubyte>();
+
+			switch (record)
+			{
+			case FRAME_TRACE_END:
+				this->cursor_ = this->data_.size();
+				return false;
+
+			case FRAME_TRACE_BLOB:
+				this->readBlob();
+				break;
+
+			case FRAME_TRACE_ADD_MESH:
+				this->readAddMesh(renderer);
+				break;
+
+			case FRAME_TRACE_REMOVE_MESH:
+			{
+				auto mesh = this->meshes_.find(this->read<GLuint>());
+				if (mesh != this->meshes_.end()) {
+					renderer->removeStaticMesh(mesh->second);
+					this->meshes_.erase(mesh);
+				}
+				break;
+			}
+
+			case FRAME_TRACE_ADD_LIGHT:
+			{
+				GLuint id = this->read<GLuint>();
+				LightType type = static_cast<LightType>(this->read<GLuint>());
+				FrameTraceLightState state = this->read<FrameTraceLightState>();
+
+				Light light(type);
+				FrameReplayer::applyLightState(&light, state);
+				this->lights_[id] = renderer->addLight(light);
+				break;
+			}
+
+			case FRAME_TRACE_REMOVE_LIGHT:
+			{
+				auto light = this->lights_.find(this->read<GLuint>());
+				if (light != this->lights_.end()) {
+					renderer->removeLight(light->second);
+					this->lights_.erase(light);
+				}
+				break;
+			}
+
+			case FRAME_TRACE_MESH_STATE:
+			{
+				GLuint id = this->read<GLuint>();
+				FrameTraceMeshState state = this->read<FrameTraceMeshState>();
+				FrameReplayer::applyMeshState(this->meshes_.at(id).get(), state);
+				break;
+			}
+
+			case FRAME_TRACE_LIGHT_STATE:
+			{
+				GLuint id = this->read<GLuint>();
+				FrameTraceLightState state = this->read<FrameTraceLightState>();
+				FrameReplayer::applyLightState(this->lights_.at(id).get(), state);
+				break;
+			}
+
+			case FRAME_TRACE_VIEW:
+				renderer->setViewMatrix(this->read<glm::mat4>());
+				break;
+
+			case FRAME_TRACE_PROJECTION:
+				renderer->setProjectionMatrix(this->read<glm::mat4>());
+				break;
+
+			case FRAME_TRACE_SETTINGS:
+				FrameReplayer::applySettings(renderer, this->read<FrameTraceSettings>());
+				break;
+
+			case FRAME_TRACE_FRAME:
+			{
+				GLuint64 timestamp = this->read<GLuint64>();
+				glm::vec4 clearColor = this->read<glm::vec4>();
+				GLbitfield clearMask = static_cast<GLbitfield>(this->read<GLuint>());
+				GLfloat renderScale = this->read<GLfloat>();
+
+				// Отсчет темпа ведется от первого кадра
+				if (this->framesPlayed_ == 0) {
+					this->start_ = std::chrono::high_resolution_clock::now() - std::chrono::microseconds(timestamp);
+				}
+
+				if (paced) {
+					std::this_thread::sleep_until(this->start_ + std::chrono::microseconds(timestamp));
+				}
+
+				// Масштаб разрешения записанного кадра (подбор по времени кадра при воспроизведении не выполняется)
+				renderer->setRenderScaleOverride(renderScale);
+				renderer->drawFrame(clearColor, clearMask);
+				this->framesPlayed_++;
+				return true;
+			}
+
+			default:
+				throw std::runtime_error("OpenGL:FrameReplayer: Unknown trace record " + std::to_string(record));
+			}
+		}
+
+		return false;
+	}
+}
@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <map>
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <GL/glew.h>
+
+#include "FrameRecorder.h"
+
+namespace ogl
+{
+	/**
+	 * \brief Воспроизведение трассы сеанса, записанной FrameRecorder
+	 * \details Трасса читается целиком при создании. Каждый вызов nextFrame применяет к рендереру записи до очередного
+	 * кадра (ресурсы создаются из записанного содержимого, меши и источники добавляются, удаляются и перемещаются,
+	 * устанавливаются матрицы и параметры) и рисует кадр в записанном масштабе разрешения. Рендерер должен быть создан
+	 * с контекстом размера трассы и не содержать своих мешей и источников. Требует текущего контекста OpenGL
+	 */
+	class FrameReplayer
+	{
+	private:
+		std::vector<char> data_;                                     // Содержимое трассы
+		size_t cursor_;                                              // Положение чтения
+		GLuint width_;                                               // Ширина кадра при записи
+		GLuint height_;                                              // Высота кадра при записи
+		GLuint frameCount_;                                          // Кол-во кадров в трассе
+		GLuint framesPlayed_;                                        // Кол-во воспроизведенных кадров
+		std::chrono::high_resolution_clock::time_point start_;       // Начало воспроизведения (для соблюдения темпа)
+		std::map<GLuint64, StaticGeometryResourcePtr> geometries_;   // Геометрия (по хешу содержимого)
+		std::map<GLuint64, TextureResourcePtr> textures_;            // Текстуры (по хешу содержимого)
+		std::map<GLuint, StaticMeshPtr> meshes_;                     // Меши (по идентификатору в трассе)
+		std::map<GLuint, LightPtr> lights_;                          // Источники (по идентификатору в трассе)
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		FrameReplayer(const FrameReplayer& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const FrameReplayer& other) = delete;
+
+		/**
+		 * \brief Прочитать значение без преобразований
+		 * \return Значение
+		 */
+		template <typename T>
+		T read()
+		{
+			T value;
+			this->readBytes(&value, sizeof(T));
+			return value;
+		}
+
+		/**
+		 * \brief Прочитать байты (конец трассы посреди записи - исключение)
+		 * \param destination Куда копировать
+		 * \param size Кол-во байт
+		 */
+		void readBytes(void* destination, size_t size);
+
+		/**
+		 * \brief Создать ресурс из записанного содержимого
+		 */
+		void readBlob();
+
+		/**
+		 * \brief Прочитать параметры текстуры части меша
+		 * \param parameters Параметры
+		 */
+		void readTextureParameters(TextureParameters* parameters);
+
+		/**
+		 * \brief Прочитать добавление меша
+		 * \param renderer Рендерер
+		 */
+		void readAddMesh(Renderer* renderer);
+
+		/**
+		 * \brief Применить записанные параметры рендерера
+		 * \param renderer Рендерер
+		 * \param settings Параметры
+		 */
+		static void applySettings(Renderer* renderer, const FrameTraceSettings& settings);
+
+		/**
+		 * \brief Применить записанное состояние источника
+		 * \param light Источник
+		 * \param state Состояние
+		 */
+		static void applyLightState(Light* light, const FrameTraceLightState& state);
+
+		/**
+		 * \brief Применить записанное положение меша
+		 * \param mesh Меш
+		 * \param state Положение
+		 */
+		static void applyMeshState(StaticMesh* mesh, const FrameTraceMeshState& state);
+
+	public:
+		/**
+		 * \brief Загрузить трассу
+		 * \param path Путь к файлу трассы
+		 */
+		explicit FrameReplayer(const std::string& path);
+
+		/**
+		 * \brief Деструктор
+		 */
+		~FrameReplayer() = default;
+
+		/**
+		 * \brief Ширина кадра при записи
+		 * \return Целое число
+		 */
+		GLuint getWidth() const;
+
+		/**
+		 * \brief Высота кадра при записи
+		 * \return Целое число
+		 */
+		GLuint getHeight() const;
+
+		/**
+		 * \brief Кол-во кадров в трассе
+		 * \return Целое число
+		 */
+		GLuint getFrameCount() const;
+
+		/**
+		 * \brief Воспроизвести следующий кадр
+		 * \param renderer Рендерер
+		 * \param paced Соблюдать темп записи (ожидать момента кадра), иначе - рисовать сразу
+		 * \return Был ли нарисован кадр (false - трасса закончилась)
+		 */
+		bool nextFrame(Renderer* renderer, bool paced = false);
+	};
+}
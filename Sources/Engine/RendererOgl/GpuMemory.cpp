@@ -0,0 +1,156 @@
+﻿#include "GpuMemory.h"
+#include <algorithm>
+#include <string>
+#include <stdexcept>
+
+namespace ogl
+{
+	/**
+	* \brief Конструктор
+	*/
+	GpuMemory::GpuMemory() :
+		totalBytes_(0),
+		totalPeakBytes_(0),
+		budget_(0),
+		nextEvictorId_(1),
+		evicting_(false)
+	{
+		std::fill(this->bytes_, this->bytes_ + GPU_MEMORY_CATEGORY_COUNT, 0);
+		std::fill(this->peakBytes_, this->peakBytes_ + GPU_MEMORY_CATEGORY_COUNT, 0);
+		std::fill(this->allocations_, this->allocations_ + GPU_MEMORY_CATEGORY_COUNT, 0);
+	}
+
+	/**
+	* \brief Учет памяти процесса
+	* \return Ссылка на учет
+	*/
+	GpuMemory& GpuMemory::get()
+	{
+		static GpuMemory memory;
+		return memory;
+	}
+
+	/**
+	* \brief Учесть выделение памяти (до создания объекта OpenGL)
+	* \param category Категория
+	* \param bytes Кол-во байт
+	* \details Если выделение превышает бюджет и вытеснение не освободило достаточно памяти - бросает исключение
+	*/
+	void GpuMemory::allocate(GpuMemoryCategory category, GLuint64 bytes)
+	{
+		// Сначала вытеснение (функции освобождают память через release, общий объем уменьшается)
+		if (this->budget_ > 0 && this->totalBytes_ + bytes > this->budget_ && !this->evicting_)
+		{
+			this->evicting_ = true;
+			for (auto& evictor : this->evictors_) {
+				if (this->totalBytes_ + bytes <= this->budget_) break;
+				evictor.second(this->totalBytes_ + bytes - this->budget_);
+			}
+			this->evicting_ = false;
+		}
+
+		if (this->budget_ > 0 && this->totalBytes_ + bytes > this->budget_) {
+			throw std::runtime_error("OpenGL:GpuMemory: Budget exceeded (" + std::to_string(this->totalBytes_ + bytes) + " of " + std::to_string(this->budget_) + " bytes)");
+		}
+
+		this->bytes_[category] += bytes;
+		this->allocations_[category]++;
+		this->totalBytes_ += bytes;
+
+		this->peakBytes_[category] = std::max(this->peakBytes_[category], this->bytes_[category]);
+		this->totalPeakBytes_ = std::max(this->totalPeakBytes_, this->totalBytes_);
+	}
+
+	/**
+	* \brief Учесть освобождение памяти
+	* \param category Категория
+	* \param bytes Кол-во байт (столько же, сколько было учтено при выделении)
+	*/
+	void GpuMemory::release(GpuMemoryCategory category, GLuint64 bytes)
+	{
+		bytes = std::min(bytes, this->bytes_[category]);
+		this->bytes_[category] -= bytes;
+		this->totalBytes_ -= bytes;
+		if (this->allocations_[category] > 0) this->allocations_[category]--;
+	}
+
+	/**
+	* \brief Текущий объем и максимумы по категориям
+	* \return Статистика
+	*/
+	GpuMemoryStats GpuMemory::getStats() const
+	{
+		GpuMemoryStats stats = {};
+		std::copy(this->bytes_, this->bytes_ + GPU_MEMORY_CATEGORY_COUNT, stats.bytes);
+		std::copy(this->peakBytes_, this->peakBytes_ + GPU_MEMORY_CATEGORY_COUNT, stats.peakBytes);
+		std::copy(this->allocations_, this->allocations_ + GPU_MEMORY_CATEGORY_COUNT, stats.allocations);
+		stats.totalBytes = this->totalBytes_;
+		stats.totalPeakBytes = this->totalPeakBytes_;
+		stats.budget = this->budget_;
+		return stats;
+	}
+
+	/**
+	* \brief Сбросить максимумы до текущих значений
+	*/
+	void GpuMemory::resetPeaks()
+	{
+		std::copy(this->bytes_, this->bytes_ + GPU_MEMORY_CATEGORY_COUNT, this->peakBytes_);
+		this->totalPeakBytes_ = this->totalBytes_;
+	}
+
+	/**
+	* \brief Установить бюджет
+	* \param bytes Кол-во байт (0 - не ограничен)
+	* \details Уже выделенная память не освобождается, бюджет проверяется при следующих выделениях
+	*/
+	void GpuMemory::setBudget(GLuint64 bytes)
+	{
+		this->budget_ = bytes;
+	}
+
+	/**
+	* \brief Добавить функцию вытеснения
+	* \param evictor Функция (вызывается при нехватке бюджета, в порядке добавления)
+	* \return Идентификатор для удаления
+	*/
+	GLuint GpuMemory::addEvictor(const GpuMemoryEvictor& evictor)
+	{
+		GLuint id = this->nextEvictorId_++;
+		this->evictors_.push_back({ id, evictor });
+		return id;
+	}
+
+	/**
+	* \brief Удалить функцию вытеснения
+	* \param id Идентификатор
+	*/
+	void GpuMemory::removeEvictor(GLuint id)
+	{
+		this->evictors_.erase(std::remove_if(this->evictors_.begin(), this->evictors_.end(), [id](const std::pair<GLuint, GpuMemoryEvictor>& evictor) {
+			return evictor.first == id;
+		}), this->evictors_.end());
+	}
+
+	/**
+	* \brief Объем двумерной текстуры
+	* \param width Ширина
+	* \param height Высота
+	* \param bytesPerTexel Байт на тексель
+	* \param mipmaps С цепочкой мип-уровней
+	* \return Кол-во байт
+	*/
+	GLuint64 GpuMemoryTextureSize(GLuint width, GLuint height, GLuint bytesPerTexel, bool mipmaps)
+	{
+		GLuint64 bytes = static_cast<GLuint64>(width) * height * bytesPerTexel;
+
+		// Уровни уменьшаются вдвое по каждой стороне до размера 1*1
+		while (mipmaps && (width > 1 || height > 1)) {
+			width = std::max(width / 2, 1u);
+			height = std::max(height / 2, 1u);
+			bytes += static_cast<GLuint64>(width) * height * bytesPerTexel;
+		}
+
+		return bytes;
+	}
+}
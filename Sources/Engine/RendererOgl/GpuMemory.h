@@ -0,0 +1,143 @@
+﻿#pragma once
+
+#include <vector>
+#include <functional>
+#include <GL/glew.h>
+
+#define GPU_MEMORY_CATEGORY_COUNT 6
+
+namespace ogl
+{
+	/**
+	 * \brief Категория памяти GPU
+	 */
+	enum GpuMemoryCategory
+	{
+		GPU_MEMORY_GEOMETRY = 0,        // Буферы вершин и индексов статической геометрии
+		GPU_MEMORY_TEXTURES = 1,        // Текстуры (с цепочками мип-уровней)
+		GPU_MEMORY_CUBEMAPS = 2,        // Кубические текстуры (с цепочками мип-уровней)
+		GPU_MEMORY_RENDER_TARGETS = 3,  // Вложения кадровых буферов (G-буфер и временные текстуры графа кадра, внеэкранный буфер)
+		GPU_MEMORY_SHADOW_MAPS = 4,     // Карты теней и атлас теней
+		GPU_MEMORY_DYNAMIC_BUFFERS = 5  // Буферы, перезаписываемые каждый кадр (теневые объемы, панель производительности, чтение кадров)
+	};
+
+	/**
+	 * \brief Объем памяти GPU по категориям
+	 */
+	struct GpuMemoryStats
+	{
+		GLuint64 bytes[GPU_MEMORY_CATEGORY_COUNT];      // Занято сейчас (байт, индекс - GpuMemoryCategory)
+		GLuint64 peakBytes[GPU_MEMORY_CATEGORY_COUNT];  // Максимум с запуска или сброса (байт)
+		GLuint allocations[GPU_MEMORY_CATEGORY_COUNT];  // Кол-во выделений, не освобожденных до сих пор
+		GLuint64 totalBytes;                            // Занято всего
+		GLuint64 totalPeakBytes;                        // Максимум общего объема
+		GLuint64 budget;                                // Бюджет (0 - не ограничен)
+	};
+
+	/**
+	 * \brief Функция вытеснения
+	 * \details Получает кол-во байт, которые нужно освободить, возвращает кол-во освобожденных байт
+	 */
+	typedef std::function<GLuint64(GLuint64)> GpuMemoryEvictor;
+
+	/**
+	 * \brief Учет памяти GPU на стороне CPU
+	 * \details Ресурсы сообщают о выделении и освобождении памяти (размеры считаются по форматам, драйвер может
+	 * выравнивать больше). При заданном бюджете выделение сверх бюджета сначала вызывает функции вытеснения
+	 * (например, граф кадра удаляет неиспользуемые текстуры пула), и только если их не хватило - завершается исключением.
+	 * Рассчитан на использование из одного потока (потока контекста OpenGL)
+	 */
+	class GpuMemory
+	{
+	private:
+		GLuint64 bytes_[GPU_MEMORY_CATEGORY_COUNT];      // Занято по категориям
+		GLuint64 peakBytes_[GPU_MEMORY_CATEGORY_COUNT];  // Максимум по категориям
+		GLuint allocations_[GPU_MEMORY_CATEGORY_COUNT];  // Кол-во выделений по категориям
+		GLuint64 totalBytes_;                            // Занято всего
+		GLuint64 totalPeakBytes_;                        // Максимум общего объема
+		GLuint64 budget_;                                // Бюджет (0 - не ограничен)
+		std::vector<std::pair<GLuint, GpuMemoryEvictor>> evictors_; // Функции вытеснения (с идентификаторами)
+		GLuint nextEvictorId_;                           // Идентификатор следующей функции вытеснения
+		bool evicting_;                                  // Выполняется вытеснение (выделения из функций вытеснения не вытесняют)
+
+		/**
+		 * \brief Конструктор
+		 */
+		GpuMemory();
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		GpuMemory(const GpuMemory& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const GpuMemory& other) = delete;
+
+	public:
+		/**
+		 * \brief Учет памяти процесса
+		 * \return Ссылка на учет
+		 */
+		static GpuMemory& get();
+
+		/**
+		 * \brief Учесть выделение памяти (до создания объекта OpenGL)
+		 * \param category Категория
+		 * \param bytes Кол-во байт
+		 * \details Если выделение превышает бюджет и вытеснение не освободило достаточно памяти - бросает исключение
+		 */
+		void allocate(GpuMemoryCategory category, GLuint64 bytes);
+
+		/**
+		 * \brief Учесть освобождение памяти
+		 * \param category Категория
+		 * \param bytes Кол-во байт (столько же, сколько было учтено при выделении)
+		 */
+		void release(GpuMemoryCategory category, GLuint64 bytes);
+
+		/**
+		 * \brief Текущий объем и максимумы по категориям
+		 * \return Статистика
+		 */
+		GpuMemoryStats getStats() const;
+
+		/**
+		 * \brief Сбросить максимумы до текущих значений
+		 */
+		void resetPeaks();
+
+		/**
+		 * \brief Установить бюджет
+		 * \param bytes Кол-во байт (0 - не ограничен)
+		 * \details Уже выделенная память не освобождается, бюджет проверяется при следующих выделениях
+		 */
+		void setBudget(GLuint64 bytes);
+
+		/**
+		 * \brief Добавить функцию вытеснения
+		 * \param evictor Функция (вызывается при нехватке бюджета, в порядке добавления)
+		 * \return Идентификатор для удаления
+		 */
+		GLuint addEvictor(const GpuMemoryEvictor& evictor);
+
+		/**
+		 * \brief Удалить функцию вытеснения
+		 * \param id Идентификатор
+		 */
+		void removeEvictor(GLuint id);
+	};
+
+	/**
+	 * \brief Объем двумерной текстуры
+	 * \param width Ширина
+	 * \param height Высота
+	 * \param bytesPerTexel Байт на тексель
+	 * \param mipmaps С цепочкой мип-уровней
+	 * \return Кол-во байт
+	 */
+	GLuint64 GpuMemoryTextureSize(GLuint width, GLuint height, GLuint bytesPerTexel, bool mipmaps);
+}
@@ -23,6 +23,10 @@ namespace ogl
 		this->attenuation.quadratic = 0.20f;
 		this->cutOffAngle = 40.0f;
 		this->cutOffOuterAngle = 45.0f;
+
+		// Начальное состояние положения (до первого обновления состояния источник считается измененным)
+		this->lastTransform_ = { this->position, this->rotation };
+		this->transformChanged_ = true;
 	}
 
 	/**
@@ -72,9 +76,20 @@ namespace ogl
 		// TODO: по остальным углам (из-за того что угол участвует лишь в формирвоании направления,
 		// TODO: пока вектор UP указывает на абсолютный верх). Нужно устранить это дерьмо
 
-		return glm::lookAt(this->position, this->position + this->getDirection(), glm::vec3(0.0f, 1.0f, 0.0f));
+		// Если направление почти совпадает с вертикалью - вектор UP не может быть вертикальным (вырожденная матрица)
+		glm::vec3 direction = this->getDirection();
+		glm::vec3 up = glm::abs(glm::normalize(direction).y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+		return glm::lookAt(this->position, this->position + direction, up);
 	}
 
+	/**
+	 * \brief Получить матрицу проекции с точки зрения источника
+	 * \details Для прожектора угол обзора соответствует внешнему конусу, для точечного источника - 90 градусов (грань куба)
+	 * \param zNear Ближняя грань отсечения
+	 * \param zFar Дальняя грань отсечения
+	 * \return Матрица
+	 */
 	glm::mat4 Light::getProjectionMatrix(GLfloat zNear, GLfloat zFar) const
 	{
 		if(this->type_ == LightType::DIRECTIONAL_LIGHT)
@@ -82,7 +97,30 @@ namespace ogl
 			return glm::ortho(-5.0f, 5.0f, -5.0f, 5.0f, zNear, zFar);
 		}
 
-		return glm::perspective(90.0f, 1.0f, zNear, zFar);
+		if(this->type_ == LightType::SPOT_LIGHT)
+		{
+			return glm::perspective(glm::radians(glm::min(this->cutOffOuterAngle * 2.0f, 179.0f)), 1.0f, zNear, zFar);
+		}
+
+		return glm::perspective(glm::radians(90.0f), 1.0f, zNear, zFar);
+	}
+
+	/**
+	 * \brief Получить дальность действия источника
+	 * \details Расстояние, на котором затухание ослабляет свет до 1/256 (дальше вклад источника незаметен)
+	 * \return Расстояние
+	 */
+	GLfloat Light::getRange() const
+	{
+		// Решение уравнения quadratic * d^2 + linear * d + 1 = 256 относительно d
+		GLfloat linear = this->attenuation.linear;
+		GLfloat quadratic = this->attenuation.quadratic;
+
+		if (quadratic <= 0.0f) {
+			return linear > 0.0f ? 255.0f / linear : 1000.0f;
+		}
+
+		return (-linear + glm::sqrt(linear * linear + 4.0f * quadratic * 255.0f)) / (2.0f * quadratic);
 	}
 
 	/**
@@ -102,4 +140,30 @@ namespace ogl
 	{
 		return this->getRotationMatrix4x4() * glm::vec4(0.0f, 0.0f, -1.0f, 1.0f);
 	}
+
+	/**
+	 * \brief Обновить состояние положения
+	 * \details Сравнивает текущие положение и вращение с их значениями на момент предыдущего вызова.
+	 * Рендерер вызывает метод один раз за кадр, что позволяет не пересчитывать зависящие от положения данные
+	 * \return Изменилось ли положение с момента предыдущего вызова
+	 */
+	bool Light::updateTransformState()
+	{
+		this->transformChanged_ =
+			this->lastTransform_.position != this->position ||
+			this->lastTransform_.rotation != this->rotation;
+
+		this->lastTransform_ = { this->position, this->rotation };
+		return this->transformChanged_;
+	}
+
+	/**
+	 * \brief Изменилось ли положение при последнем обновлении состояния
+	 * \details Сразу после создания источника считается, что положение изменилось
+	 * \return Да или нет
+	 */
+	bool Light::isTransformChanged() const
+	{
+		return this->transformChanged_;
+	}
 }
\ No newline at end of file
@@ -2,7 +2,7 @@
 
 #include <memory>
 #include <glm/glm.hpp>
-#include <gl/glew.h>
+#include <GL/glew.h>
 
 namespace ogl
 {
@@ -24,9 +24,20 @@ namespace ogl
 	private:
 		LightType type_;         // Тип источника
 
+		/**
+		 * \brief Параметры положения на момент последнего обновления состояния
+		 * \details Используется для определения того, было ли изменено положение источника (см. updateTransformState)
+		 */
+		struct {
+			glm::vec3 position;
+			glm::vec3 rotation;
+		} lastTransform_;
+
+		bool transformChanged_;  // Изменилось ли положение при последнем обновлении состояния
+
 	public:
 		bool render;              // Отображать ли источник визуально
-		bool shadows;             // Создает тени от объектов (ВНИМАНИЕ! такой может быть только один)
+		bool shadows;             // Создает тени от объектов (учитывается атласом карт теней, число таких источников не ограничено)
 		float renderScale;        // Размер отображаемого объекта
 		glm::vec3 position;       // Положение в пространстве (важно для POINT_LIGHT и SPOT_LIGHT)
 		glm::vec3 rotation;       // Вращение (важно для DIRECTIONAL_LIGHT и для SPOT_LIGHT)
@@ -78,10 +89,20 @@ namespace ogl
 
 		/**
 		 * \brief Получить матрицу проекции с точки зрения источника
+		 * \details Для прожектора угол обзора соответствует внешнему конусу, для точечного источника - 90 градусов (грань куба)
+		 * \param zNear Ближняя грань отсечения
+		 * \param zFar Дальняя грань отсечения
 		 * \return Матрица
 		 */
 		glm::mat4 getProjectionMatrix(GLfloat zNear = 0.1f, GLfloat zFar = 7.0f) const;
 
+		/**
+		 * \brief Получить дальность действия источника
+		 * \details Расстояние, на котором затухание ослабляет свет до 1/256 (дальше вклад источника незаметен)
+		 * \return Расстояние
+		 */
+		GLfloat getRange() const;
+
 		/**
 		 * \brief Получить тип
 		 * \return Идентификатор типа
@@ -94,6 +115,21 @@ namespace ogl
 		 */
 		glm::vec3 getDirection() const;
 
+		/**
+		 * \brief Обновить состояние положения
+		 * \details Сравнивает текущие положение и вращение с их значениями на момент предыдущего вызова.
+		 * Рендерер вызывает метод один раз за кадр, что позволяет не пересчитывать зависящие от положения данные
+		 * \return Изменилось ли положение с момента предыдущего вызова
+		 */
+		bool updateTransformState();
+
+		/**
+		 * \brief Изменилось ли положение при последнем обновлении состояния
+		 * \details Сразу после создания источника считается, что положение изменилось
+		 * \return Да или нет
+		 */
+		bool isTransformChanged() const;
+
 		/**
 		 * \brief Деструктор
 		 */
@@ -0,0 +1,305 @@
+﻿#include "PerformanceHud.h"
+#include "Defaults.h"
+#include "GpuMemory.h"
+#include <cstdio>
+#include <algorithm>
+#include <stdexcept>
+#include <STB/stb_easy_font.h>
+
+// Размещение панели (в единицах панели, одна единица - HUD_SCALE пикселей)
+#define HUD_MARGIN 4.0f
+#define HUD_PADDING 4.0f
+#define HUD_BAR_WIDTH 1.5f
+#define HUD_GRAPH_HEIGHT 40.0f
+#define HUD_GRAPH_RANGE 33.3f
+
+namespace ogl
+{
+	/**
+	* \brief Проинициализирован ли GLEW
+	*/
+	extern bool _isGlewInitialised;
+
+	/**
+	* \brief Цвета панели
+	*/
+	static const GLubyte HudPanelColor[4] = { 0, 0, 0, 160 };
+	static const GLubyte HudGridColor[4] = { 255, 255, 255, 60 };
+	static const GLubyte HudTextColor[4] = { 230, 230, 230, 255 };
+	static const GLubyte HudGoodColor[4] = { 80, 200, 80, 220 };
+	static const GLubyte HudSlowColor[4] = { 230, 200, 60, 220 };
+	static const GLubyte HudBadColor[4] = { 230, 70, 60, 220 };
+	static const GLubyte HudGpuColor[4] = { 80, 170, 255, 220 };
+
+	/**
+	* \brief Создание буферов и шейдера панели
+	*/
+	PerformanceHud::PerformanceHud() :
+		vaoId_(0),
+		vboId_(0),
+		eboId_(0),
+		quadCapacity_(0),
+		textVertexCount_(0),
+		textAge_(HUD_TEXT_REFRESH_FRAMES),
+		textHeight_(0.0f),
+		graphNext_(0),
+		lastUpdate_(std::chrono::high_resolution_clock::now()),
+		cost_(0.0f)
+	{
+		// Инициализация GLEW
+		if (!_isGlewInitialised) {
+			glewExperimental = GL_TRUE;
+			_isGlewInitialised = glewInit() == GLEW_OK;
+		}
+
+		if (!_isGlewInitialised) {
+			throw std::runtime_error("OpenGL:PerformanceHud: Glew is not initialised");
+		}
+
+		std::fill(this->frameTimes_, this->frameTimes_ + HUD_GRAPH_FRAMES, 0.0f);
+		std::fill(this->gpuTimes_, this->gpuTimes_ + HUD_GRAPH_FRAMES, 0.0f);
+
+		this->shader_ = MakeShaderResource(defaults::GetShaderSource(defaults::DefaultShaderType::HUD));
+
+		// VAO с форматом вершин stb_easy_font (положение - 3 float, цвет - 4 байта)
+		glGenVertexArrays(1, &(this->vaoId_));
+		glGenBuffers(1, &(this->vboId_));
+		glGenBuffers(1, &(this->eboId_));
+
+		glBindVertexArray(this->vaoId_);
+		glBindBuffer(GL_ARRAY_BUFFER, this->vboId_);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, this->eboId_);
+
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(HudVertex), reinterpret_cast<GLvoid*>(offsetof(HudVertex, x)));
+		glEnableVertexAttribArray(0);
+		glVertexAttribPointer(1, 4, GL_UNSIGNED_BYTE, GL_TRUE, sizeof(HudVertex), reinterpret_cast<GLvoid*>(offsetof(HudVertex, color)));
+		glEnableVertexAttribArray(1);
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+		glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0);
+	}
+
+	/**
+	* \brief Освобождение буферов
+	*/
+	PerformanceHud::~PerformanceHud()
+	{
+		glDeleteBuffers(1, &(this->vboId_));
+		glDeleteBuffers(1, &(this->eboId_));
+		glDeleteVertexArrays(1, &(this->vaoId_));
+		GpuMemory::get().release(GPU_MEMORY_DYNAMIC_BUFFERS, static_cast<GLuint64>(this->quadCapacity_) * (4 * sizeof(HudVertex) + 6 * sizeof(GLuint)));
+	}
+
+	/**
+	* \brief Добавить прямоугольник
+	* \param x Левая граница
+	* \param y Верхняя граница
+	* \param width Ширина
+	* \param height Высота
+	* \param color Цвет RGBA
+	*/
+	void PerformanceHud::addRect(GLfloat x, GLfloat y, GLfloat width, GLfloat height, const GLubyte color[4])
+	{
+		// Порядок вершин как у четырехугольников stb_easy_font (по часовой стрелке от левого верхнего угла)
+		HudVertex vertex = { x, y, 0.0f, { color[0], color[1], color[2], color[3] } };
+		this->vertices_.push_back(vertex);
+		vertex.x = x + width;
+		this->vertices_.push_back(vertex);
+		vertex.y = y + height;
+		this->vertices_.push_back(vertex);
+		vertex.x = x;
+		this->vertices_.push_back(vertex);
+	}
+
+	/**
+	* \brief Перестроить текст
+	* \param stats Счетчики рендерера
+	* \param passes Время проходов графа кадра
+	*/
+	void PerformanceHud::buildText(const RenderStats& stats, const std::vector<RenderGraphPassTiming>& passes)
+	{
+		// Среднее время за период графика (незаполненные значения не учитываются)
+		GLfloat frameSum = 0.0f, gpuSum = 0.0f;
+		GLuint frames = 0;
+		for (GLuint i = 0; i < HUD_GRAPH_FRAMES; i++) {
+			if (this->frameTimes_[i] <= 0.0f) continue;
+			frameSum += this->frameTimes_[i];
+			gpuSum += this->gpuTimes_[i];
+			frames++;
+		}
+
+		GLfloat frameAverage = frames > 0 ? frameSum / static_cast<GLfloat>(frames) : 0.0f;
+		GLfloat gpuAverage = frames > 0 ? gpuSum / static_cast<GLfloat>(frames) : 0.0f;
+
+		char line[128];
+		std::string text;
+
+		snprintf(line, sizeof(line), "frame %6.2f ms  %5.0f fps\n", frameAverage, frameAverage > 0.0f ? 1000.0f / frameAverage : 0.0f);
+		text += line;
+		snprintf(line, sizeof(line), "gpu   %6.2f ms  hud %.3f ms\n", gpuAverage, this->cost_);
+		text += line;
+		snprintf(line, sizeof(line), "draws %u  tris %u\n", RenderStatsTotalDrawCalls(stats), RenderStatsTotalTriangles(stats));
+		text += line;
+		snprintf(line, sizeof(line), "binds prog %u  vao %u  tex %u  fbo %u\n", stats.programBinds, stats.vaoBinds, stats.textureBinds, stats.frameBufferBinds);
+		text += line;
+		snprintf(line, sizeof(line), "uniforms %u  upload %llu kb\n", stats.uniformUploads, static_cast<unsigned long long>(stats.bytesUploaded / 1024));
+		text += line;
+		snprintf(line, sizeof(line), "meshes %u (-%u)  lights %u (-%u)\n", stats.meshesSubmitted, stats.meshesCulled, stats.lightsSubmitted, stats.lightsCulled);
+		text += line;
+
+		GpuMemoryStats memory = GpuMemory::get().getStats();
+		snprintf(line, sizeof(line), "vram %.1f mb  peak %.1f mb\n", memory.totalBytes / 1048576.0, memory.totalPeakBytes / 1048576.0);
+		text += line;
+
+		// Время проходов графа (без профилирования проходов список пуст)
+		if (!passes.empty()) text += "pass           cpu     gpu\n";
+		for (const RenderGraphPassTiming& pass : passes) {
+			snprintf(line, sizeof(line), "%-12.12s %5.2f  %6.2f\n", pass.name.c_str(), pass.cpuTime, pass.gpuTime);
+			text += line;
+		}
+
+		// Вершины текста (не более 16 четырехугольников на символ)
+		size_t capacity = text.size() * 16 * 4;
+		if (this->textVertices_.size() < capacity) this->textVertices_.resize(capacity);
+
+		GLubyte color[4] = { HudTextColor[0], HudTextColor[1], HudTextColor[2], HudTextColor[3] };
+		int quads = stb_easy_font_print(HUD_MARGIN + HUD_PADDING, HUD_MARGIN + HUD_PADDING, &text[0], color,
+			this->textVertices_.data(), static_cast<int>(this->textVertices_.size() * sizeof(HudVertex)));
+
+		this->textVertexCount_ = static_cast<GLuint>(quads) * 4;
+		this->textHeight_ = static_cast<GLfloat>(stb_easy_font_height(&text[0]));
+	}
+
+	/**
+	* \brief Записать время кадра и построить вершины панели
+	* \param gpuFrameTime Время кадра на GPU (мс)
+	* \param stats Счетчики рендерера (последний кадр)
+	* \param passes Время проходов графа кадра
+	*/
+	void PerformanceHud::update(GLfloat gpuFrameTime, const RenderStats& stats, const std::vector<RenderGraphPassTiming>& passes)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		// Интервал между кадрами
+		this->frameTimes_[this->graphNext_] = std::chrono::duration<GLfloat, std::milli>(start - this->lastUpdate_).count();
+		this->gpuTimes_[this->graphNext_] = gpuFrameTime;
+		this->graphNext_ = (this->graphNext_ + 1) % HUD_GRAPH_FRAMES;
+		this->lastUpdate_ = start;
+
+		// Текст перестраивается периодически (используется время панели предыдущего кадра)
+		if (++this->textAge_ >= HUD_TEXT_REFRESH_FRAMES) {
+			this->buildText(stats, passes);
+			this->textAge_ = 0;
+		}
+
+		// Подложка
+		GLfloat width = HUD_GRAPH_FRAMES * HUD_BAR_WIDTH;
+		GLfloat graphTop = HUD_MARGIN + HUD_PADDING + this->textHeight_ + HUD_PADDING;
+		GLfloat graphBottom = graphTop + HUD_GRAPH_HEIGHT;
+
+		this->vertices_.clear();
+		this->addRect(HUD_MARGIN, HUD_MARGIN, width + HUD_PADDING * 2.0f, graphBottom + HUD_PADDING - HUD_MARGIN, HudPanelColor);
+
+		// Линии 60 и 30 кадров в секунду
+		this->addRect(HUD_MARGIN + HUD_PADDING, graphBottom - HUD_GRAPH_HEIGHT * (16.7f / HUD_GRAPH_RANGE), width, 0.5f, HudGridColor);
+		this->addRect(HUD_MARGIN + HUD_PADDING, graphTop, width, 0.5f, HudGridColor);
+
+		// Столбцы времени кадра (от старых к новым) и времени GPU поверх них
+		for (GLuint i = 0; i < HUD_GRAPH_FRAMES; i++)
+		{
+			GLuint index = (this->graphNext_ + i) % HUD_GRAPH_FRAMES;
+			GLfloat x = HUD_MARGIN + HUD_PADDING + static_cast<GLfloat>(i) * HUD_BAR_WIDTH;
+
+			GLfloat frameTime = this->frameTimes_[index];
+			if (frameTime <= 0.0f) continue;
+
+			const GLubyte* color = frameTime <= 16.7f ? HudGoodColor : (frameTime <= 33.3f ? HudSlowColor : HudBadColor);
+			GLfloat height = HUD_GRAPH_HEIGHT * std::min(frameTime / HUD_GRAPH_RANGE, 1.0f);
+			this->addRect(x, graphBottom - height, HUD_BAR_WIDTH, height, color);
+
+			GLfloat gpuHeight = HUD_GRAPH_HEIGHT * std::min(this->gpuTimes_[index] / HUD_GRAPH_RANGE, 1.0f);
+			if (gpuHeight > 0.0f) this->addRect(x + HUD_BAR_WIDTH * 0.5f, graphBottom - gpuHeight, HUD_BAR_WIDTH * 0.5f, gpuHeight, HudGpuColor);
+		}
+
+		// Текст поверх графиков (в пределах одного вызова треугольники рисуются по порядку)
+		this->vertices_.insert(this->vertices_.end(), this->textVertices_.begin(), this->textVertices_.begin() + this->textVertexCount_);
+
+		this->cost_ = std::chrono::duration<GLfloat, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	/**
+	* \brief Нарисовать панель одним вызовом (в текущий кадровый буфер, со смешиванием)
+	* \param width Ширина области вида
+	* \param height Высота области вида
+	*/
+	void PerformanceHud::draw(GLuint width, GLuint height)
+	{
+		auto start = std::chrono::high_resolution_clock::now();
+
+		GLuint quads = static_cast<GLuint>(this->vertices_.size() / 4);
+		if (quads == 0) return;
+
+		glBindVertexArray(this->vaoId_);
+		glBindBuffer(GL_ARRAY_BUFFER, this->vboId_);
+
+		// Буферы растут с запасом (индексы одинаковы для всех кадров и загружаются только при росте)
+		if (quads > this->quadCapacity_)
+		{
+			GLuint capacity = std::max(quads, this->quadCapacity_ * 2);
+			GpuMemory::get().allocate(GPU_MEMORY_DYNAMIC_BUFFERS, static_cast<GLuint64>(capacity - this->quadCapacity_) * (4 * sizeof(HudVertex) + 6 * sizeof(GLuint)));
+			this->quadCapacity_ = capacity;
+
+			std::vector<GLuint> indices(this->quadCapacity_ * 6);
+			for (GLuint i = 0; i < this->quadCapacity_; i++) {
+				GLuint indexArray[6] = { i * 4, i * 4 + 1, i * 4 + 2, i * 4, i * 4 + 2, i * 4 + 3 };
+				std::copy(indexArray, indexArray + 6, indices.begin() + i * 6);
+			}
+
+			glBufferData(GL_ELEMENT_ARRAY_BUFFER, indices.size() * sizeof(GLuint), indices.data(), GL_STATIC_DRAW);
+			OGL_STATS_ADD(bytesUploaded, indices.size() * sizeof(GLuint));
+		}
+
+		// Новая память буфера на каждый кадр (драйвер не ждет, пока GPU дочитает буфер предыдущего кадра)
+		GLsizeiptr bytes = static_cast<GLsizeiptr>(this->vertices_.size() * sizeof(HudVertex));
+		glBufferData(GL_ARRAY_BUFFER, this->quadCapacity_ * 4 * sizeof(HudVertex), nullptr, GL_STREAM_DRAW);
+		glBufferSubData(GL_ARRAY_BUFFER, 0, bytes, this->vertices_.data());
+		OGL_STATS_ADD(bytesUploaded, bytes);
+
+		// Шейдер
+		GLuint shaderID = this->shader_->getId();
+		glUseProgram(shaderID);
+		glUniform2f(glGetUniformLocation(shaderID, "screenSize"), static_cast<GLfloat>(width), static_cast<GLfloat>(height));
+		glUniform1f(glGetUniformLocation(shaderID, "scale"), HUD_SCALE);
+		OGL_STATS_ADD(programBinds, 1);
+		OGL_STATS_ADD(vaoBinds, 1);
+		OGL_STATS_ADD(uniformUploads, 2);
+
+		// Все четырехугольники одним вызовом
+		glDrawElements(GL_TRIANGLES, quads * 6, GL_UNSIGNED_INT, nullptr);
+		OGL_STATS_DRAW(GL_TRIANGLES, quads * 6);
+
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+
+		this->cost_ += std::chrono::duration<GLfloat, std::milli>(std::chrono::high_resolution_clock::now() - start).count();
+	}
+
+	/**
+	* \brief Время построения и рисования панели на CPU
+	* \return Время предыдущего кадра (мс)
+	*/
+	GLfloat PerformanceHud::getCost() const
+	{
+		return this->cost_;
+	}
+
+	/**
+	* \brief Создание панели производительности
+	* \return Умный указатель на панель
+	*/
+	PerformanceHudPtr MakePerformanceHud()
+	{
+		return std::make_shared<PerformanceHud>();
+	}
+}
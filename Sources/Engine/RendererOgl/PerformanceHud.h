@@ -0,0 +1,128 @@
+﻿#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <chrono>
+#include <GL/glew.h>
+
+#include "ShaderResource.h"
+#include "RenderGraph.h"
+#include "RenderStats.h"
+
+#define HUD_GRAPH_FRAMES 120
+#define HUD_TEXT_REFRESH_FRAMES 15
+#define HUD_SCALE 2.0f
+
+namespace ogl
+{
+	/**
+	 * \brief Вершина панели (формат вершин stb_easy_font)
+	 */
+	struct HudVertex
+	{
+		GLfloat x, y, z;            // Положение (в единицах панели от левого верхнего угла окна)
+		GLubyte color[4];           // Цвет RGBA
+	};
+
+	/**
+	 * \brief Панель производительности поверх кадра
+	 * \details Показывает график времени кадра и времени GPU, время проходов графа кадра и счетчики рендерера.
+	 * Текст (stb_easy_font) и графики строятся из четырехугольников на CPU, все четырехугольники кадра загружаются
+	 * в один динамический буфер вершин и рисуются одним вызовом. Текст перестраивается раз в HUD_TEXT_REFRESH_FRAMES
+	 * кадров (чтобы цифры можно было прочитать), график - каждый кадр
+	 */
+	class PerformanceHud
+	{
+	private:
+		GLuint vaoId_;                              // VAO
+		GLuint vboId_;                              // Буфер вершин (перезаписывается каждый кадр)
+		GLuint eboId_;                              // Буфер индексов (одинаковая разбивка четырехугольников на треугольники)
+		GLuint quadCapacity_;                       // Кол-во четырехугольников, под которые выделены буферы
+		ShaderResourcePtr shader_;                  // Шейдер панели
+
+		std::vector<HudVertex> textVertices_;       // Вершины текста (перестраиваются периодически, размер только растет)
+		GLuint textVertexCount_;                    // Кол-во вершин текста
+		std::vector<HudVertex> vertices_;           // Вершины кадра (подложка, графики, текст)
+		GLuint textAge_;                            // Кол-во кадров с последнего перестроения текста
+		GLfloat textHeight_;                        // Высота текста (в единицах панели)
+
+		GLfloat frameTimes_[HUD_GRAPH_FRAMES];      // Интервалы между кадрами (мс, по кругу)
+		GLfloat gpuTimes_[HUD_GRAPH_FRAMES];        // Время кадров на GPU (мс, по кругу)
+		GLuint graphNext_;                          // Индекс следующего значения графиков
+		std::chrono::high_resolution_clock::time_point lastUpdate_; // Время предыдущего обновления
+		GLfloat cost_;                              // Время построения и рисования панели на CPU в предыдущем кадре (мс)
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		PerformanceHud(const PerformanceHud& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const PerformanceHud& other) = delete;
+
+		/**
+		 * \brief Добавить прямоугольник
+		 * \param x Левая граница
+		 * \param y Верхняя граница
+		 * \param width Ширина
+		 * \param height Высота
+		 * \param color Цвет RGBA
+		 */
+		void addRect(GLfloat x, GLfloat y, GLfloat width, GLfloat height, const GLubyte color[4]);
+
+		/**
+		 * \brief Перестроить текст
+		 * \param stats Счетчики рендерера
+		 * \param passes Время проходов графа кадра
+		 */
+		void buildText(const RenderStats& stats, const std::vector<RenderGraphPassTiming>& passes);
+
+	public:
+		/**
+		 * \brief Создание буферов и шейдера панели
+		 */
+		PerformanceHud();
+
+		/**
+		 * \brief Освобождение буферов
+		 */
+		~PerformanceHud();
+
+		/**
+		 * \brief Записать время кадра и построить вершины панели
+		 * \param gpuFrameTime Время кадра на GPU (мс)
+		 * \param stats Счетчики рендерера (последний кадр)
+		 * \param passes Время проходов графа кадра
+		 */
+		void update(GLfloat gpuFrameTime, const RenderStats& stats, const std::vector<RenderGraphPassTiming>& passes);
+
+		/**
+		 * \brief Нарисовать панель одним вызовом (в текущий кадровый буфер, со смешиванием)
+		 * \param width Ширина области вида
+		 * \param height Высота области вида
+		 */
+		void draw(GLuint width, GLuint height);
+
+		/**
+		 * \brief Время построения и рисования панели на CPU
+		 * \return Время предыдущего кадра (мс)
+		 */
+		GLfloat getCost() const;
+	};
+
+	/**
+	 * \brief Тип для умного указателя на панель
+	 */
+	typedef std::shared_ptr<PerformanceHud> PerformanceHudPtr;
+
+	/**
+	 * \brief Создание панели производительности
+	 * \return Умный указатель на панель
+	 */
+	PerformanceHudPtr MakePerformanceHud();
+}
@@ -0,0 +1,239 @@
+﻿#include "PostEffect.h"
+#include <cmath>
+#include <algorithm>
+#include <stdexcept>
+
+namespace ogl
+{
+	/**
+	* \brief Создать попиксельный эффект
+	* \param code Код GLSL, изменяющий переменную color
+	* \param inputs Читаемые ресурсы (маска PostEffectResource)
+	* \param outputs Записываемые ресурсы (поддерживается только цвет)
+	*/
+	PostEffect::PostEffect(const std::string& code, GLuint inputs, GLuint outputs) :
+		kind_(PostEffectKind::POST_EFFECT_PER_PIXEL),
+		inputs_(inputs | POST_RESOURCE_COLOR),
+		outputs_(outputs),
+		code_(code),
+		enabled(true),
+		strength(1.0f),
+		params(0.0f)
+	{
+		if (outputs != POST_RESOURCE_COLOR) {
+			throw std::runtime_error("OpenGL:PostEffect: Only color output is supported");
+		}
+	}
+
+	/**
+	* \brief Создать разделимый эффект
+	* \param kernel Веса половины симметричного ядра (начиная с центрального, не более MAX_POST_KERNEL_TAPS)
+	*/
+	PostEffect::PostEffect(const std::vector<GLfloat>& kernel) :
+		kind_(PostEffectKind::POST_EFFECT_SEPARABLE),
+		inputs_(POST_RESOURCE_COLOR),
+		outputs_(POST_RESOURCE_COLOR),
+		kernel_(kernel),
+		enabled(true),
+		strength(1.0f),
+		params(0.0f)
+	{
+		if (kernel.empty() || kernel.size() > MAX_POST_KERNEL_TAPS) {
+			throw std::runtime_error("OpenGL:PostEffect: Kernel size must be in range [1, MAX_POST_KERNEL_TAPS]");
+		}
+	}
+
+	/**
+	* \brief Способ доступа к входным данным
+	* \return Тип эффекта
+	*/
+	PostEffectKind PostEffect::getKind() const
+	{
+		return this->kind_;
+	}
+
+	/**
+	* \brief Читаемые ресурсы
+	* \return Маска PostEffectResource
+	*/
+	GLuint PostEffect::getInputs() const
+	{
+		return this->inputs_;
+	}
+
+	/**
+	* \brief Записываемые ресурсы
+	* \return Маска PostEffectResource
+	*/
+	GLuint PostEffect::getOutputs() const
+	{
+		return this->outputs_;
+	}
+
+	/**
+	* \brief Код попиксельного эффекта
+	* \return Строка кода
+	*/
+	const std::string& PostEffect::getCode() const
+	{
+		return this->code_;
+	}
+
+	/**
+	* \brief Веса половины ядра разделимого эффекта
+	* \return Массив весов
+	*/
+	const std::vector<GLfloat>& PostEffect::getKernel() const
+	{
+		return this->kernel_;
+	}
+
+	/**
+	* \brief Не меняет ли эффект кадр
+	* \details Выключенный эффект, эффект с нулевой силой, ядро из единственного единичного веса
+	* \return Да, если эффект можно пропустить
+	*/
+	bool PostEffect::isIdentity() const
+	{
+		if (!this->enabled || this->strength <= 0.0f) {
+			return true;
+		}
+
+		return this->kind_ == PostEffectKind::POST_EFFECT_SEPARABLE && this->kernel_.size() == 1 && this->kernel_[0] == 1.0f;
+	}
+
+	/**
+	* \brief Получить смещения и веса выборок одного прохода разделимого ядра
+	* \param offsets Смещения выборок (в текселях, от центра)
+	* \param weights Веса выборок
+	* \details Соседние веса объединяются в одну выборку между текселями (линейная фильтрация), кол-во выборок почти вдвое меньше
+	*/
+	void PostEffect::getLinearTaps(std::vector<GLfloat>* offsets, std::vector<GLfloat>* weights) const
+	{
+		offsets->clear();
+		weights->clear();
+
+		// Ядро с учетом силы эффекта (смесь с единичным ядром)
+		std::vector<GLfloat> kernel(this->kernel_);
+		for (GLfloat& weight : kernel) weight *= this->strength;
+		kernel[0] += 1.0f - this->strength;
+
+		// Центральная выборка
+		offsets->push_back(0.0f);
+		weights->push_back(kernel[0]);
+
+		// Пары соседних весов - одна выборка в точке между текселями, пропорциональной весам
+		for (size_t i = 1; i < kernel.size(); i += 2)
+		{
+			GLfloat a = kernel[i];
+			GLfloat b = i + 1 < kernel.size() ? kernel[i + 1] : 0.0f;
+			if (a + b == 0.0f) continue;
+
+			offsets->push_back((static_cast<GLfloat>(i) * a + static_cast<GLfloat>(i + 1) * b) / (a + b));
+			weights->push_back(a + b);
+		}
+	}
+
+	/**
+	* \brief Создать попиксельный эффект
+	* \param code Код GLSL, изменяющий переменную color
+	* \param inputs Читаемые ресурсы (маска PostEffectResource)
+	* \return Умный указатель на эффект
+	*/
+	PostEffectPtr MakePostEffect(const std::string& code, GLuint inputs)
+	{
+		return std::make_shared<PostEffect>(code, inputs);
+	}
+
+	/**
+	* \brief Создать разделимый эффект
+	* \param kernel Веса половины симметричного ядра (начиная с центрального)
+	* \return Умный указатель на эффект
+	*/
+	PostEffectPtr MakeSeparablePostEffect(const std::vector<GLfloat>& kernel)
+	{
+		return std::make_shared<PostEffect>(kernel);
+	}
+
+	/**
+	* \brief Создать эффект размытия по Гауссу
+	* \param radius Радиус ядра (в текселях)
+	* \param sigma Среднеквадратичное отклонение
+	* \return Умный указатель на эффект
+	*/
+	PostEffectPtr MakeGaussianBlurPostEffect(GLuint radius, GLfloat sigma)
+	{
+		std::vector<GLfloat> kernel(std::min<GLuint>(radius, MAX_POST_KERNEL_TAPS - 1) + 1);
+
+		// Веса нормируются с учетом симметрии (боковые веса входят в сумму дважды)
+		GLfloat sum = 0.0f;
+		for (size_t i = 0; i < kernel.size(); i++) {
+			kernel[i] = std::exp(-static_cast<GLfloat>(i * i) / (2.0f * sigma * sigma));
+			sum += i == 0 ? kernel[i] : 2.0f * kernel[i];
+		}
+
+		for (GLfloat& weight : kernel) weight /= sum;
+
+		return std::make_shared<PostEffect>(kernel);
+	}
+
+	/**
+	* \brief Получить код шейдера, объединяющего последовательность попиксельных эффектов
+	* \param effects Попиксельные эффекты (в порядке применения)
+	* \details Параметры i-го эффекта передаются в uniform-массивы effectParams[i] и effectStrength[i]
+	* \return Строка с кодом шейдера
+	*/
+	std::string GetFusedPostEffectSource(const std::vector<PostEffectPtr>& effects)
+	{
+		// Читает ли глубину хотя бы один эффект
+		bool readsDepth = false;
+		for (const PostEffectPtr& effect : effects) {
+			if (effect->getInputs() & POST_RESOURCE_DEPTH) readsDepth = true;
+		}
+
+		std::string count = std::to_string(effects.size() > 0 ? effects.size() : 1);
+
+		std::string source =
+			"/*VERTEX-SHADER-BEGIN*/\n"
+			"#version 330 core\n"
+			"layout (location = 0) in vec3 position;\n"
+			"layout (location = 2) in vec2 uv;\n"
+			"out vec2 screenUv;\n"
+			"void main(){gl_Position = vec4(position.x, position.y, 0.0, 1.0); screenUv = uv;}\n"
+			"/*VERTEX-SHADER-END*/\n"
+			"/*FRAGMENT-SHADER-BEGIN*/\n"
+			"#version 330 core\n"
+			"layout (location = 0) out vec4 fragColor;\n"
+			"in vec2 screenUv;\n"
+			"uniform sampler2D screenTexture;\n"
+			"uniform sampler2D depthTexture;\n"
+			"uniform vec2 uvScale;\n"
+			"uniform vec4 effectParams[" + count + "];\n"
+			"uniform float effectStrength[" + count + "];\n";
+
+		// Каждый эффект - отдельная функция (переменные эффектов не пересекаются)
+		for (size_t i = 0; i < effects.size(); i++) {
+			source +=
+				"vec3 effect" + std::to_string(i) + "(vec3 color, float depth, vec2 uv, vec4 params){\n" +
+				effects[i]->getCode() + "\n"
+				"return color;}\n";
+		}
+
+		// Одна выборка цвета (и глубины) на все эффекты (кадр занимает часть текстуры uvScale, эффекты получают координаты экрана)
+		source +=
+			"void main(){\n"
+			"vec3 color = texture(screenTexture, screenUv * uvScale).rgb;\n";
+		source += readsDepth ? "float depth = texture(depthTexture, screenUv * uvScale).r;\n" : "float depth = 1.0;\n";
+
+		for (size_t i = 0; i < effects.size(); i++) {
+			std::string index = std::to_string(i);
+			source += "color = mix(color, effect" + index + "(color, depth, screenUv, effectParams[" + index + "]), effectStrength[" + index + "]);\n";
+		}
+
+		source +=
+			"fragColor = vec4(color, 1.0);}\n"
+			"/*FRAGMENT-SHADER-END*/\n";
+
+		return source;
+	}
+}
@@ -0,0 +1,146 @@
+﻿#pragma once
+
+#include <vector>
+#include <string>
+#include <memory>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#define MAX_POST_KERNEL_TAPS 16
+
+namespace ogl
+{
+	/**
+	 * \brief Способ доступа эффекта к входным данным
+	 */
+	enum PostEffectKind
+	{
+		POST_EFFECT_PER_PIXEL = 0,  // Читает только текущий пиксель (соседние попиксельные эффекты объединяются в один шейдер)
+		POST_EFFECT_SEPARABLE = 1   // Разделимое симметричное ядро свертки (выполняется двумя одномерными проходами)
+	};
+
+	/**
+	 * \brief Ресурсы кадра, которые эффект читает или пишет
+	 */
+	enum PostEffectResource
+	{
+		POST_RESOURCE_COLOR = 1,    // Цвет кадра
+		POST_RESOURCE_DEPTH = 2     // Глубина (из G-буфера, только чтение)
+	};
+
+	/**
+	 * \brief Эффект пост-обработки
+	 * \details Попиксельный эффект задается кодом GLSL, который изменяет переменную vec3 color. В коде доступны
+	 * float depth (если эффект читает глубину), vec2 uv и vec4 params. Результат смешивается с исходным цветом по strength.
+	 * Разделимый эффект задается весами половины симметричного ядра (начиная с центрального)
+	 */
+	class PostEffect
+	{
+	private:
+		PostEffectKind kind_;         // Способ доступа к входным данным
+		GLuint inputs_;               // Читаемые ресурсы (маска PostEffectResource)
+		GLuint outputs_;              // Записываемые ресурсы (маска PostEffectResource)
+		std::string code_;            // Код попиксельного эффекта
+		std::vector<GLfloat> kernel_; // Веса половины ядра разделимого эффекта
+
+	public:
+		bool enabled;                 // Включен ли эффект
+		GLfloat strength;             // Сила эффекта (0 - эффект не меняет кадр и пропускается)
+		glm::vec4 params;             // Параметры попиксельного эффекта (uniform params)
+
+		/**
+		 * \brief Создать попиксельный эффект
+		 * \param code Код GLSL, изменяющий переменную color
+		 * \param inputs Читаемые ресурсы (маска PostEffectResource)
+		 * \param outputs Записываемые ресурсы (поддерживается только цвет)
+		 */
+		PostEffect(const std::string& code, GLuint inputs = POST_RESOURCE_COLOR, GLuint outputs = POST_RESOURCE_COLOR);
+
+		/**
+		 * \brief Создать разделимый эффект
+		 * \param kernel Веса половины симметричного ядра (начиная с центрального, не более MAX_POST_KERNEL_TAPS)
+		 */
+		PostEffect(const std::vector<GLfloat>& kernel);
+
+		/**
+		 * \brief Способ доступа к входным данным
+		 * \return Тип эффекта
+		 */
+		PostEffectKind getKind() const;
+
+		/**
+		 * \brief Читаемые ресурсы
+		 * \return Маска PostEffectResource
+		 */
+		GLuint getInputs() const;
+
+		/**
+		 * \brief Записываемые ресурсы
+		 * \return Маска PostEffectResource
+		 */
+		GLuint getOutputs() const;
+
+		/**
+		 * \brief Код попиксельного эффекта
+		 * \return Строка кода
+		 */
+		const std::string& getCode() const;
+
+		/**
+		 * \brief Веса половины ядра разделимого эффекта
+		 * \return Массив весов
+		 */
+		const std::vector<GLfloat>& getKernel() const;
+
+		/**
+		 * \brief Не меняет ли эффект кадр
+		 * \details Выключенный эффект, эффект с нулевой силой, ядро из единственного единичного веса
+		 * \return Да, если эффект можно пропустить
+		 */
+		bool isIdentity() const;
+
+		/**
+		 * \brief Получить смещения и веса выборок одного прохода разделимого ядра
+		 * \param offsets Смещения выборок (в текселях, от центра)
+		 * \param weights Веса выборок
+		 * \details Соседние веса объединяются в одну выборку между текселями (линейная фильтрация), кол-во выборок почти вдвое меньше
+		 */
+		void getLinearTaps(std::vector<GLfloat>* offsets, std::vector<GLfloat>* weights) const;
+	};
+
+	/**
+	 * \brief Тип для умного указателя на эффект
+	 */
+	typedef std::shared_ptr<PostEffect> PostEffectPtr;
+
+	/**
+	 * \brief Создать попиксельный эффект
+	 * \param code Код GLSL, изменяющий переменную color
+	 * \param inputs Читаемые ресурсы (маска PostEffectResource)
+	 * \return Умный указатель на эффект
+	 */
+	PostEffectPtr MakePostEffect(const std::string& code, GLuint inputs = POST_RESOURCE_COLOR);
+
+	/**
+	 * \brief Создать разделимый эффект
+	 * \param kernel Веса половины симметричного ядра (начиная с центрального)
+	 * \return Умный указатель на эффект
+	 */
+	PostEffectPtr MakeSeparablePostEffect(const std::vector<GLfloat>& kernel);
+
+	/**
+	 * \brief Создать эффект размытия по Гауссу
+	 * \param radius Радиус ядра (в текселях)
+	 * \param sigma Среднеквадратичное отклонение
+	 * \return Умный указатель на эффект
+	 */
+	PostEffectPtr MakeGaussianBlurPostEffect(GLuint radius, GLfloat sigma);
+
+	/**
+	 * \brief Получить код шейдера, объединяющего последовательность попиксельных эффектов
+	 * \param effects Попиксельные эффекты (в порядке применения)
+	 * \details Параметры i-го эффекта передаются в uniform-массивы effectParams[i] и effectStrength[i]
+	 * \return Строка с кодом шейдера
+	 */
+	std::string GetFusedPostEffectSource(const std::vector<PostEffectPtr>& effects);
+}
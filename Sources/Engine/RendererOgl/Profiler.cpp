@@ -0,0 +1,362 @@
+﻿#include "Profiler.h"
+#include <map>
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <glm/glm.hpp>
+
+namespace ogl
+{
+	/**
+	* \brief Проинициализирован ли GLEW
+	*/
+	extern bool _isGlewInitialised;
+
+	/**
+	* \brief Конструктор
+	*/
+	Profiler::Profiler() :
+		enabled_(false),
+		epoch_(std::chrono::high_resolution_clock::now()),
+		current_(0),
+		frameIndex_(0),
+		historyNext_(0)
+	{
+		for (Frame& frame : this->frames_) {
+			frame.queryCount = 0;
+			frame.gpuOffset = 0.0;
+			frame.index = 0;
+			frame.pending = false;
+		}
+	}
+
+	/**
+	* \brief Профилировщик процесса
+	* \return Ссылка на профилировщик
+	*/
+	Profiler& Profiler::get()
+	{
+		static Profiler profiler;
+		return profiler;
+	}
+
+	/**
+	* \brief Время CPU на шкале профилировщика
+	* \return Кол-во микросекунд от запуска
+	*/
+	double Profiler::now() const
+	{
+		return std::chrono::duration<double, std::micro>(std::chrono::high_resolution_clock::now() - this->epoch_).count();
+	}
+
+	/**
+	* \brief Начать замер кадра в ячейке current_ (забирает результат кадра, ранее замеренного в этой ячейке)
+	*/
+	void Profiler::openFrame()
+	{
+		Frame& frame = this->frames_[this->current_];
+		if (frame.pending) this->resolveFrame(frame);
+
+		frame.zones.clear();
+		frame.queryCount = 0;
+		frame.index = this->frameIndex_;
+		frame.gpuOffset = 0.0;
+		this->stack_.clear();
+
+		// Сдвиг шкалы GPU относительно CPU (для совмещения зон в трассе)
+		if (_isGlewInitialised) {
+			GLint64 gpuNow = 0;
+			glGetInteger64v(GL_TIMESTAMP, &gpuNow);
+			frame.gpuOffset = this->now() - static_cast<double>(gpuNow) / 1000.0;
+		}
+	}
+
+	/**
+	* \brief Получить результат меток кадра и перенести кадр в историю
+	* \param frame Замер кадра
+	*/
+	void Profiler::resolveFrame(Frame& frame)
+	{
+		for (Zone& zone : frame.zones)
+		{
+			if (zone.queryIndex < 0) continue;
+
+			GLuint64 start = 0;
+			GLuint64 end = 0;
+			glGetQueryObjectui64v(frame.queryIds[zone.queryIndex], GL_QUERY_RESULT, &start);
+			glGetQueryObjectui64v(frame.queryIds[zone.queryIndex + 1], GL_QUERY_RESULT, &end);
+			zone.gpuStart = static_cast<double>(start) / 1000.0 + frame.gpuOffset;
+			zone.gpuEnd = static_cast<double>(end) / 1000.0 + frame.gpuOffset;
+		}
+
+		frame.pending = false;
+
+		// Время зон полученного кадра (для рендерера и замеров по кадрам)
+		ProfilerFrameResult result = {};
+		result.index = frame.index;
+		for (const Zone& zone : frame.zones) {
+			GLfloat gpuTime = zone.queryIndex >= 0 ? static_cast<GLfloat>(glm::max(zone.gpuEnd - zone.gpuStart, 0.0) / 1000.0) : 0.0f;
+			result.zones.push_back({ zone.name, zone.depth, static_cast<GLfloat>((zone.cpuEnd - zone.cpuStart) / 1000.0), gpuTime });
+		}
+		this->resolved_.push_back(result);
+
+		// История хранит только зоны (запросы остаются в пуле кадра)
+		Frame resolved = {};
+		resolved.zones = frame.zones;
+		resolved.index = frame.index;
+
+		if (this->history_.size() < PROFILER_HISTORY_FRAMES) this->history_.push_back(resolved);
+		else this->history_[this->historyNext_] = resolved;
+
+		this->historyNext_ = (this->historyNext_ + 1) % PROFILER_HISTORY_FRAMES;
+	}
+
+	/**
+	* \brief Включить или выключить профилировщик
+	* \param enabled Состояние
+	* \details При выключении незавершенные замеры и история удаляются, запросы освобождаются (контекст должен быть текущим)
+	*/
+	void Profiler::setEnabled(bool enabled)
+	{
+		if (this->enabled_ == enabled) return;
+		this->enabled_ = enabled;
+
+		for (Frame& frame : this->frames_)
+		{
+			if (!enabled && !frame.queryIds.empty()) {
+				glDeleteQueries(static_cast<GLsizei>(frame.queryIds.size()), frame.queryIds.data());
+				frame.queryIds.clear();
+			}
+
+			frame.zones.clear();
+			frame.queryCount = 0;
+			frame.pending = false;
+		}
+
+		this->history_.clear();
+		this->historyNext_ = 0;
+		this->stack_.clear();
+		this->resolved_.clear();
+
+		if (enabled) this->openFrame();
+	}
+
+	/**
+	* \brief Включен ли профилировщик
+	* \return Да или нет
+	*/
+	bool Profiler::isEnabled() const
+	{
+		return this->enabled_;
+	}
+
+	/**
+	* \brief Завершить кадр и начать следующий
+	* \details Зоны, открытые вне кадров рендерера (например, создание ресурсов), попадают в ближайший кадр
+	*/
+	void Profiler::nextFrame()
+	{
+		if (!this->enabled_) return;
+
+		// Незакрытые зоны закрываются концом кадра
+		while (!this->stack_.empty()) {
+			this->endZone();
+		}
+
+		this->frames_[this->current_].pending = true;
+		this->current_ = (this->current_ + 1) % PROFILER_GPU_FRAMES;
+		this->frameIndex_++;
+		this->resolved_.clear();
+		this->openFrame();
+	}
+
+	/**
+	* \brief Завершить кадр и дождаться результатов GPU всех незавершенных кадров
+	* \details Полученные кадры доступны через getResolvedFrames (например, последние кадры замера перед выходом)
+	*/
+	void Profiler::flush()
+	{
+		if (!this->enabled_) return;
+
+		while (!this->stack_.empty()) {
+			this->endZone();
+		}
+
+		this->frames_[this->current_].pending = true;
+		this->resolved_.clear();
+
+		// От самого старого кадра к текущему
+		for (GLuint i = 1; i <= PROFILER_GPU_FRAMES; i++) {
+			Frame& frame = this->frames_[(this->current_ + i) % PROFILER_GPU_FRAMES];
+			if (frame.pending) this->resolveFrame(frame);
+		}
+
+		this->current_ = (this->current_ + 1) % PROFILER_GPU_FRAMES;
+		this->frameIndex_++;
+		this->openFrame();
+	}
+
+	/**
+	* \brief Номер текущего кадра
+	* \return Номер (увеличивается при каждом nextFrame и flush)
+	*/
+	unsigned long long Profiler::getFrameIndex() const
+	{
+		return this->frameIndex_;
+	}
+
+	/**
+	* \brief Кадры, результаты GPU которых получены последним вызовом nextFrame или flush
+	* \return Массив кадров (по возрастанию номера, обычно один кадр, отстающий на PROFILER_GPU_FRAMES)
+	*/
+	const std::vector<ProfilerFrameResult>& Profiler::getResolvedFrames() const
+	{
+		return this->resolved_;
+	}
+
+	/**
+	* \brief Постоянная копия названия зоны
+	* \param name Название (например, название прохода графа кадра)
+	* \return Строка, живущая столько же, сколько профилировщик
+	*/
+	const char* Profiler::intern(const std::string& name)
+	{
+		return this->names_.insert(name).first->c_str();
+	}
+
+	/**
+	* \brief Открыть зону
+	* \param name Название (литерал или строка, живущая дольше профилировщика)
+	* \param gpu Замерять время на GPU
+	*/
+	void Profiler::beginZone(const char* name, bool gpu)
+	{
+		if (!this->enabled_) return;
+
+		Frame& frame = this->frames_[this->current_];
+		Zone zone = { name, static_cast<GLuint>(this->stack_.size()), this->now(), 0.0, -1, 0.0, 0.0 };
+
+		// Две метки времени из пула кадра (пул растет при необходимости)
+		if (gpu && _isGlewInitialised)
+		{
+			if (frame.queryCount + 2 > frame.queryIds.size()) {
+				size_t created = frame.queryIds.size();
+				frame.queryIds.resize(created + 32);
+				glGenQueries(32, frame.queryIds.data() + created);
+			}
+
+			zone.queryIndex = static_cast<GLint>(frame.queryCount);
+			frame.queryCount += 2;
+			glQueryCounter(frame.queryIds[zone.queryIndex], GL_TIMESTAMP);
+		}
+
+		this->stack_.push_back(static_cast<GLint>(frame.zones.size()));
+		frame.zones.push_back(zone);
+	}
+
+	/**
+	* \brief Закрыть последнюю открытую зону
+	*/
+	void Profiler::endZone()
+	{
+		if (!this->enabled_ || this->stack_.empty()) return;
+
+		Frame& frame = this->frames_[this->current_];
+		Zone& zone = frame.zones[this->stack_.back()];
+		this->stack_.pop_back();
+
+		if (zone.queryIndex >= 0) glQueryCounter(frame.queryIds[zone.queryIndex + 1], GL_TIMESTAMP);
+		zone.cpuEnd = this->now();
+	}
+
+	/**
+	* \brief Скользящая статистика зон по истории кадров
+	* \return Массив статистики (порядок - порядок первого появления зон)
+	*/
+	std::vector<ProfilerZoneStats> Profiler::getZoneStats() const
+	{
+		std::vector<ProfilerZoneStats> stats;
+		std::map<std::string, size_t> indices;
+
+		for (const Frame& frame : this->history_)
+		{
+			// Суммы зон за кадр (зона может выполняться несколько раз - например, освещение для каждого источника)
+			std::map<size_t, std::pair<double, double>> frameTimes;
+
+			for (const Zone& zone : frame.zones)
+			{
+				auto it = indices.find(zone.name);
+				if (it == indices.end()) {
+					it = indices.insert({ zone.name, stats.size() }).first;
+					stats.push_back({ zone.name, zone.depth, 0, 0.0f, 0.0f, 0.0f, 0.0f });
+				}
+
+				std::pair<double, double>& times = frameTimes[it->second];
+				times.first += (zone.cpuEnd - zone.cpuStart) / 1000.0;
+				if (zone.queryIndex >= 0) times.second += (zone.gpuEnd - zone.gpuStart) / 1000.0;
+				stats[it->second].samples++;
+			}
+
+			for (const auto& entry : frameTimes)
+			{
+				ProfilerZoneStats& zoneStats = stats[entry.first];
+				zoneStats.cpuAverage += static_cast<GLfloat>(entry.second.first);
+				zoneStats.gpuAverage += static_cast<GLfloat>(entry.second.second);
+				zoneStats.cpuMax = std::max(zoneStats.cpuMax, static_cast<GLfloat>(entry.second.first));
+				zoneStats.gpuMax = std::max(zoneStats.gpuMax, static_cast<GLfloat>(entry.second.second));
+			}
+		}
+
+		// Среднее по кадрам истории (кадры, в которых зоны не было, считаются нулем)
+		if (!this->history_.empty()) {
+			for (ProfilerZoneStats& zoneStats : stats) {
+				zoneStats.cpuAverage /= static_cast<GLfloat>(this->history_.size());
+				zoneStats.gpuAverage /= static_cast<GLfloat>(this->history_.size());
+			}
+		}
+
+		return stats;
+	}
+
+	/**
+	* \brief Выгрузить историю кадров в формате Chrome trace (trace_event JSON)
+	* \param path Путь к файлу (открывается в chrome://tracing или Perfetto)
+	* \details Зоны CPU и GPU выводятся отдельными потоками, время GPU приведено к шкале CPU
+	*/
+	void Profiler::writeChromeTrace(const std::string& path) const
+	{
+		std::ofstream file(path);
+		if (file.fail()) {
+			throw std::runtime_error("OpenGL:Profiler: Can't write trace file " + path);
+		}
+
+		// Кадры истории по порядку (история хранится по кругу)
+		std::vector<const Frame*> frames;
+		for (size_t i = 0; i < this->history_.size(); i++) {
+			size_t index = this->history_.size() < PROFILER_HISTORY_FRAMES ? i : (this->historyNext_ + i) % PROFILER_HISTORY_FRAMES;
+			frames.push_back(&(this->history_[index]));
+		}
+
+		file.precision(3);
+		file << std::fixed;
+		file << "{\"traceEvents\":[\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"CPU\"}},\n";
+		file << "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":2,\"args\":{\"name\":\"GPU\"}}";
+
+		for (const Frame* frame : frames)
+		{
+			for (const Zone& zone : frame->zones)
+			{
+				file << ",\n{\"name\":\"" << zone.name << "\",\"cat\":\"cpu\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":" << zone.cpuStart
+					<< ",\"dur\":" << (zone.cpuEnd - zone.cpuStart) << ",\"args\":{\"frame\":" << frame->index << "}}";
+
+				if (zone.queryIndex >= 0) {
+					file << ",\n{\"name\":\"" << zone.name << "\",\"cat\":\"gpu\",\"ph\":\"X\",\"pid\":1,\"tid\":2,\"ts\":" << zone.gpuStart
+						<< ",\"dur\":" << (zone.gpuEnd - zone.gpuStart) << ",\"args\":{\"frame\":" << frame->index << "}}";
+				}
+			}
+		}
+
+		file << "\n],\"displayTimeUnit\":\"ms\"}\n";
+	}
+}
@@ -0,0 +1,271 @@
+﻿#pragma once
+
+#include <vector>
+#include <string>
+#include <set>
+#include <chrono>
+#include <GL/glew.h>
+
+#define PROFILER_GPU_FRAMES 4
+#define PROFILER_HISTORY_FRAMES 120
+
+// Зона профилировщика до конца текущего блока (при объявлении OGL_NO_PROFILER зоны не компилируются,
+// зоны графа кадра остаются - по ним рендерер замеряет время кадра и проходов на GPU)
+#ifndef OGL_NO_PROFILER
+#define OGL_PROFILER_CONCAT_(a, b) a##b
+#define OGL_PROFILER_CONCAT(a, b) OGL_PROFILER_CONCAT_(a, b)
+#define OGL_PROFILE_ZONE(name) ogl::ProfilerZone OGL_PROFILER_CONCAT(profilerZone_, __LINE__)(name, true)
+#define OGL_PROFILE_ZONE_CPU(name) ogl::ProfilerZone OGL_PROFILER_CONCAT(profilerZone_, __LINE__)(name, false)
+#else
+#define OGL_PROFILE_ZONE(name)
+#define OGL_PROFILE_ZONE_CPU(name)
+#endif
+
+namespace ogl
+{
+	/**
+	 * \brief Скользящая статистика зоны профилировщика
+	 */
+	struct ProfilerZoneStats
+	{
+		std::string name;      // Название зоны
+		GLuint depth;          // Глубина вложенности (при первом появлении)
+		GLuint samples;        // Кол-во замеров (зона может выполняться несколько раз за кадр)
+		GLfloat cpuAverage;    // Среднее время на CPU за кадр (мс)
+		GLfloat cpuMax;        // Максимальное время на CPU за кадр (мс)
+		GLfloat gpuAverage;    // Среднее время на GPU за кадр (мс, 0 - зона только для CPU)
+		GLfloat gpuMax;        // Максимальное время на GPU за кадр (мс)
+	};
+
+	/**
+	 * \brief Время выполнения зоны в кадре
+	 */
+	struct ProfilerZoneTiming
+	{
+		const char* name;      // Название зоны
+		GLuint depth;          // Глубина вложенности
+		GLfloat cpuTime;       // Время на CPU (мс)
+		GLfloat gpuTime;       // Время на GPU (мс, 0 - зона только для CPU)
+	};
+
+	/**
+	 * \brief Кадр, результаты GPU которого получены
+	 */
+	struct ProfilerFrameResult
+	{
+		unsigned long long index;                // Номер кадра (см. Profiler::getFrameIndex)
+		std::vector<ProfilerZoneTiming> zones;   // Зоны кадра (в порядке открытия)
+	};
+
+	/**
+	 * \brief Профилировщик кадра
+	 * \details Зоны вкладываются друг в друга и замеряют время на CPU и на GPU. Время GPU замеряется метками времени
+	 * (GL_TIMESTAMP) - в отличие от запросов GL_TIME_ELAPSED они допускают вложенность. Запросы каждого кадра берутся
+	 * из пула кадра, результат забирается через PROFILER_GPU_FRAMES кадров, когда GPU его уже выполнил (без ожидания).
+	 * Последние PROFILER_HISTORY_FRAMES кадров хранятся для статистики и выгрузки в формате Chrome trace.
+	 * Профилировщик - единственный источник времени GPU: рендерер включает его для динамического разрешения, панели
+	 * производительности и замера проходов, а время кадра и проходов берет из зон графа кадра полученных кадров.
+	 * Рассчитан на использование из одного потока (потока контекста OpenGL), по умолчанию выключен
+	 */
+	class Profiler
+	{
+	private:
+		/**
+		 * \brief Замер зоны
+		 */
+		struct Zone
+		{
+			const char* name;       // Название (литерал или строка из intern - должна жить дольше профилировщика)
+			GLuint depth;           // Глубина вложенности
+			double cpuStart;        // Начало на CPU (мкс от запуска профилировщика)
+			double cpuEnd;          // Окончание на CPU
+			GLint queryIndex;       // Индекс первой из двух меток времени в пуле кадра (-1 - без замера GPU)
+			double gpuStart;        // Начало на GPU (мкс на шкале CPU)
+			double gpuEnd;          // Окончание на GPU
+		};
+
+		/**
+		 * \brief Замер кадра
+		 */
+		struct Frame
+		{
+			std::vector<Zone> zones;         // Зоны кадра (в порядке открытия)
+			std::vector<GLuint> queryIds;    // Пул меток времени
+			GLuint queryCount;               // Кол-во использованных меток
+			double gpuOffset;                // Сдвиг времени GPU относительно шкалы CPU (мкс)
+			unsigned long long index;        // Номер кадра
+			bool pending;                    // Результат меток еще не получен
+		};
+
+		bool enabled_;                                         // Профилировщик включен
+		std::chrono::high_resolution_clock::time_point epoch_; // Начало шкалы времени
+		Frame frames_[PROFILER_GPU_FRAMES];                    // Кадры, ожидающие результатов GPU (по кругу)
+		GLuint current_;                                       // Индекс текущего кадра
+		unsigned long long frameIndex_;                        // Номер текущего кадра
+		std::vector<GLint> stack_;                             // Открытые зоны текущего кадра
+		std::vector<Frame> history_;                           // Последние завершенные кадры (по кругу)
+		size_t historyNext_;                                   // Индекс следующей записи истории
+		std::vector<ProfilerFrameResult> resolved_;            // Кадры, результаты которых получены последним nextFrame или flush
+		std::set<std::string> names_;                          // Названия зон, заданные строками (см. intern)
+
+		/**
+		 * \brief Конструктор
+		 */
+		Profiler();
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		Profiler(const Profiler& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const Profiler& other) = delete;
+
+		/**
+		 * \brief Время CPU на шкале профилировщика
+		 * \return Кол-во микросекунд от запуска
+		 */
+		double now() const;
+
+		/**
+		 * \brief Начать замер кадра в ячейке current_ (забирает результат кадра, ранее замеренного в этой ячейке)
+		 */
+		void openFrame();
+
+		/**
+		 * \brief Получить результат меток кадра и перенести кадр в историю
+		 * \param frame Замер кадра
+		 */
+		void resolveFrame(Frame& frame);
+
+	public:
+		/**
+		 * \brief Профилировщик процесса
+		 * \return Ссылка на профилировщик
+		 */
+		static Profiler& get();
+
+		/**
+		 * \brief Включить или выключить профилировщик
+		 * \param enabled Состояние
+		 * \details При выключении незавершенные замеры и история удаляются, запросы освобождаются (контекст должен быть текущим)
+		 */
+		void setEnabled(bool enabled);
+
+		/**
+		 * \brief Включен ли профилировщик
+		 * \return Да или нет
+		 */
+		bool isEnabled() const;
+
+		/**
+		 * \brief Завершить кадр и начать следующий
+		 * \details Зоны, открытые вне кадров рендерера (например, создание ресурсов), попадают в ближайший кадр
+		 */
+		void nextFrame();
+
+		/**
+		 * \brief Завершить кадр и дождаться результатов GPU всех незавершенных кадров
+		 * \details Полученные кадры доступны через getResolvedFrames (например, последние кадры замера перед выходом)
+		 */
+		void flush();
+
+		/**
+		 * \brief Номер текущего кадра
+		 * \return Номер (увеличивается при каждом nextFrame и flush)
+		 */
+		unsigned long long getFrameIndex() const;
+
+		/**
+		 * \brief Кадры, результаты GPU которых получены последним вызовом nextFrame или flush
+		 * \return Массив кадров (по возрастанию номера, обычно один кадр, отстающий на PROFILER_GPU_FRAMES)
+		 */
+		const std::vector<ProfilerFrameResult>& getResolvedFrames() const;
+
+		/**
+		 * \brief Постоянная копия названия зоны
+		 * \param name Название (например, название прохода графа кадра)
+		 * \return Строка, живущая столько же, сколько профилировщик
+		 */
+		const char* intern(const std::string& name);
+
+		/**
+		 * \brief Открыть зону
+		 * \param name Название (литерал или строка, живущая дольше профилировщика)
+		 * \param gpu Замерять время на GPU
+		 */
+		void beginZone(const char* name, bool gpu);
+
+		/**
+		 * \brief Закрыть последнюю открытую зону
+		 */
+		void endZone();
+
+		/**
+		 * \brief Скользящая статистика зон по истории кадров
+		 * \return Массив статистики (порядок - порядок первого появления зон)
+		 */
+		std::vector<ProfilerZoneStats> getZoneStats() const;
+
+		/**
+		 * \brief Выгрузить историю кадров в формате Chrome trace (trace_event JSON)
+		 * \param path Путь к файлу (открывается в chrome://tracing или Perfetto)
+		 * \details Зоны CPU и GPU выводятся отдельными потоками, время GPU приведено к шкале CPU
+		 */
+		void writeChromeTrace(const std::string& path) const;
+	};
+
+	/**
+	 * \brief Зона профилировщика на время жизни объекта
+	 */
+	class ProfilerZone
+	{
+	private:
+		bool active_;   // Зона открыта (профилировщик был включен при создании)
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		ProfilerZone(const ProfilerZone& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const ProfilerZone& other) = delete;
+
+	public:
+		/**
+		 * \brief Открыть зону
+		 * \param name Название
+		 * \param gpu Замерять время на GPU
+		 */
+		ProfilerZone(const char* name, bool gpu) : active_(Profiler::get().isEnabled())
+		{
+			if (this->active_) Profiler::get().beginZone(name, gpu);
+		}
+
+		/**
+		 * \brief Открыть зону с названием из строки
+		 * \param name Название (копия хранится профилировщиком)
+		 * \param gpu Замерять время на GPU
+		 */
+		ProfilerZone(const std::string& name, bool gpu) : active_(Profiler::get().isEnabled())
+		{
+			if (this->active_) Profiler::get().beginZone(Profiler::get().intern(name), gpu);
+		}
+
+		/**
+		 * \brief Закрыть зону
+		 */
+		~ProfilerZone()
+		{
+			if (this->active_) Profiler::get().endZone();
+		}
+	};
+}
@@ -0,0 +1,666 @@
+﻿#include "RenderGraph.h"
+#include "RenderStats.h"
+#include "GpuMemory.h"
+#include <algorithm>
+#include <stdexcept>
+#include <cstring>
+
+namespace ogl
+{
+	/**
+	* \brief Оценка объема видеопамяти текстуры
+	* \return Кол-во байт
+	* \details Форматы RGB16F драйверы, как правило, хранят с выравниванием до RGBA16F (8 байт на пиксель)
+	*/
+	size_t RenderGraphTextureDesc::getMemorySize() const
+	{
+		size_t bytesPerPixel;
+		switch (this->internalFormat)
+		{
+		case GL_R8:
+			bytesPerPixel = 1;
+			break;
+		case GL_RG8:
+			bytesPerPixel = 2;
+			break;
+		case GL_RGB16F:
+		case GL_RGBA16F:
+		case GL_RG32F:
+			bytesPerPixel = 8;
+			break;
+		case GL_RGB32F:
+		case GL_RGBA32F:
+			bytesPerPixel = 16;
+			break;
+		default:
+			bytesPerPixel = 4;
+			break;
+		}
+
+		return static_cast<size_t>(this->width) * static_cast<size_t>(this->height) * bytesPerPixel;
+	}
+
+	/**
+	* \brief Отсечь проходы, результат которых не используется
+	* \details Проходы просматриваются с конца. Проход нужен, если он пишет в основной буфер, имеет побочный эффект
+	* или пишет ресурс, который читает один из последующих нужных проходов
+	*/
+	void RenderGraph::cullPasses()
+	{
+		// Нужно ли содержимое ресурса последующим (уже просмотренным) проходам
+		std::vector<bool> needed(this->resources_.size(), false);
+		this->culledPassCount_ = 0;
+
+		for (auto pass = this->passes_.rbegin(); pass != this->passes_.rend(); ++pass)
+		{
+			// Вложение глубины, которое проход только читает, результатом прохода не является
+			auto isProduced = [&](RenderGraphResource resource) {
+				return resource != RENDER_GRAPH_NONE && !(pass->desc.depthReadOnly && this->resources_[resource].desc.isDepth());
+			};
+
+			bool alive = pass->desc.sideEffect;
+			for (RenderGraphResource resource : pass->desc.writes) {
+				if (isProduced(resource) && (needed[resource] || this->resources_[resource].backBuffer)) alive = true;
+			}
+
+			pass->culled = !alive;
+			if (pass->culled) {
+				this->culledPassCount_++;
+				continue;
+			}
+
+			// Прежнее содержимое очищаемых ресурсов не нужно (проходы до этого не нужны ради них)
+			for (RenderGraphResource resource : pass->desc.discards) {
+				needed[resource] = false;
+			}
+
+			// Читаемые ресурсы нужны
+			for (RenderGraphResource resource : pass->desc.reads) {
+				needed[resource] = true;
+			}
+
+			// Запись без очистки (смешивание, тест глубины и трафарета) использует прежнее содержимое
+			for (RenderGraphResource resource : pass->desc.writes) {
+				if (resource == RENDER_GRAPH_NONE || this->resources_[resource].backBuffer) continue;
+				if (std::find(pass->desc.discards.begin(), pass->desc.discards.end(), resource) == pass->desc.discards.end()) {
+					needed[resource] = true;
+				}
+			}
+		}
+	}
+
+	/**
+	* \brief Разместить временные текстуры в пуле
+	* \details Текстуры с совместимым описанием и непересекающимся временем жизни получают одну и ту же текстуру пула
+	*/
+	void RenderGraph::allocateTextures()
+	{
+		// Время жизни ресурсов (от первого до последнего использующего прохода)
+		for (Resource& resource : this->resources_) {
+			resource.firstUse = -1;
+			resource.lastUse = -1;
+			resource.physical = -1;
+		}
+
+		for (GLint i = 0; i < static_cast<GLint>(this->passes_.size()); i++)
+		{
+			if (this->passes_[i].culled) continue;
+
+			auto use = [&](RenderGraphResource index) {
+				if (index == RENDER_GRAPH_NONE) return;
+				Resource& resource = this->resources_[index];
+				if (resource.firstUse < 0) resource.firstUse = i;
+				resource.lastUse = i;
+			};
+
+			for (RenderGraphResource index : this->passes_[i].desc.reads) use(index);
+			for (RenderGraphResource index : this->passes_[i].desc.writes) use(index);
+		}
+
+		// Временные ресурсы в порядке начала времени жизни
+		std::vector<size_t> order;
+		for (size_t i = 0; i < this->resources_.size(); i++) {
+			if (!this->resources_[i].imported && this->resources_[i].firstUse >= 0) order.push_back(i);
+		}
+
+		std::stable_sort(order.begin(), order.end(), [this](size_t a, size_t b) {
+			return this->resources_[a].firstUse < this->resources_[b].firstUse;
+		});
+
+		// Распределить ресурсы по ячейкам памяти (ячейка освобождается после последнего использования ресурса)
+		struct Slot {
+			RenderGraphTextureDesc desc;
+			GLint lastUse;
+			GLuint textureId;
+		};
+
+		std::vector<Slot> slots;
+		std::vector<size_t> resourceSlots(this->resources_.size(), 0);
+		this->transientMemory_ = 0;
+
+		for (size_t index : order)
+		{
+			Resource& resource = this->resources_[index];
+			this->transientMemory_ += resource.desc.getMemorySize();
+
+			auto slot = std::find_if(slots.begin(), slots.end(), [&resource](const Slot& slot) {
+				return slot.lastUse < resource.firstUse && slot.desc.isCompatible(resource.desc);
+			});
+
+			if (slot != slots.end()) {
+				slot->lastUse = resource.lastUse;
+				resourceSlots[index] = static_cast<size_t>(slot - slots.begin());
+			}
+			else {
+				slots.push_back({ resource.desc, resource.lastUse, 0 });
+				resourceSlots[index] = slots.size() - 1;
+			}
+		}
+
+		// Удалить текстуры пула, которые давно не используются (например, после смены размеров)
+		for (size_t i = this->pool_.size(); i > 0; i--)
+		{
+			PhysicalTexture& texture = this->pool_[i - 1];
+			if (!texture.used && ++texture.unusedFrames > RENDER_GRAPH_POOL_FRAMES) {
+				this->freePoolTexture(i - 1);
+			}
+		}
+
+		for (PhysicalTexture& texture : this->pool_) {
+			texture.used = false;
+		}
+
+		// Назначить ячейкам подходящие текстуры пула
+		this->aliasedMemory_ = 0;
+
+		for (Slot& slot : slots)
+		{
+			auto texture = std::find_if(this->pool_.begin(), this->pool_.end(), [&slot](const PhysicalTexture& texture) {
+				return !texture.used && texture.desc.isCompatible(slot.desc);
+			});
+
+			if (texture != this->pool_.end()) {
+				texture->used = true;
+				texture->unusedFrames = 0;
+				slot.textureId = texture->id;
+			}
+
+			this->aliasedMemory_ += slot.desc.getMemorySize();
+		}
+
+		// Создать недостающие текстуры. Ячейки ссылаются на текстуры по идентификатору, а не по индексу пула,
+		// поэтому при нехватке бюджета памяти неиспользуемые текстуры пула можно вытеснить прямо во время создания
+		for (Slot& slot : slots)
+		{
+			if (slot.textureId != 0) continue;
+
+			PhysicalTexture created = {};
+			created.desc = slot.desc;
+			created.filter = slot.desc.filter;
+			created.used = true;
+
+			GpuMemory::get().allocate(GPU_MEMORY_RENDER_TARGETS, slot.desc.getMemorySize());
+
+			glGenTextures(1, &created.id);
+			glBindTexture(GL_TEXTURE_2D, created.id);
+			glTexImage2D(GL_TEXTURE_2D, 0, slot.desc.internalFormat, slot.desc.width, slot.desc.height, 0, slot.desc.format, slot.desc.type, nullptr);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, slot.desc.filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, slot.desc.filter);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+			glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+			glBindTexture(GL_TEXTURE_2D, 0);
+
+			this->pool_.push_back(created);
+			slot.textureId = created.id;
+		}
+
+		// Индексы пула назначаются после того, как пул перестал меняться
+		for (size_t index : order)
+		{
+			Resource& resource = this->resources_[index];
+			resource.textureId = slots[resourceSlots[index]].textureId;
+
+			auto texture = std::find_if(this->pool_.begin(), this->pool_.end(), [&resource](const PhysicalTexture& texture) {
+				return texture.id == resource.textureId;
+			});
+			resource.physical = static_cast<GLint>(texture - this->pool_.begin());
+		}
+	}
+
+	/**
+	* \brief Подобрать наборы вложений кадровых буферов проходов
+	* \details Проход, пишущий только глубину, выполняется в кадровом буфере соседнего прохода с той же глубиной
+	*/
+	void RenderGraph::assignTargets()
+	{
+		// Наборы вложений проходов (последний элемент - глубина, 0 - нет вложения)
+		// и кадровые буферы основного буфера, в который пишут проходы (-1 - проход в него не пишет)
+		std::vector<std::vector<GLuint>> targets(this->passes_.size());
+		std::vector<GLint> backBuffer(this->passes_.size(), -1);
+
+		for (size_t i = 0; i < this->passes_.size(); i++)
+		{
+			Pass& pass = this->passes_[i];
+			pass.frameBufferId = -1;
+			if (pass.culled || pass.desc.externalTarget) continue;
+
+			GLuint depth = 0;
+			for (RenderGraphResource index : pass.desc.writes)
+			{
+				if (index == RENDER_GRAPH_NONE) {
+					targets[i].push_back(0);
+					continue;
+				}
+
+				const Resource& resource = this->resources_[index];
+				if (resource.backBuffer) backBuffer[i] = static_cast<GLint>(resource.textureId);
+				else if (resource.desc.isDepth()) depth = resource.textureId;
+				else targets[i].push_back(resource.textureId);
+			}
+
+			targets[i].push_back(depth);
+		}
+
+		// Найти ближайший не отсеченный проход (в заданном направлении), который сам выбирает буфер графа
+		auto neighbour = [this](size_t from, int step) -> GLint {
+			for (GLint i = static_cast<GLint>(from) + step; i >= 0 && i < static_cast<GLint>(this->passes_.size()); i += step) {
+				if (!this->passes_[i].culled && !this->passes_[i].desc.externalTarget) return i;
+			}
+			return -1;
+		};
+
+		for (size_t i = 0; i < this->passes_.size(); i++)
+		{
+			Pass& pass = this->passes_[i];
+			if (pass.culled || pass.desc.externalTarget) continue;
+
+			if (backBuffer[i] >= 0) {
+				pass.frameBufferId = backBuffer[i];
+				continue;
+			}
+
+			// Проход, пишущий только глубину, не переключает буфер, если соседний проход пишет ту же глубину
+			if (targets[i].size() == 1 && targets[i].back() != 0)
+			{
+				GLint previous = neighbour(i, -1);
+				GLint next = neighbour(i, 1);
+
+				if (previous >= 0 && backBuffer[previous] < 0 && targets[previous].back() == targets[i].back()) {
+					targets[i] = targets[previous];
+				}
+				else if (next >= 0 && backBuffer[next] < 0 && targets[next].back() == targets[i].back()) {
+					targets[i] = targets[next];
+				}
+			}
+
+			pass.frameBufferId = static_cast<GLint>(this->getFrameBuffer(targets[i]));
+		}
+	}
+
+	/**
+	* \brief Получить кадровый буфер с набором вложений (создается при первом запросе)
+	* \param target Набор вложений (последний элемент - глубина)
+	* \return ID кадрового буфера
+	*/
+	GLuint RenderGraph::getFrameBuffer(const std::vector<GLuint>& target)
+	{
+		auto it = this->frameBuffers_.find(target);
+		if (it != this->frameBuffers_.end()) {
+			return it->second;
+		}
+
+		GLuint frameBufferId;
+		glGenFramebuffers(1, &frameBufferId);
+		glBindFramebuffer(GL_FRAMEBUFFER, frameBufferId);
+
+		// Цветовые вложения (пропуски выводятся в GL_NONE)
+		std::vector<GLenum> drawBuffers;
+		bool hasColor = false;
+		for (size_t i = 0; i + 1 < target.size(); i++)
+		{
+			if (target[i] != 0) {
+				glFramebufferTexture2D(GL_FRAMEBUFFER, static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i), GL_TEXTURE_2D, target[i], 0);
+				drawBuffers.push_back(static_cast<GLenum>(GL_COLOR_ATTACHMENT0 + i));
+				hasColor = true;
+			}
+			else {
+				drawBuffers.push_back(GL_NONE);
+			}
+		}
+
+		if (hasColor) {
+			glDrawBuffers(static_cast<GLsizei>(drawBuffers.size()), drawBuffers.data());
+		}
+		else {
+			glDrawBuffer(GL_NONE);
+			glReadBuffer(GL_NONE);
+		}
+
+		// Вложение глубины (или глубины-трафарета)
+		GLuint depth = target.back();
+		if (depth != 0)
+		{
+			auto texture = std::find_if(this->pool_.begin(), this->pool_.end(), [depth](const PhysicalTexture& texture) { return texture.id == depth; });
+			GLenum attachment = texture != this->pool_.end() && texture->desc.format == GL_DEPTH_COMPONENT ? GL_DEPTH_ATTACHMENT : GL_DEPTH_STENCIL_ATTACHMENT;
+			glFramebufferTexture2D(GL_FRAMEBUFFER, attachment, GL_TEXTURE_2D, depth, 0);
+		}
+
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw std::runtime_error("OpenGL:RenderGraph: Frame buffer can't be initialized");
+		}
+
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+
+		this->frameBuffers_[target] = frameBufferId;
+		return frameBufferId;
+	}
+
+	/**
+	* \brief Удалить текстуру пула и кадровые буферы, в которых она используется
+	* \param index Индекс текстуры в пуле
+	*/
+	void RenderGraph::freePoolTexture(size_t index)
+	{
+		GLuint textureId = this->pool_[index].id;
+
+		for (auto it = this->frameBuffers_.begin(); it != this->frameBuffers_.end();)
+		{
+			if (std::find(it->first.begin(), it->first.end(), textureId) != it->first.end()) {
+				glDeleteFramebuffers(1, &(it->second));
+				it = this->frameBuffers_.erase(it);
+			}
+			else {
+				++it;
+			}
+		}
+
+		glDeleteTextures(1, &textureId);
+		GpuMemory::get().release(GPU_MEMORY_RENDER_TARGETS, this->pool_[index].desc.getMemorySize());
+		this->pool_.erase(this->pool_.begin() + index);
+	}
+
+	/**
+	* \brief Удалить текстуры пула, не используемые в последнем кадре (вытеснение при нехватке бюджета памяти GPU)
+	* \param bytes Кол-во байт, которые нужно освободить
+	* \return Кол-во освобожденных байт
+	*/
+	GLuint64 RenderGraph::evictUnusedTextures(GLuint64 bytes)
+	{
+		GLuint64 freed = 0;
+		for (size_t i = this->pool_.size(); i > 0 && freed < bytes; i--)
+		{
+			if (this->pool_[i - 1].used) continue;
+			freed += this->pool_[i - 1].desc.getMemorySize();
+			this->freePoolTexture(i - 1);
+		}
+
+		return freed;
+	}
+
+	/**
+	* \brief Конструктор
+	*/
+	RenderGraph::RenderGraph() :
+		transientMemory_(0),
+		aliasedMemory_(0),
+		culledPassCount_(0),
+		frameBufferSwitches_(0),
+		evictorId_(0)
+	{
+		this->evictorId_ = GpuMemory::get().addEvictor([this](GLuint64 bytes) {
+			return this->evictUnusedTextures(bytes);
+		});
+	}
+
+	/**
+	* \brief Освобождение текстур пула и кадровых буферов
+	*/
+	RenderGraph::~RenderGraph()
+	{
+		for (auto& frameBuffer : this->frameBuffers_) {
+			glDeleteFramebuffers(1, &(frameBuffer.second));
+		}
+
+		GpuMemory::get().removeEvictor(this->evictorId_);
+
+		for (PhysicalTexture& texture : this->pool_) {
+			glDeleteTextures(1, &(texture.id));
+			GpuMemory::get().release(GPU_MEMORY_RENDER_TARGETS, texture.desc.getMemorySize());
+		}
+	}
+
+	/**
+	* \brief Начать описание нового кадра (ресурсы и проходы предыдущего кадра удаляются, пул сохраняется)
+	*/
+	void RenderGraph::reset()
+	{
+		this->resources_.clear();
+		this->passes_.clear();
+	}
+
+	/**
+	* \brief Объявить временную текстуру
+	* \param name Название
+	* \param desc Описание
+	* \return Дескриптор ресурса
+	*/
+	RenderGraphResource RenderGraph::createTexture(const std::string& name, const RenderGraphTextureDesc& desc)
+	{
+		this->resources_.push_back({ name, desc, 0, false, false, -1, -1, -1 });
+		return static_cast<RenderGraphResource>(this->resources_.size() - 1);
+	}
+
+	/**
+	* \brief Объявить внешнюю текстуру (память которой управляет не граф)
+	* \param name Название
+	* \param textureId ID текстуры
+	* \return Дескриптор ресурса
+	*/
+	RenderGraphResource RenderGraph::importTexture(const std::string& name, GLuint textureId)
+	{
+		this->resources_.push_back({ name, {}, textureId, true, false, -1, -1, -1 });
+		return static_cast<RenderGraphResource>(this->resources_.size() - 1);
+	}
+
+	/**
+	* \brief Объявить основной буфер (в который выводится кадр)
+	* \param frameBufferId ID кадрового буфера (0 - буфер окна, иначе - внеэкранный буфер контекста)
+	* \return Дескриптор ресурса
+	*/
+	RenderGraphResource RenderGraph::importBackBuffer(GLuint frameBufferId)
+	{
+		this->resources_.push_back({ "back-buffer", {}, frameBufferId, true, true, -1, -1, -1 });
+		return static_cast<RenderGraphResource>(this->resources_.size() - 1);
+	}
+
+	/**
+	* \brief Добавить проход
+	* \param desc Описание прохода
+	* \param execute Функция выполнения (кадровый буфер уже привязан графом, если проход не выбирает его сам)
+	* \details Проход, пишущий только глубину, не должен писать цвет - он может выполняться в буфере с цветовыми вложениями
+	*/
+	void RenderGraph::addPass(const RenderGraphPassDesc& desc, const std::function<void()>& execute)
+	{
+		this->passes_.push_back({ desc, execute, false, -1 });
+	}
+
+	/**
+	* \brief Компиляция графа (отсечение проходов, время жизни и размещение текстур, наборы вложений)
+	*/
+	void RenderGraph::compile()
+	{
+		this->cullPasses();
+		this->allocateTextures();
+		this->assignTargets();
+	}
+
+	/**
+	* \brief Выполнить не отсеченные проходы
+	*/
+	void RenderGraph::execute()
+	{
+		// Текущий кадровый буфер (-1 - неизвестен)
+		GLint current = -1;
+		this->frameBufferSwitches_ = 0;
+
+		// Зона всего графа (время кадра на GPU) и зоны проходов
+		ProfilerZone graphZone(RENDER_GRAPH_PROFILER_ZONE, true);
+
+		for (Pass& pass : this->passes_)
+		{
+			if (pass.culled) continue;
+
+			// Зона прохода (включая переключение буфера и смену фильтрации)
+			ProfilerZone passZone(pass.desc.name, true);
+
+			// Фильтрация читаемых текстур (совмещенные ресурсы могут использовать разную фильтрацию)
+			for (RenderGraphResource index : pass.desc.reads)
+			{
+				const Resource& resource = this->resources_[index];
+				if (resource.physical < 0) continue;
+
+				PhysicalTexture& texture = this->pool_[resource.physical];
+				if (texture.filter != resource.desc.filter) {
+					glBindTexture(GL_TEXTURE_2D, texture.id);
+					OGL_STATS_ADD(textureBinds, 1);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, resource.desc.filter);
+					glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, resource.desc.filter);
+					texture.filter = resource.desc.filter;
+				}
+			}
+
+			// Проход сам выбирает буфер - после него привязанный буфер неизвестен
+			if (pass.desc.externalTarget) {
+				pass.execute();
+				current = -1;
+			}
+			// Переключить буфер, только если набор вложений сменился
+			else {
+				if (pass.frameBufferId >= 0 && pass.frameBufferId != current) {
+					glBindFramebuffer(GL_FRAMEBUFFER, static_cast<GLuint>(pass.frameBufferId));
+					current = pass.frameBufferId;
+					this->frameBufferSwitches_++;
+					OGL_STATS_ADD(frameBufferBinds, 1);
+				}
+
+				pass.execute();
+			}
+		}
+	}
+
+	/**
+	* \brief Получить ID текстуры ресурса (после компиляции)
+	* \param resource Дескриптор ресурса
+	* \return ID текстуры (0 - если ресурс не используется)
+	*/
+	GLuint RenderGraph::getTextureId(RenderGraphResource resource) const
+	{
+		return this->resources_[resource].textureId;
+	}
+
+	/**
+	* \brief Объем временных текстур кадра без совмещения памяти
+	* \return Кол-во байт
+	*/
+	size_t RenderGraph::getTransientMemory() const
+	{
+		return this->transientMemory_;
+	}
+
+	/**
+	* \brief Объем временных текстур кадра с совмещением памяти
+	* \return Кол-во байт
+	*/
+	size_t RenderGraph::getAliasedMemory() const
+	{
+		return this->aliasedMemory_;
+	}
+
+	/**
+	* \brief Кол-во отсеченных проходов
+	* \return Кол-во проходов
+	*/
+	GLuint RenderGraph::getCulledPassCount() const
+	{
+		return this->culledPassCount_;
+	}
+
+	/**
+	* \brief Кол-во переключений кадрового буфера при последнем выполнении
+	* \return Кол-во переключений
+	*/
+	GLuint RenderGraph::getFrameBufferSwitches() const
+	{
+		return this->frameBufferSwitches_;
+	}
+
+	/**
+	* \brief Отчет о проходах, времени жизни ресурсов и памяти
+	* \return Строка отчета
+	*/
+	std::string RenderGraph::getReport() const
+	{
+		auto mb = [](size_t bytes) { return std::to_string(bytes / (1024 * 1024)) + " MB"; };
+
+		std::string report = "Render graph\n";
+		report += "  passes: " + std::to_string(this->passes_.size()) + " (" + std::to_string(this->culledPassCount_) + " culled)\n";
+		for (const Pass& pass : this->passes_) {
+			report += "    " + pass.desc.name + (pass.culled ? " [culled]" : "") + "\n";
+		}
+
+		report += "  transient textures:\n";
+		for (const Resource& resource : this->resources_)
+		{
+			if (resource.imported) continue;
+			report += "    " + resource.name;
+			if (resource.firstUse < 0) {
+				report += " [unused]\n";
+				continue;
+			}
+			report += " passes " + std::to_string(resource.firstUse) + "-" + std::to_string(resource.lastUse);
+			report += ", texture #" + std::to_string(resource.physical) + "\n";
+		}
+
+		report += "  peak render-target memory: " + mb(this->transientMemory_) + " without aliasing, " + mb(this->aliasedMemory_) + " with aliasing\n";
+		report += "  frame buffer switches: " + std::to_string(this->frameBufferSwitches_) + "\n";
+		return report;
+	}
+
+	/**
+	* \brief Время выполнения графа кадра на GPU
+	* \param frame Кадр профилировщика
+	* \return Время (мс, 0 - граф в кадре не выполнялся)
+	*/
+	GLfloat RenderGraphGpuTime(const ProfilerFrameResult& frame)
+	{
+		for (const ProfilerZoneTiming& zone : frame.zones) {
+			if (strcmp(zone.name, RENDER_GRAPH_PROFILER_ZONE) == 0) return zone.gpuTime;
+		}
+
+		return 0.0f;
+	}
+
+	/**
+	* \brief Время выполнения не отсеченных проходов графа кадра
+	* \param frame Кадр профилировщика
+	* \return Проходы в порядке выполнения (зоны, вложенные непосредственно в зону графа)
+	*/
+	std::vector<RenderGraphPassTiming> RenderGraphPassTimings(const ProfilerFrameResult& frame)
+	{
+		std::vector<RenderGraphPassTiming> timings;
+
+		for (size_t i = 0; i < frame.zones.size(); i++)
+		{
+			if (strcmp(frame.zones[i].name, RENDER_GRAPH_PROFILER_ZONE) != 0) continue;
+
+			// Зоны после зоны графа до выхода из нее (зоны, вложенные в проходы, пропускаются)
+			GLuint depth = frame.zones[i].depth;
+			for (size_t j = i + 1; j < frame.zones.size() && frame.zones[j].depth > depth; j++) {
+				if (frame.zones[j].depth == depth + 1) timings.push_back({ frame.zones[j].name, frame.zones[j].cpuTime, frame.zones[j].gpuTime });
+			}
+			break;
+		}
+
+		return timings;
+	}
+}
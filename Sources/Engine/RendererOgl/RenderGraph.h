@@ -0,0 +1,305 @@
+﻿#pragma once
+
+#include <vector>
+#include <map>
+#include <string>
+#include <functional>
+#include <GL/glew.h>
+
+#include "Profiler.h"
+
+#define RENDER_GRAPH_NONE 0xFFFFFFFF
+#define RENDER_GRAPH_POOL_FRAMES 60
+#define RENDER_GRAPH_PROFILER_ZONE "render-graph"
+
+namespace ogl
+{
+	/**
+	 * \brief Дескриптор ресурса графа кадра
+	 */
+	typedef GLuint RenderGraphResource;
+
+	/**
+	 * \brief Описание текстуры графа кадра
+	 * \details Текстуры с одинаковыми размерами и внутренним форматом могут использовать одну и ту же память
+	 */
+	struct RenderGraphTextureDesc
+	{
+		GLuint width;              // Ширина
+		GLuint height;             // Высота
+		GLenum internalFormat;     // Внутренний формат
+		GLenum format;             // Формат данных (для выделения памяти)
+		GLenum type;               // Тип данных (для выделения памяти)
+		GLenum filter;             // Фильтрация при выборке
+
+		/**
+		 * \brief Может ли текстура с другим описанием использовать ту же память
+		 * \param other Описание другой текстуры
+		 * \return Да или нет
+		 */
+		bool isCompatible(const RenderGraphTextureDesc& other) const
+		{
+			return this->width == other.width && this->height == other.height && this->internalFormat == other.internalFormat;
+		}
+
+		/**
+		 * \brief Является ли текстура текстурой глубины (или глубины-трафарета)
+		 * \return Да или нет
+		 */
+		bool isDepth() const
+		{
+			return this->format == GL_DEPTH_STENCIL || this->format == GL_DEPTH_COMPONENT;
+		}
+
+		/**
+		 * \brief Оценка объема видеопамяти текстуры
+		 * \return Кол-во байт
+		 */
+		size_t getMemorySize() const;
+	};
+
+	/**
+	 * \brief Описание прохода графа кадра
+	 */
+	struct RenderGraphPassDesc
+	{
+		std::string name;                           // Название (для отчетов)
+		std::vector<RenderGraphResource> reads;     // Читаемые ресурсы (выборка в шейдерах)
+		std::vector<RenderGraphResource> writes;    // Записываемые ресурсы - вложения (порядок цветовых - номер вложения, RENDER_GRAPH_NONE - пропуск)
+		std::vector<RenderGraphResource> discards;  // Ресурсы, прежнее содержимое которых проходом не используется (очищаются или перезаписываются)
+		bool sideEffect;                            // Проход нельзя отсечь (запросы к GPU и т.п.)
+		bool externalTarget;                        // Проход сам выбирает кадровый буфер (пишет в импортированные ресурсы)
+		bool depthReadOnly;                         // Вложение глубины-трафарета только читается (тесты без записи)
+	};
+
+	/**
+	 * \brief Время выполнения прохода графа кадра
+	 */
+	struct RenderGraphPassTiming
+	{
+		std::string name;    // Название прохода
+		GLfloat cpuTime;     // Время выполнения функции прохода на CPU (мс)
+		GLfloat gpuTime;     // Время выполнения прохода на GPU (мс)
+	};
+
+	/**
+	 * \brief Граф кадра
+	 * \details Проходы кадра объявляют читаемые и записываемые ресурсы. При компиляции графа отсекаются проходы, результат
+	 * которых не используется, для временных текстур вычисляется время жизни, и текстуры с непересекающимся временем жизни
+	 * размещаются в одной и той же памяти. При выполнении кадровый буфер переключается только тогда, когда меняется набор вложений.
+	 * Граф описывается заново каждый кадр, текстуры и кадровые буферы хранятся в пуле между кадрами. Выполнение графа и
+	 * каждый проход - зоны профилировщика (время кадра и проходов см. RenderGraphGpuTime и RenderGraphPassTimings)
+	 */
+	class RenderGraph
+	{
+	private:
+		/**
+		 * \brief Ресурс графа
+		 */
+		struct Resource
+		{
+			std::string name;              // Название (для отчетов)
+			RenderGraphTextureDesc desc;   // Описание текстуры
+			GLuint textureId;              // ID текстуры (у временных назначается при компиляции)
+			bool imported;                 // Внешний ресурс (не размещается графом)
+			bool backBuffer;               // Основной буфер (ID кадрового буфера хранится вместо ID текстуры)
+			GLint firstUse;                // Первый использующий проход (-1 - не используется)
+			GLint lastUse;                 // Последний использующий проход
+			GLint physical;                // Индекс текстуры в пуле (для временных)
+		};
+
+		/**
+		 * \brief Проход графа
+		 */
+		struct Pass
+		{
+			RenderGraphPassDesc desc;      // Описание
+			std::function<void()> execute; // Функция выполнения
+			bool culled;                   // Отсечен
+			GLint frameBufferId;           // Кадровый буфер прохода (-1 - граф буфер не переключает)
+		};
+
+		/**
+		 * \brief Текстура пула
+		 */
+		struct PhysicalTexture
+		{
+			GLuint id;                     // ID текстуры
+			RenderGraphTextureDesc desc;   // Описание, с которым текстура создана
+			GLenum filter;                 // Текущая фильтрация
+			GLuint unusedFrames;           // Кол-во кадров, в которых текстура не использовалась
+			bool used;                     // Используется в текущем кадре
+		};
+
+		std::vector<Resource> resources_;                       // Ресурсы текущего кадра
+		std::vector<Pass> passes_;                              // Проходы текущего кадра
+		std::vector<PhysicalTexture> pool_;                     // Пул текстур
+		std::map<std::vector<GLuint>, GLuint> frameBuffers_;   // Кадровые буферы (ключ - набор вложений)
+
+		size_t transientMemory_;                                // Объем временных текстур без совмещения (байт)
+		size_t aliasedMemory_;                                  // Объем временных текстур с совмещением (байт)
+		GLuint culledPassCount_;                                // Кол-во отсеченных проходов
+		GLuint frameBufferSwitches_;                            // Кол-во переключений кадрового буфера при последнем выполнении
+
+		GLuint evictorId_;                                      // Идентификатор функции вытеснения в учете памяти GPU
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		RenderGraph(const RenderGraph& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const RenderGraph& other) = delete;
+
+		/**
+		 * \brief Отсечь проходы, результат которых не используется
+		 * \details Проходы просматриваются с конца. Проход нужен, если он пишет в основной буфер, имеет побочный эффект
+		 * или пишет ресурс, который читает один из последующих нужных проходов
+		 */
+		void cullPasses();
+
+		/**
+		 * \brief Разместить временные текстуры в пуле
+		 * \details Текстуры с совместимым описанием и непересекающимся временем жизни получают одну и ту же текстуру пула
+		 */
+		void allocateTextures();
+
+		/**
+		 * \brief Подобрать наборы вложений кадровых буферов проходов
+		 * \details Проход, пишущий только глубину, выполняется в кадровом буфере соседнего прохода с той же глубиной
+		 */
+		void assignTargets();
+
+		/**
+		 * \brief Получить кадровый буфер с набором вложений (создается при первом запросе)
+		 * \param target Набор вложений (последний элемент - глубина)
+		 * \return ID кадрового буфера
+		 */
+		GLuint getFrameBuffer(const std::vector<GLuint>& target);
+
+		/**
+		 * \brief Удалить текстуру пула и кадровые буферы, в которых она используется
+		 * \param index Индекс текстуры в пуле
+		 */
+		void freePoolTexture(size_t index);
+
+		/**
+		 * \brief Удалить текстуры пула, не используемые в последнем кадре (вытеснение при нехватке бюджета памяти GPU)
+		 * \param bytes Кол-во байт, которые нужно освободить
+		 * \return Кол-во освобожденных байт
+		 */
+		GLuint64 evictUnusedTextures(GLuint64 bytes);
+
+	public:
+		/**
+		 * \brief Конструктор
+		 */
+		RenderGraph();
+
+		/**
+		 * \brief Освобождение текстур пула, кадровых буферов и запросов времени
+		 */
+		~RenderGraph();
+
+		/**
+		 * \brief Начать описание нового кадра (ресурсы и проходы предыдущего кадра удаляются, пул сохраняется)
+		 */
+		void reset();
+
+		/**
+		 * \brief Объявить временную текстуру
+		 * \param name Название
+		 * \param desc Описание
+		 * \return Дескриптор ресурса
+		 */
+		RenderGraphResource createTexture(const std::string& name, const RenderGraphTextureDesc& desc);
+
+		/**
+		 * \brief Объявить внешнюю текстуру (память которой управляет не граф)
+		 * \param name Название
+		 * \param textureId ID текстуры
+		 * \return Дескриптор ресурса
+		 */
+		RenderGraphResource importTexture(const std::string& name, GLuint textureId);
+
+		/**
+		 * \brief Объявить основной буфер (в который выводится кадр)
+		 * \param frameBufferId ID кадрового буфера (0 - буфер окна, иначе - внеэкранный буфер контекста)
+		 * \return Дескриптор ресурса
+		 */
+		RenderGraphResource importBackBuffer(GLuint frameBufferId = 0);
+
+		/**
+		 * \brief Добавить проход
+		 * \param desc Описание прохода
+		 * \param execute Функция выполнения (кадровый буфер уже привязан графом, если проход не выбирает его сам)
+		 * \details Проход, пишущий только глубину, не должен писать цвет - он может выполняться в буфере с цветовыми вложениями
+		 */
+		void addPass(const RenderGraphPassDesc& desc, const std::function<void()>& execute);
+
+		/**
+		 * \brief Компиляция графа (отсечение проходов, время жизни и размещение текстур, наборы вложений)
+		 */
+		void compile();
+
+		/**
+		 * \brief Выполнить не отсеченные проходы
+		 */
+		void execute();
+
+		/**
+		 * \brief Получить ID текстуры ресурса (после компиляции)
+		 * \param resource Дескриптор ресурса
+		 * \return ID текстуры (0 - если ресурс не используется)
+		 */
+		GLuint getTextureId(RenderGraphResource resource) const;
+
+		/**
+		 * \brief Объем временных текстур кадра без совмещения памяти
+		 * \return Кол-во байт
+		 */
+		size_t getTransientMemory() const;
+
+		/**
+		 * \brief Объем временных текстур кадра с совмещением памяти
+		 * \return Кол-во байт
+		 */
+		size_t getAliasedMemory() const;
+
+		/**
+		 * \brief Кол-во отсеченных проходов
+		 * \return Кол-во проходов
+		 */
+		GLuint getCulledPassCount() const;
+
+		/**
+		 * \brief Кол-во переключений кадрового буфера при последнем выполнении
+		 * \return Кол-во переключений
+		 */
+		GLuint getFrameBufferSwitches() const;
+
+		/**
+		 * \brief Отчет о проходах, времени жизни ресурсов и памяти
+		 * \return Строка отчета
+		 */
+		std::string getReport() const;
+	};
+
+	/**
+	 * \brief Время выполнения графа кадра на GPU
+	 * \param frame Кадр профилировщика
+	 * \return Время (мс, 0 - граф в кадре не выполнялся)
+	 */
+	GLfloat RenderGraphGpuTime(const ProfilerFrameResult& frame);
+
+	/**
+	 * \brief Время выполнения не отсеченных проходов графа кадра
+	 * \param frame Кадр профилировщика
+	 * \return Проходы в порядке выполнения (зоны, вложенные непосредственно в зону графа)
+	 */
+	std::vector<RenderGraphPassTiming> RenderGraphPassTimings(const ProfilerFrameResult& frame);
+}
@@ -0,0 +1,188 @@
+﻿#include "RenderStats.h"
+#include <algorithm>
+
+namespace ogl
+{
+	/**
+	* \brief Счетчики текущего кадра (заполняются макросами OGL_STATS_*)
+	*/
+	RenderStats _renderStats = {};
+
+	/**
+	* \brief Категория текущего прохода
+	*/
+	RenderStatsPass _renderStatsPass = RENDER_STATS_OTHER;
+
+	/**
+	* \brief Обойти все счетчики двух наборов попарно
+	* \param result Изменяемый набор
+	* \param frame Набор счетчиков кадра
+	* \param visit Функтор (счетчик результата, счетчик кадра)
+	*/
+	template <typename Visitor>
+	static void VisitCounters(RenderStats& result, const RenderStats& frame, Visitor& visit)
+	{
+		for (GLuint i = 0; i < RENDER_STATS_PASS_COUNT; i++) {
+			visit(result.passes[i].drawCalls, frame.passes[i].drawCalls);
+			visit(result.passes[i].triangles, frame.passes[i].triangles);
+			visit(result.passes[i].vertices, frame.passes[i].vertices);
+		}
+
+		visit(result.programBinds, frame.programBinds);
+		visit(result.vaoBinds, frame.vaoBinds);
+		visit(result.textureBinds, frame.textureBinds);
+		visit(result.uniformUploads, frame.uniformUploads);
+		visit(result.frameBufferBinds, frame.frameBufferBinds);
+		visit(result.meshesSubmitted, frame.meshesSubmitted);
+		visit(result.meshesCulled, frame.meshesCulled);
+		visit(result.lightsSubmitted, frame.lightsSubmitted);
+		visit(result.lightsCulled, frame.lightsCulled);
+		visit(result.bytesUploaded, frame.bytesUploaded);
+	}
+
+	/**
+	* \brief Накопление сумм счетчиков (в double - сумма треугольников за много кадров не помещается в GLuint)
+	*/
+	struct CounterSums
+	{
+		std::vector<double> sums;
+		size_t index;
+
+		template <typename T>
+		void operator()(T&, const T& value)
+		{
+			if (this->index == this->sums.size()) this->sums.push_back(0.0);
+			this->sums[this->index++] += static_cast<double>(value);
+		}
+	};
+
+	/**
+	* \brief Запись средних значений счетчиков
+	*/
+	struct CounterAverages
+	{
+		const std::vector<double>* sums;
+		double count;
+		size_t index;
+
+		template <typename T>
+		void operator()(T& target, const T&)
+		{
+			target = static_cast<T>((*this->sums)[this->index++] / this->count + 0.5);
+		}
+	};
+
+	/**
+	* \brief Выбор максимальных значений счетчиков
+	*/
+	struct CounterMaximums
+	{
+		template <typename T>
+		void operator()(T& target, const T& value)
+		{
+			target = std::max(target, value);
+		}
+	};
+
+	/**
+	* \brief Общее кол-во вызовов рисования кадра
+	* \param stats Счетчики кадра
+	* \return Сумма по всем проходам
+	*/
+	GLuint RenderStatsTotalDrawCalls(const RenderStats& stats)
+	{
+		GLuint total = 0;
+		for (const RenderPassStats& pass : stats.passes) total += pass.drawCalls;
+		return total;
+	}
+
+	/**
+	* \brief Общее кол-во треугольников кадра
+	* \param stats Счетчики кадра
+	* \return Сумма по всем проходам
+	*/
+	GLuint RenderStatsTotalTriangles(const RenderStats& stats)
+	{
+		GLuint total = 0;
+		for (const RenderPassStats& pass : stats.passes) total += pass.triangles;
+		return total;
+	}
+
+	/**
+	* \brief Конструктор
+	* \param capacity Кол-во хранимых кадров
+	*/
+	RenderStatsHistory::RenderStatsHistory(GLuint capacity) :next_(0), capacity_(std::max(capacity, 1u))
+	{
+		this->frames_.reserve(this->capacity_);
+	}
+
+	/**
+	* \brief Сменить кол-во хранимых кадров (история очищается)
+	* \param capacity Кол-во кадров
+	*/
+	void RenderStatsHistory::setCapacity(GLuint capacity)
+	{
+		this->capacity_ = std::max(capacity, 1u);
+		this->frames_.clear();
+		this->frames_.reserve(this->capacity_);
+		this->next_ = 0;
+	}
+
+	/**
+	* \brief Добавить счетчики кадра (вытесняет самый старый кадр)
+	* \param stats Счетчики
+	*/
+	void RenderStatsHistory::add(const RenderStats& stats)
+	{
+		if (this->frames_.size() < this->capacity_) this->frames_.push_back(stats);
+		else this->frames_[this->next_] = stats;
+
+		this->next_ = (this->next_ + 1) % this->capacity_;
+	}
+
+	/**
+	* \brief Кол-во кадров в истории
+	* \return Кол-во кадров
+	*/
+	GLuint RenderStatsHistory::getFrameCount() const
+	{
+		return static_cast<GLuint>(this->frames_.size());
+	}
+
+	/**
+	* \brief Средние значения счетчиков по истории
+	* \return Счетчики (округлены до целого)
+	*/
+	RenderStats RenderStatsHistory::getAverage() const
+	{
+		RenderStats result = {};
+		if (this->frames_.empty()) return result;
+
+		CounterSums sums = {};
+		for (const RenderStats& frame : this->frames_) {
+			sums.index = 0;
+			VisitCounters(result, frame, sums);
+		}
+
+		CounterAverages averages = { &sums.sums, static_cast<double>(this->frames_.size()), 0 };
+		VisitCounters(result, result, averages);
+
+		return result;
+	}
+
+	/**
+	* \brief Максимальные значения счетчиков по истории
+	* \return Счетчики (максимум каждого счетчика отдельно)
+	*/
+	RenderStats RenderStatsHistory::getMaximum() const
+	{
+		RenderStats result = {};
+		CounterMaximums maximums;
+		for (const RenderStats& frame : this->frames_) {
+			VisitCounters(result, frame, maximums);
+		}
+
+		return result;
+	}
+}
@@ -0,0 +1,191 @@
+﻿#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+
+#define RENDER_STATS_PASS_COUNT 7
+#define RENDER_STATS_DEFAULT_FRAMES 60
+
+// Счетчики статистики (при объявлении OGL_NO_RENDER_STATS не компилируются, статистика остается нулевой)
+#ifndef OGL_NO_RENDER_STATS
+#define OGL_STATS_CONCAT_(a, b) a##b
+#define OGL_STATS_CONCAT(a, b) OGL_STATS_CONCAT_(a, b)
+#define OGL_STATS_PASS(pass) ogl::RenderStatsPassScope OGL_STATS_CONCAT(renderStatsPass_, __LINE__)(pass)
+#define OGL_STATS_DRAW(mode, count) ogl::RenderStatsDraw(mode, count)
+#define OGL_STATS_ADD(counter, value) (ogl::_renderStats.counter += (value))
+#else
+#define OGL_STATS_PASS(pass)
+#define OGL_STATS_DRAW(mode, count)
+#define OGL_STATS_ADD(counter, value)
+#endif
+
+namespace ogl
+{
+	/**
+	 * \brief Категория прохода, к которому относятся вызовы рисования
+	 */
+	enum RenderStatsPass
+	{
+		RENDER_STATS_GEOMETRY = 0,      // Геометрия (G-буфер)
+		RENDER_STATS_DEPTH_PREPASS = 1, // Предварительный проход глубины и подсчет покрытия
+		RENDER_STATS_SHADOWS = 2,       // Теневые объемы, карты теней и атлас
+		RENDER_STATS_LIGHTING = 3,      // Освещение
+		RENDER_STATS_SYS_OBJECTS = 4,   // Системные объекты
+		RENDER_STATS_POST = 5,          // Пост-обработка
+		RENDER_STATS_OTHER = 6          // Вызовы вне проходов рендерера
+	};
+
+	/**
+	 * \brief Отправленная на рисование геометрия прохода
+	 */
+	struct RenderPassStats
+	{
+		GLuint drawCalls;           // Кол-во вызовов рисования
+		GLuint triangles;           // Кол-во треугольников
+		GLuint vertices;            // Кол-во вершин (индексов для индексированной геометрии)
+	};
+
+	/**
+	 * \brief Счетчики кадра
+	 * \details Позволяют понять, упирается ли кадр в отправку команд (много вызовов, привязок и передач uniform-переменных)
+	 * или в заполнение (мало вызовов, но высокое время GPU). Загрузки ресурсов между кадрами относятся к следующему кадру
+	 */
+	struct RenderStats
+	{
+		RenderPassStats passes[RENDER_STATS_PASS_COUNT]; // Геометрия по категориям проходов (индекс - RenderStatsPass)
+		GLuint programBinds;        // Кол-во привязок шейдерных программ
+		GLuint vaoBinds;            // Кол-во привязок VAO
+		GLuint textureBinds;        // Кол-во привязок текстур
+		GLuint uniformUploads;      // Кол-во передач uniform-переменных
+		GLuint frameBufferBinds;    // Кол-во привязок кадровых буферов (графом кадра, проходами и рендерером)
+		GLuint meshesSubmitted;     // Кол-во мешей, отправленных на рисование в проход геометрии
+		GLuint meshesCulled;        // Кол-во мешей, отброшенных до рисования
+		GLuint lightsSubmitted;     // Кол-во источников, для которых выполнен проход освещения
+		GLuint lightsCulled;        // Кол-во источников, пропущенных рендерером
+		GLuint64 bytesUploaded;     // Кол-во байт, загруженных в буферы и текстуры
+	};
+
+	/**
+	 * \brief Счетчики текущего кадра (заполняются макросами OGL_STATS_*)
+	 */
+	extern RenderStats _renderStats;
+
+	/**
+	 * \brief Категория текущего прохода
+	 */
+	extern RenderStatsPass _renderStatsPass;
+
+	/**
+	 * \brief Учесть вызов рисования в текущем проходе
+	 * \param mode Тип примитивов
+	 * \param count Кол-во вершин (индексов)
+	 */
+	inline void RenderStatsDraw(GLenum mode, GLsizei count)
+	{
+		RenderPassStats& pass = _renderStats.passes[_renderStatsPass];
+		pass.drawCalls++;
+		pass.vertices += static_cast<GLuint>(count);
+		pass.triangles += static_cast<GLuint>(mode == GL_TRIANGLES_ADJACENCY ? count / 6 : count / 3);
+	}
+
+	/**
+	 * \brief Общее кол-во вызовов рисования кадра
+	 * \param stats Счетчики кадра
+	 * \return Сумма по всем проходам
+	 */
+	GLuint RenderStatsTotalDrawCalls(const RenderStats& stats);
+
+	/**
+	 * \brief Общее кол-во треугольников кадра
+	 * \param stats Счетчики кадра
+	 * \return Сумма по всем проходам
+	 */
+	GLuint RenderStatsTotalTriangles(const RenderStats& stats);
+
+	/**
+	 * \brief Категория прохода на время жизни объекта (предыдущая восстанавливается при удалении)
+	 */
+	class RenderStatsPassScope
+	{
+	private:
+		RenderStatsPass previous_;  // Категория, действовавшая до создания
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		RenderStatsPassScope(const RenderStatsPassScope& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const RenderStatsPassScope& other) = delete;
+
+	public:
+		/**
+		 * \brief Установить категорию
+		 * \param pass Категория прохода
+		 */
+		explicit RenderStatsPassScope(RenderStatsPass pass) : previous_(_renderStatsPass)
+		{
+			_renderStatsPass = pass;
+		}
+
+		/**
+		 * \brief Восстановить предыдущую категорию
+		 */
+		~RenderStatsPassScope()
+		{
+			_renderStatsPass = this->previous_;
+		}
+	};
+
+	/**
+	 * \brief Счетчики последних кадров (по кругу) для усреднения
+	 */
+	class RenderStatsHistory
+	{
+	private:
+		std::vector<RenderStats> frames_;   // Счетчики кадров
+		size_t next_;                       // Индекс следующей записи
+		GLuint capacity_;                   // Кол-во хранимых кадров
+
+	public:
+		/**
+		 * \brief Конструктор
+		 * \param capacity Кол-во хранимых кадров
+		 */
+		explicit RenderStatsHistory(GLuint capacity = RENDER_STATS_DEFAULT_FRAMES);
+
+		/**
+		 * \brief Сменить кол-во хранимых кадров (история очищается)
+		 * \param capacity Кол-во кадров
+		 */
+		void setCapacity(GLuint capacity);
+
+		/**
+		 * \brief Добавить счетчики кадра (вытесняет самый старый кадр)
+		 * \param stats Счетчики
+		 */
+		void add(const RenderStats& stats);
+
+		/**
+		 * \brief Кол-во кадров в истории
+		 * \return Кол-во кадров
+		 */
+		GLuint getFrameCount() const;
+
+		/**
+		 * \brief Средние значения счетчиков по истории
+		 * \return Счетчики (округлены до целого)
+		 */
+		RenderStats getAverage() const;
+
+		/**
+		 * \brief Максимальные значения счетчиков по истории
+		 * \return Счетчики (максимум каждого счетчика отдельно)
+		 */
+		RenderStats getMaximum() const;
+	};
+}
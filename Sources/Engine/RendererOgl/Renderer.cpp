@@ -1,5 +1,7 @@
 ﻿#include "Renderer.h"
 #include "Defaults.h"
+#include "Profiler.h"
+#include "GpuMemory.h"
 #include <algorithm>
 
 namespace ogl
@@ -10,121 +12,73 @@ namespace ogl
 	extern bool _isGlewInitialised;
 
 	/**
-	* \brief Инициализация G-буффера
-	* \param width Ширина буфера
-	* \param height Высота буфера
+	* \brief Определения вариантов шейдера геометрии (индекс - бит маски, первые биты - MESH_DEFINE_* части меша)
 	*/
-	void Renderer::initGBuffer(GLuint width, GLuint height)
-	{
-		// Сохранить размеры в структуре
-		this->gBuffer_.sizes = { width,height };
-
-		// Создать объект фрейм-буфера и привязать его (работаем с фрейм-буфером)
-		glGenFramebuffers(1, &gBuffer_.gBufferId);
-		glBindFramebuffer(GL_FRAMEBUFFER, gBuffer_.gBufferId);
-
-		// Создать цветовое вложение для хранения положения фрагментов
-		glGenTextures(1, &gBuffer_.gPositionAttachmentId);
-		glBindTexture(GL_TEXTURE_2D, gBuffer_.gPositionAttachmentId);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		// Создать цветовое вложение для хранения нормалей фрагментов
-		glGenTextures(1, &gBuffer_.gNormalAttachmentId);
-		glBindTexture(GL_TEXTURE_2D, gBuffer_.gNormalAttachmentId);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB16F, width, height, 0, GL_RGB, GL_FLOAT, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		// Создать цветовое вложение для хранения цвета и интенсивности отражения (RGB - цвет, A - отражения)
-		glGenTextures(1, &gBuffer_.gAlbedoSpecAttachmentId);
-		glBindTexture(GL_TEXTURE_2D, gBuffer_.gAlbedoSpecAttachmentId);
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGBA, width, height, 0, GL_RGBA, GL_UNSIGNED_BYTE, nullptr);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_NEAREST);
-		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_NEAREST);
-		glBindTexture(GL_TEXTURE_2D, 0);
-
-		// Создание буфера глубины-трафарета (используем render-буфер, не текстуру, т.к. выборка в шейдере не нужна)
-		glGenRenderbuffers(1, &gBuffer_.depthStencilAttachmentId);
-		glBindRenderbuffer(GL_RENDERBUFFER, gBuffer_.depthStencilAttachmentId);
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, width, height);
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-		// Собрать фрейм-буфер используя выше-описанные компоненты
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, gBuffer_.gPositionAttachmentId, 0);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT1, GL_TEXTURE_2D, gBuffer_.gNormalAttachmentId, 0);
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT2, GL_TEXTURE_2D, gBuffer_.gAlbedoSpecAttachmentId, 0);
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, gBuffer_.depthStencilAttachmentId);
+	static const std::vector<std::string> GeometryShaderDefines = { "HAS_SPECULAR_MAP", "HAS_BUMP_MAP", "HAS_DISPLACEMENT_MAP", "PARALLAX_OFFSET_ONLY", "GBUFFER_COMPACT" };
+	static const GLuint GeometryDefineCompact = 0x10;
 
-		// Указать какие вложения будут использованы для рендеринга
-		GLuint attachments[3] = { GL_COLOR_ATTACHMENT0, GL_COLOR_ATTACHMENT1, GL_COLOR_ATTACHMENT2 };
-		glDrawBuffers(3, attachments);
-
-		// Если фрейм-буфер не готов
-		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-			throw std::runtime_error("OpenGL:Renderer: G-buffer can't be initialized");
-		}
-
-		// Прекращаем работу с фрейм-буфером
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
-	}
+	/**
+	* \brief Определения вариантов шейдера освещения (индекс - бит маски)
+	*/
+	static const std::vector<std::string> LightingShaderDefines = { "LIGHT_TYPE_POINT", "LIGHT_TYPE_DIRECTIONAL", "LIGHT_TYPE_SPOT", "GBUFFER_COMPACT" };
+	static const GLuint LightingDefineCompact = 0x08;
 
 	/**
-	* \brief Очистка G-буфера
+	* \brief Объем карт теней (глубина 24 бита хранится в 4 байтах)
+	* \return Кол-во байт
 	*/
-	void Renderer::freeGBuffer()
+	static GLuint64 ShadowMapsMemorySize()
 	{
-		GLuint textures[3] = { this->gBuffer_.gPositionAttachmentId,this->gBuffer_.gNormalAttachmentId,this->gBuffer_.gAlbedoSpecAttachmentId };
-		glDeleteTextures(3, textures);
-		glDeleteRenderbuffers(1, &gBuffer_.depthStencilAttachmentId);
-		glDeleteFramebuffers(1, &gBuffer_.gBufferId);
-		this->gBuffer_.sizes = { 0,0 };
+		return static_cast<GLuint64>(SHADOW_MAP_SIZE) * SHADOW_MAP_SIZE * 4 * (1 + SHADOW_MAP_CASCADES);
 	}
 
 	/**
-	* \brief Инициализация фрейм-буфера
-	* \param width Ширина буфера
-	* \param height Высота буфера
+	* \brief Инициализация карт теней
 	*/
-	void Renderer::initFrameBuffer(GLuint width, GLuint height)
+	void Renderer::initShadowMaps()
 	{
-		// Сохранить размеры в структуре
-		this->frameBuffer_.sizes = { width,height };
+		GpuMemory::get().allocate(GPU_MEMORY_SHADOW_MAPS, ShadowMapsMemorySize());
 
-		// Создать объект фрейм-буфера и привязать его (работаем с фрейм-буфером)
-		glGenFramebuffers(1, &(this->frameBuffer_.frameBufferId));
-		glBindFramebuffer(GL_FRAMEBUFFER, this->frameBuffer_.frameBufferId);
+		// Цвет границы (за пределами карты тени нет)
+		GLfloat borderColor[] = { 1.0f, 1.0f, 1.0f, 1.0f };
 
-		// Создать объект текстуры для цветового вложения фрейм-буфера
-		glGenTextures(1, &(this->frameBuffer_.colorAttachmentId));
-		glBindTexture(GL_TEXTURE_2D, this->frameBuffer_.colorAttachmentId);
-		// Выделить текстурную память нужного размера
-		glTexImage2D(GL_TEXTURE_2D, 0, GL_RGB, frameBuffer_.sizes.width, frameBuffer_.sizes.height, 0, GL_RGB, GL_UNSIGNED_BYTE, nullptr);
-		// Фильтрация (линейная)
+		// Карта теней прожектора
+		glGenTextures(1, &(this->shadowMaps_.spotMapId));
+		glBindTexture(GL_TEXTURE_2D, this->shadowMaps_.spotMapId);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+		// Линейная фильтрация с режимом сравнения дает аппаратную PCF-фильтрацию (2*2 выборки)
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
-		// Отвязать текустуру (завершаем работу с текстурой)
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D, GL_TEXTURE_BORDER_COLOR, borderColor);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
 		glBindTexture(GL_TEXTURE_2D, 0);
 
-		// Создание буфера глубины-трафарета (используем render-буфер, не текстуру, т.к. выборка в шейдере не нужна)
-		glGenRenderbuffers(1, &(this->frameBuffer_.depthStencilAttachmentId));
-		glBindRenderbuffer(GL_RENDERBUFFER, this->frameBuffer_.depthStencilAttachmentId);
-		// Выделить необходимое кол-во памяти
-		glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH24_STENCIL8, frameBuffer_.sizes.width, frameBuffer_.sizes.height);
-		// Отвязать render-буфер
-		glBindRenderbuffer(GL_RENDERBUFFER, 0);
-
-		// Привязать текстуру к кадровому буферу в качестве нулевого цветового вложения
-		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_TEXTURE_2D, frameBuffer_.colorAttachmentId, 0);
-		// Привязать render-буфер глубины-трафарета в качестве вложения глубины трафарета
-		glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_STENCIL_ATTACHMENT, GL_RENDERBUFFER, frameBuffer_.depthStencilAttachmentId);
+		// Каскады направленного источника (каждый каскад - слой массива)
+		glGenTextures(1, &(this->shadowMaps_.cascadeMapId));
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->shadowMaps_.cascadeMapId);
+		glTexImage3D(GL_TEXTURE_2D_ARRAY, 0, GL_DEPTH_COMPONENT24, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE, SHADOW_MAP_CASCADES, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_BORDER);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_BORDER);
+		glTexParameterfv(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_BORDER_COLOR, borderColor);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D_ARRAY, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, 0);
+
+		// Фрейм-буфер без цветовых вложений (вложение глубины меняется в зависимости от рисуемой карты)
+		glGenFramebuffers(1, &(this->shadowMaps_.frameBufferId));
+		glBindFramebuffer(GL_FRAMEBUFFER, this->shadowMaps_.frameBufferId);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->shadowMaps_.spotMapId, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
 
 		// Если фрейм-буфер не готов
 		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
-			throw std::runtime_error("OpenGL:Renderer: Frame buffer can't be initialized");
+			throw std::runtime_error("OpenGL:Renderer: Shadow map buffer can't be initialized");
 		}
 
 		// Прекращаем работу с фрейм-буфером
@@ -132,62 +86,93 @@ namespace ogl
 	}
 
 	/**
-	* \brief Очистка фрейм-буфера
+	* \brief Очистка карт теней
 	*/
-	void Renderer::freeFrameBuffer()
+	void Renderer::freeShadowMaps()
 	{
-		// Удалить все объекты буфера
-		glDeleteRenderbuffers(1, &(this->frameBuffer_.depthStencilAttachmentId));
-		glDeleteTextures(1, &(this->frameBuffer_.colorAttachmentId));
-		glDeleteFramebuffers(1, &(this->frameBuffer_.frameBufferId));
-
-		// Обнулить идентификаторы и прочие значения
-		this->frameBuffer_.frameBufferId = 0;
-		this->frameBuffer_.depthStencilAttachmentId = 0;
-		this->frameBuffer_.colorAttachmentId = 0;
-		this->frameBuffer_.sizes = {};
+		GLuint textures[2] = { this->shadowMaps_.spotMapId, this->shadowMaps_.cascadeMapId };
+		glDeleteTextures(2, textures);
+		glDeleteFramebuffers(1, &(this->shadowMaps_.frameBufferId));
+		if (this->shadowMaps_.spotMapId) GpuMemory::get().release(GPU_MEMORY_SHADOW_MAPS, ShadowMapsMemorySize());
+
+		this->shadowMaps_.frameBufferId = 0;
+		this->shadowMaps_.spotMapId = 0;
+		this->shadowMaps_.cascadeMapId = 0;
 	}
 
 	/**
 	* \brief Проход для рендеринга геометрии (рендеринг в G-буфер)
-	* \param shaderID шейдер для рендеринга в G-буфре
+	* \param shader Шейдер для рендеринга в G-буфер (вариант выбирается для каждой части меша)
 	* \param clearColor Цвет очистки
 	* \param clearMask Маска очистки
 	*/
-	void Renderer::renderPassGeometry(GLuint shaderID, glm::vec4 clearColor, GLbitfield clearMask)
+	void Renderer::renderPassGeometry(const ShaderResourcePtr& shader, glm::vec4 clearColor, GLbitfield clearMask, bool depthPrePassed, bool countSamples)
 	{
-		// Установка размеров области вида
-		glViewport(0, 0, this->viewPort.width, this->viewPort.height);
+		OGL_STATS_PASS(RENDER_STATS_GEOMETRY);
 
-		// Активировать G-буфер (рендеринг в G-буфер)
-		glBindFramebuffer(GL_FRAMEBUFFER, this->gBuffer_.gBufferId);
+		// Установка размеров области вида (G-буфер привязан графом кадра)
+		glViewport(0, 0, this->renderSize_.width, this->renderSize_.height);
 
-		// Установка параметров очистки экрана
-		glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
-		glClear(clearMask);
+		// Если глубина уже записана - ее нельзя очищать, фрагменты проходят тест только при точном совпадении глубины
+		// (шейдер геометрии выполняется только для видимых фрагментов)
+		if (depthPrePassed) {
+			clearMask &= ~GL_DEPTH_BUFFER_BIT;
+			glDepthFunc(GL_EQUAL);
+			glDepthMask(GL_FALSE);
+		}
 
-		// Использовать шейдер
-		glUseProgram(shaderID);
+		// Установка параметров очистки экрана (трафарет очищается всегда - в нем отмечаются покрытые геометрией пиксели)
+		glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+		glClearStencil(0);
+		glStencilMask(0xFF);
+		glClear(clearMask | GL_STENCIL_BUFFER_BIT);
 
-		// Пеередать матрицы вида и проекции в шейдер
-		glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, glm::value_ptr(this->projectionMatrix_));
-		glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(this->viewMatrix_));
+		// Текущий вариант шейдера (выбирается для каждой части меша по набору ее текстур)
+		GLuint shaderID = 0;
+		GLuint compactMask = this->gBuffer_.layout == GBufferLayout::GBUFFER_COMPACT ? GeometryDefineCompact : 0;
 
-		// Передать положение камеры (для бликов/отражений)
-		glUniform3fv(glGetUniformLocation(shaderID, "cameraPosition"), 1, glm::value_ptr(this->cameraPosition));
+		// Начать подсчет фрагментов
+		if (countSamples) {
+			glBeginQuery(GL_SAMPLES_PASSED, this->overdraw_.shadedQueryId);
+		}
 
 		// Включить тест глубины
 		glEnable(GL_DEPTH_TEST);
 
-		// Отключить тест трафарета
-		glDisable(GL_STENCIL_TEST);
+		// Тест трафарета всегда проходит, каждый нарисованный фрагмент помечается битом геометрии
+		// Последующие проходы (теневые объемы, освещение) обрабатывают только помеченные пиксели, фон пропускается
+		glEnable(GL_STENCIL_TEST);
+		glStencilFunc(GL_ALWAYS, STENCIL_GEOMETRY_BIT, 0xFF);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_REPLACE);
 
 		// Пройтись по всем статическим мешам
 		for (auto staticMesh : this->staticMeshes_)
 		{
+			OGL_STATS_ADD(meshesSubmitted, 1);
+
 			// Пройтись по всем частям меша
-			for (auto part : staticMesh->getParts())
+			for (const StaticMeshPart& part : staticMesh->getParts())
 			{
+				// Минимальный вариант шейдера для части (без выборок из отсутствующих текстур)
+				GLuint variantID = shader->getVariantId(part.getShaderDefineMask() | compactMask, GeometryShaderDefines);
+
+				// Если вариант сменился - использовать его и передать общие для прохода значения
+				if (variantID != shaderID)
+				{
+					shaderID = variantID;
+					glUseProgram(shaderID);
+					OGL_STATS_ADD(programBinds, 1);
+					this->frameStats_.shaderSwitches++;
+
+					// Пеередать матрицы вида и проекции в шейдер
+					glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, glm::value_ptr(this->projectionMatrix_));
+					glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(this->viewMatrix_));
+
+					// Передать положение камеры (для бликов/отражений)
+					glUniform3fv(glGetUniformLocation(shaderID, "cameraPosition"), 1, glm::value_ptr(this->cameraPosition));
+					OGL_STATS_ADD(uniformUploads, 3);
+				}
+
 				// Передать матрицу модели в шейдер
 				glm::mat4 mdodelMatrix = staticMesh->getModelMatrix();
 				glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, glm::value_ptr(mdodelMatrix));
@@ -239,16 +224,21 @@ namespace ogl
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, part.displacementTexture.wrapS);
 				glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, part.displacementTexture.wrapT);
 				glUniform1i(glGetUniformLocation(shaderID, "displaceTexture"), 3);
+				OGL_STATS_ADD(textureBinds, 4);
+				OGL_STATS_ADD(uniformUploads, 5);
 
 				// Привязать VAO
 				glBindVertexArray(part.getGeometry()->getVaoId());
+				OGL_STATS_ADD(vaoBinds, 1);
 
 				// Рисовать либо индексированную либо не-индексированную геометрию
 				if (part.getGeometry()->IsIndexed()) {
 					glDrawElements(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+					OGL_STATS_DRAW(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount());
 				}
 				else {
 					glDrawArrays(GL_TRIANGLES, 0, part.getGeometry()->getVertexCount());
+					OGL_STATS_DRAW(GL_TRIANGLES, part.getGeometry()->getVertexCount());
 				}
 
 				// Отвязка VAO
@@ -256,16 +246,432 @@ namespace ogl
 			}
 		}
 
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		// Завершить подсчет фрагментов
+		if (countSamples) {
+			glEndQuery(GL_SAMPLES_PASSED);
+		}
+
+		// Отключить тест трафарета
+		glDisable(GL_STENCIL_TEST);
+
+		// Вернуть тест и запись глубины в исходное состояние
+		glDepthFunc(GL_LESS);
+		glDepthMask(GL_TRUE);
+	}
+
+	/**
+	* \brief Предварительный проход глубины (только положения вершин, без записи цвета)
+	* \param shaderID Шейдер глубины
+	* \param countSamples Считать кол-во прошедших тест глубины фрагментов (для оценки перекрытия)
+	*/
+	void Renderer::renderPassDepthPrePass(GLuint shaderID, bool countSamples)
+	{
+		OGL_STATS_PASS(RENDER_STATS_DEPTH_PREPASS);
+
+		// Установка размеров области вида (глубина пишется во вложение глубины-трафарета G-буфера, привязанного графом кадра)
+		glViewport(0, 0, this->renderSize_.width, this->renderSize_.height);
+
+		// Очистить глубину
+		glDepthMask(GL_TRUE);
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		// Цвет не записывается
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+
+		// Включить тест глубины, отключить тест трафарета
+		glEnable(GL_DEPTH_TEST);
+		glDepthFunc(GL_LESS);
+		glDisable(GL_STENCIL_TEST);
+
+		// Использовать шейдер
+		glUseProgram(shaderID);
+		OGL_STATS_ADD(programBinds, 1);
+
+		// Матрицы вида и проекции передаются раздельно, как в проходе геометрии (положения должны совпасть в точности)
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, glm::value_ptr(this->projectionMatrix_));
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(this->viewMatrix_));
+		OGL_STATS_ADD(uniformUploads, 2);
+
+		// Начать подсчет фрагментов
+		if (countSamples) {
+			glBeginQuery(GL_SAMPLES_PASSED, this->overdraw_.shadedQueryId);
+		}
+
+		// Пройтись по всем статическим мешам
+		for (auto staticMesh : this->staticMeshes_)
+		{
+			// Передать матрицу модели в шейдер
+			glm::mat4 mdodelMatrix = staticMesh->getModelMatrix();
+			glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, glm::value_ptr(mdodelMatrix));
+			OGL_STATS_ADD(uniformUploads, 1);
+
+			// Пройтись по всем частям меша
+			for (auto& part : staticMesh->getParts())
+			{
+				// Привязать VAO (только положения вершин)
+				glBindVertexArray(part.getGeometry()->getPositionVaoId());
+				OGL_STATS_ADD(vaoBinds, 1);
+
+				// Без геометрического шейдера смежные вершины игнорируются, рисуются обычные треугольники
+				if (part.getGeometry()->IsIndexed()) {
+					glDrawElements(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+					OGL_STATS_DRAW(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount());
+				}
+				else {
+					glDrawArrays(GL_TRIANGLES, 0, part.getGeometry()->getVertexCount());
+					OGL_STATS_DRAW(GL_TRIANGLES, part.getGeometry()->getVertexCount());
+				}
+
+				// Отвязка VAO
+				glBindVertexArray(0);
+			}
+		}
+
+		// Завершить подсчет фрагментов
+		if (countSamples) {
+			glEndQuery(GL_SAMPLES_PASSED);
+		}
+
+		// Снова включить запись цвета
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+
+	/**
+	* \brief Подсчет кол-ва покрытых геометрией пикселей (по биту геометрии в трафарете)
+	* \param shaderID Шейдер глубины
+	*/
+	void Renderer::renderPassCoverage(GLuint shaderID)
+	{
+		OGL_STATS_PASS(RENDER_STATS_DEPTH_PREPASS);
+
+		// Установка размеров области вида (трафарет с битом геометрии привязан графом кадра)
+		glViewport(0, 0, this->renderSize_.width, this->renderSize_.height);
+
+		// Ничего не записывается, квадрат проходит только там, где есть бит геометрии
+		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
+		glDisable(GL_DEPTH_TEST);
+		glEnable(GL_STENCIL_TEST);
+		glStencilFunc(GL_EQUAL, STENCIL_GEOMETRY_BIT, STENCIL_GEOMETRY_BIT);
+		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
+
+		// Квадрат на весь экран (координаты вершин квадрата уже в пространстве отсечения)
+		glUseProgram(shaderID);
+		OGL_STATS_ADD(programBinds, 1);
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1)));
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1)));
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1)));
+		OGL_STATS_ADD(uniformUploads, 3);
+
+		glBeginQuery(GL_SAMPLES_PASSED, this->overdraw_.coveredQueryId);
+		glBindVertexArray(this->defaultGeometry_.quad->getVaoId());
+		OGL_STATS_ADD(vaoBinds, 1);
+		glDrawElements(GL_TRIANGLES, this->defaultGeometry_.quad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+		OGL_STATS_DRAW(GL_TRIANGLES, this->defaultGeometry_.quad->getIndexCount());
+		glBindVertexArray(0);
+		glEndQuery(GL_SAMPLES_PASSED);
+
+		// Вернуть состояние в исходное
+		glDisable(GL_STENCIL_TEST);
+		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+	}
+
+	/**
+	* \brief Получить результат измерения перекрытия, если он готов
+	*/
+	void Renderer::updateOverdrawEstimate()
+	{
+		if (!this->overdraw_.pending) {
+			return;
+		}
+
+		// Запросы завершаются по порядку - если готов последний, готов и первый
+		GLuint available = 0;
+		glGetQueryObjectuiv(this->overdraw_.coveredQueryId, GL_QUERY_RESULT_AVAILABLE, &available);
+		if (!available) {
+			return;
+		}
+
+		GLuint shaded = 0;
+		GLuint covered = 0;
+		glGetQueryObjectuiv(this->overdraw_.shadedQueryId, GL_QUERY_RESULT, &shaded);
+		glGetQueryObjectuiv(this->overdraw_.coveredQueryId, GL_QUERY_RESULT, &covered);
+
+		this->overdraw_.value = covered > 0 ? static_cast<GLfloat>(shaded) / static_cast<GLfloat>(covered) : 1.0f;
+		this->overdraw_.pending = false;
+	}
+
+	/**
+	* \brief Подобрать масштаб разрешения рендеринга по измеренному времени кадра
+	* \details Стоимость большинства проходов пропорциональна кол-ву пикселей, поэтому масштаб меняется
+	* пропорционально корню из отношения целевого и измеренного времени (уменьшается быстрее, чем растет)
+	*/
+	void Renderer::updateRenderScale()
+	{
+		GLfloat minScale = glm::clamp(this->dynamicResolution.minScale, 0.1f, 1.0f);
+		GLfloat maxScale = glm::clamp(this->dynamicResolution.maxScale, minScale, 1.0f);
+
+		// Профилировщик выключен - время кадров не измеряется
+		if (!Profiler::get().isEnabled()) {
+			this->gpuTiming_.frameTime = 0.0f;
+			this->gpuTiming_.passes.clear();
+		}
+
+		// Кадры, результаты которых профилировщик получил в начале этого кадра
+		for (const ProfilerFrameResult& frame : Profiler::get().getResolvedFrames())
+		{
+			this->gpuTiming_.frameTime = RenderGraphGpuTime(frame);
+			this->gpuTiming_.passes = RenderGraphPassTimings(frame);
+
+			if (!this->dynamicResolution.enabled || this->renderScaleOverride_ > 0.0f || this->gpuTiming_.frameTime <= 0.0f) continue;
+
+			// Масштаб, при котором время кадра было бы равно целевому (от масштаба измеренного кадра, а не текущего -
+			// иначе несколько результатов, полученных за один кадр, уменьшали бы масштаб повторно)
+			GLfloat frameScale = this->gpuTiming_.frameScales[frame.index % PROFILER_GPU_FRAMES];
+			GLfloat desired = frameScale * glm::sqrt(this->dynamicResolution.targetFrameTime / this->gpuTiming_.frameTime);
+			desired = glm::clamp(desired, minScale, maxScale);
+
+			// При превышении целевого времени масштаб уменьшается сразу, запас используется постепенно (без колебаний)
+			GLfloat scale = desired < this->renderSize_.scale ? desired : glm::mix(this->renderSize_.scale, desired, 0.1f);
+
+			// Мелкие изменения не применяются (размер кадра не "дрожит" от шума измерений)
+			if (glm::abs(scale - this->renderSize_.scale) >= 0.02f || scale == minScale || scale == maxScale) {
+				this->renderSize_.scale = scale;
+			}
+		}
+
+		// Без динамического разрешения рендеринг выполняется в разрешении окна, при воспроизведении - в записанном
+		if (this->renderScaleOverride_ > 0.0f) {
+			this->renderSize_.scale = glm::clamp(this->renderScaleOverride_, 0.1f, 1.0f);
+		}
+		else {
+			this->renderSize_.scale = this->dynamicResolution.enabled ? glm::clamp(this->renderSize_.scale, minScale, maxScale) : 1.0f;
+		}
+		this->renderSize_.width = glm::max(static_cast<GLuint>(glm::round(this->viewPort.width * this->renderSize_.scale)), 1u);
+		this->renderSize_.height = glm::max(static_cast<GLuint>(glm::round(this->viewPort.height * this->renderSize_.scale)), 1u);
+	}
+
+	/**
+	* \brief Визуализация перекрытия (кол-во слоев геометрии на пиксель, чем ярче - тем больше слоев)
+	* \param shaderID Шейдер однотонной заливки
+	*/
+	void Renderer::renderPassOverdraw(GLuint shaderID) const
+	{
+		// Установка размеров области вида
+		glViewport(0, 0, this->renderSize_.width, this->renderSize_.height);
+
+		// Освещенный кадр заменяется визуализацией
+		glClearColor(0.0f, 0.0f, 0.0f, 1.0f);
+		glClear(GL_COLOR_BUFFER_BIT);
+
+		// Каждый слой геометрии добавляет немного цвета (насыщение - около 10 слоев)
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_STENCIL_TEST);
+		glEnable(GL_BLEND);
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFunc(GL_ONE, GL_ONE);
+
+		// Использовать шейдер
+		glUseProgram(shaderID);
+		OGL_STATS_ADD(programBinds, 1);
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, glm::value_ptr(this->projectionMatrix_));
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(this->viewMatrix_));
+		glUniform3fv(glGetUniformLocation(shaderID, "lightColor"), 1, glm::value_ptr(glm::vec3(0.1f, 0.05f, 0.02f)));
+		OGL_STATS_ADD(uniformUploads, 3);
+
+		// Пройтись по всем статическим мешам
+		for (auto staticMesh : this->staticMeshes_)
+		{
+			// Передать матрицу модели в шейдер
+			glm::mat4 mdodelMatrix = staticMesh->getModelMatrix();
+			glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, glm::value_ptr(mdodelMatrix));
+			OGL_STATS_ADD(uniformUploads, 1);
+
+			// Пройтись по всем частям меша
+			for (auto& part : staticMesh->getParts())
+			{
+				glBindVertexArray(part.getGeometry()->getPositionVaoId());
+				OGL_STATS_ADD(vaoBinds, 1);
+
+				if (part.getGeometry()->IsIndexed()) {
+					glDrawElements(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+					OGL_STATS_DRAW(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount());
+				}
+				else {
+					glDrawArrays(GL_TRIANGLES, 0, part.getGeometry()->getVertexCount());
+					OGL_STATS_DRAW(GL_TRIANGLES, part.getGeometry()->getVertexCount());
+				}
+
+				glBindVertexArray(0);
+			}
+		}
+
+		// Отключить смешивание
+		glDisable(GL_BLEND);
+	}
+
+	/**
+	* \brief Положение источника, от которого вытягиваются теневые объемы
+	* \details Одна модель источника для геометрического шейдера, построения объемов на CPU и выбора метода Z-pass/Z-fail
+	* \param light Источник освещения
+	* \return Положение в мировом пространстве (w = 0 для направленного источника - тогда это вектор к источнику)
+	*/
+	glm::vec4 Renderer::getShadowVolumeLight(LightPtr light) const
+	{
+		if (light->getType() == LightType::DIRECTIONAL_LIGHT) {
+			return glm::vec4(-glm::normalize(light->getDirection()), 0.0f);
+		}
+
+		return glm::vec4(light->position, 1.0f);
+	}
+
+	/**
+	* \brief Нужны ли крышки теневого объема (метод Z-fail) для источника в текущем кадре
+	* \details Если ближняя плоскость отсечения камеры не может оказаться внутри ни одного теневого объема источника,
+	* то можно использовать более дешевый метод Z-pass, не требующий передней и задней крышек объема
+	* \param light Источник освещения
+	* \return Да, если нужен Z-fail
+	*/
+	bool Renderer::isShadowVolumeCapRequired(LightPtr light) const
+	{
+		// Углы ближней плоскости отсечения камеры в мировом пространстве
+		glm::mat4 inverseViewProjection = glm::inverse(this->projectionMatrix_ * this->viewMatrix_);
+		glm::vec3 corners[4];
+		glm::vec2 ndcCorners[4] = { { -1.0f,-1.0f },{ 1.0f,-1.0f },{ 1.0f,1.0f },{ -1.0f,1.0f } };
+		for (unsigned int i = 0; i < 4; i++) {
+			glm::vec4 corner = inverseViewProjection * glm::vec4(ndcCorners[i], -1.0f, 1.0f);
+			corners[i] = glm::vec3(corner) / corner.w;
+		}
+
+		// Центр ближней плоскости (заведомо находится внутри проверяемой области)
+		glm::vec3 center = (corners[0] + corners[1] + corners[2] + corners[3]) * 0.25f;
+
+		// Направленный источник находится бесконечно далеко (вектор к нему - обратное направление света),
+		// так же, как при построении объемов (см. getShadowVolumeLight)
+		glm::vec4 lightWorld = this->getShadowVolumeLight(light);
+		bool directional = lightWorld.w == 0.0f;
+		glm::vec3 toLight = directional ? glm::vec3(lightWorld) : light->position - center;
+
+		// Плоскости выпуклой области между источником и ближней плоскостью камеры (xyz - нормаль, w - смещение)
+		// Любой объект, отбрасывающий тень на ближнюю плоскость, обязан пересекать эту область
+		glm::vec4 planes[5];
+
+		// Плоскость отсечения камеры (внутренняя сторона - та, где источник)
+		glm::vec3 nearNormal = glm::cross(corners[1] - corners[0], corners[3] - corners[0]);
+		if (glm::dot(nearNormal, toLight) < 0.0f) nearNormal = -nearNormal;
+
+		// Если источник лежит (почти) в ближней плоскости - область вырождена, используем надежный Z-fail
+		if (glm::abs(glm::dot(glm::normalize(nearNormal), toLight)) < 0.0001f) {
+			return true;
+		}
+
+		planes[0] = glm::vec4(nearNormal, -glm::dot(nearNormal, center));
+
+		// Боковые плоскости, проходящие через ребра ближней плоскости и источник
+		for (unsigned int i = 0; i < 4; i++)
+		{
+			glm::vec3 a = corners[i];
+			glm::vec3 b = corners[(i + 1) % 4];
+			glm::vec3 normal = directional ? glm::cross(b - a, toLight) : glm::cross(b - a, light->position - a);
+			if (glm::dot(normal, center - a) < 0.0f) normal = -normal;
+			planes[i + 1] = glm::vec4(normal, -glm::dot(normal, a));
+		}
+
+		// Пройтись по всем статическим мешам и проверить пересечение их ограничивающих объемов с областью
+		for (auto staticMesh : this->staticMeshes_)
+		{
+			glm::mat4 modelMatrix = staticMesh->getModelMatrix();
+
+			for (auto& part : staticMesh->getParts())
+			{
+				// Теневые объемы строятся только для индексированной геометрии
+				if (!part.getGeometry()->IsIndexed()) continue;
+
+				BoundingBox box = part.getGeometry()->getBounds().transformed(modelMatrix);
+
+				// Объект вне области, если он целиком с внешней стороны хотя бы одной плоскости
+				bool outside = false;
+				for (const glm::vec4& plane : planes)
+				{
+					// Наиболее удаленная в направлении нормали точка объема
+					glm::vec3 positive(
+						plane.x >= 0.0f ? box.max.x : box.min.x,
+						plane.y >= 0.0f ? box.max.y : box.min.y,
+						plane.z >= 0.0f ? box.max.z : box.min.z);
+
+					if (glm::dot(glm::vec3(plane), positive) + plane.w < 0.0f) {
+						outside = true;
+						break;
+					}
+				}
+
+				// Если хотя бы один объект может затенять ближнюю плоскость - нужны крышки
+				if (!outside) return true;
+			}
+		}
+
+		return false;
+	}
+
+	/**
+	* \brief Обновить кешированные теневые объемы источника
+	* \details Объемы перестраиваются только для тех мешей, у которых изменилось положение (либо изменилось положение источника)
+	* \param light Источник освещения
+	*/
+	void Renderer::updateShadowVolumes(LightPtr light)
+	{
+		OGL_PROFILE_ZONE_CPU("shadow-volumes-update");
+
+		// Положение источника в мировом пространстве (для направленного - вектор к источнику, w = 0)
+		glm::vec4 lightWorld = this->getShadowVolumeLight(light);
+
+		for (auto staticMesh : this->staticMeshes_)
+		{
+			auto& parts = staticMesh->getParts();
+			auto& entries = this->shadowVolumeCache_[{ light.get(), staticMesh.get() }];
+
+			// Нужно ли перестраивать объемы всех частей меша (изменилось положение, либо кол-во частей)
+			bool rebuildAll = light->isTransformChanged() || staticMesh->isTransformChanged() || entries.size() != parts.size();
+			entries.resize(parts.size());
+
+			// Положение источника в пространстве модели меша (объем строится в нем, матрица модели применяется при рисовании)
+			glm::vec4 lightLocal = glm::inverse(staticMesh->getModelMatrix()) * lightWorld;
+
+			for (size_t i = 0; i < parts.size(); i++)
+			{
+				StaticGeometryResourcePtr geometry = parts[i].getGeometry();
+				ShadowVolumeCacheEntry& entry = entries[i];
+
+				// Объем актуален, если он построен для той же геометрии и положение не менялось
+				if (!rebuildAll && entry.geometry == geometry) {
+					this->frameStats_.shadowVolumesCached++;
+					continue;
+				}
+
+				entry.geometry = geometry;
+
+				// Объемы строятся только для геометрии со смежностями
+				if (geometry == nullptr || geometry->getShadowCasterData().triangles.empty()) {
+					entry.volume = nullptr;
+					continue;
+				}
+
+				if (entry.volume == nullptr) entry.volume = MakeShadowVolume();
+				entry.volume->build(geometry->getShadowCasterData(), lightLocal);
+				this->frameStats_.shadowVolumesBuilt++;
+			}
+		}
 	}
 
 	/**
 	* \brief Проход для построения теневых объемов и записи инаформации о тени в stencil-буфер
 	* \param light Источник освещения
 	* \param shaderID Шейдер для построения теневых объемов
+	* \param zFail Использовать метод Z-fail (с крышками объема), иначе Z-pass
 	*/
-	void Renderer::renderPassShadows(LightPtr light, GLuint shaderID)
+	void Renderer::renderPassShadows(LightPtr light, GLuint shaderID, bool zFail)
 	{
+		OGL_STATS_PASS(RENDER_STATS_SHADOWS);
+
 		// Включить тест глубины
 		glEnable(GL_DEPTH_TEST);
 		// Отключить отбрасывание граней (нам нужны обе стороны теневого объема)
@@ -279,50 +685,90 @@ namespace ogl
 		glPolygonOffset(0.0f, 100.0f);
 
 		// Установка размеров области вида
-		glViewport(0, 0, this->viewPort.width, this->viewPort.height);
-
-		// Активировать фрейм-буфер (рендеринг во фрейм-буфер)
-		glBindFramebuffer(GL_FRAMEBUFFER, this->frameBuffer_.frameBufferId);
+		glViewport(0, 0, this->renderSize_.width, this->renderSize_.height);
 
-		// Очистить stencil буфер
+		// Очистить счетчик теней в stencil буфере (бит геометрии защищен маской записи)
+		glStencilMask(STENCIL_SHADOW_MASK);
 		glClear(GL_STENCIL_BUFFER_BIT);
 
 		// Отключить рисование в цветовой буфер (тени рисуются только в stencil, при этом учитывая Z-буфер)
 		glColorMask(GL_FALSE, GL_FALSE, GL_FALSE, GL_FALSE);
 
-		// Активировать stencil-тест, но он должен всегда проходить успешно
+		// Активировать stencil-тест, он проходит только для пикселей, покрытых геометрией (фон не может быть затенен)
 		glEnable(GL_STENCIL_TEST);
-		glStencilFunc(GL_ALWAYS, 0, 0xff);
+		glStencilFunc(GL_EQUAL, STENCIL_GEOMETRY_BIT, STENCIL_GEOMETRY_BIT);
 
-		// Алгоритм Z-fail. В начале рисуем нелицевые полигоны теневого объема, увелививая stencil значение для них на 1
-		// Затем, рисуя лицевые, от того что есть единицу. В итоге затененных областях остануться единицы
-		glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
-		glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+		if (zFail)
+		{
+			// Алгоритм Z-fail. В начале рисуем нелицевые полигоны теневого объема, увелививая stencil значение для них на 1
+			// Затем, рисуя лицевые, от того что есть единицу. В итоге затененных областях остануться единицы
+			glStencilOpSeparate(GL_BACK, GL_KEEP, GL_INCR_WRAP, GL_KEEP);
+			glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_DECR_WRAP, GL_KEEP);
+		}
+		else
+		{
+			// Алгоритм Z-pass. Лицевые полигоны, прошедшие тест глубины, увеличивают значение, нелицевые - уменьшают
+			// Крышки объема не нужны, поскольку ближняя плоскость камеры гарантированно вне теневых объемов
+			glStencilOpSeparate(GL_FRONT, GL_KEEP, GL_KEEP, GL_INCR_WRAP);
+			glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_DECR_WRAP);
+		}
 
 		// Использовать шейдер
 		glUseProgram(shaderID);
+		OGL_STATS_ADD(programBinds, 1);
 
 		// Передать матрицы вида, проекции, положение источника освещения в шейдер
 		glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, glm::value_ptr(this->projectionMatrix_));
 		glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(this->viewMatrix_));
-		glUniform3fv(glGetUniformLocation(shaderID, "lightPosition"), 1, glm::value_ptr(light->position));
+		glUniform4fv(glGetUniformLocation(shaderID, "lightPosition"), 1, glm::value_ptr(this->getShadowVolumeLight(light)));
+
+		// Передать необходимость построения крышек объема
+		glUniform1i(glGetUniformLocation(shaderID, "caps"), zFail ? 1 : 0);
+		OGL_STATS_ADD(uniformUploads, 4);
 
 		// Пройтись по всем статическим мешам
 		for (auto staticMesh : this->staticMeshes_)
 		{
-			// Пройтись по всем частям меша
-			for (auto part : staticMesh->getParts())
+			// Передать матрицу модели в шейдер
+			glm::mat4 mdodelMatrix = staticMesh->getModelMatrix();
+			glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, glm::value_ptr(mdodelMatrix));
+			OGL_STATS_ADD(uniformUploads, 1);
+
+			// Если объемы построены на CPU - рисовать их из кеша
+			if (this->shadowVolumeMode == ShadowVolumeMode::CPU_CACHED)
 			{
-				// Передать матрицу модели в шейдер
-				glm::mat4 mdodelMatrix = staticMesh->getModelMatrix();
-				glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, glm::value_ptr(mdodelMatrix));
+				auto cached = this->shadowVolumeCache_.find({ light.get(), staticMesh.get() });
+				if (cached == this->shadowVolumeCache_.end()) continue;
+
+				for (auto& entry : cached->second)
+				{
+					if (entry.volume == nullptr) continue;
+
+					// Боковые стороны нужны всегда, крышки (следуют за ними в буфере) - только для Z-fail
+					GLuint count = entry.volume->getSidesVertexCount() + (zFail ? entry.volume->getCapsVertexCount() : 0);
+					if (count == 0) continue;
+
+					glBindVertexArray(entry.volume->getVaoId());
+					OGL_STATS_ADD(vaoBinds, 1);
+					glDrawArrays(GL_TRIANGLES, 0, count);
+					OGL_STATS_DRAW(GL_TRIANGLES, count);
+					glBindVertexArray(0);
+				}
 
+				continue;
+			}
+
+			// Пройтись по всем частям меша
+			for (auto& part : staticMesh->getParts())
+			{
 				// Привязать VAO
 				glBindVertexArray(part.getGeometry()->getVaoId());
+				OGL_STATS_ADD(vaoBinds, 1);
 
 				// Рисовать только индексированную геометрию со смежностями
 				if (part.getGeometry()->IsIndexed()) {
 					glDrawElements(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+					OGL_STATS_DRAW(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount());
 				}
 
 				// Отвязка VAO
@@ -344,34 +790,332 @@ namespace ogl
 		glPolygonOffset(0, 0);
 		// Снова включить рисование в цветовой буфер
 		glColorMask(GL_TRUE, GL_TRUE, GL_TRUE, GL_TRUE);
+		// Вернуть маску записи трафарета и отключить тест трафарета
+		glStencilMask(0xFF);
+		glDisable(GL_STENCIL_TEST);
+	}
+
+	/**
+	* \brief Используются ли для источника карты теней
+	* \details В режиме SHADOW_MAPS точечные источники используют теневые объемы, в режиме SHADOW_ATLAS - ячейки атласа
+	* \param light Источник освещения
+	* \return Да или нет
+	*/
+	bool Renderer::isShadowMapped(LightPtr light) const
+	{
+		switch (this->shadowTechnique)
+		{
+		case ShadowTechnique::SHADOW_MAPS:
+			return light->getType() != LightType::POINT_LIGHT;
+		case ShadowTechnique::SHADOW_ATLAS:
+			return true;
+		default:
+			return false;
+		}
+	}
+
+	/**
+	* \brief Подобрать каскады карт теней направленного источника
+	* \details Границы каскадов распределяются по пирамиде видимости камеры (комбинация логарифмического и
+	* равномерного распределения), каждый каскад охватывает свою часть пирамиды ограничивающей сферой
+	* \param light Направленный источник освещения
+	*/
+	void Renderer::updateShadowCascades(LightPtr light)
+	{
+		// Ближняя и дальняя плоскости камеры (из ее матрицы проекции)
+		GLfloat zNear = this->projectionMatrix_[3][2] / (this->projectionMatrix_[2][2] - 1.0f);
+		GLfloat zFar = this->projectionMatrix_[3][2] / (this->projectionMatrix_[2][2] + 1.0f);
+		GLfloat shadowFar = glm::min(zFar, this->shadowCascades.maxDistance);
+
+		// Углы ближней и дальней плоскостей камеры в мировом пространстве
+		glm::mat4 inverseViewProjection = glm::inverse(this->projectionMatrix_ * this->viewMatrix_);
+		glm::vec3 nearCorners[4];
+		glm::vec3 farCorners[4];
+		glm::vec2 ndcCorners[4] = { { -1.0f,-1.0f },{ 1.0f,-1.0f },{ 1.0f,1.0f },{ -1.0f,1.0f } };
+		for (unsigned int i = 0; i < 4; i++) {
+			glm::vec4 nearCorner = inverseViewProjection * glm::vec4(ndcCorners[i], -1.0f, 1.0f);
+			glm::vec4 farCorner = inverseViewProjection * glm::vec4(ndcCorners[i], 1.0f, 1.0f);
+			nearCorners[i] = glm::vec3(nearCorner) / nearCorner.w;
+			farCorners[i] = glm::vec3(farCorner) / farCorner.w;
+		}
+
+		// Направление света и вектор UP для матрицы вида источника
+		glm::vec3 direction = glm::normalize(light->getDirection());
+		glm::vec3 up = glm::abs(direction.y) > 0.99f ? glm::vec3(0.0f, 0.0f, 1.0f) : glm::vec3(0.0f, 1.0f, 0.0f);
+
+		// Ограничивающие объемы всей геометрии (в мировом пространстве)
+		std::vector<BoundingBox> sceneBoxes;
+		for (auto staticMesh : this->staticMeshes_) {
+			glm::mat4 modelMatrix = staticMesh->getModelMatrix();
+			for (auto& part : staticMesh->getParts()) {
+				sceneBoxes.push_back(part.getGeometry()->getBounds().transformed(modelMatrix));
+			}
+		}
+
+		this->shadowMaps_.cascadeCount = glm::clamp<GLuint>(this->shadowCascades.cascadeCount, 1, SHADOW_MAP_CASCADES);
+		GLfloat splitNear = zNear;
+
+		for (GLuint i = 0; i < this->shadowMaps_.cascadeCount; i++)
+		{
+			// Дальняя граница каскада (комбинация логарифмического и равномерного распределения)
+			GLfloat part = static_cast<GLfloat>(i + 1) / static_cast<GLfloat>(this->shadowMaps_.cascadeCount);
+			GLfloat logSplit = zNear * glm::pow(shadowFar / zNear, part);
+			GLfloat uniformSplit = zNear + (shadowFar - zNear) * part;
+			GLfloat splitFar = glm::mix(uniformSplit, logSplit, this->shadowCascades.splitLambda);
+
+			// Углы части пирамиды видимости (глубина меняется вдоль ребер пирамиды линейно)
+			glm::vec3 corners[8];
+			for (unsigned int j = 0; j < 4; j++) {
+				corners[j] = glm::mix(nearCorners[j], farCorners[j], (splitNear - zNear) / (zFar - zNear));
+				corners[j + 4] = glm::mix(nearCorners[j], farCorners[j], (splitFar - zNear) / (zFar - zNear));
+			}
+
+			// Ограничивающая сфера части пирамиды (размер не зависит от поворота камеры, что исключает "дрожание" теней)
+			glm::vec3 center(0.0f);
+			for (const glm::vec3& corner : corners) center += corner / 8.0f;
+			GLfloat radius = 0.0f;
+			for (const glm::vec3& corner : corners) radius = glm::max(radius, glm::length(corner - center));
+			radius = glm::ceil(radius * 16.0f) / 16.0f;
+
+			// Матрица вида источника (смотрит на центр сферы)
+			glm::mat4 lightView = glm::lookAt(center - direction * radius, center, up);
+
+			// Глубина охватывает всю геометрию сцены по направлению света (тени отбрасывают и объекты вне пирамиды)
+			GLfloat depthMin = 0.0f;
+			GLfloat depthMax = radius * 2.0f;
+			for (const BoundingBox& box : sceneBoxes) {
+				for (unsigned int c = 0; c < 8; c++) {
+					glm::vec3 corner(c & 1 ? box.max.x : box.min.x, c & 2 ? box.max.y : box.min.y, c & 4 ? box.max.z : box.min.z);
+					GLfloat depth = -(lightView * glm::vec4(corner, 1.0f)).z;
+					depthMin = glm::min(depthMin, depth);
+					depthMax = glm::max(depthMax, depth);
+				}
+			}
+
+			glm::mat4 lightProjection = glm::ortho(-radius, radius, -radius, radius, depthMin, depthMax);
+
+			// Привязать начало координат источника к текселям карты (при перемещении камеры тени не "мерцают")
+			glm::vec4 origin = lightProjection * lightView * glm::vec4(0.0f, 0.0f, 0.0f, 1.0f) * (SHADOW_MAP_SIZE / 2.0f);
+			glm::vec4 offset = (glm::round(origin) - origin) * (2.0f / SHADOW_MAP_SIZE);
+			lightProjection[3][0] += offset.x;
+			lightProjection[3][1] += offset.y;
+
+			this->shadowMaps_.cascadeMatrices[i] = lightProjection * lightView;
+			this->shadowMaps_.cascadeSplits[i] = splitFar;
+			splitNear = splitFar;
+		}
+	}
+
+	/**
+	* \brief Нарисовать всю геометрию сцены в текущий буфер глубины
+	* \param shaderID Шейдер для рендеринга в карту теней
+	* \param lightMatrix Матрица вида-проекции источника
+	*/
+	void Renderer::renderShadowMapGeometry(GLuint shaderID, const glm::mat4& lightMatrix) const
+	{
+		// Матрица вида-проекции источника передается целиком (как проекция)
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, glm::value_ptr(lightMatrix));
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(glm::mat4(1)));
+		OGL_STATS_ADD(uniformUploads, 2);
+
+		// Пройтись по всем статическим мешам
+		for (auto staticMesh : this->staticMeshes_)
+		{
+			// Передать матрицу модели в шейдер
+			glm::mat4 mdodelMatrix = staticMesh->getModelMatrix();
+			glUniformMatrix4fv(glGetUniformLocation(shaderID, "model"), 1, GL_FALSE, glm::value_ptr(mdodelMatrix));
+			OGL_STATS_ADD(uniformUploads, 1);
+
+			// Пройтись по всем частям меша
+			for (auto& part : staticMesh->getParts())
+			{
+				// Привязать VAO (только положения вершин)
+				glBindVertexArray(part.getGeometry()->getPositionVaoId());
+				OGL_STATS_ADD(vaoBinds, 1);
+
+				// Без геометрического шейдера смежные вершины игнорируются, рисуются обычные треугольники
+				if (part.getGeometry()->IsIndexed()) {
+					glDrawElements(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+					OGL_STATS_DRAW(GL_TRIANGLES_ADJACENCY, part.getGeometry()->getIndexCount());
+				}
+				else {
+					glDrawArrays(GL_TRIANGLES, 0, part.getGeometry()->getVertexCount());
+					OGL_STATS_DRAW(GL_TRIANGLES, part.getGeometry()->getVertexCount());
+				}
+
+				// Отвязка VAO
+				glBindVertexArray(0);
+			}
+		}
+	}
+
+	/**
+	* \brief Проход для рендеринга карт теней источника
+	* \param light Источник освещения (направленный или прожектор)
+	* \param shaderID Шейдер для рендеринга в карту теней
+	*/
+	void Renderer::renderPassShadowMaps(LightPtr light, GLuint shaderID)
+	{
+		OGL_STATS_PASS(RENDER_STATS_SHADOWS);
+
+		// Установка размеров области вида (размер карты)
+		glViewport(0, 0, SHADOW_MAP_SIZE, SHADOW_MAP_SIZE);
+
+		// Активировать буфер карт теней
+		glBindFramebuffer(GL_FRAMEBUFFER, this->shadowMaps_.frameBufferId);
+		OGL_STATS_ADD(frameBufferBinds, 1);
+
+		// Включить тест и запись глубины
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
 		// Отключить тест трафарета
 		glDisable(GL_STENCIL_TEST);
+		// Отключить отбрасывание граней (в сцене есть односторонняя геометрия - пол, стены)
+		glDisable(GL_CULL_FACE);
+		// Полигональный сдвиг глубины (во избежании самозатенения поверхностей)
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 4.0f);
+
+		// Использовать шейдер
+		glUseProgram(shaderID);
+		OGL_STATS_ADD(programBinds, 1);
+
+		if (light->getType() == LightType::DIRECTIONAL_LIGHT)
+		{
+			// Подобрать каскады под текущее положение камеры
+			this->updateShadowCascades(light);
+
+			// Нарисовать каждый каскад в свой слой массива
+			for (GLuint i = 0; i < this->shadowMaps_.cascadeCount; i++)
+			{
+				glFramebufferTextureLayer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, this->shadowMaps_.cascadeMapId, 0, i);
+				glClear(GL_DEPTH_BUFFER_BIT);
+				this->renderShadowMapGeometry(shaderID, this->shadowMaps_.cascadeMatrices[i]);
+				this->frameStats_.shadowMapPasses++;
+			}
+		}
+		else
+		{
+			// Прожектор - одна карта, перспективная проекция по внешнему конусу
+			this->shadowMaps_.spotMatrix = light->getProjectionMatrix(0.1f, light->getRange()) * light->getViewMatrix();
+
+			glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->shadowMaps_.spotMapId, 0);
+			glClear(GL_DEPTH_BUFFER_BIT);
+			this->renderShadowMapGeometry(shaderID, this->shadowMaps_.spotMatrix);
+			this->frameStats_.shadowMapPasses++;
+		}
+
+		// Вернуть состояние в исходное
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(0.0f, 0.0f);
+		glEnable(GL_CULL_FACE);
+		glDisable(GL_DEPTH_TEST);
+
+		// Прекращаем работу с фрейм-буфером
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		OGL_STATS_ADD(frameBufferBinds, 1);
+	}
+
+	/**
+	* \brief Проход для рендеринга ячеек атласа карт теней
+	* \details Перерисовываются только ячейки, выбранные атласом (в пределах ограничения на кадр)
+	* \param shaderID Шейдер для рендеринга в карту теней
+	*/
+	void Renderer::renderPassShadowAtlas(GLuint shaderID)
+	{
+		OGL_STATS_PASS(RENDER_STATS_SHADOWS);
+
+		// Если перерисовывать нечего
+		if (this->shadowAtlas_->getPendingTiles().empty()) {
+			return;
+		}
+
+		// Активировать буфер атласа
+		glBindFramebuffer(GL_FRAMEBUFFER, this->shadowAtlas_->getFrameBufferId());
+		OGL_STATS_ADD(frameBufferBinds, 1);
+
+		// Включить тест и запись глубины
+		glEnable(GL_DEPTH_TEST);
+		glDepthMask(GL_TRUE);
+		// Отключить тест трафарета
+		glDisable(GL_STENCIL_TEST);
+		// Отключить отбрасывание граней (в сцене есть односторонняя геометрия - пол, стены)
+		glDisable(GL_CULL_FACE);
+		// Полигональный сдвиг глубины (во избежании самозатенения поверхностей)
+		glEnable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(2.0f, 4.0f);
+		// Очистка и рисование ограничиваются ячейкой
+		glEnable(GL_SCISSOR_TEST);
+
+		// Использовать шейдер
+		glUseProgram(shaderID);
+		OGL_STATS_ADD(programBinds, 1);
+
+		for (ShadowAtlasTile* tile : this->shadowAtlas_->getPendingTiles())
+		{
+			// Область вида - ячейка атласа
+			glViewport(tile->position.x, tile->position.y, tile->size, tile->size);
+			glScissor(tile->position.x, tile->position.y, tile->size, tile->size);
+			glClear(GL_DEPTH_BUFFER_BIT);
+
+			this->renderShadowMapGeometry(shaderID, tile->matrix);
+			ShadowAtlas::markRendered(tile);
+			this->frameStats_.shadowAtlasRendered++;
+		}
+
+		// Вернуть состояние в исходное
+		glDisable(GL_SCISSOR_TEST);
+		glDisable(GL_POLYGON_OFFSET_FILL);
+		glPolygonOffset(0.0f, 0.0f);
+		glEnable(GL_CULL_FACE);
+		glDisable(GL_DEPTH_TEST);
+
+		// Прекращаем работу с фрейм-буфером
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		OGL_STATS_ADD(frameBufferBinds, 1);
 	}
 
 	/**
 	* \brief Проход рендеринга освещенности (один источником света)
 	* \details Данный метод вызывается многократно (для нескольких источников), результаты буфера суммируются
 	* \param light Источник света
-	* \param shaderID Шейдер для рендеринга освещения
+	* \param shader Шейдер для рендеринга освещения (вариант выбирается по типу источника)
 	* \param cameraPosition Положение камеры
 	* \param clearColor Цвет очистки
 	* \param clearMask Маска очистки
 	* \param clear Очистить
+	* \param shadowMapped Тени источника берутся из карт теней (иначе - из stencil-буфера)
 	*/
-	void Renderer::renderPassLighting(LightPtr light, GLuint shaderID, const glm::vec3& cameraPosition, glm::vec4 clearColor, GLbitfield clearMask, bool clear) const
+	void Renderer::renderPassLighting(LightPtr light, const ShaderResourcePtr& shader, const glm::vec3& cameraPosition, glm::vec4 clearColor, GLbitfield clearMask, bool clear, bool shadowMapped) const
 	{
-		// Установка размеров области вида
-		glViewport(0, 0, this->viewPort.width, this->viewPort.height);
+		OGL_STATS_PASS(RENDER_STATS_LIGHTING);
 
-		// Активировать фрейм-буфер (рендеринг во фрейм-буфер)
-		glBindFramebuffer(GL_FRAMEBUFFER, this->frameBuffer_.frameBufferId);
+		// Вариант шейдера для типа источника (без ветвления по типу в шейдере)
+		GLuint mask = 0;
+		switch (light->getType())
+		{
+		case LightType::POINT_LIGHT: mask = 0x01; break;
+		case LightType::DIRECTIONAL_LIGHT: mask = 0x02; break;
+		case LightType::SPOT_LIGHT: mask = 0x04; break;
+		}
+		if (this->gBuffer_.layout == GBufferLayout::GBUFFER_COMPACT) mask |= LightingDefineCompact;
+		GLuint shaderID = shader->getVariantId(mask, LightingShaderDefines);
 
-		// Включить тест трафарета
+		// Установка размеров области вида
+		glViewport(0, 0, this->renderSize_.width, this->renderSize_.height);
+
+		// Освещаются только пиксели, покрытые геометрией (бит геометрии установлен)
+		// Если тени берутся из теневых объемов - счетчик теней также должен быть равен нулю
+		// Если из карт теней - счетчик не учитывается (в нем остаются значения от других источников)
 		glEnable(GL_STENCIL_TEST);
-		// Тест трафарета считается пройденым если значение в нем равно нулю
-		glStencilFunc(GL_EQUAL, 0x0, 0xFF);
-		// Не обновлять тест трафарета
-		//glStencilOpSeparate(GL_BACK, GL_KEEP, GL_KEEP, GL_KEEP);
+		if (shadowMapped) {
+			glStencilFunc(GL_EQUAL, STENCIL_GEOMETRY_BIT, STENCIL_GEOMETRY_BIT);
+		}
+		else {
+			glStencilFunc(GL_EQUAL, STENCIL_GEOMETRY_BIT, 0xFF);
+		}
+		// Не обновлять значения трафарета
+		glStencilOp(GL_KEEP, GL_KEEP, GL_KEEP);
 
 		// Включть аддтимвное смешивание (предыдущй цвет складывается с текущим)
 		glEnable(GL_BLEND);
@@ -391,6 +1135,7 @@ namespace ogl
 
 		// Использовать шейдер
 		glUseProgram(shaderID);
+		OGL_STATS_ADD(programBinds, 1);
 
 		// Передать положение камеры (для бликов/отражений)
 		glUniform3fv(glGetUniformLocation(shaderID, "cameraPosition"), 1, glm::value_ptr(this->cameraPosition));
@@ -400,24 +1145,92 @@ namespace ogl
 
 		// Привязать VAO (геометрия квадрата)
 		glBindVertexArray(this->defaultGeometry_.quad->getVaoId());
+		OGL_STATS_ADD(vaoBinds, 1);
 
 		// Передать значения цвета-бликовости фрагментов в шейдер
 		glActiveTexture(GL_TEXTURE0);
 		glBindTexture(GL_TEXTURE_2D, this->gBuffer_.gAlbedoSpecAttachmentId);
 		glUniform1i(glGetUniformLocation(shaderID, "albedoSpecularTexture"), 0);
 
-		// Передать значения положений фрагментов в шейдер
+		// Передать значения положений фрагментов в шейдер (в компактном формате - глубину, записанную проходом геометрии)
 		glActiveTexture(GL_TEXTURE1);
 		glBindTexture(GL_TEXTURE_2D, this->gBuffer_.gPositionAttachmentId);
 		glUniform1i(glGetUniformLocation(shaderID, "positionTexture"), 1);
 
-		// Передать значения нормалей фрагментов в шейдер
-		glActiveTexture(GL_TEXTURE2);
-		glBindTexture(GL_TEXTURE_2D, this->gBuffer_.gNormalAttachmentId);
-		glUniform1i(glGetUniformLocation(shaderID, "normalTexture"), 2);
+		// Передать значения нормалей фрагментов в шейдер
+		glActiveTexture(GL_TEXTURE2);
+		glBindTexture(GL_TEXTURE_2D, this->gBuffer_.gNormalAttachmentId);
+		glUniform1i(glGetUniformLocation(shaderID, "normalTexture"), 2);
+
+		// Передать обратную матрицу вида-проекции (для восстановления положения в компактном формате)
+		// Вложение глубины-трафарета не читается - оно привязано к кадровому буферу прохода (тест трафарета)
+		glm::mat4 inverseViewProjection = glm::inverse(this->projectionMatrix_ * this->viewMatrix_);
+		glUniformMatrix4fv(glGetUniformLocation(shaderID, "inverseViewProjection"), 1, GL_FALSE, glm::value_ptr(inverseViewProjection));
+
+		// Доля текстур G-буфера, занятая кадром (при пониженном разрешении рендеринга)
+		glUniform2f(glGetUniformLocation(shaderID, "renderScale"),
+			static_cast<GLfloat>(this->renderSize_.width) / static_cast<GLfloat>(this->gBuffer_.sizes.width),
+			static_cast<GLfloat>(this->renderSize_.height) / static_cast<GLfloat>(this->gBuffer_.sizes.height));
+
+		// Передать в шейдер тип источника освещения
+		glUniform1ui(glGetUniformLocation(shaderID, "light.type"), static_cast<GLuint>(light->getType()));
+
+		// Карты теней (привязываются всегда, т.к. семплеры разных типов не могут использовать один текстурный блок)
+		glActiveTexture(GL_TEXTURE3);
+		glBindTexture(GL_TEXTURE_2D, this->shadowMaps_.spotMapId);
+		glUniform1i(glGetUniformLocation(shaderID, "spotShadowMap"), 3);
+
+		glActiveTexture(GL_TEXTURE4);
+		glBindTexture(GL_TEXTURE_2D_ARRAY, this->shadowMaps_.cascadeMapId);
+		glUniform1i(glGetUniformLocation(shaderID, "cascadeShadowMap"), 4);
+
+		// Атлас карт теней (если атласа нет - привязывается карта прожектора, чтобы блок не оставался пустым)
+		glActiveTexture(GL_TEXTURE5);
+		glBindTexture(GL_TEXTURE_2D, this->shadowAtlas_ != nullptr ? this->shadowAtlas_->getTextureId() : this->shadowMaps_.spotMapId);
+		glUniform1i(glGetUniformLocation(shaderID, "atlasShadowMap"), 5);
+
+		// Ячейки источника в атласе (если используется атлас)
+		const std::vector<ShadowAtlasTile>* atlasTiles = nullptr;
+		if (shadowMapped && this->shadowTechnique == ShadowTechnique::SHADOW_ATLAS && light->getType() != LightType::DIRECTIONAL_LIGHT && this->shadowAtlas_ != nullptr) {
+			atlasTiles = this->shadowAtlas_->getTiles(light.get());
+		}
+
+		// Способ затенения (0 - карты не используются, 1 - карта прожектора, 2 - каскады направленного источника, 3 - атлас)
+		GLuint shadowMode = 0;
+		if (shadowMapped) {
+			if (light->getType() == LightType::DIRECTIONAL_LIGHT) shadowMode = 2;
+			else if (this->shadowTechnique == ShadowTechnique::SHADOW_ATLAS) shadowMode = atlasTiles != nullptr ? 3 : 0;
+			else shadowMode = 1;
+		}
+		glUniform1ui(glGetUniformLocation(shaderID, "shadowMode"), shadowMode);
+
+		// Параметры ячеек атласа (ячейки без содержимого передаются с нулевым размером - они не затеняют)
+		if (atlasTiles != nullptr)
+		{
+			glm::mat4 matrices[6];
+			glm::vec4 rects[6];
+			GLsizei count = static_cast<GLsizei>(glm::min<size_t>(atlasTiles->size(), 6));
+
+			for (GLsizei i = 0; i < count; i++) {
+				const ShadowAtlasTile& tile = (*atlasTiles)[i];
+				matrices[i] = tile.renderedMatrix;
+				rects[i] = tile.rendered ? tile.getRect(this->shadowAtlas_->getSize()) : glm::vec4(0.0f);
+			}
+
+			glUniformMatrix4fv(glGetUniformLocation(shaderID, "atlasMatrices"), count, GL_FALSE, glm::value_ptr(matrices[0]));
+			glUniform4fv(glGetUniformLocation(shaderID, "atlasRects"), count, glm::value_ptr(rects[0]));
+			glUniform1i(glGetUniformLocation(shaderID, "atlasTileCount"), count);
+		}
 
-		// Передать в шейдер тип источника освещения
-		glUniform1ui(glGetUniformLocation(shaderID, "light.type"), static_cast<GLuint>(light->getType()));
+		// Параметры карт теней
+		if (shadowMapped)
+		{
+			glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(this->viewMatrix_));
+			glUniformMatrix4fv(glGetUniformLocation(shaderID, "spotShadowMatrix"), 1, GL_FALSE, glm::value_ptr(this->shadowMaps_.spotMatrix));
+			glUniformMatrix4fv(glGetUniformLocation(shaderID, "cascadeMatrices"), this->shadowMaps_.cascadeCount, GL_FALSE, glm::value_ptr(this->shadowMaps_.cascadeMatrices[0]));
+			glUniform1fv(glGetUniformLocation(shaderID, "cascadeSplits"), this->shadowMaps_.cascadeCount, this->shadowMaps_.cascadeSplits);
+			glUniform1i(glGetUniformLocation(shaderID, "cascadeCount"), static_cast<GLint>(this->shadowMaps_.cascadeCount));
+		}
 
 		// Передать параметры источника освещения в шейдер (в зависимости от типа)
 		switch (light->getType())
@@ -447,8 +1260,15 @@ namespace ogl
 			break;
 		}
 
+		// Текстуры G-буфера и карт теней, параметры прохода, карт теней и источника
+		OGL_STATS_ADD(textureBinds, 7);
+		OGL_STATS_ADD(uniformUploads, 12 + (atlasTiles != nullptr ? 3 : 0) + (shadowMapped ? 5 : 0) +
+			(light->getType() == LightType::SPOT_LIGHT ? 8 : light->getType() == LightType::DIRECTIONAL_LIGHT ? 2 : 4));
+		OGL_STATS_ADD(lightsSubmitted, 1);
+
 		// Отрисовать VAO
 		glDrawElements(GL_TRIANGLES, this->defaultGeometry_.quad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+		OGL_STATS_DRAW(GL_TRIANGLES, this->defaultGeometry_.quad->getIndexCount());
 
 		// Отвязать VAO
 		glBindVertexArray(0);
@@ -466,19 +1286,14 @@ namespace ogl
 	*/
 	void Renderer::renderPassSysObjects(GLuint shaderID) const
 	{
+		OGL_STATS_PASS(RENDER_STATS_SYS_OBJECTS);
+
 		// Установка размеров области вида
-		glViewport(0, 0, this->viewPort.width, this->viewPort.height);
+		glViewport(0, 0, this->renderSize_.width, this->renderSize_.height);
 
 		// Использовать шейдер
 		glUseProgram(shaderID);
-
-		// Скопировать значения глубины из G-буфера во фрейм-буфер (чтобы объекты не рендерелись поверх всего подряд)
-		//glBindFramebuffer(GL_READ_FRAMEBUFFER, this->gBuffer_.gBufferId);
-		//glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->frameBuffer_.frameBufferId);
-		//glBlitFramebuffer(0, 0, this->viewPort.width, this->viewPort.height, 0, 0, this->viewPort.width, this->viewPort.height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
-
-		// Активировать фрейм-буфер (рендеринг во фрейм-буфер)
-		glBindFramebuffer(GL_FRAMEBUFFER, this->frameBuffer_.frameBufferId);
+		OGL_STATS_ADD(programBinds, 1);
 
 		// Включить тест глубины
 		glEnable(GL_DEPTH_TEST);
@@ -489,6 +1304,7 @@ namespace ogl
 		// Передача матриц проекции и вида в шейдер
 		glUniformMatrix4fv(glGetUniformLocation(shaderID, "view"), 1, GL_FALSE, glm::value_ptr(this->viewMatrix_));
 		glUniformMatrix4fv(glGetUniformLocation(shaderID, "projection"), 1, GL_FALSE, glm::value_ptr(this->projectionMatrix_));
+		OGL_STATS_ADD(uniformUploads, 2);
 
 		// Проход по всем источникам освещения для их отображения
 		for (auto light : this->lights_)
@@ -502,58 +1318,254 @@ namespace ogl
 
 				// Передать цвет
 				glUniform3fv(glGetUniformLocation(shaderID, "lightColor"), 1, glm::value_ptr(light->color));
+				OGL_STATS_ADD(uniformUploads, 2);
 
 				// Привязать VAO
 				glBindVertexArray(this->defaultGeometry_.cube->getVaoId());
+				OGL_STATS_ADD(vaoBinds, 1);
 				glDrawElements(GL_TRIANGLES, this->defaultGeometry_.cube->getIndexCount(), GL_UNSIGNED_INT, nullptr);
+				OGL_STATS_DRAW(GL_TRIANGLES, this->defaultGeometry_.cube->getIndexCount());
 				glBindVertexArray(0);
 			}
 		}
 	}
 
 	/**
-	* \brief Проход рендеринга для финального представления (рендеринг в основной буфер)
-	* \param shaderID шейдер для рендеринга во фрейм-буфер
-	* \param clearColor Цвет очистки
-	* \param clearMask Маска очистки
+	* \brief Получить шейдер, объединяющий последовательность попиксельных эффектов
+	* \param effects Попиксельные эффекты
+	* \details Шейдер собирается при первом запросе, затем берется из кеша
+	* \return ID шейдера
 	*/
-	void Renderer::renderPassFinal(GLuint shaderID, glm::vec4 clearColor, GLbitfield clearMask) const
+	GLuint Renderer::getFusedPostShader(const std::vector<PostEffectPtr>& effects)
 	{
-		// Установка размеров области вида
-		glViewport(0, 0, this->viewPort.width, this->viewPort.height);
+		// Ключ - код эффектов с учетом чтения глубины (параметры эффектов передаются через uniform-переменные)
+		std::string key;
+		for (const PostEffectPtr& effect : effects) {
+			key.append(std::to_string(effect->getInputs())).append(":").append(effect->getCode()).append("\n");
+		}
 
-		// Активировать основной буфер (окна, оконной системы)
-		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+		auto it = this->postShaders_.find(key);
+		if (it != this->postShaders_.end()) {
+			return it->second->getId();
+		}
 
-		// Установка параметров очистки экрана
-		glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
-		glClear(clearMask);
+		ShaderResourcePtr shader = MakeShaderResource(GetFusedPostEffectSource(effects));
+		this->postShaders_[key] = shader;
+		return shader->getId();
+	}
 
-		// Использовать шейдер
-		glUseProgram(shaderID);
+	/**
+	* \brief Полноэкранный проход пост-обработки (в буфер, привязанный графом кадра)
+	* \param shaderID Шейдер (uniform-переменные эффекта уже должны быть установлены)
+	* \param sourceTextureId Текстура исходного кадра
+	* \param toWindow Проход пишет во всю область окна (увеличение кадра), иначе - в область рендеринга
+	*/
+	void Renderer::renderPostPass(GLuint shaderID, GLuint sourceTextureId, bool toWindow) const
+	{
+		OGL_STATS_PASS(RENDER_STATS_POST);
 
-		// Отключить тест глубины
-		glDisable(GL_DEPTH_TEST);
+		// Установка размеров области вида
+		if (toWindow) glViewport(0, 0, this->viewPort.width, this->viewPort.height);
+		else glViewport(0, 0, this->renderSize_.width, this->renderSize_.height);
 
-		// Отключить тест трафарета
-		glDisable(GL_STENCIL_TEST);
+		// Исходный кадр занимает часть текстуры (размер текстур - размер окна), выборки не должны выходить за его границу
+		glm::vec2 textureSize = { static_cast<GLfloat>(this->viewPort.width), static_cast<GLfloat>(this->viewPort.height) };
+		glm::vec2 frameSize = { static_cast<GLfloat>(this->renderSize_.width), static_cast<GLfloat>(this->renderSize_.height) };
+		glUniform2fv(glGetUniformLocation(shaderID, "uvScale"), 1, glm::value_ptr(frameSize / textureSize));
+		glUniform2fv(glGetUniformLocation(shaderID, "uvMax"), 1, glm::value_ptr((frameSize - 0.5f) / textureSize));
+		OGL_STATS_ADD(uniformUploads, 2);
 
-		// Привязать VAO (геометрия квадрата)
-		glBindVertexArray(this->defaultGeometry_.quad->getVaoId());
+		// Квадрат на весь экран рисуется без тестов глубины и трафарета
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_STENCIL_TEST);
 
-		// Нацепить текстуру фреймбуфера на квадрат
+		// Нацепить текстуру исходного кадра на квадрат
 		glActiveTexture(GL_TEXTURE0);
-		glBindTexture(GL_TEXTURE_2D, this->frameBuffer_.colorAttachmentId);
+		glBindTexture(GL_TEXTURE_2D, sourceTextureId);
+		OGL_STATS_ADD(textureBinds, 1);
 		glUniform1i(glGetUniformLocation(shaderID, "screenTexture"), 0);
+		OGL_STATS_ADD(uniformUploads, 1);
 
-		// Отрисовать VAO
+		// Отрисовать VAO (геометрия квадрата)
+		glBindVertexArray(this->defaultGeometry_.quad->getVaoId());
+		OGL_STATS_ADD(vaoBinds, 1);
 		glDrawElements(GL_TRIANGLES, this->defaultGeometry_.quad->getIndexCount(), GL_UNSIGNED_INT, nullptr);
-
-		// Отвязать VAO
+		OGL_STATS_DRAW(GL_TRIANGLES, this->defaultGeometry_.quad->getIndexCount());
 		glBindVertexArray(0);
+	}
+
+	/**
+	* \brief Проход панели производительности (поверх представленного кадра в основном буфере)
+	*/
+	void Renderer::renderPassHud()
+	{
+		OGL_STATS_PASS(RENDER_STATS_OTHER);
+
+		// Панель рисуется в пикселях окна без тестов, полупрозрачная подложка смешивается с кадром
+		glViewport(0, 0, this->viewPort.width, this->viewPort.height);
+		glDisable(GL_DEPTH_TEST);
+		glDisable(GL_STENCIL_TEST);
+		glEnable(GL_BLEND);
+		glBlendEquation(GL_FUNC_ADD);
+		glBlendFunc(GL_SRC_ALPHA, GL_ONE_MINUS_SRC_ALPHA);
+
+		this->hud_->draw(this->viewPort.width, this->viewPort.height);
+
+		glDisable(GL_BLEND);
+	}
+
+	/**
+	* \brief Добавить в граф кадра проходы пост-обработки (финальное представление в основном буфере)
+	* \param frameColor Ресурс освещенного кадра
+	* \param depth Ресурс глубины-трафарета (читается эффектами, которым нужна глубина)
+	* \param backBuffer Ресурс основного буфера
+	* \param shaderID шейдер для копирования кадра в основной буфер (если цепочка эффектов пуста или ничего не меняет)
+	* \details Соседние попиксельные эффекты цепочки выполняются одним шейдером, разделимые - двумя одномерными
+	* проходами. Эффекты, не меняющие кадр, пропускаются. Последний проход пишет сразу в основной буфер, промежуточные
+	* результаты - временные текстуры графа
+	*/
+	void Renderer::addPostProcessingPasses(RenderGraphResource frameColor, RenderGraphResource depth, RenderGraphResource backBuffer, GLuint shaderID)
+	{
+		// Разбить цепочку на проходы (соседние попиксельные эффекты объединяются, эффекты без изменений пропускаются)
+		struct PostPass {
+			std::vector<PostEffectPtr> effects;
+			bool separable;
+		};
+
+		std::vector<PostPass> passes;
+		GLuint passCount = 0;
+
+		for (const PostEffectPtr& effect : this->postEffects_)
+		{
+			if (effect == nullptr || effect->isIdentity()) continue;
+
+			bool separable = effect->getKind() == PostEffectKind::POST_EFFECT_SEPARABLE;
+			if (!separable && !passes.empty() && !passes.back().separable) {
+				passes.back().effects.push_back(effect);
+				continue;
+			}
+
+			passes.push_back({ { effect }, separable });
+			passCount += separable ? 2 : 1;
+		}
+
+		// При пониженном разрешении последний проход увеличивает кадр до размеров окна
+		bool upscale = this->renderSize_.width != this->viewPort.width || this->renderSize_.height != this->viewPort.height;
+
+		// Цепочка пуста или ничего не меняет - одна выборка на пиксель сразу в основной буфер
+		if (passCount == 0 && !upscale) {
+			this->renderGraph_.addPass({ "post-copy", { frameColor }, { backBuffer }, {}, false, false, false }, [this, frameColor, shaderID]() {
+				glUseProgram(shaderID);
+				OGL_STATS_ADD(programBinds, 1);
+				this->renderPostPass(shaderID, this->renderGraph_.getTextureId(frameColor));
+			});
+			this->frameStats_.postPasses = 1;
+			return;
+		}
+
+		// Описание промежуточных текстур (формат и фильтрация как у освещенного кадра - линейная фильтрация нужна разделимым ядрам)
+		RenderGraphTextureDesc targetDesc = { this->viewPort.width, this->viewPort.height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR };
+
+		// Исходный кадр очередного прохода
+		RenderGraphResource source = frameColor;
+		GLuint passesLeft = upscale ? passCount + 1 : passCount;
+
+		// Добавить проход: последний пишет в основной буфер, остальные - в новые временные текстуры
+		// (граф размещает их в памяти текстур, время жизни которых уже закончилось)
+		auto addPass = [&](const std::string& name, bool readsDepth, const std::function<void(GLuint)>& setup, GLuint passShaderID)
+		{
+			passesLeft--;
+			RenderGraphResource target = passesLeft == 0 ? backBuffer : this->renderGraph_.createTexture(name, targetDesc);
+
+			std::vector<RenderGraphResource> reads = { source };
+			if (readsDepth) reads.push_back(depth);
+
+			this->renderGraph_.addPass({ name, reads, { target }, { target }, false, false, false }, [this, source, setup, passShaderID]() {
+				glUseProgram(passShaderID);
+				OGL_STATS_ADD(programBinds, 1);
+				setup(passShaderID);
+				this->renderPostPass(passShaderID, this->renderGraph_.getTextureId(source));
+			});
+
+			source = target;
+		};
+
+		GLuint separableShaderID = this->shaders_.shaderSeparableKernel_->getId();
+		glm::vec2 texelSize = { 1.0f / static_cast<GLfloat>(this->viewPort.width), 1.0f / static_cast<GLfloat>(this->viewPort.height) };
+
+		for (size_t p = 0; p < passes.size(); p++)
+		{
+			const PostPass& pass = passes[p];
+			std::string name = "post-" + std::to_string(p);
+
+			if (pass.separable)
+			{
+				// Смещения и веса выборок (соседние веса объединены за счет линейной фильтрации)
+				std::vector<GLfloat> offsets, weights;
+				pass.effects[0]->getLinearTaps(&offsets, &weights);
+
+				auto kernel = [offsets, weights](GLuint id, glm::vec2 texelStep) {
+					glUniform1fv(glGetUniformLocation(id, "tapOffsets"), static_cast<GLsizei>(offsets.size()), offsets.data());
+					glUniform1fv(glGetUniformLocation(id, "tapWeights"), static_cast<GLsizei>(weights.size()), weights.data());
+					glUniform1i(glGetUniformLocation(id, "tapCount"), static_cast<GLint>(weights.size()));
+					glUniform2f(glGetUniformLocation(id, "texelStep"), texelStep.x, texelStep.y);
+					OGL_STATS_ADD(uniformUploads, 4);
+				};
+
+				// Горизонтальный, затем вертикальный проход
+				addPass(name + "-h", false, [kernel, texelSize](GLuint id) { kernel(id, { texelSize.x, 0.0f }); }, separableShaderID);
+				addPass(name + "-v", false, [kernel, texelSize](GLuint id) { kernel(id, { 0.0f, texelSize.y }); }, separableShaderID);
+			}
+			else
+			{
+				GLuint fusedShaderID = this->getFusedPostShader(pass.effects);
+				std::vector<PostEffectPtr> effects = pass.effects;
+
+				bool readsDepth = false;
+				for (const PostEffectPtr& effect : effects) {
+					if (effect->getInputs() & PostEffectResource::POST_RESOURCE_DEPTH) readsDepth = true;
+				}
+
+				addPass(name, readsDepth, [this, effects, depth, readsDepth](GLuint id) {
+					for (size_t i = 0; i < effects.size(); i++) {
+						std::string index = "[" + std::to_string(i) + "]";
+						glUniform4fv(glGetUniformLocation(id, ("effectParams" + index).c_str()), 1, glm::value_ptr(effects[i]->params));
+						glUniform1f(glGetUniformLocation(id, ("effectStrength" + index).c_str()), std::min(effects[i]->strength, 1.0f));
+						OGL_STATS_ADD(uniformUploads, 2);
+					}
+
+					// Глубина G-буфера (для эффектов, которые ее читают)
+					if (readsDepth) {
+						glActiveTexture(GL_TEXTURE1);
+						glBindTexture(GL_TEXTURE_2D, this->renderGraph_.getTextureId(depth));
+						OGL_STATS_ADD(textureBinds, 1);
+						glUniform1i(glGetUniformLocation(id, "depthTexture"), 1);
+						OGL_STATS_ADD(uniformUploads, 1);
+					}
+				}, fusedShaderID);
+			}
+		}
+
+		// Увеличение кадра до размеров окна (в основной буфер)
+		if (upscale)
+		{
+			RenderGraphResource upscaleSource = source;
+			GLuint upscaleShaderID = this->shaders_.shaderUpscale_->getVariantId(
+				this->dynamicResolution.filter == UpscaleFilter::UPSCALE_EDGE_AWARE ? std::vector<std::string>{ "EDGE_AWARE" } : std::vector<std::string>{});
+			glm::vec2 texelSize = { 1.0f / static_cast<GLfloat>(this->viewPort.width), 1.0f / static_cast<GLfloat>(this->viewPort.height) };
+			GLfloat sharpness = glm::clamp(this->dynamicResolution.sharpness, 0.0f, 1.0f);
+
+			this->renderGraph_.addPass({ "upscale", { upscaleSource }, { backBuffer }, {}, false, false, false }, [this, upscaleSource, upscaleShaderID, texelSize, sharpness]() {
+				glUseProgram(upscaleShaderID);
+				OGL_STATS_ADD(programBinds, 1);
+				glUniform2fv(glGetUniformLocation(upscaleShaderID, "texelSize"), 1, glm::value_ptr(texelSize));
+				glUniform1f(glGetUniformLocation(upscaleShaderID, "sharpness"), sharpness);
+				OGL_STATS_ADD(uniformUploads, 2);
+				this->renderPostPass(upscaleShaderID, this->renderGraph_.getTextureId(upscaleSource), true);
+			});
+		}
 
-		// Смена буферов окна
-		SwapBuffers(GetDC(this->hwnd_));
+		this->frameStats_.postPasses = upscale ? passCount + 1 : passCount;
 	}
 
 	/**
@@ -568,21 +1580,32 @@ namespace ogl
 		glUniform2fv(glGetUniformLocation(shaderId, std::string(uniformName + ".origin").c_str()), 1, glm::value_ptr(mapping.origin));
 		glUniform2fv(glGetUniformLocation(shaderId, std::string(uniformName + ".scale").c_str()), 1, glm::value_ptr(mapping.scale));
 		glUniformMatrix2fv(glGetUniformLocation(shaderId, std::string(uniformName + ".rotation").c_str()), 1, GL_FALSE, glm::value_ptr(mapping.rotation));
+		OGL_STATS_ADD(uniformUploads, 4);
 	}
 
 	/**
 	* \brief Конструктор
-	* \param hwnd Хендл WinAPI окна
+	* \param context Контекст OpenGL (в его основной буфер выводится кадр)
 	* \param geometry Шейдер для рендеринга геометрии
 	* \param lightning Шейдер для подсчета освещенности
 	* \param postProcessing Шейдер для пост-обработки
 	* \param shadows Шейдер для построения теневых объемов
 	*/
-	Renderer::Renderer(HWND hwnd, ShaderResourcePtr geometry, ShaderResourcePtr lightning, ShaderResourcePtr postProcessing, ShaderResourcePtr shadows) :
-		hwnd_(hwnd),
+	Renderer::Renderer(ContextPtr context, ShaderResourcePtr geometry, ShaderResourcePtr lightning, ShaderResourcePtr postProcessing, ShaderResourcePtr shadows) :
+		context_(context),
 		viewMatrix_(glm::mat4(1)),
 		projectionMatrix_(glm::mat4(1)),
-		cameraPosition(glm::vec3(0.0f, 0.0f, 0.0f))
+		frameStats_({}),
+		renderStats_({}),
+		renderStatsHistory_(RENDER_STATS_DEFAULT_FRAMES),
+		cameraPosition(glm::vec3(0.0f, 0.0f, 0.0f)),
+		shadowVolumeMode(ShadowVolumeMode::GEOMETRY_SHADER),
+		shadowTechnique(ShadowTechnique::STENCIL_VOLUMES),
+		depthPrePassMode(DepthPrePassMode::DEPTH_PREPASS_OFF),
+		depthPrePassThreshold(1.5f),
+		showOverdraw(false),
+		passProfiling(false),
+		showHud(false)
 	{
 		// Инициализация GLEW
 		if (!_isGlewInitialised) {
@@ -594,24 +1617,50 @@ namespace ogl
 			throw std::runtime_error("OpenGL:Renderer: Glew is not initialised");
 		}
 
+		if (context == nullptr) {
+			throw std::runtime_error("OpenGL:Renderer: Context is not initialized");
+		}
+
 		if (geometry == nullptr || lightning == nullptr || postProcessing == nullptr) {
 			throw std::runtime_error("OpenGL:Renderer: Not all shaders initialized");
 		}
 
 		// v i e w - p o r t
 
-		// Получение размеров области вида
-		RECT clientRect;
-		GetClientRect(this->hwnd_, &clientRect);
-		this->viewPort.width = static_cast<GLuint>(clientRect.right);
-		this->viewPort.height = static_cast<GLuint>(clientRect.bottom);
+		// Получение размеров области вида (размеры основного буфера контекста)
+		this->viewPort.width = this->context_->getWidth();
+		this->viewPort.height = this->context_->getHeight();
 
 		// Установка размеров области вида
 		glViewport(0, 0, this->viewPort.width, this->viewPort.height);
 
-		// Инициализация G-буфера и фрейм-буфера
-		this->initGBuffer(this->viewPort.width, this->viewPort.height);
-		this->initFrameBuffer(this->viewPort.width, this->viewPort.height);
+		// Вложения G-буфера и кадровые буферы размещаются графом кадра при рисовании
+		this->gBuffer_ = {};
+		this->gBuffer_.layout = GBufferLayout::GBUFFER_STANDARD;
+
+		// д и н а м и ч е с к о е  р а з р е ш е н и е
+
+		// Целевое время - с запасом относительно 60 кадров в секунду (работа CPU, композиция окон)
+		this->dynamicResolution.enabled = false;
+		this->dynamicResolution.targetFrameTime = 14.0f;
+		this->dynamicResolution.minScale = 0.5f;
+		this->dynamicResolution.maxScale = 1.0f;
+		this->dynamicResolution.filter = UpscaleFilter::UPSCALE_EDGE_AWARE;
+		this->dynamicResolution.sharpness = 0.5f;
+		this->renderSize_ = { 1.0f, this->viewPort.width, this->viewPort.height };
+		this->renderScaleOverride_ = 0.0f;
+
+		// к а р т ы  т е н е й
+
+		this->shadowMaps_ = {};
+		this->initShadowMaps();
+		this->shadowCascades.cascadeCount = SHADOW_MAP_CASCADES;
+		this->shadowCascades.splitLambda = 0.75f;
+		this->shadowCascades.maxDistance = 100.0f;
+		this->shadowAtlasSettings.size = 4096;
+		this->shadowAtlasSettings.minTileSize = 128;
+		this->shadowAtlasSettings.maxTileSize = 1024;
+		this->shadowAtlasSettings.tilesPerFrame = 8;
 
 		// с г л а ж и в а н и е
 
@@ -674,6 +1723,24 @@ namespace ogl
 		this->shaders_.shaderPostProcessing_ = postProcessing;
 		this->shaders_.shaderSolidColor_ = MakeShaderResource(defaults::GetShaderSource(defaults::DefaultShaderType::SOLID_COLORED));
 		this->shaders_.shaderShadowVolumes_ = shadows;
+		this->shaders_.shaderShadowVolumesCached_ = MakeShaderResource(defaults::GetShaderSource(defaults::DefaultShaderType::SHADOW_VOLUME));
+		this->shaders_.shaderShadowMap_ = MakeShaderResource(defaults::GetShaderSource(defaults::DefaultShaderType::LIGHT_SHADOW_MAP));
+		this->shaders_.shaderDepthOnly_ = MakeShaderResource(defaults::GetShaderSource(defaults::DefaultShaderType::DEPTH_ONLY));
+		this->shaders_.shaderSeparableKernel_ = MakeShaderResource(defaults::GetShaderSource(defaults::DefaultShaderType::SEPARABLE_KERNEL));
+		this->shaders_.shaderUpscale_ = MakeShaderResource(defaults::GetShaderSource(defaults::DefaultShaderType::UPSCALE));
+
+		// и з м е р е н и е  п е р е к р ы т и я
+
+		this->overdraw_ = {};
+		this->overdraw_.value = 1.0f;
+		glGenQueries(1, &(this->overdraw_.shadedQueryId));
+		glGenQueries(1, &(this->overdraw_.coveredQueryId));
+
+		// и з м е р е н и е  в р е м е н и  к а д р а
+
+		this->gpuTiming_.frameTime = 0.0f;
+		for (GLfloat& scale : this->gpuTiming_.frameScales) scale = 1.0f;
+		this->profilerEnabled_ = false;
 	}
 
 	/**
@@ -681,9 +1748,14 @@ namespace ogl
 	*/
 	Renderer::~Renderer()
 	{
-		// Уничтожение G-буфера и фрейм-буфера
-		this->freeGBuffer();
-		this->freeFrameBuffer();
+		// Текстуры и кадровые буферы графа кадра удаляются вместе с графом
+		this->freeShadowMaps();
+
+		glDeleteQueries(1, &(this->overdraw_.shadedQueryId));
+		glDeleteQueries(1, &(this->overdraw_.coveredQueryId));
+
+		// Запросы профилировщика созданы в контексте рендерера
+		if (this->profilerEnabled_) Profiler::get().setEnabled(false);
 	}
 
 	/**
@@ -693,6 +1765,7 @@ namespace ogl
 	void Renderer::setViewMatrix(const glm::mat4& matrix)
 	{
 		this->viewMatrix_ = matrix;
+		if (this->recorder_) this->recorder_->onViewMatrix(matrix);
 	}
 
 	/**
@@ -702,6 +1775,7 @@ namespace ogl
 	void Renderer::setProjectionMatrix(const glm::mat4& matrix)
 	{
 		this->projectionMatrix_ = matrix;
+		if (this->recorder_) this->recorder_->onProjectionMatrix(matrix);
 	}
 
 	/**
@@ -712,6 +1786,7 @@ namespace ogl
 	StaticMeshPtr Renderer::addStaticMesh(const StaticMesh& mesh)
 	{
 		this->staticMeshes_.push_back(std::make_shared<StaticMesh>(mesh));
+		if (this->recorder_) this->recorder_->onAddStaticMesh(this->staticMeshes_.back());
 		return this->staticMeshes_[this->staticMeshes_.size() - 1];
 	}
 
@@ -721,6 +1796,8 @@ namespace ogl
 	*/
 	void Renderer::removeStaticMesh(StaticMeshPtr& meshPtr)
 	{
+		if (this->recorder_ && meshPtr) this->recorder_->onRemoveStaticMesh(meshPtr);
+
 		// Переместить в конец списка элемент с указанным адресом и получить итератор
 		auto newEnd = std::remove_if(this->staticMeshes_.begin(), this->staticMeshes_.end(), [&meshPtr](const StaticMeshPtr& entry)
 		{
@@ -730,6 +1807,11 @@ namespace ogl
 		// Удалить объект из массива
 		this->staticMeshes_.erase(newEnd, staticMeshes_.end());
 
+		// Удалить теневые объемы меша из кеша
+		for (auto it = this->shadowVolumeCache_.begin(); it != this->shadowVolumeCache_.end();) {
+			it = it->first.second == meshPtr.get() ? this->shadowVolumeCache_.erase(it) : std::next(it);
+		}
+
 		// Обнулить указатель
 		meshPtr = nullptr;
 	}
@@ -742,6 +1824,7 @@ namespace ogl
 	LightPtr Renderer::addLight(const Light& light)
 	{
 		this->lights_.push_back(std::make_shared<Light>(light));
+		if (this->recorder_) this->recorder_->onAddLight(this->lights_.back());
 		return this->lights_[this->lights_.size() - 1];
 	}
 
@@ -751,6 +1834,8 @@ namespace ogl
 	*/
 	void Renderer::removeLight(LightPtr& lightPtr)
 	{
+		if (this->recorder_ && lightPtr) this->recorder_->onRemoveLight(lightPtr);
+
 		// Переместить в конец списка элемент с указанным адресом и получить итератор
 		auto newEnd = std::remove_if(this->lights_.begin(), this->lights_.end(), [&lightPtr](const LightPtr& entry)
 		{
@@ -760,6 +1845,11 @@ namespace ogl
 		// Удалить объект из массива
 		this->lights_.erase(newEnd, lights_.end());
 
+		// Удалить теневые объемы источника из кеша
+		for (auto it = this->shadowVolumeCache_.begin(); it != this->shadowVolumeCache_.end();) {
+			it = it->first.first == lightPtr.get() ? this->shadowVolumeCache_.erase(it) : std::next(it);
+		}
+
 		// Обнулить указатель
 		lightPtr = nullptr;
 	}
@@ -782,6 +1872,224 @@ namespace ogl
 		return this->lights_;
 	}
 
+	/**
+	* \brief Добавить эффект в конец цепочки пост-обработки
+	* \param effect Эффект
+	* \return Указатель на эффект
+	*/
+	PostEffectPtr Renderer::addPostEffect(const PostEffectPtr& effect)
+	{
+		this->postEffects_.push_back(effect);
+		return effect;
+	}
+
+	/**
+	* \brief Удалить эффект из цепочки пост-обработки
+	* \param effect Указатель на эффект
+	*/
+	void Renderer::removePostEffect(PostEffectPtr& effect)
+	{
+		// Переместить в конец списка элемент с указанным адресом и получить итератор
+		auto newEnd = std::remove_if(this->postEffects_.begin(), this->postEffects_.end(), [&effect](const PostEffectPtr& entry)
+		{
+			return effect.get() == entry.get();
+		});
+
+		// Удалить объект из массива
+		this->postEffects_.erase(newEnd, this->postEffects_.end());
+
+		// Обнулить указатель
+		effect = nullptr;
+	}
+
+	/**
+	* \brief Получить цепочку эффектов пост-обработки
+	* \return Ссылка на массив указателей (порядок - порядок применения)
+	*/
+	std::vector<PostEffectPtr>& Renderer::getPostEffects()
+	{
+		return this->postEffects_;
+	}
+
+	/**
+	* \brief Получить статистику последнего отрисованного кадра
+	* \return Константная ссылка на структуру статистики
+	*/
+	const FrameStats& Renderer::getFrameStats() const
+	{
+		return this->frameStats_;
+	}
+
+	/**
+	* \brief Установить формат G-буфера
+	* \param layout Формат буфера
+	* \details Вложения нового формата размещаются графом кадра при рисовании следующего кадра
+	*/
+	void Renderer::setGBufferLayout(GBufferLayout layout)
+	{
+		this->gBuffer_.layout = layout;
+	}
+
+	/**
+	* \brief Получить формат G-буфера
+	* \return Формат буфера
+	*/
+	GBufferLayout Renderer::getGBufferLayout() const
+	{
+		return this->gBuffer_.layout;
+	}
+
+	/**
+	* \brief Оценка объема видеопамяти, занимаемого G-буфером (включая глубину-трафарет)
+	* \param layout Формат буфера
+	* \param width Ширина буфера
+	* \param height Высота буфера
+	* \return Кол-во байт
+	* \details Форматы RGB16F драйверы, как правило, хранят с выравниванием до RGBA16F (8 байт на пиксель)
+	*/
+	size_t Renderer::estimateGBufferMemory(GBufferLayout layout, GLuint width, GLuint height)
+	{
+		size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+
+		// Глубина-трафарет (4) + цвет и бликовость (4)
+		size_t bytesPerPixel = 4 + 4;
+
+		if (layout == GBufferLayout::GBUFFER_COMPACT) {
+			// Глубина R32F (4) + нормаль RG16 (4)
+			bytesPerPixel += 4 + 4;
+		}
+		else {
+			// Положение RGB16F (8) + нормаль RGB16F (8)
+			bytesPerPixel += 8 + 8;
+		}
+
+		return pixels * bytesPerPixel;
+	}
+
+	/**
+	* \brief Отчет о памяти и чтении на источник для обоих форматов G-буфера
+	* \param width Ширина буфера
+	* \param height Высота буфера
+	* \return Строка отчета
+	*/
+	std::string Renderer::getGBufferMemoryReport(GLuint width, GLuint height)
+	{
+		size_t pixels = static_cast<size_t>(width) * static_cast<size_t>(height);
+		size_t standard = estimateGBufferMemory(GBufferLayout::GBUFFER_STANDARD, width, height);
+		size_t compact = estimateGBufferMemory(GBufferLayout::GBUFFER_COMPACT, width, height);
+
+		// Чтение на источник в проходе освещения (в компактном формате глубина читается из текстуры R32F)
+		size_t standardRead = pixels * (8 + 8 + 4);
+		size_t compactRead = pixels * (4 + 4 + 4);
+
+		auto mb = [](size_t bytes) { return std::to_string(bytes / (1024 * 1024)) + " MB"; };
+
+		std::string report;
+		report += "G-buffer " + std::to_string(width) + "x" + std::to_string(height) + "\n";
+		report += "  standard: " + mb(standard) + " (" + mb(standardRead) + " read per light)\n";
+		report += "  compact:  " + mb(compact) + " (" + mb(compactRead) + " read per light)\n";
+		report += "  saved:    " + mb(standard - compact) + "\n";
+		return report;
+	}
+
+	/**
+	* \brief Отчет графа последнего кадра (проходы, время жизни текстур, память до и после совмещения)
+	* \return Строка отчета
+	*/
+	std::string Renderer::getRenderGraphReport() const
+	{
+		return this->renderGraph_.getReport();
+	}
+
+	/**
+	* \brief Время выполнения проходов графа кадра (при включенном профилировщике)
+	* \return Замер кадра, выполненного PROFILER_GPU_FRAMES кадров назад
+	*/
+	const std::vector<RenderGraphPassTiming>& Renderer::getPassTimings() const
+	{
+		return this->gpuTiming_.passes;
+	}
+
+	/**
+	* \brief Счетчики последнего кадра (вызовы рисования, привязки, передачи uniform-переменных, загрузки)
+	* \return Ссылка на счетчики (нулевые при сборке с OGL_NO_RENDER_STATS)
+	*/
+	const RenderStats& Renderer::getRenderStats() const
+	{
+		return this->renderStats_;
+	}
+
+	/**
+	* \brief Средние значения счетчиков за последние кадры
+	* \return Счетчики
+	*/
+	RenderStats Renderer::getRenderStatsAverage() const
+	{
+		return this->renderStatsHistory_.getAverage();
+	}
+
+	/**
+	* \brief Максимальные значения счетчиков за последние кадры
+	* \return Счетчики
+	*/
+	RenderStats Renderer::getRenderStatsMaximum() const
+	{
+		return this->renderStatsHistory_.getMaximum();
+	}
+
+	/**
+	* \brief Задать кол-во кадров для усреднения счетчиков (накопленные значения сбрасываются)
+	* \param frames Кол-во кадров
+	*/
+	void Renderer::setRenderStatsFrames(GLuint frames)
+	{
+		this->renderStatsHistory_.setCapacity(frames);
+	}
+
+	/**
+	* \brief Начать или завершить запись сеанса
+	* \param recorder Запись (в нее сразу попадают текущие меши, источники и матрицы камеры), nullptr - завершить запись
+	* \details Трасса дописывается и закрывается при уничтожении последнего указателя на запись
+	*/
+	void Renderer::setRecorder(const FrameRecorderPtr& recorder)
+	{
+		this->recorder_ = recorder;
+
+		if (this->recorder_) {
+			this->recorder_->beginSession(*this);
+			this->recorder_->onViewMatrix(this->viewMatrix_);
+			this->recorder_->onProjectionMatrix(this->projectionMatrix_);
+		}
+	}
+
+	/**
+	* \brief Получить текущую запись сеанса
+	* \return Указатель на запись (пустой, если запись не ведется)
+	*/
+	FrameRecorderPtr Renderer::getRecorder() const
+	{
+		return this->recorder_;
+	}
+
+	/**
+	* \brief Задать масштаб разрешения рендеринга вместо подбираемого по времени кадра
+	* \param scale Масштаб относительно размеров окна (0 - вернуть подбор)
+	* \details Используется воспроизведением трассы - кадры рисуются в том же разрешении, что и при записи
+	*/
+	void Renderer::setRenderScaleOverride(GLfloat scale)
+	{
+		this->renderScaleOverride_ = scale;
+	}
+
+	/**
+	* \brief Получить масштаб разрешения рендеринга текущего кадра
+	* \return Масштаб относительно размеров окна
+	*/
+	GLfloat Renderer::getRenderScale() const
+	{
+		return this->renderSize_.scale;
+	}
+
 	/**
 	* \brief Рисование кадра
 	* \param clearColor Цвет очистки кадра
@@ -799,47 +2107,280 @@ namespace ogl
 			throw std::runtime_error("OpenGL:Renderer: Glew is not initialised");
 		}
 
+		// Завершить замер предыдущего кадра (результаты GPU забираются с задержкой в несколько кадров)
+		// Профилировщик - источник времени кадра для динамического разрешения, панели и замера проходов
+		// Рендерер включает его только на время, пока замеры нужны (включенный пользователем не выключается)
+		bool gpuTimingNeeded = this->dynamicResolution.enabled || this->passProfiling || this->showHud;
+		if (gpuTimingNeeded && !Profiler::get().isEnabled()) {
+			Profiler::get().setEnabled(true);
+			this->profilerEnabled_ = true;
+		}
+		else if (!gpuTimingNeeded && this->profilerEnabled_) {
+			Profiler::get().setEnabled(false);
+			this->profilerEnabled_ = false;
+		}
+		Profiler::get().nextFrame();
+		OGL_PROFILE_ZONE("frame");
+
 		// Получить ID'ы всех необходимых шейдеров
-		GLuint geometryShaderID = this->shaders_.shaderGBuffer_->getId();
-		GLuint lightingShaderID = this->shaders_.shaderLighting_->getId();
 		GLuint postProcessingShaderID = this->shaders_.shaderPostProcessing_->getId();
 		GLuint solidColorShaderID = this->shaders_.shaderSolidColor_->getId();
-		GLuint shadowShaderID = this->shaders_.shaderShadowVolumes_->getId();
+		GLuint shadowShaderID = this->shadowVolumeMode == ShadowVolumeMode::CPU_CACHED ?
+			this->shaders_.shaderShadowVolumesCached_->getId() :
+			this->shaders_.shaderShadowVolumes_->getId();
+		GLuint shadowMapShaderID = this->shaders_.shaderShadowMap_->getId();
+		GLuint depthOnlyShaderID = this->shaders_.shaderDepthOnly_->getId();
+
+		// Сбросить статистику кадра
+		this->frameStats_ = {};
+
+		// Забрать результат измерения перекрытия из прошлых кадров (если готов) и решить, нужен ли проход глубины
+		this->updateOverdrawEstimate();
+		bool measureOverdraw = !this->overdraw_.pending;
+		bool depthPrePass = this->depthPrePassMode == DepthPrePassMode::DEPTH_PREPASS_ON ||
+			(this->depthPrePassMode == DepthPrePassMode::DEPTH_PREPASS_AUTO && this->overdraw_.value >= this->depthPrePassThreshold);
+		this->frameStats_.depthPrePass = depthPrePass ? 1 : 0;
+		this->frameStats_.overdraw = this->overdraw_.value;
+
+		// Забрать измеренное время прошлых кадров и подобрать разрешение рендеринга
+		this->updateRenderScale();
+		this->frameStats_.renderScale = this->renderSize_.scale;
+		this->frameStats_.gpuFrameTime = this->gpuTiming_.frameTime;
+		this->gpuTiming_.frameScales[Profiler::get().getFrameIndex() % PROFILER_GPU_FRAMES] = this->renderSize_.scale;
+
+		// Запись изменений сцены и самого кадра (до рисования - воспроизведение применяет их в том же порядке)
+		// Выполняется после выбора масштаба разрешения - он записывается вместе с кадром
+		if (this->recorder_) {
+			this->recorder_->onDrawFrame(*this, clearColor, clearMask);
+		}
+
+		// Обновить состояние положения мешей и источников (для определения необходимости перестроения теневых объемов)
+		for (auto staticMesh : this->staticMeshes_) staticMesh->updateTransformState();
+		for (auto light : this->lights_) if (light != nullptr) light->updateTransformState();
+
+		// Матрицы модели измененных мешей пересчитываются одним пакетом и сохраняются в мешах (проходы получают готовые матрицы)
+		{
+			OGL_PROFILE_ZONE_CPU("transforms");
+			this->meshTransforms_.resize(this->staticMeshes_.size());
+			for (size_t i = 0; i < this->staticMeshes_.size(); i++) {
+				const StaticMeshPtr& staticMesh = this->staticMeshes_[i];
+				this->meshTransforms_.set(i, staticMesh->origin, staticMesh->rotation, staticMesh->position, staticMesh->scale);
+			}
+
+			this->meshTransforms_.update();
+			for (size_t i = 0; i < this->staticMeshes_.size(); i++) {
+				if (this->staticMeshes_[i]->isTransformChanged()) this->staticMeshes_[i]->setModelMatrix(this->meshTransforms_.getMatrix(i));
+			}
+		}
+
+		// Г Р А Ф  К А Д Р А
+
+		this->renderGraph_.reset();
+
+		// Временные текстуры кадра (размещаются графом, текстуры с непересекающимся временем жизни используют одну память)
+		// Текстуры имеют размер окна независимо от разрешения рендеринга - при его смене текстуры пула не пересоздаются
+		GLuint width = this->viewPort.width;
+		GLuint height = this->viewPort.height;
+		bool compact = this->gBuffer_.layout == GBufferLayout::GBUFFER_COMPACT;
+		this->gBuffer_.sizes = { width,height };
+
+		// В компактном формате положение восстанавливается из глубины, нормаль - в октаэдрической упаковке
+		// Глубина записывается проходом геометрии в отдельную текстуру (вложение глубины-трафарета привязано к кадровому
+		// буферу прохода освещения для теста трафарета, читать его в том же проходе нельзя)
+		RenderGraphResource position = compact ?
+			this->renderGraph_.createTexture("g-depth", { width, height, GL_R32F, GL_RED, GL_FLOAT, GL_NEAREST }) :
+			this->renderGraph_.createTexture("g-position", { width, height, GL_RGB16F, GL_RGB, GL_FLOAT, GL_NEAREST });
+		RenderGraphResource normal = compact ?
+			this->renderGraph_.createTexture("g-normal", { width, height, GL_RG16, GL_RG, GL_UNSIGNED_SHORT, GL_NEAREST }) :
+			this->renderGraph_.createTexture("g-normal", { width, height, GL_RGB16F, GL_RGB, GL_FLOAT, GL_NEAREST });
+		RenderGraphResource albedo = this->renderGraph_.createTexture("g-albedo-specular", { width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_NEAREST });
+		RenderGraphResource depth = this->renderGraph_.createTexture("depth-stencil", { width, height, GL_DEPTH24_STENCIL8, GL_DEPTH_STENCIL, GL_UNSIGNED_INT_24_8, GL_NEAREST });
+		RenderGraphResource frameColor = this->renderGraph_.createTexture("frame-color", { width, height, GL_RGBA8, GL_RGBA, GL_UNSIGNED_BYTE, GL_LINEAR });
+
+		// Внешние ресурсы (карты теней и основной буфер)
+		RenderGraphResource spotMap = this->renderGraph_.importTexture("shadow-map-spot", this->shadowMaps_.spotMapId);
+		RenderGraphResource cascadeMap = this->renderGraph_.importTexture("shadow-map-cascades", this->shadowMaps_.cascadeMapId);
+		RenderGraphResource backBuffer = this->renderGraph_.importBackBuffer(this->context_->getFrameBufferId());
+
+		// Ресурсы G-буфера, которые читает проход освещения (глубина-трафарет - только вложение прохода)
+		std::vector<RenderGraphResource> gBufferReads = { position, normal, albedo };
+
+		// Предварительный проход глубины (фрагменты, прошедшие тест, считаются здесь - тест тот же, что был бы без прохода)
+		if (depthPrePass) {
+			this->renderGraph_.addPass({ "depth-prepass", {}, { depth }, { depth }, false, false, false }, [this, depthOnlyShaderID, measureOverdraw]() {
+				this->renderPassDepthPrePass(depthOnlyShaderID, measureOverdraw);
+			});
+		}
 
 		// Отрендерить кадр с геометрией, записать значения положений, нормалей, цветов фрагментов в G-буфер
-		this->renderPassGeometry(geometryShaderID, { 0.0f,0.0f,0.0f,0.0f }, clearMask);
+		std::vector<RenderGraphResource> gBufferDiscards = { position, normal, albedo };
+		if (!depthPrePass) gBufferDiscards.push_back(depth);
+
+		this->renderGraph_.addPass({ "geometry", {}, { position, normal, albedo, depth }, gBufferDiscards, false, false, false }, [this, clearMask, depthPrePass, measureOverdraw]() {
+			this->renderPassGeometry(this->shaders_.shaderGBuffer_, { 0.0f,0.0f,0.0f,0.0f }, clearMask, depthPrePass, measureOverdraw && !depthPrePass);
+		});
+
+		// Посчитать покрытые геометрией пиксели (результат забирается в следующих кадрах)
+		if (measureOverdraw) {
+			this->renderGraph_.addPass({ "coverage", {}, { depth }, {}, true, false, false }, [this, depthOnlyShaderID]() {
+				this->renderPassCoverage(depthOnlyShaderID);
+				this->overdraw_.pending = true;
+			});
+		}
+
+		// Распределить ячейки атласа карт теней и перерисовать устаревшие (в пределах ограничения на кадр)
+		RenderGraphResource atlas = RENDER_GRAPH_NONE;
+		if (this->shadowTechnique == ShadowTechnique::SHADOW_ATLAS)
+		{
+			if (this->shadowAtlas_ == nullptr) {
+				this->shadowAtlas_ = MakeShadowAtlas(this->shadowAtlasSettings.size, this->shadowAtlasSettings.minTileSize, this->shadowAtlasSettings.maxTileSize);
+			}
+
+			this->shadowAtlas_->update(this->lights_, this->staticMeshes_, this->viewMatrix_, this->projectionMatrix_, this->viewPort.height, this->shadowAtlasSettings.tilesPerFrame);
+			this->frameStats_.shadowAtlasStale = this->shadowAtlas_->getStaleTileCount();
 
-		// Скопировать значения глубины из G-буфера во фрейм-буфер (чтобы объекты не рендерелись поверх всего подряд)
-		glBindFramebuffer(GL_READ_FRAMEBUFFER, this->gBuffer_.gBufferId);
-		glBindFramebuffer(GL_DRAW_FRAMEBUFFER, this->frameBuffer_.frameBufferId);
-		glBlitFramebuffer(0, 0, this->viewPort.width, this->viewPort.height, 0, 0, this->viewPort.width, this->viewPort.height, GL_DEPTH_BUFFER_BIT, GL_NEAREST);
+			// Ячейки, не выбранные для перерисовки, сохраняют содержимое (атлас не очищается целиком)
+			atlas = this->renderGraph_.importTexture("shadow-atlas", this->shadowAtlas_->getTextureId());
+			this->renderGraph_.addPass({ "shadow-atlas", {}, { atlas }, {}, false, true, false }, [this, shadowMapShaderID]() {
+				this->renderPassShadowAtlas(shadowMapShaderID);
+			});
+		}
+
+		// Очищен ли освещенный кадр (очищается первым проходом освещения)
+		bool frameCleared = false;
 
 		// Пройти по всем источникам
 		for(unsigned int i = 0; i < this->lights_.size(); i++)
 		{
+			LightPtr light = this->lights_[i];
+
 			// Если источник установлен и валиден
-			if (this->lights_[i] != nullptr){
-
-				this->renderPassShadows(
-					this->lights_[i],
-					shadowShaderID
-				);
-
-				// Посчитать освещенность для источника, наложить на имеющийся в фрейм-буфере
-				this->renderPassLighting(
-					this->lights_[i],     // Источник
-					lightingShaderID,     // Шейдер
-					this->cameraPosition, // Положение камеры
-					clearColor,           // Цвет очистки
-					GL_COLOR_BUFFER_BIT,  // Очищать цветовой буфер
-					i == 0                // Поскольку очистка произведена выше, очищать не нужно
-				);
+			if (light != nullptr){
+
+				// Тени источника строятся либо картами теней, либо теневыми объемами
+				bool shadowMapped = this->isShadowMapped(light);
+				std::vector<RenderGraphResource> lightingReads = gBufferReads;
+
+				if (shadowMapped)
+				{
+					// Карты прожекторов и точечных источников в режиме атласа рисуются отдельным проходом (см. выше)
+					bool atlasShadows = this->shadowTechnique == ShadowTechnique::SHADOW_ATLAS && light->getType() != LightType::DIRECTIONAL_LIGHT;
+
+					if (atlasShadows) {
+						lightingReads.push_back(atlas);
+					}
+					else {
+						// Карты одни для всех источников - каждый проход перезаписывает их целиком
+						RenderGraphResource shadowMap = light->getType() == LightType::DIRECTIONAL_LIGHT ? cascadeMap : spotMap;
+						lightingReads.push_back(shadowMap);
+
+						this->renderGraph_.addPass({ "shadow-maps", {}, { shadowMap }, { shadowMap }, false, true, false }, [this, light, shadowMapShaderID]() {
+							this->renderPassShadowMaps(light, shadowMapShaderID);
+						});
+					}
+				}
+				else
+				{
+					// Выбрать метод построения теней (Z-fail только тогда, когда без него не обойтись)
+					bool zFail = this->isShadowVolumeCapRequired(light);
+
+					// Теневые объемы пишут только трафарет (счетчик теней в трафарете читает проход освещения источника)
+					this->renderGraph_.addPass({ "shadow-volumes", {}, { depth }, {}, false, false, false }, [this, light, shadowShaderID, zFail]() {
+						if (zFail) this->frameStats_.shadowVolumesZFail++;
+						else this->frameStats_.shadowVolumesZPass++;
+
+						// Обновить теневые объемы, построенные на CPU (если используются)
+						if (this->shadowVolumeMode == ShadowVolumeMode::CPU_CACHED) {
+							this->updateShadowVolumes(light);
+						}
+
+						this->renderPassShadows(light, shadowShaderID, zFail);
+					});
+				}
+
+				// Посчитать освещенность для источника, наложить на имеющийся в кадре (первый проход очищает кадр)
+				// Глубина-трафарет только читается (тест трафарета), поэтому ради нее проход не сохраняется
+				bool clear = !frameCleared;
+				std::vector<RenderGraphResource> lightingDiscards;
+				if (clear) lightingDiscards.push_back(frameColor);
+				frameCleared = true;
+
+				this->renderGraph_.addPass({ "lighting", lightingReads, { frameColor, depth }, lightingDiscards, false, false, true }, [this, light, clearColor, clear, shadowMapped]() {
+					this->renderPassLighting(
+						light,                          // Источник
+						this->shaders_.shaderLighting_, // Шейдер
+						this->cameraPosition,           // Положение камеры
+						clearColor,                     // Цвет очистки
+						GL_COLOR_BUFFER_BIT,            // Очищать цветовой буфер
+						clear,                          // Очищать только в первом проходе освещения
+						shadowMapped                    // Источник тени
+					);
+				});
+			}
+		}
+
+		// Визуализация перекрытия (при необходимости) заменяет освещенный кадр - проходы освещения и теней будут отсечены
+		if (this->showOverdraw) {
+			this->renderGraph_.addPass({ "overdraw", {}, { frameColor }, { frameColor }, false, false, false }, [this, solidColorShaderID]() {
+				this->renderPassOverdraw(solidColorShaderID);
+			});
+			frameCleared = true;
+		}
+
+		// Отрендерить системные объекты (если источников нет - кадр сначала очищается)
+		bool clearFrame = !frameCleared;
+		this->renderGraph_.addPass({ "sys-objects", {}, { frameColor, depth }, clearFrame ? std::vector<RenderGraphResource>{ frameColor } : std::vector<RenderGraphResource>{}, false, false, false },
+			[this, solidColorShaderID, clearColor, clearFrame]() {
+			if (clearFrame) {
+				glClearColor(clearColor.r, clearColor.g, clearColor.b, clearColor.a);
+				glClear(GL_COLOR_BUFFER_BIT);
 			}
+			this->renderPassSysObjects(solidColorShaderID);
+		});
+
+		// Осуществить пост-обработку полученного кадра (запись в основной буфер)
+		this->addPostProcessingPasses(frameColor, depth, backBuffer, postProcessingShaderID);
+
+		// Панель производительности поверх кадра (данные предыдущих кадров)
+		if (this->showHud) {
+			if (!this->hud_) this->hud_ = MakePerformanceHud();
+			this->hud_->update(this->frameStats_.gpuFrameTime, this->renderStats_, this->gpuTiming_.passes);
+			this->renderGraph_.addPass({ "hud", {}, { backBuffer }, {}, false, false, false }, [this]() {
+				this->renderPassHud();
+			});
 		}
 
-		// Отрендерить системные объекты (при необходимости)
-		this->renderPassSysObjects(solidColorShaderID);
-		// Осуществить пост-обработку полученного кадра, на основе цветового вложения фрейм-буфера (запись в основной буфер)
-		this->renderPassFinal(postProcessingShaderID, clearColor, GL_COLOR_BUFFER_BIT);
+		// Отсечь лишние проходы и разместить временные текстуры
+		{
+			OGL_PROFILE_ZONE_CPU("render-graph-compile");
+			this->renderGraph_.compile();
+		}
+		this->frameStats_.renderPassesCulled = this->renderGraph_.getCulledPassCount();
+
+		// Текстуры G-буфера текущего кадра
+		this->gBuffer_.gPositionAttachmentId = this->renderGraph_.getTextureId(position);
+		this->gBuffer_.gNormalAttachmentId = this->renderGraph_.getTextureId(normal);
+		this->gBuffer_.gAlbedoSpecAttachmentId = this->renderGraph_.getTextureId(albedo);
+		this->gBuffer_.depthStencilAttachmentId = this->renderGraph_.getTextureId(depth);
+
+		// Выполнить проходы (граф и проходы замеряются зонами профилировщика)
+		this->renderGraph_.execute();
+		this->frameStats_.graphFrameBufferSwitches = this->renderGraph_.getFrameBufferSwitches();
+
+		// Вернуть основной буфер и представить кадр
+		glBindFramebuffer(GL_FRAMEBUFFER, this->context_->getFrameBufferId());
+		OGL_STATS_ADD(frameBufferBinds, 1);
+		this->context_->swapBuffers();
+
+#ifndef OGL_NO_RENDER_STATS
+		// Меши и источники, не дошедшие до рисования (пустые слоты источников, отсеченные графом проходы)
+		_renderStats.meshesCulled = static_cast<GLuint>(this->staticMeshes_.size()) - glm::min(_renderStats.meshesSubmitted, static_cast<GLuint>(this->staticMeshes_.size()));
+		_renderStats.lightsCulled = static_cast<GLuint>(this->lights_.size()) - glm::min(_renderStats.lightsSubmitted, static_cast<GLuint>(this->lights_.size()));
+
+		// Счетчики кадра (загрузки ресурсов до следующего кадра будут отнесены к нему)
+		this->renderStats_ = _renderStats;
+		this->renderStatsHistory_.add(this->renderStats_);
+		_renderStats = {};
+#endif
 	}
 }
@@ -1,23 +1,109 @@
 ﻿#pragma once
 
-#include <Windows.h>
 #include <vector>
+#include <map>
+#include <string>
 #include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <glm/gtc/matrix_transform.hpp>
 #include <glm/gtc/type_ptr.hpp>
 
+#include "Context.h"
 #include "ShaderResource.h"
 #include "TextureResource.h"
 #include "StaticMesh.h"
 #include "Light.h"
+#include "ShadowVolume.h"
+#include "ShadowAtlas.h"
+#include "PostEffect.h"
+#include "RenderGraph.h"
+#include "RenderStats.h"
+#include "PerformanceHud.h"
+#include "FrameRecorder.h"
+#include "TransformStore.h"
 
 #define MAX_POINT_LIGHTS 32
 #define MAX_DIRECT_LIGHTS 32
 #define MAX_SPOT_LIGHTS 32
 
+#define SHADOW_MAP_SIZE 2048
+#define SHADOW_MAP_CASCADES 4
+
+#define STENCIL_GEOMETRY_BIT 0x80
+#define STENCIL_SHADOW_MASK 0x7F
+
 namespace ogl
 {
+	/**
+	 * \brief Способ построения теневых объемов
+	 */
+	enum ShadowVolumeMode
+	{
+		GEOMETRY_SHADER = 0,    // Каждый кадр в геометрическом шейдере (для всех мешей и источников)
+		CPU_CACHED = 1          // На CPU, с кешированием (объем перестраивается только при изменении положения меша или источника)
+	};
+
+	/**
+	 * \brief Способ построения теней
+	 */
+	enum ShadowTechnique
+	{
+		STENCIL_VOLUMES = 0,    // Теневые объемы (точные тени, но стоимость растет со сложностью геометрии)
+		SHADOW_MAPS = 1,        // Карты теней (каскадные для направленных источников, одиночные для прожекторов)
+		SHADOW_ATLAS = 2        // Каскадные карты для направленных источников, атлас карт для прожекторов и точечных источников
+	};
+
+	/**
+	 * \brief Режим предварительного прохода глубины
+	 */
+	enum DepthPrePassMode
+	{
+		DEPTH_PREPASS_OFF = 0,  // Не использовать
+		DEPTH_PREPASS_ON = 1,   // Использовать всегда
+		DEPTH_PREPASS_AUTO = 2  // Использовать, если измеренное перекрытие фрагментов превышает порог
+	};
+
+	/**
+	 * \brief Формат G-буфера
+	 */
+	enum GBufferLayout
+	{
+		GBUFFER_STANDARD = 0,   // Положение (RGB16F), нормаль (RGB16F), цвет и бликовость (RGBA8)
+		GBUFFER_COMPACT = 1     // Нормаль в октаэдрической упаковке (RG16), цвет и бликовость (RGBA8), положение восстанавливается из глубины (R32F)
+	};
+
+	/**
+	 * \brief Фильтр увеличения кадра до размеров окна (при пониженном разрешении рендеринга)
+	 */
+	enum UpscaleFilter
+	{
+		UPSCALE_BILINEAR = 0,   // Билинейная фильтрация
+		UPSCALE_EDGE_AWARE = 1  // Билинейная фильтрация с адаптивным повышением резкости (слабее на контрастных границах)
+	};
+
+	/**
+	 * \brief Статистика последнего отрисованного кадра
+	 * \details Заполняется во время рисования кадра, позволяет понять какие решения были приняты рендерером
+	 */
+	struct FrameStats
+	{
+		GLuint shadowVolumesZPass;  // Кол-во источников, тени которых построены методом Z-pass (без крышек объема)
+		GLuint shadowVolumesZFail;  // Кол-во источников, тени которых построены методом Z-fail (с крышками объема)
+		GLuint shadowVolumesBuilt;  // Кол-во теневых объемов, построенных на CPU в этом кадре
+		GLuint shadowVolumesCached; // Кол-во теневых объемов, взятых из кеша
+		GLuint shadowMapPasses;     // Кол-во проходов рендеринга в карты теней (каскад считается отдельным проходом)
+		GLuint shadowAtlasRendered; // Кол-во ячеек атласа карт теней, перерисованных в этом кадре
+		GLuint shadowAtlasStale;    // Кол-во ячеек атласа, перерисовка которых отложена из-за ограничения
+		GLuint shaderSwitches;      // Кол-во переключений вариантов шейдера геометрии
+		GLuint depthPrePass;        // Выполнялся ли предварительный проход глубины (0 или 1)
+		GLfloat overdraw;           // Последнее измеренное перекрытие (кол-во обработанных фрагментов на покрытый пиксель)
+		GLuint postPasses;          // Кол-во полноэкранных проходов пост-обработки (включая финальный)
+		GLuint renderPassesCulled;  // Кол-во проходов, отсеченных графом кадра (их результат не используется)
+		GLuint graphFrameBufferSwitches; // Кол-во переключений кадрового буфера между проходами графа кадра (без привязок внутри проходов)
+		GLfloat renderScale;        // Масштаб разрешения рендеринга относительно размеров окна
+		GLfloat gpuFrameTime;       // Последнее измеренное время выполнения графа кадра на GPU (мс, 0 - профилировщик выключен)
+	};
+
 	/**
 	 * \brief Объекты данного класса осуществляют рендеринг
 	 * \details Рендерер получает данные об объектах и источниках света, а затем визуализирует сцену
@@ -25,35 +111,90 @@ namespace ogl
 	class Renderer
 	{
 	private:
-		HWND hwnd_;                          // Хендл WinAPI окна
+		ContextPtr context_;                 // Контекст OpenGL (окно или внеэкранный буфер)
 		glm::mat4 viewMatrix_;               // Матрица вида
 		glm::mat4 projectionMatrix_;         // Матрица проекции
 
 		// Б У Ф Е Р Ы  К А Д Р А
 
 		/**
-		 * \brief Идентификатор G-буфера и его вложений
+		 * \brief Граф кадра
+		 * \details Описывается заново каждый кадр. Вложения G-буфера, освещенный кадр и промежуточные буферы пост-обработки
+		 * являются временными текстурами графа - текстуры с непересекающимся временем жизни используют одну и ту же память
+		 */
+		RenderGraph renderGraph_;
+
+		/**
+		 * \brief Вложения G-буфера
 		 * \details В первом проходе рендеринг сцены будет осуществляться в G-буфер, без освещения
+		 * Текстуры назначаются графом кадра при его компиляции (действительны только в пределах кадра)
 		 */
 		struct {
-			GLuint gBufferId;                // ID буфера
-			GLuint gPositionAttachmentId;    // Позиции фрагментов в 3D пространстве
+			GLuint gPositionAttachmentId;    // Позиции фрагментов в 3D пространстве (в компактном формате - глубина)
 			GLuint gNormalAttachmentId;      // Нормали фрагментов
 			GLuint gAlbedoSpecAttachmentId;  // Цвет и интенсивность отражения
-			GLuint depthStencilAttachmentId; // Значения глубины-трафарета (для тестов глубины и трафарета)
+			GLuint depthStencilAttachmentId; // Текстура глубины-трафарета (общая с освещенным кадром)
+			GBufferLayout layout;            // Формат буфера (в компактном формате вложение положений не создается)
 			struct { GLuint width; GLuint height; } sizes; // Размеры буфера
 		} gBuffer_;
 
 		/**
-		 * \brief Идентификатор кадрового буфера и его вложений
-		 * \details Во втором проходе будет осуществляться рендеринг в кадровый буфер, с учетом данных их G-буфера (для освещения)
+		 * \brief Карты теней и их параметры
+		 * \details Карты рендерятся для каждого источника непосредственно перед проходом освещения, поэтому одни и те же
+		 * текстуры используются всеми источниками. Каскады направленного источника хранятся в слоях текстурного массива
 		 */
-		struct{
-			GLuint frameBufferId;
-			GLuint colorAttachmentId;
-			GLuint depthStencilAttachmentId;
-			struct { GLuint width; GLuint height; } sizes; 
-		} frameBuffer_;
+		struct {
+			GLuint frameBufferId;                                // ID буфера (только вложение глубины)
+			GLuint spotMapId;                                    // Карта теней прожектора
+			GLuint cascadeMapId;                                 // Каскады направленного источника (массив текстур)
+			glm::mat4 spotMatrix;                                // Матрица вида-проекции прожектора
+			glm::mat4 cascadeMatrices[SHADOW_MAP_CASCADES];      // Матрицы вида-проекции каскадов
+			GLfloat cascadeSplits[SHADOW_MAP_CASCADES];          // Дальние границы каскадов (расстояние от камеры)
+			GLuint cascadeCount;                                 // Кол-во используемых каскадов
+		} shadowMaps_;
+
+		ShadowAtlasPtr shadowAtlas_;         // Атлас карт теней (создается при первом использовании)
+
+		/**
+		 * \brief Измерение перекрытия фрагментов в G-буфере
+		 * \details Кол-во фрагментов, прошедших тест глубины (без предварительного прохода каждый из них проходит
+		 * через шейдер геометрии) делится на кол-во покрытых геометрией пикселей. Результат запросов забирается
+		 * в последующих кадрах, когда он готов (без ожидания GPU)
+		 */
+		struct {
+			GLuint shadedQueryId;               // Запрос кол-ва прошедших тест глубины фрагментов
+			GLuint coveredQueryId;              // Запрос кол-ва покрытых геометрией пикселей
+			bool pending;                       // Запросы отправлены, результат еще не получен
+			GLfloat value;                      // Последнее измеренное перекрытие
+		} overdraw_;
+
+		/**
+		 * \brief Время выполнения кадров на GPU
+		 * \details Замеряется зонами профилировщика (граф кадра и его проходы), результат кадра приходит через
+		 * PROFILER_GPU_FRAMES кадров. Масштаб разрешения запоминается по номеру кадра профилировщика
+		 */
+		struct {
+			GLfloat frameScales[PROFILER_GPU_FRAMES];   // Масштаб разрешения кадров, ожидающих результата (индекс - номер кадра по модулю)
+			GLfloat frameTime;                          // Время графа последнего полученного кадра (мс)
+			std::vector<RenderGraphPassTiming> passes;  // Проходы последнего полученного кадра
+		} gpuTiming_;
+
+		/**
+		 * \brief Профилировщик включен рендерером (для динамического разрешения, панели или замера проходов)
+		 * \details Такой профилировщик выключается, когда замеры больше не нужны. Включенный пользователем - не трогается
+		 */
+		bool profilerEnabled_;
+
+		/**
+		 * \brief Текущее разрешение рендеринга
+		 * \details Временные текстуры кадра имеют размер окна, проходы до увеличения кадра рисуют в их часть
+		 * (смена масштаба не требует пересоздания текстур)
+		 */
+		struct {
+			GLfloat scale;                      // Масштаб относительно размеров окна
+			GLuint width;                       // Ширина области рендеринга
+			GLuint height;                      // Высота области рендеринга
+		} renderSize_;
 
 		// Ш Е Й Д Е Р Ы
 
@@ -67,8 +208,15 @@ namespace ogl
 			ShaderResourcePtr shaderPostProcessing_;
 			ShaderResourcePtr shaderSolidColor_;
 			ShaderResourcePtr shaderShadowVolumes_;
+			ShaderResourcePtr shaderShadowVolumesCached_;
+			ShaderResourcePtr shaderShadowMap_;
+			ShaderResourcePtr shaderDepthOnly_;
+			ShaderResourcePtr shaderSeparableKernel_;
+			ShaderResourcePtr shaderUpscale_;
 		} shaders_;
 
+		std::map<std::string, ShaderResourcePtr> postShaders_; // Шейдеры объединенных попиксельных эффектов (ключ - код эффектов)
+
 		// Г Е О М Е Т Р И Я  П О  У М О Л Ч А Н И Ю
 
 		/**
@@ -97,6 +245,36 @@ namespace ogl
 
 		std::vector<StaticMeshPtr> staticMeshes_;  // Массив статических мешей (указателей)
 		std::vector<LightPtr> lights_;             // Массив источников света (указателей)
+		std::vector<PostEffectPtr> postEffects_;   // Цепочка эффектов пост-обработки (в порядке применения)
+		TransformStore meshTransforms_;            // Положения мешей (индекс - индекс в staticMeshes_, матрицы пересчитываются пакетом)
+
+		// К Е Ш  Т Е Н Е В Ы Х  О Б Ъ Е М О В
+
+		/**
+		 * \brief Теневой объем части меша, построенный на CPU
+		 * \details Хранит указатель на геометрию, для которой построен объем (если у части сменится геометрия - объем будет перестроен)
+		 */
+		struct ShadowVolumeCacheEntry {
+			StaticGeometryResourcePtr geometry;
+			ShadowVolumePtr volume;
+		};
+
+		/**
+		 * \brief Кеш теневых объемов (ключ - пара источник-меш, значение - объемы частей меша)
+		 */
+		std::map<std::pair<const Light*, const StaticMesh*>, std::vector<ShadowVolumeCacheEntry>> shadowVolumeCache_;
+
+		// С Т А Т И С Т И К А
+
+		FrameStats frameStats_;                    // Статистика последнего кадра
+		RenderStats renderStats_;                  // Счетчики последнего кадра
+		RenderStatsHistory renderStatsHistory_;    // Счетчики последних кадров (для усреднения)
+		PerformanceHudPtr hud_;                    // Панель производительности (создается при первом показе)
+
+		// З А П И С Ь   С Е А Н С А
+
+		FrameRecorderPtr recorder_;                // Запись сеанса (пустой указатель - запись не ведется)
+		GLfloat renderScaleOverride_;              // Масштаб разрешения, заданный воспроизведением (0 - подбирается по времени кадра)
 
 		////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////////
 
@@ -110,58 +288,140 @@ namespace ogl
 		* \brief Запрект копирования через присваивание
 		* \param other Ссылка на копируемый объекта
 		*/
-		void Renderer::operator=(const Renderer& other) = delete;
+		void operator=(const Renderer& other) = delete;
 
 		/**
-		 * \brief Инициализация G-буффера
-		 * \param width Ширина буфера
-		 * \param height Высота буфера
+		 * \brief Инициализация карт теней
 		 */
-		void initGBuffer(GLuint width, GLuint height);
+		void initShadowMaps();
 
 		/**
-		 * \brief Очистка G-буфера
+		 * \brief Очистка карт теней
 		 */
-		void freeGBuffer();
+		void freeShadowMaps();
 
 		/**
-		 * \brief Инициализация фрейм-буфера
-		 * \param width Ширина буфера
-		 * \param height Высота буфера
+		 * \brief Проход для рендеринга геометрии (рендеринг в G-буфер)
+		 * \param shader Шейдер для рендеринга в G-буфер (вариант выбирается для каждой части меша)
+		 * \param clearColor Цвет очистки
+		 * \param clearMask Маска очистки
+		 * \param depthPrePassed Глубина уже записана предварительным проходом (тест GL_EQUAL, без записи глубины)
+		 * \param countSamples Считать кол-во прошедших тест глубины фрагментов (для оценки перекрытия)
 		 */
-		void initFrameBuffer(GLuint width, GLuint height);
+		void renderPassGeometry(const ShaderResourcePtr& shader, glm::vec4 clearColor, GLbitfield clearMask, bool depthPrePassed = false, bool countSamples = false);
 
 		/**
-		 * \brief Очистка фрейм-буфера
+		 * \brief Предварительный проход глубины (только положения вершин, без записи цвета)
+		 * \param shaderID Шейдер глубины
+		 * \param countSamples Считать кол-во прошедших тест глубины фрагментов (для оценки перекрытия)
 		 */
-		void freeFrameBuffer();
+		void renderPassDepthPrePass(GLuint shaderID, bool countSamples);
 
 		/**
-		 * \brief Проход для рендеринга геометрии (рендеринг в G-буфер)
-		 * \param shaderID шейдер для рендеринга в G-буфер
-		 * \param clearColor Цвет очистки
-		 * \param clearMask Маска очистки
+		 * \brief Подсчет кол-ва покрытых геометрией пикселей (по биту геометрии в трафарете)
+		 * \param shaderID Шейдер глубины
+		 */
+		void renderPassCoverage(GLuint shaderID);
+
+		/**
+		 * \brief Получить результат измерения перекрытия, если он готов
 		 */
-		void renderPassGeometry(GLuint shaderID, glm::vec4 clearColor, GLbitfield clearMask);
+		void updateOverdrawEstimate();
+
+		/**
+		 * \brief Подобрать масштаб разрешения рендеринга по измеренному времени кадра
+		 * \details Стоимость большинства проходов пропорциональна кол-ву пикселей, поэтому масштаб меняется
+		 * пропорционально корню из отношения целевого и измеренного времени (уменьшается быстрее, чем растет)
+		 */
+		void updateRenderScale();
+
+		/**
+		 * \brief Визуализация перекрытия (кол-во слоев геометрии на пиксель, чем ярче - тем больше слоев)
+		 * \param shaderID Шейдер однотонной заливки
+		 */
+		void renderPassOverdraw(GLuint shaderID) const;
+
+		/**
+		 * \brief Положение источника, от которого вытягиваются теневые объемы
+		 * \details Одна модель источника для геометрического шейдера, построения объемов на CPU и выбора метода Z-pass/Z-fail
+		 * \param light Источник освещения
+		 * \return Положение в мировом пространстве (w = 0 для направленного источника - тогда это вектор к источнику)
+		 */
+		glm::vec4 getShadowVolumeLight(LightPtr light) const;
+
+		/**
+		 * \brief Нужны ли крышки теневого объема (метод Z-fail) для источника в текущем кадре
+		 * \details Если ближняя плоскость отсечения камеры не может оказаться внутри ни одного теневого объема источника,
+		 * то можно использовать более дешевый метод Z-pass, не требующий передней и задней крышек объема
+		 * \param light Источник освещения
+		 * \return Да, если нужен Z-fail
+		 */
+		bool isShadowVolumeCapRequired(LightPtr light) const;
+
+		/**
+		 * \brief Обновить кешированные теневые объемы источника
+		 * \details Объемы перестраиваются только для тех мешей, у которых изменилось положение (либо изменилось положение источника)
+		 * \param light Источник освещения
+		 */
+		void updateShadowVolumes(LightPtr light);
 
 		/**
 		 * \brief Проход для построения теневых объемов и записи инаформации о тени в stencil-буфер
 		 * \param light Источник освещения
 		 * \param shaderID Шейдер для построения теневых объемов
+		 * \param zFail Использовать метод Z-fail (с крышками объема), иначе Z-pass
+		 */
+		void renderPassShadows(LightPtr light, GLuint shaderID, bool zFail = true);
+
+		/**
+		 * \brief Используются ли для источника карты теней
+		 * \details В режиме SHADOW_MAPS точечные источники используют теневые объемы, в режиме SHADOW_ATLAS - ячейки атласа
+		 * \param light Источник освещения
+		 * \return Да или нет
+		 */
+		bool isShadowMapped(LightPtr light) const;
+
+		/**
+		 * \brief Подобрать каскады карт теней направленного источника
+		 * \details Границы каскадов распределяются по пирамиде видимости камеры (комбинация логарифмического и
+		 * равномерного распределения), каждый каскад охватывает свою часть пирамиды ограничивающей сферой
+		 * \param light Направленный источник освещения
+		 */
+		void updateShadowCascades(LightPtr light);
+
+		/**
+		 * \brief Нарисовать всю геометрию сцены в текущий буфер глубины
+		 * \param shaderID Шейдер для рендеринга в карту теней
+		 * \param lightMatrix Матрица вида-проекции источника
 		 */
-		void renderPassShadows(LightPtr light, GLuint shaderID);
+		void renderShadowMapGeometry(GLuint shaderID, const glm::mat4& lightMatrix) const;
+
+		/**
+		 * \brief Проход для рендеринга карт теней источника
+		 * \param light Источник освещения (направленный или прожектор)
+		 * \param shaderID Шейдер для рендеринга в карту теней
+		 */
+		void renderPassShadowMaps(LightPtr light, GLuint shaderID);
+
+		/**
+		 * \brief Проход для рендеринга ячеек атласа карт теней
+		 * \details Перерисовываются только ячейки, выбранные атласом (в пределах ограничения на кадр)
+		 * \param shaderID Шейдер для рендеринга в карту теней
+		 */
+		void renderPassShadowAtlas(GLuint shaderID);
 
 		/**
 		 * \brief Проход рендеринга освещенности (один источником света)
 		 * \details Данный метод вызывается многократно (для нескольких источников), результаты буфера суммируются
 		 * \param light Источник света
-		 * \param shaderID Шейдер для рендеринга освещения
+		 * \param shader Шейдер для рендеринга освещения (вариант выбирается по типу источника)
 		 * \param cameraPosition Положение камеры
 		 * \param clearColor Цвет очистки
 		 * \param clearMask Маска очистки
 		 * \param clear Очистить
+		 * \param shadowMapped Тени источника берутся из карт теней (иначе - из stencil-буфера)
 		 */
-		void renderPassLighting(LightPtr light, GLuint shaderID, const glm::vec3& cameraPosition, glm::vec4 clearColor, GLbitfield clearMask, bool clear = false) const;
+		void renderPassLighting(LightPtr light, const ShaderResourcePtr& shader, const glm::vec3& cameraPosition, glm::vec4 clearColor, GLbitfield clearMask, bool clear = false, bool shadowMapped = false) const;
 
 		/**
 		 * \brief Проход для рендеринга системных объектов (напр. источники света)
@@ -170,12 +430,38 @@ namespace ogl
 		void renderPassSysObjects(GLuint shaderID) const;
 
 		/**
-		 * \brief Проход рендеринга для финального представления (рендеринг в основной буфер)
-		 * \param shaderID шейдер для рендеринга во фрейм-буфер
-		 * \param clearColor Цвет очистки
-		 * \param clearMask Маска очистки
+		 * \brief Получить шейдер, объединяющий последовательность попиксельных эффектов
+		 * \param effects Попиксельные эффекты
+		 * \details Шейдер собирается при первом запросе, затем берется из кеша
+		 * \return ID шейдера
+		 */
+		GLuint getFusedPostShader(const std::vector<PostEffectPtr>& effects);
+
+		/**
+		 * \brief Полноэкранный проход пост-обработки (в буфер, привязанный графом кадра)
+		 * \param shaderID Шейдер (uniform-переменные эффекта уже должны быть установлены)
+		 * \param sourceTextureId Текстура исходного кадра
+		 * \param toWindow Проход пишет во всю область окна (увеличение кадра), иначе - в область рендеринга
+		 */
+		void renderPostPass(GLuint shaderID, GLuint sourceTextureId, bool toWindow = false) const;
+
+		/**
+		 * \brief Добавить в граф кадра проходы пост-обработки (финальное представление в основном буфере)
+		 * \param frameColor Ресурс освещенного кадра
+		 * \param depth Ресурс глубины-трафарета (читается эффектами, которым нужна глубина)
+		 * \param backBuffer Ресурс основного буфера
+		 * \param shaderID шейдер для копирования кадра в основной буфер (если цепочка эффектов пуста или ничего не меняет)
+		 * \details Соседние попиксельные эффекты цепочки выполняются одним шейдером, разделимые - двумя одномерными
+		 * проходами. Эффекты, не меняющие кадр, пропускаются. Последний проход пишет сразу в основной буфер, промежуточные
+		 * результаты - временные текстуры графа. При пониженном разрешении цепочка выполняется в нем, последним
+		 * проходом кадр увеличивается до размеров окна
 		 */
-		void renderPassFinal(GLuint shaderID, glm::vec4 clearColor, GLbitfield clearMask) const;
+		void addPostProcessingPasses(RenderGraphResource frameColor, RenderGraphResource depth, RenderGraphResource backBuffer, GLuint shaderID);
+
+		/**
+		 * \brief Проход панели производительности (поверх представленного кадра в основном буфере)
+		 */
+		void renderPassHud();
 
 		/**
 		 * \brief Передать в шейдер структуру маппинга текстуры
@@ -202,14 +488,85 @@ namespace ogl
 		 */
 		glm::vec3 cameraPosition;
 
+		/**
+		 * \brief Способ построения теневых объемов
+		 * \details Кеширование на CPU выгодно для статичных сцен с высокополигональными мешами
+		 */
+		ShadowVolumeMode shadowVolumeMode;
+
+		/**
+		 * \brief Способ построения теней
+		 * \details Карты теней менее точны, но их стоимость предсказуема и слабо зависит от сложности геометрии
+		 */
+		ShadowTechnique shadowTechnique;
+
+		/**
+		 * \brief Режим предварительного прохода глубины
+		 * \details Проход дешев (только положения вершин), но выгоден лишь при заметном перекрытии геометрии
+		 */
+		DepthPrePassMode depthPrePassMode;
+
+		/**
+		 * \brief Порог перекрытия для автоматического режима предварительного прохода глубины
+		 */
+		GLfloat depthPrePassThreshold;
+
+		/**
+		 * \brief Показывать визуализацию перекрытия вместо освещенного кадра
+		 */
+		bool showOverdraw;
+
+		/**
+		 * \brief Замерять время кадра и каждого прохода графа кадра на CPU и GPU (включает профилировщик, см. getPassTimings)
+		 */
+		bool passProfiling;
+
+		/**
+		 * \brief Показывать панель производительности поверх кадра (включает профилировщик)
+		 */
+		bool showHud;
+
+		/**
+		 * \brief Параметры каскадных карт теней
+		 */
+		struct {
+			GLuint cascadeCount;        // Кол-во каскадов (не более SHADOW_MAP_CASCADES)
+			GLfloat splitLambda;        // Доля логарифмического распределения границ каскадов (0 - равномерное, 1 - логарифмическое)
+			GLfloat maxDistance;        // Дальность теней от камеры (ограничивает дальнюю плоскость камеры)
+		} shadowCascades;
+
+		/**
+		 * \brief Параметры динамического разрешения рендеринга
+		 * \details Геометрия, тени, освещение и пост-обработка выполняются в пониженном разрешении, масштаб подбирается
+		 * каждый кадр так, чтобы время кадра на GPU не превышало целевое
+		 */
+		struct {
+			bool enabled;               // Включено (иначе рендеринг в разрешении окна)
+			GLfloat targetFrameTime;    // Целевое время кадра на GPU (мс, с запасом относительно периода обновления экрана)
+			GLfloat minScale;           // Минимальный масштаб
+			GLfloat maxScale;           // Максимальный масштаб (не более 1 - текстуры кадра имеют размер окна)
+			UpscaleFilter filter;       // Фильтр увеличения кадра
+			GLfloat sharpness;          // Сила повышения резкости (0..1, для UPSCALE_EDGE_AWARE)
+		} dynamicResolution;
+
+		/**
+		 * \brief Параметры атласа карт теней
+		 */
+		struct {
+			GLuint size;                // Размер атласа (учитывается при создании атласа)
+			GLuint minTileSize;         // Минимальный размер ячейки (учитывается при создании атласа)
+			GLuint maxTileSize;         // Максимальный размер ячейки (учитывается при создании атласа)
+			GLuint tilesPerFrame;       // Максимальное кол-во перерисовываемых за кадр ячеек
+		} shadowAtlasSettings;
+
 		/**
 		 * \brief Конструктор
-		 * \param hwnd Хендл WinAPI окна
+		 * \param context Контекст OpenGL (в его основной буфер выводится кадр)
 		 * \param geometry Шейдер для рендеринга геометрии
 		 * \param lightning Шейдер для подсчета освещенности
 		 * \param postProcessing Шейдер для пост-обработки
 		 */
-		Renderer(HWND hwnd, ShaderResourcePtr geometry, ShaderResourcePtr lightning, ShaderResourcePtr postProcessing, ShaderResourcePtr shadows);
+		Renderer(ContextPtr context, ShaderResourcePtr geometry, ShaderResourcePtr lightning, ShaderResourcePtr postProcessing, ShaderResourcePtr shadows);
 
 		/**
 		 * \brief Освобождение памяти
@@ -266,6 +623,123 @@ namespace ogl
 		 */
 		std::vector<LightPtr>& getLights();
 
+		/**
+		 * \brief Добавить эффект в конец цепочки пост-обработки
+		 * \param effect Эффект
+		 * \return Указатель на эффект
+		 */
+		PostEffectPtr addPostEffect(const PostEffectPtr& effect);
+
+		/**
+		 * \brief Удалить эффект из цепочки пост-обработки
+		 * \param effect Указатель на эффект
+		 */
+		void removePostEffect(PostEffectPtr& effect);
+
+		/**
+		 * \brief Получить цепочку эффектов пост-обработки
+		 * \return Ссылка на массив указателей (порядок - порядок применения)
+		 */
+		std::vector<PostEffectPtr>& getPostEffects();
+
+		/**
+		 * \brief Получить статистику последнего отрисованного кадра
+		 * \return Константная ссылка на структуру статистики
+		 */
+		const FrameStats& getFrameStats() const;
+
+		/**
+		 * \brief Установить формат G-буфера
+		 * \param layout Формат буфера
+		 * \details Вложения нового формата размещаются графом кадра при рисовании следующего кадра
+		 */
+		void setGBufferLayout(GBufferLayout layout);
+
+		/**
+		 * \brief Получить формат G-буфера
+		 * \return Формат буфера
+		 */
+		GBufferLayout getGBufferLayout() const;
+
+		/**
+		 * \brief Оценка объема видеопамяти, занимаемого G-буфером (включая глубину-трафарет)
+		 * \param layout Формат буфера
+		 * \param width Ширина буфера
+		 * \param height Высота буфера
+		 * \return Кол-во байт
+		 */
+		static size_t estimateGBufferMemory(GBufferLayout layout, GLuint width, GLuint height);
+
+		/**
+		 * \brief Отчет о памяти и чтении на источник для обоих форматов G-буфера
+		 * \param width Ширина буфера (по умолчанию 4K)
+		 * \param height Высота буфера (по умолчанию 4K)
+		 * \return Строка отчета
+		 */
+		static std::string getGBufferMemoryReport(GLuint width = 3840, GLuint height = 2160);
+
+		/**
+		 * \brief Отчет графа последнего кадра (проходы, время жизни текстур, память до и после совмещения)
+		 * \return Строка отчета
+		 */
+		std::string getRenderGraphReport() const;
+
+		/**
+		 * \brief Время выполнения проходов графа кадра (при включенном профилировщике)
+		 * \return Замер кадра, выполненного PROFILER_GPU_FRAMES кадров назад
+		 */
+		const std::vector<RenderGraphPassTiming>& getPassTimings() const;
+
+		/**
+		 * \brief Счетчики последнего кадра (вызовы рисования, привязки, передачи uniform-переменных, загрузки)
+		 * \return Ссылка на счетчики (нулевые при сборке с OGL_NO_RENDER_STATS)
+		 */
+		const RenderStats& getRenderStats() const;
+
+		/**
+		 * \brief Средние значения счетчиков за последние кадры
+		 * \return Счетчики
+		 */
+		RenderStats getRenderStatsAverage() const;
+
+		/**
+		 * \brief Максимальные значения счетчиков за последние кадры
+		 * \return Счетчики
+		 */
+		RenderStats getRenderStatsMaximum() const;
+
+		/**
+		 * \brief Задать кол-во кадров для усреднения счетчиков (накопленные значения сбрасываются)
+		 * \param frames Кол-во кадров
+		 */
+		void setRenderStatsFrames(GLuint frames);
+
+		/**
+		 * \brief Начать или завершить запись сеанса
+		 * \param recorder Запись (в нее сразу попадают текущие меши, источники и матрицы камеры), nullptr - завершить запись
+		 * \details Трасса дописывается и закрывается при уничтожении последнего указателя на запись
+		 */
+		void setRecorder(const FrameRecorderPtr& recorder);
+
+		/**
+		 * \brief Получить текущую запись сеанса
+		 * \return Указатель на запись (пустой, если запись не ведется)
+		 */
+		FrameRecorderPtr getRecorder() const;
+
+		/**
+		 * \brief Задать масштаб разрешения рендеринга вместо подбираемого по времени кадра
+		 * \param scale Масштаб относительно размеров окна (0 - вернуть подбор)
+		 * \details Используется воспроизведением трассы - кадры рисуются в том же разрешении, что и при записи
+		 */
+		void setRenderScaleOverride(GLfloat scale);
+
+		/**
+		 * \brief Получить масштаб разрешения рендеринга текущего кадра
+		 * \return Масштаб относительно размеров окна
+		 */
+		GLfloat getRenderScale() const;
+
 		/**
 		 * \brief Рисование кадра
 		 * \param clearColor Цвет очистки кадра
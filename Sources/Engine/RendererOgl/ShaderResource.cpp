@@ -1,6 +1,10 @@
 ﻿#include "ShaderResource.h"
+#include "Profiler.h"
 #include <map>
 #include <sstream>
+#include <fstream>
+#include <algorithm>
+#include <iterator>
 
 namespace ogl
 {
@@ -9,6 +13,11 @@ namespace ogl
 	*/
 	extern bool _isGlewInitialised;
 
+	/**
+	* \brief Каталог кеша двоичных программ
+	*/
+	std::string ShaderResource::binaryCacheDir_;
+
 	/**
 	* \brief Внутренний метод разбития строки на под-строки
 	* \param str Исходная строка
@@ -73,6 +82,7 @@ namespace ogl
 	* \brief Компиляция шейдера
 	* \param shaderSource Исходный код шейдера
 	* \param type Тип шейдера
+	* \details Статус компиляции не проверяется (ошибки выясняются при проверке сборки программы)
 	* \return Идентификатор шейдера
 	*/
 	GLuint ShaderResource::compileShader(const char* shaderSource, GLuint type)
@@ -96,41 +106,164 @@ namespace ogl
 		// Связать исходный код и шейдер
 		glShaderSource(id, 1, &shaderSource, nullptr);
 
-		// Компиляция шейдера
+		// Компиляция шейдера (запрос статуса заблокировал бы поток до ее окончания)
 		glCompileShader(id);
 
-		// Успешна ли копиляция
-		GLint success;
-		glGetShaderiv(id, GL_COMPILE_STATUS, &success);
+		return id;
+	}
 
-		// Если не скомпилирован - генерация исключения
-		if (!success) {
-			GLsizei messageLength = 0;
-			GLchar message[1024];
-			glGetShaderInfoLog(id, 1024, &messageLength, message);
+	/**
+	* \brief Добавить определения препроцессора в код шейдера
+	* \param shaderSource Исходный код шейдера
+	* \param defines Список определений
+	* \details Определения вставляются сразу после директивы #version
+	* \return Код шейдера с определениями
+	*/
+	std::string ShaderResource::injectDefines(const std::string& shaderSource, const std::vector<std::string>& defines)
+	{
+		if (defines.empty()) {
+			return shaderSource;
+		}
+
+		// Строки определений
+		std::string definesCode;
+		for (const std::string& define : defines) {
+			definesCode.append("#define ").append(define).append("\n");
+		}
+
+		// Директива #version должна быть первой, поэтому определения идут следующей строкой
+		std::size_t version = shaderSource.find("#version");
+		if (version == std::string::npos) {
+			return definesCode + shaderSource;
+		}
 
-			throw std::runtime_error(std::string("OpenGL:ShaderResource:Compilation: ").append(message));
+		std::size_t lineEnd = shaderSource.find('\n', version);
+		if (lineEnd == std::string::npos) {
+			return shaderSource + "\n" + definesCode;
+		}
+
+		std::string result = shaderSource;
+		result.insert(lineEnd + 1, definesCode);
+		return result;
+	}
+
+	/**
+	* \brief Путь к файлу двоичной программы в кеше
+	* \param stageSources Исходные коды этапов (с учетом определений)
+	* \details Имя файла - хеш кода этапов и строк производителя, модели и версии драйвера
+	* \return Путь к файлу (пустая строка, если кеш не используется или не поддерживается)
+	*/
+	std::string ShaderResource::getBinaryCachePath(const std::map<GLuint, std::string>& stageSources)
+	{
+		if (ShaderResource::binaryCacheDir_.empty() || !(GLEW_VERSION_4_1 || GLEW_ARB_get_program_binary)) {
+			return "";
+		}
+
+		// Драйвер может не поддерживать ни одного формата двоичных программ
+		GLint formatCount = 0;
+		glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+		if (formatCount <= 0) {
+			return "";
+		}
+
+		// 64-битный FNV-1a хеш
+		unsigned long long hash = 14695981039346656037ULL;
+		auto hashString = [&hash](const char* str) {
+			for (; str != nullptr && *str != 0; str++) {
+				hash ^= static_cast<unsigned char>(*str);
+				hash *= 1099511628211ULL;
+			}
+			hash ^= 0xFF;
+			hash *= 1099511628211ULL;
+		};
+
+		// Двоичный код действителен только для того же драйвера
+		hashString(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+		hashString(reinterpret_cast<const char*>(glGetString(GL_RENDERER)));
+		hashString(reinterpret_cast<const char*>(glGetString(GL_VERSION)));
+
+		// Код этапов (определения варианта уже добавлены в код)
+		for (const auto& stage : stageSources) {
+			hashString(std::to_string(stage.first).c_str());
+			hashString(stage.second.c_str());
+		}
+
+		char name[17];
+		snprintf(name, sizeof(name), "%016llx", hash);
+		return ShaderResource::binaryCacheDir_ + name + ".bin";
+	}
+
+	/**
+	* \brief Загрузить программу из двоичного кеша
+	* \param path Путь к файлу
+	* \return Идентификатор программы (0 если файла нет или драйвер отверг двоичный код)
+	*/
+	GLuint ShaderResource::loadProgramBinary(const std::string& path)
+	{
+		std::ifstream file(path, std::ios::binary);
+		if (!file.is_open()) {
+			return 0;
+		}
+
+		// Формат (GLenum), затем двоичный код программы
+		GLenum format = 0;
+		if (!file.read(reinterpret_cast<char*>(&format), sizeof(format))) {
+			return 0;
+		}
+
+		std::vector<char> binary((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+		if (binary.empty()) {
+			return 0;
+		}
+
+		GLuint id = glCreateProgram();
+		glProgramBinary(id, format, binary.data(), static_cast<GLsizei>(binary.size()));
+
+		// Драйвер может отвергнуть двоичный код (например, после обновления) - тогда программа собирается из исходников
+		GLint success = 0;
+		glGetProgramiv(id, GL_LINK_STATUS, &success);
+		if (!success) {
+			glDeleteProgram(id);
+			return 0;
 		}
 
 		return id;
 	}
 
 	/**
-	* \brief Создать шейдерную программу
-	* \param source Исходный код шейдеров
+	* \brief Сохранить собранную программу в двоичный кеш
+	* \param id Идентификатор программы
+	* \param path Путь к файлу
 	*/
-	ShaderResource::ShaderResource(const std::string& source)
+	void ShaderResource::saveProgramBinary(GLuint id, const std::string& path)
 	{
-		// Инициализация GLEW
-		if (!_isGlewInitialised) {
-			glewExperimental = GL_TRUE;
-			_isGlewInitialised = glewInit() == GLEW_OK;
+		GLint length = 0;
+		glGetProgramiv(id, GL_PROGRAM_BINARY_LENGTH, &length);
+		if (length <= 0) {
+			return;
 		}
 
-		if (!_isGlewInitialised) {
-			throw std::runtime_error("OpenGL:ShaderResource: Glew is not initialised");
+		GLenum format = 0;
+		std::vector<char> binary(static_cast<size_t>(length));
+		glGetProgramBinary(id, length, &length, &format, binary.data());
+
+		// Если записать не удалось (например, нет каталога) - кеш просто не используется
+		std::ofstream file(path, std::ios::binary | std::ios::trunc);
+		if (file.is_open()) {
+			file.write(reinterpret_cast<const char*>(&format), sizeof(format));
+			file.write(binary.data(), length);
 		}
+	}
 
+	/**
+	* \brief Начать сборку шейдерной программы
+	* \param source Исходный код шейдеров
+	* \param defines Список определений препроцессора
+	* \details Запрашивает компиляцию и линковку без ожидания результата
+	* \return Начатая сборка
+	*/
+	ShaderResource::ProgramBuild ShaderResource::beginBuild(const std::string& source, const std::vector<std::string>& defines)
+	{
 		// Ассоциативный массив исходных кодов шейдеров
 		std::map<GLuint, std::string> shaderSources;
 		shaderSources[GL_VERTEX_SHADER] = "/*VERTEX-SHADER-BEGIN*/|/*VERTEX-SHADER-END*/";
@@ -140,15 +273,31 @@ namespace ogl
 		// Поделить весь файл на куски относящиеся к соответствующим типам шейдеров
 		ShaderResource::splitCodeToMap(&shaderSources, source);
 
+		// Добавить определения варианта в код этапов
+		for (auto& stage : shaderSources) {
+			if (stage.second.length() > 0) stage.second = ShaderResource::injectDefines(stage.second, defines);
+		}
+
+		ProgramBuild build;
+
+		// Попробовать загрузить программу из двоичного кеша
+		build.cachePath = ShaderResource::getBinaryCachePath(shaderSources);
+		if (!build.cachePath.empty()) {
+			build.id = ShaderResource::loadProgramBinary(build.cachePath);
+			if (build.id != 0) return build;
+		}
+
 		// Зарегестрировать шейдерную программу
-		this->id_ = glCreateProgram();
+		build.id = glCreateProgram();
+
+		// Разрешить получение двоичного кода программы после сборки
+		if (!build.cachePath.empty()) {
+			glProgramParameteri(build.id, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+		}
 
 		// Итератор ассоциативного массива
 		std::map<GLuint, std::string>::iterator it;
 
-		// ID'ы шейдеров (чтобы освободить память после линковки программы)
-		std::vector<GLuint> shaderIds;
-
 		// Пройтись по всем элементам ассоциативного массива
 		for (it = shaderSources.begin(); it != shaderSources.end(); ++it)
 		{
@@ -158,32 +307,116 @@ namespace ogl
 				// Скомпилировать шейдер
 				GLuint shaderId = ShaderResource::compileShader(it->second.c_str(), it->first);
 				// Добавить шейдер к программе
-				glAttachShader(this->id_, shaderId);
-				// Добавить в список ID'ов
-				shaderIds.push_back(shaderId);
+				glAttachShader(build.id, shaderId);
+				// Добавить в список ID'ов (чтобы освободить память после линковки программы)
+				build.shaderIds.push_back(shaderId);
 			}
 		}
 
-		// Собрать шейдерную программу
-		glLinkProgram(this->id_);
+		// Собрать шейдерную программу (статус проверяется в finishBuild)
+		glLinkProgram(build.id);
 
-		// Проверка ошибок сборки шейдерной программы
+		return build;
+	}
+
+	/**
+	* \brief Завершить сборку шейдерной программы
+	* \param build Начатая сборка
+	* \details Ожидает завершения, проверяет статус, освобождает шейдеры. В случае ошибки генерирует исключение
+	*/
+	void ShaderResource::finishBuild(ProgramBuild& build)
+	{
+		// Программа загружена из кеша или сборка уже завершена
+		if (build.shaderIds.empty()) {
+			return;
+		}
+
+		// Проверка ошибок сборки шейдерной программы (первый запрос статуса дожидается окончания сборки)
 		GLint success;
-		glGetProgramiv(this->id_, GL_LINK_STATUS, &success);
+		glGetProgramiv(build.id, GL_LINK_STATUS, &success);
 
-		// Если не удалось собрать программу
+		// Если не удалось собрать программу - выяснить причину (ошибка компиляции одного из шейдеров или линковки)
 		if (!success) {
 			GLsizei messageLength = 0;
 			GLchar message[1024];
-			glGetProgramInfoLog(this->id_, 1024, &messageLength, message);
+			std::string error;
+
+			for (const GLuint& shaderId : build.shaderIds) {
+				GLint compiled;
+				glGetShaderiv(shaderId, GL_COMPILE_STATUS, &compiled);
+				if (!compiled) {
+					glGetShaderInfoLog(shaderId, 1024, &messageLength, message);
+					error = std::string("OpenGL:ShaderResource:Compilation: ").append(message);
+					break;
+				}
+			}
 
-			throw std::runtime_error(std::string("OpenGL:ShaderResource:Linking: ").append(message));
+			if (error.empty()) {
+				glGetProgramInfoLog(build.id, 1024, &messageLength, message);
+				error = std::string("OpenGL:ShaderResource:Linking: ").append(message);
+			}
+
+			for (const GLuint& shaderId : build.shaderIds) {
+				glDeleteShader(shaderId);
+			}
+
+			glDeleteProgram(build.id);
+			build.id = 0;
+			build.shaderIds.clear();
+
+			throw std::runtime_error(error);
 		}
 
 		// Удалить шейдеры (после сборки шейдерной программы они уже не нужны в памяти)
-		for (const GLuint& shaderId : shaderIds) {
+		for (const GLuint& shaderId : build.shaderIds) {
 			glDeleteShader(shaderId);
 		}
+		build.shaderIds.clear();
+
+		// Сохранить в двоичный кеш
+		if (!build.cachePath.empty()) {
+			ShaderResource::saveProgramBinary(build.id, build.cachePath);
+		}
+	}
+
+	/**
+	* \brief Сборка шейдерной программы
+	* \param source Исходный код шейдеров
+	* \param defines Список определений препроцессора
+	* \return Идентификатор программы
+	*/
+	GLuint ShaderResource::buildProgram(const std::string& source, const std::vector<std::string>& defines)
+	{
+		ProgramBuild build = ShaderResource::beginBuild(source, defines);
+		ShaderResource::finishBuild(build);
+		return build.id;
+	}
+
+	/**
+	* \brief Создать шейдерную программу
+	* \param source Исходный код шейдеров
+	* \param deferred Отложить проверку сборки до вызова wait() или getId()
+	*/
+	ShaderResource::ShaderResource(const std::string& source, bool deferred):source_(source)
+	{
+		// Инициализация GLEW
+		if (!_isGlewInitialised) {
+			glewExperimental = GL_TRUE;
+			_isGlewInitialised = glewInit() == GLEW_OK;
+		}
+
+		if (!_isGlewInitialised) {
+			throw std::runtime_error("OpenGL:ShaderResource: Glew is not initialised");
+		}
+
+		OGL_PROFILE_ZONE("shader-create");
+
+		this->pendingBuild_ = ShaderResource::beginBuild(this->source_, {});
+		this->id_ = this->pendingBuild_.id;
+
+		if (!deferred) {
+			this->wait();
+		}
 	}
 
 	/**
@@ -191,6 +424,14 @@ namespace ogl
 	*/
 	ShaderResource::~ShaderResource()
 	{
+		for (auto& variant : this->variants_) {
+			glDeleteProgram(variant.second);
+		}
+
+		for (const GLuint& shaderId : this->pendingBuild_.shaderIds) {
+			glDeleteShader(shaderId);
+		}
+
 		if (id_) glDeleteProgram(id_);
 	}
 
@@ -200,9 +441,126 @@ namespace ogl
 	*/
 	GLuint ShaderResource::getId() const
 	{
+		this->wait();
 		return this->id_;
 	}
 
+	/**
+	* \brief Завершена ли сборка основной программы
+	* \details Не блокирует. Без поддержки GL_KHR_parallel_shader_compile драйвер не сообщает о ходе сборки - всегда true
+	* \return Состояние
+	*/
+	bool ShaderResource::isReady() const
+	{
+		if (this->pendingBuild_.shaderIds.empty() || !(GLEW_KHR_parallel_shader_compile || GLEW_ARB_parallel_shader_compile)) {
+			return true;
+		}
+
+		GLint completed = GL_FALSE;
+		glGetProgramiv(this->pendingBuild_.id, GL_COMPLETION_STATUS_KHR, &completed);
+		return completed == GL_TRUE;
+	}
+
+	/**
+	* \brief Дождаться завершения отложенной сборки
+	* \details В случае ошибки компиляции или линковки генерирует исключение
+	*/
+	void ShaderResource::wait() const
+	{
+		// При ошибке программа удаляется - основной ID больше недействителен
+		try {
+			ShaderResource::finishBuild(this->pendingBuild_);
+		}
+		catch (...) {
+			this->id_ = 0;
+			throw;
+		}
+	}
+
+	/**
+	* \brief Получить ID варианта шейдерной программы
+	* \param defines Список определений препроцессора (порядок не важен)
+	* \details Вариант собирается при первом запросе, затем берется из кеша. Пустой список - основная программа
+	* \return Числовой идентификатор
+	*/
+	GLuint ShaderResource::getVariantId(std::vector<std::string> defines)
+	{
+		if (defines.empty()) {
+			return this->getId();
+		}
+
+		// Ключ варианта не должен зависеть от порядка и повторов определений
+		std::sort(defines.begin(), defines.end());
+		defines.erase(std::unique(defines.begin(), defines.end()), defines.end());
+
+		std::string key;
+		for (const std::string& define : defines) {
+			key.append(define).append(";");
+		}
+
+		// Если вариант уже собран
+		auto it = this->variants_.find(key);
+		if (it != this->variants_.end()) {
+			return it->second;
+		}
+
+		GLuint id = ShaderResource::buildProgram(this->source_, defines);
+		this->variants_[key] = id;
+		return id;
+	}
+
+	/**
+	* \brief Получить ID варианта шейдерной программы по маске определений
+	* \param mask Маска (бит i - определение names[i])
+	* \param names Названия определений битов маски (одни и те же для всех запросов ресурса)
+	* \details Для вызова на каждое рисование - повторный запрос маски не строит строк. Пустая маска - основная программа
+	* \return Числовой идентификатор
+	*/
+	GLuint ShaderResource::getVariantId(GLuint mask, const std::vector<std::string>& names)
+	{
+		auto it = this->maskVariants_.find(mask);
+		if (it != this->maskVariants_.end()) {
+			return it->second;
+		}
+
+		// Первый запрос маски - вариант по списку определений
+		std::vector<std::string> defines;
+		for (size_t i = 0; i < names.size(); i++) {
+			if (mask & (1u << i)) defines.push_back(names[i]);
+		}
+
+		GLuint id = this->getVariantId(defines);
+		this->maskVariants_[mask] = id;
+		return id;
+	}
+
+	/**
+	* \brief Получить кол-во собранных вариантов (без основной программы)
+	* \return Кол-во вариантов
+	*/
+	size_t ShaderResource::getVariantCount() const
+	{
+		return this->variants_.size();
+	}
+
+	/**
+	* \brief Установить каталог кеша двоичных программ
+	* \param dir Путь к существующему каталогу (с разделителем в конце). Пустая строка отключает кеш
+	*/
+	void ShaderResource::setBinaryCacheDir(const std::string& dir)
+	{
+		ShaderResource::binaryCacheDir_ = dir;
+	}
+
+	/**
+	* \brief Получить каталог кеша двоичных программ
+	* \return Путь к каталогу
+	*/
+	const std::string& ShaderResource::getBinaryCacheDir()
+	{
+		return ShaderResource::binaryCacheDir_;
+	}
+
 	/**
 	* \brief Создать ресурс шейдерной программы
 	* \param source Исходный код шейдеров
@@ -212,4 +570,37 @@ namespace ogl
 	{
 		return std::make_shared<ShaderResource>(source);
 	}
+
+	/**
+	* \brief Создать набор ресурсов шейдерных программ
+	* \param sources Исходные коды шейдеров
+	* \details Сначала запрашивается сборка всех программ, проверка статуса откладывается до wait() или getId().
+	* Это позволяет драйверу собирать программы параллельно (GL_KHR_parallel_shader_compile), а приложению - продолжать загрузку
+	* \return Массив умных указателей на ресурсы (в порядке исходных кодов)
+	*/
+	std::vector<ShaderResourcePtr> MakeShaderResources(const std::vector<std::string>& sources)
+	{
+		// Инициализация GLEW
+		if (!_isGlewInitialised) {
+			glewExperimental = GL_TRUE;
+			_isGlewInitialised = glewInit() == GLEW_OK;
+		}
+
+		if (!_isGlewInitialised) {
+			throw std::runtime_error("OpenGL:ShaderResource: Glew is not initialised");
+		}
+
+		// Кол-во потоков компилятора выбирает драйвер (до запроса сборки первой программы)
+		if (GLEW_KHR_parallel_shader_compile) glMaxShaderCompilerThreadsKHR(0xFFFFFFFF);
+		else if (GLEW_ARB_parallel_shader_compile) glMaxShaderCompilerThreadsARB(0xFFFFFFFF);
+
+		std::vector<ShaderResourcePtr> resources;
+		resources.reserve(sources.size());
+
+		for (const std::string& source : sources) {
+			resources.push_back(std::make_shared<ShaderResource>(source, true));
+		}
+
+		return resources;
+	}
 }
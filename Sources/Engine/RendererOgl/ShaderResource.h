@@ -1,21 +1,42 @@
 ﻿#pragma once
 
-#include <gl/glew.h>
+#include <GL/glew.h>
 #include <vector>
 #include <map>
 #include <memory>
+#include <string>
 
 namespace ogl
 {
 	/**
 	 * \brief Ресурс шейдерной программы
 	 * \details Производит компиляцию шейдеров и сборку программы во время инициализации. Не копируемый
+	 * Варианты программы (с набором #define) собираются по требованию и кешируются по ключу
+	 * Если задан каталог кеша, собранные программы сохраняются на диск в двоичном виде и загружаются при следующем запуске
+	 * При отложенной сборке проверка статуса откладывается до первого обращения, чтобы драйвер мог собирать программы параллельно
 	 */
 	class ShaderResource
 	{
 
 	private:
-		GLuint id_;  // Идентификатор шейдерной программы
+		/**
+		 * \brief Начатая сборка программы
+		 * \details Компиляция и линковка уже запрошены у драйвера, статус еще не проверялся
+		 */
+		struct ProgramBuild
+		{
+			GLuint id = 0;                 // Идентификатор программы
+			std::vector<GLuint> shaderIds; // Шейдеры программы (пусто, если программа загружена из кеша или сборка завершена)
+			std::string cachePath;         // Путь к файлу двоичного кеша (пустая строка - не сохранять)
+		};
+
+		mutable GLuint id_;                      // Идентификатор шейдерной программы (без дополнительных определений)
+		std::string source_;                     // Исходный код (для сборки вариантов)
+		std::map<std::string, GLuint> variants_; // Собранные варианты программы (ключ - отсортированный набор определений)
+		std::map<GLuint, GLuint> maskVariants_;  // Варианты, запрошенные по маске определений (ключ - маска)
+		mutable ProgramBuild pendingBuild_;      // Незавершенная отложенная сборка основной программы
+
+		static std::string binaryCacheDir_;      // Каталог кеша двоичных программ (пустая строка - кеш не используется)
 
 		/**
 		 * \brief Внутренний метод разбития строки на под-строки
@@ -38,10 +59,66 @@ namespace ogl
 		 * \brief Компиляция шейдера
 		 * \param shaderSource Исходный код шейдера
 		 * \param type Тип шейдера
+		 * \details Статус компиляции не проверяется (ошибки выясняются при проверке сборки программы)
 		 * \return Идентификатор шейдера
 		 */
 		static GLuint compileShader(const char * shaderSource, GLuint type);
 
+		/**
+		 * \brief Добавить определения препроцессора в код шейдера
+		 * \param shaderSource Исходный код шейдера
+		 * \param defines Список определений
+		 * \details Определения вставляются сразу после директивы #version
+		 * \return Код шейдера с определениями
+		 */
+		static std::string injectDefines(const std::string& shaderSource, const std::vector<std::string>& defines);
+
+		/**
+		 * \brief Путь к файлу двоичной программы в кеше
+		 * \param stageSources Исходные коды этапов (с учетом определений)
+		 * \details Имя файла - хеш кода этапов и строк производителя, модели и версии драйвера
+		 * \return Путь к файлу (пустая строка, если кеш не используется или не поддерживается)
+		 */
+		static std::string getBinaryCachePath(const std::map<GLuint, std::string>& stageSources);
+
+		/**
+		 * \brief Загрузить программу из двоичного кеша
+		 * \param path Путь к файлу
+		 * \return Идентификатор программы (0 если файла нет или драйвер отверг двоичный код)
+		 */
+		static GLuint loadProgramBinary(const std::string& path);
+
+		/**
+		 * \brief Сохранить собранную программу в двоичный кеш
+		 * \param id Идентификатор программы
+		 * \param path Путь к файлу
+		 */
+		static void saveProgramBinary(GLuint id, const std::string& path);
+
+		/**
+		 * \brief Начать сборку шейдерной программы
+		 * \param source Исходный код шейдеров
+		 * \param defines Список определений препроцессора
+		 * \details Запрашивает компиляцию и линковку без ожидания результата
+		 * \return Начатая сборка
+		 */
+		static ProgramBuild beginBuild(const std::string& source, const std::vector<std::string>& defines);
+
+		/**
+		 * \brief Завершить сборку шейдерной программы
+		 * \param build Начатая сборка
+		 * \details Ожидает завершения, проверяет статус, освобождает шейдеры. В случае ошибки генерирует исключение
+		 */
+		static void finishBuild(ProgramBuild& build);
+
+		/**
+		 * \brief Сборка шейдерной программы
+		 * \param source Исходный код шейдеров
+		 * \param defines Список определений препроцессора
+		 * \return Идентификатор программы
+		 */
+		static GLuint buildProgram(const std::string& source, const std::vector<std::string>& defines);
+
 		/**
 		 * \brief Запрет копирования через инициализацию
 		 * \param other Ссылка на копируемый объекта
@@ -52,15 +129,16 @@ namespace ogl
 		 * \brief Запрект копирования через присваивание
 		 * \param other Ссылка на копируемый объекта
 		 */
-		void ShaderResource::operator=(const ShaderResource& other) = delete;
+		void operator=(const ShaderResource& other) = delete;
 
 	public:
 
 		/**
 		 * \brief Создать шейдерную программу
 		 * \param source Исходный код шейдеров
+		 * \param deferred Отложить проверку сборки до вызова wait() или getId()
 		 */
-		ShaderResource(const std::string& source);
+		ShaderResource(const std::string& source, bool deferred = false);
 
 		/**
 		 * \brief Уничтожить шейдерную программу
@@ -69,9 +147,58 @@ namespace ogl
 
 		/**
 		 * \brief Получть ID шейдерной программы
+		 * \details Если сборка отложена - дожидается ее завершения
 		 * \return Числовой идентификатор
 		 */
 		GLuint getId() const;
+
+		/**
+		 * \brief Завершена ли сборка основной программы
+		 * \details Не блокирует. Без поддержки GL_KHR_parallel_shader_compile драйвер не сообщает о ходе сборки - всегда true
+		 * \return Состояние
+		 */
+		bool isReady() const;
+
+		/**
+		 * \brief Дождаться завершения отложенной сборки
+		 * \details В случае ошибки компиляции или линковки генерирует исключение
+		 */
+		void wait() const;
+
+		/**
+		 * \brief Получить ID варианта шейдерной программы
+		 * \param defines Список определений препроцессора (порядок не важен)
+		 * \details Вариант собирается при первом запросе, затем берется из кеша. Пустой список - основная программа
+		 * \return Числовой идентификатор
+		 */
+		GLuint getVariantId(std::vector<std::string> defines);
+
+		/**
+		 * \brief Получить ID варианта шейдерной программы по маске определений
+		 * \param mask Маска (бит i - определение names[i])
+		 * \param names Названия определений битов маски (одни и те же для всех запросов ресурса)
+		 * \details Для вызова на каждое рисование - повторный запрос маски не строит строк. Пустая маска - основная программа
+		 * \return Числовой идентификатор
+		 */
+		GLuint getVariantId(GLuint mask, const std::vector<std::string>& names);
+
+		/**
+		 * \brief Получить кол-во собранных вариантов (без основной программы)
+		 * \return Кол-во вариантов
+		 */
+		size_t getVariantCount() const;
+
+		/**
+		 * \brief Установить каталог кеша двоичных программ
+		 * \param dir Путь к существующему каталогу (с разделителем в конце). Пустая строка отключает кеш
+		 */
+		static void setBinaryCacheDir(const std::string& dir);
+
+		/**
+		 * \brief Получить каталог кеша двоичных программ
+		 * \return Путь к каталогу
+		 */
+		static const std::string& getBinaryCacheDir();
 	};
 
 	/**
@@ -86,4 +213,13 @@ namespace ogl
 	 * \return Умный указатель на ресурс
 	 */
 	ShaderResourcePtr MakeShaderResource(const std::string& source);
+
+	/**
+	 * \brief Создать набор ресурсов шейдерных программ
+	 * \param sources Исходные коды шейдеров
+	 * \details Сначала запрашивается сборка всех программ, проверка статуса откладывается до wait() или getId().
+	 * Это позволяет драйверу собирать программы параллельно (GL_KHR_parallel_shader_compile), а приложению - продолжать загрузку
+	 * \return Массив умных указателей на ресурсы (в порядке исходных кодов)
+	 */
+	std::vector<ShaderResourcePtr> MakeShaderResources(const std::vector<std::string>& sources);
 }
@@ -0,0 +1,488 @@
+﻿#include "ShadowAtlas.h"
+#include "GpuMemory.h"
+#include <algorithm>
+#include <cfloat>
+#include <stdexcept>
+#include <glm/gtc/matrix_transform.hpp>
+
+namespace ogl
+{
+	/**
+	* \brief Проинициализирован ли GLEW
+	*/
+	extern bool _isGlewInitialised;
+
+	/**
+	* \brief Получить размер ячейки уровня
+	* \param level Уровень
+	* \return Размер стороны (в текселях)
+	*/
+	GLuint ShadowAtlas::getCellSize(GLuint level) const
+	{
+		return this->maxTileSize_ >> level;
+	}
+
+	/**
+	* \brief Выделить ячейку
+	* \details Если свободных ячеек уровня нет - делится ячейка большего уровня
+	* \param level Уровень
+	* \param position Указатель на положение выделенной ячейки
+	* \return Удалось ли выделить
+	*/
+	bool ShadowAtlas::allocateCell(GLuint level, glm::uvec2* position)
+	{
+		// Если есть свободная ячейка нужного уровня - взять ее
+		if (!this->freeCells_[level].empty()) {
+			*position = this->freeCells_[level].back();
+			this->freeCells_[level].pop_back();
+			return true;
+		}
+
+		// Ячейки максимального размера делить нечем
+		if (level == 0) {
+			return false;
+		}
+
+		// Разделить ячейку большего уровня на 4 части (первая выделяется, остальные свободны)
+		glm::uvec2 parent;
+		if (!this->allocateCell(level - 1, &parent)) {
+			return false;
+		}
+
+		GLuint size = this->getCellSize(level);
+		this->freeCells_[level].push_back(parent + glm::uvec2(size, 0));
+		this->freeCells_[level].push_back(parent + glm::uvec2(0, size));
+		this->freeCells_[level].push_back(parent + glm::uvec2(size, size));
+
+		*position = parent;
+		return true;
+	}
+
+	/**
+	* \brief Освободить ячейку
+	* \details Если все 4 ячейки одной родительской свободны - они объединяются
+	* \param level Уровень
+	* \param position Положение ячейки
+	*/
+	void ShadowAtlas::freeCell(GLuint level, const glm::uvec2& position)
+	{
+		if (level > 0)
+		{
+			// Положение родительской ячейки и соседних ячеек того же уровня
+			GLuint size = this->getCellSize(level);
+			GLuint parentSize = this->getCellSize(level - 1);
+			glm::uvec2 parent = (position / parentSize) * parentSize;
+
+			std::vector<glm::uvec2>& cells = this->freeCells_[level];
+			std::vector<std::vector<glm::uvec2>::iterator> siblings;
+
+			for (GLuint i = 0; i < 4; i++)
+			{
+				glm::uvec2 sibling = parent + glm::uvec2((i & 1) * size, (i >> 1) * size);
+				if (sibling == position) continue;
+
+				auto it = std::find(cells.begin(), cells.end(), sibling);
+				if (it == cells.end()) break;
+				siblings.push_back(it);
+			}
+
+			// Если все соседние ячейки свободны - объединить их в родительскую
+			if (siblings.size() == 3)
+			{
+				cells.erase(std::remove_if(cells.begin(), cells.end(), [&](const glm::uvec2& cell)
+				{
+					return (cell / parentSize) * parentSize == parent;
+				}), cells.end());
+
+				this->freeCell(level - 1, parent);
+				return;
+			}
+		}
+
+		this->freeCells_[level].push_back(position);
+	}
+
+	/**
+	* \brief Освободить все ячейки источника
+	* \param entry Запись источника
+	*/
+	void ShadowAtlas::freeTiles(Entry* entry)
+	{
+		for (const ShadowAtlasTile& tile : entry->tiles) {
+			this->freeCell(tile.level, tile.position);
+		}
+
+		entry->tiles.clear();
+	}
+
+	/**
+	* \brief Выделить ячейки источнику
+	* \details Если ячеек нужного уровня не хватает - пробуются меньшие уровни
+	* \param entry Запись источника
+	* \param count Кол-во ячеек
+	* \param level Желаемый уровень
+	* \return Удалось ли выделить
+	*/
+	bool ShadowAtlas::allocateTiles(Entry* entry, GLuint count, GLuint level)
+	{
+		for (GLuint l = level; l < this->levelCount_; l++)
+		{
+			for (GLuint i = 0; i < count; i++)
+			{
+				ShadowAtlasTile tile = {};
+				tile.level = l;
+				tile.size = this->getCellSize(l);
+				tile.dirty = true;
+
+				if (!this->allocateCell(l, &(tile.position))) break;
+				entry->tiles.push_back(tile);
+			}
+
+			// Все ячейки выделены
+			if (entry->tiles.size() == count) {
+				return true;
+			}
+
+			// Не хватило места - вернуть выделенное и попробовать меньший уровень
+			this->freeTiles(entry);
+		}
+
+		return false;
+	}
+
+	/**
+	* \brief Подсчитать матрицы вида-проекции ячеек источника
+	* \param light Источник
+	* \param matrices Массив для записи матриц (1 для прожектора, 6 для точечного источника)
+	*/
+	void ShadowAtlas::calculateMatrices(const Light& light, std::vector<glm::mat4>* matrices)
+	{
+		glm::mat4 projection = light.getProjectionMatrix(0.1f, light.getRange());
+		matrices->clear();
+
+		// Прожектор - одна проекция по направлению источника
+		if (light.getType() == LightType::SPOT_LIGHT) {
+			matrices->push_back(projection * light.getViewMatrix());
+			return;
+		}
+
+		// Точечный источник - 6 граней куба (+X, -X, +Y, -Y, +Z, -Z), порядок важен для выбора грани в шейдере
+		const glm::vec3 directions[6] = { { 1,0,0 },{ -1,0,0 },{ 0,1,0 },{ 0,-1,0 },{ 0,0,1 },{ 0,0,-1 } };
+		const glm::vec3 ups[6] = { { 0,1,0 },{ 0,1,0 },{ 0,0,1 },{ 0,0,1 },{ 0,1,0 },{ 0,1,0 } };
+
+		for (unsigned int i = 0; i < 6; i++) {
+			matrices->push_back(projection * glm::lookAt(light.position, light.position + directions[i], ups[i]));
+		}
+	}
+
+	/**
+	* \brief Конструктор
+	* \param size Размер атласа (в текселях)
+	* \param minTileSize Минимальный размер ячейки
+	* \param maxTileSize Максимальный размер ячейки
+	*/
+	ShadowAtlas::ShadowAtlas(GLuint size, GLuint minTileSize, GLuint maxTileSize) :
+		frameBufferId_(0),
+		textureId_(0),
+		size_(size),
+		maxTileSize_(glm::min(maxTileSize, size)),
+		levelCount_(1),
+		staleTileCount_(0)
+	{
+		// Инициализация GLEW
+		if (!_isGlewInitialised) {
+			glewExperimental = GL_TRUE;
+			_isGlewInitialised = glewInit() == GLEW_OK;
+		}
+
+		if (!_isGlewInitialised) {
+			throw std::runtime_error("OpenGL:ShadowAtlas: Glew is not initialised");
+		}
+
+		if (minTileSize == 0 || minTileSize > this->maxTileSize_) {
+			throw std::runtime_error("OpenGL:ShadowAtlas: Wrong tile sizes");
+		}
+
+		// Кол-во уровней размера (каждый следующий уровень в 2 раза меньше)
+		while ((this->maxTileSize_ >> this->levelCount_) >= minTileSize) this->levelCount_++;
+
+		// Изначально свободны все ячейки максимального размера
+		this->freeCells_.resize(this->levelCount_);
+		for (GLuint y = 0; y + this->maxTileSize_ <= size; y += this->maxTileSize_) {
+			for (GLuint x = 0; x + this->maxTileSize_ <= size; x += this->maxTileSize_) {
+				this->freeCells_[0].push_back({ x, y });
+			}
+		}
+
+		// Текстура глубины (режим сравнения дает аппаратную PCF-фильтрацию)
+		GpuMemory::get().allocate(GPU_MEMORY_SHADOW_MAPS, static_cast<GLuint64>(size) * size * 4);
+		glGenTextures(1, &(this->textureId_));
+		glBindTexture(GL_TEXTURE_2D, this->textureId_);
+		glTexImage2D(GL_TEXTURE_2D, 0, GL_DEPTH_COMPONENT24, size, size, 0, GL_DEPTH_COMPONENT, GL_FLOAT, nullptr);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MIN_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_S, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_WRAP_T, GL_CLAMP_TO_EDGE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_MODE, GL_COMPARE_REF_TO_TEXTURE);
+		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_COMPARE_FUNC, GL_LEQUAL);
+		glBindTexture(GL_TEXTURE_2D, 0);
+
+		// Фрейм-буфер без цветовых вложений
+		glGenFramebuffers(1, &(this->frameBufferId_));
+		glBindFramebuffer(GL_FRAMEBUFFER, this->frameBufferId_);
+		glFramebufferTexture2D(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_TEXTURE_2D, this->textureId_, 0);
+		glDrawBuffer(GL_NONE);
+		glReadBuffer(GL_NONE);
+
+		// Если фрейм-буфер не готов
+		if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+			throw std::runtime_error("OpenGL:ShadowAtlas: Frame buffer can't be initialized");
+		}
+
+		// Очистить атлас целиком (далее ячейки очищаются по отдельности)
+		glClear(GL_DEPTH_BUFFER_BIT);
+
+		// Прекращаем работу с фрейм-буфером
+		glBindFramebuffer(GL_FRAMEBUFFER, 0);
+	}
+
+	/**
+	* \brief Деструктор
+	* \details Уничтожает OpenGL объекты
+	*/
+	ShadowAtlas::~ShadowAtlas()
+	{
+		if (this->textureId_) {
+			glDeleteTextures(1, &(this->textureId_));
+			GpuMemory::get().release(GPU_MEMORY_SHADOW_MAPS, static_cast<GLuint64>(this->size_) * this->size_ * 4);
+		}
+		if (this->frameBufferId_) glDeleteFramebuffers(1, &(this->frameBufferId_));
+	}
+
+	/**
+	* \brief Обновить распределение ячеек и выбрать ячейки для перерисовки
+	* \details Должно вызываться раз в кадр, после обновления состояния положения источников и мешей
+	* \param lights Источники освещения (учитываются прожекторы и точечные источники, отбрасывающие тени)
+	* \param meshes Статические меши сцены
+	* \param view Матрица вида камеры
+	* \param projection Матрица проекции камеры
+	* \param viewportHeight Высота области вида (в пикселях)
+	* \param budget Максимальное кол-во перерисовываемых за кадр ячеек
+	*/
+	void ShadowAtlas::update(const std::vector<LightPtr>& lights, const std::vector<StaticMeshPtr>& meshes, const glm::mat4& view, const glm::mat4& projection, GLuint viewportHeight, GLuint budget)
+	{
+		// Ограничивающие объемы движущихся мешей (в текущем и предыдущем положении - тень должна исчезнуть и там и там)
+		std::vector<BoundingBox> movingBoxes;
+		std::map<const StaticMesh*, BoundingBox> currentBounds;
+
+		for (auto& mesh : meshes)
+		{
+			glm::mat4 modelMatrix = mesh->getModelMatrix();
+			BoundingBox box = { glm::vec3(FLT_MAX), glm::vec3(-FLT_MAX) };
+			for (auto& part : mesh->getParts()) {
+				BoundingBox partBox = part.getGeometry()->getBounds().transformed(modelMatrix);
+				box.min = glm::min(box.min, partBox.min);
+				box.max = glm::max(box.max, partBox.max);
+			}
+			currentBounds[mesh.get()] = box;
+
+			auto last = this->lastBounds_.find(mesh.get());
+			if (mesh->isTransformChanged() || last == this->lastBounds_.end()) {
+				movingBoxes.push_back(box);
+				if (last != this->lastBounds_.end()) movingBoxes.push_back(last->second);
+			}
+		}
+
+		// Удаленные меши тоже меняют тени
+		for (auto& last : this->lastBounds_) {
+			if (currentBounds.find(last.first) == currentBounds.end()) movingBoxes.push_back(last.second);
+		}
+
+		this->lastBounds_ = currentBounds;
+
+		// Отметить все записи как отсутствующие (актуальные будут отмечены ниже)
+		for (auto& entry : this->entries_) entry.second.present = false;
+
+		// Источники, которым нужны ячейки, и желаемый уровень ячеек
+		struct Candidate { const Light* light; Entry* entry; GLuint count; GLuint level; };
+		std::vector<Candidate> candidates;
+
+		for (auto& light : lights)
+		{
+			if (light == nullptr || !light->shadows || light->getType() == LightType::DIRECTIONAL_LIGHT) continue;
+
+			Entry& entry = this->entries_[light.get()];
+			entry.present = true;
+
+			// Важность - радиус области действия источника на экране (в пикселях)
+			GLfloat range = light->getRange();
+			glm::vec3 viewPosition = glm::vec3(view * glm::vec4(light->position, 1.0f));
+			GLfloat distance = glm::length(viewPosition);
+
+			if (viewPosition.z - range > 0.0f) entry.importance = 0.0f;
+			else if (distance <= range) entry.importance = static_cast<GLfloat>(viewportHeight);
+			else entry.importance = (range / distance) * projection[1][1] * static_cast<GLfloat>(viewportHeight) * 0.5f;
+
+			// Желаемый размер ячейки (точечный источник делит разрешение на 6 граней)
+			GLuint count = light->getType() == LightType::POINT_LIGHT ? 6 : 1;
+			GLfloat desiredSize = entry.importance * (count == 6 ? 1.0f : 2.0f);
+
+			GLuint level = 0;
+			while (level + 1 < this->levelCount_ && static_cast<GLfloat>(this->getCellSize(level + 1)) >= desiredSize) level++;
+
+			candidates.push_back({ light.get(), &entry, count, level });
+		}
+
+		// Освободить ячейки источников, которых больше нет (или которые больше не отбрасывают тени)
+		for (auto it = this->entries_.begin(); it != this->entries_.end();) {
+			if (!it->second.present) {
+				this->freeTiles(&(it->second));
+				it = this->entries_.erase(it);
+			}
+			else ++it;
+		}
+
+		// Важные источники получают ячейки первыми
+		std::sort(candidates.begin(), candidates.end(), [](const Candidate& a, const Candidate& b)
+		{
+			return a.entry->importance > b.entry->importance;
+		});
+
+		// Сначала освободить ячейки, размер которых должен измениться, затем выделить новые
+		std::vector<bool> reallocate(candidates.size(), false);
+		for (size_t i = 0; i < candidates.size(); i++)
+		{
+			Entry* entry = candidates[i].entry;
+			if (entry->tiles.size() != candidates[i].count || entry->tiles[0].level != candidates[i].level) {
+				this->freeTiles(entry);
+				reallocate[i] = true;
+			}
+		}
+
+		for (size_t i = 0; i < candidates.size(); i++) {
+			if (reallocate[i]) this->allocateTiles(candidates[i].entry, candidates[i].count, candidates[i].level);
+		}
+
+		// Обновить матрицы и определить какие ячейки нужно перерисовать
+		std::vector<glm::mat4> matrices;
+		std::vector<std::pair<ShadowAtlasTile*, GLfloat>> dirtyTiles;
+
+		for (const Candidate& candidate : candidates)
+		{
+			const Light& light = *candidate.light;
+			ShadowAtlas::calculateMatrices(light, &matrices);
+
+			// Изменилось ли положение источника, либо двигались ли объекты в области его действия
+			bool changed = light.isTransformChanged();
+			GLfloat range = light.getRange();
+
+			for (size_t i = 0; i < movingBoxes.size() && !changed; i++) {
+				glm::vec3 closest = glm::clamp(light.position, movingBoxes[i].min, movingBoxes[i].max);
+				changed = glm::length(closest - light.position) <= range;
+			}
+
+			for (size_t i = 0; i < candidate.entry->tiles.size(); i++)
+			{
+				ShadowAtlasTile& tile = candidate.entry->tiles[i];
+				tile.matrix = matrices[i];
+				if (changed) tile.dirty = true;
+				if (tile.dirty) dirtyTiles.push_back({ &tile, candidate.entry->importance });
+			}
+		}
+
+		// Сначала рисуются ячейки без содержимого, затем - по убыванию важности источника
+		std::stable_sort(dirtyTiles.begin(), dirtyTiles.end(), [](const std::pair<ShadowAtlasTile*, GLfloat>& a, const std::pair<ShadowAtlasTile*, GLfloat>& b)
+		{
+			if (a.first->rendered != b.first->rendered) return !a.first->rendered;
+			return a.second > b.second;
+		});
+
+		// Выбрать ячейки в пределах ограничения, остальные будут перерисованы в следующих кадрах
+		this->pendingTiles_.clear();
+		for (size_t i = 0; i < dirtyTiles.size() && i < budget; i++) {
+			this->pendingTiles_.push_back(dirtyTiles[i].first);
+		}
+
+		this->staleTileCount_ = static_cast<GLuint>(dirtyTiles.size() - this->pendingTiles_.size());
+	}
+
+	/**
+	* \brief Получить ячейки, которые нужно нарисовать в этом кадре
+	* \return Массив указателей на ячейки
+	*/
+	const std::vector<ShadowAtlasTile*>& ShadowAtlas::getPendingTiles() const
+	{
+		return this->pendingTiles_;
+	}
+
+	/**
+	* \brief Отметить ячейку как нарисованную
+	* \param tile Ячейка
+	*/
+	void ShadowAtlas::markRendered(ShadowAtlasTile* tile)
+	{
+		tile->renderedMatrix = tile->matrix;
+		tile->rendered = true;
+		tile->dirty = false;
+	}
+
+	/**
+	* \brief Получить ячейки источника
+	* \param light Источник
+	* \return Указатель на массив ячеек (nullptr, если источнику ячейки не выделены)
+	*/
+	const std::vector<ShadowAtlasTile>* ShadowAtlas::getTiles(const Light* light) const
+	{
+		auto it = this->entries_.find(light);
+		if (it == this->entries_.end() || it->second.tiles.empty()) return nullptr;
+		return &(it->second.tiles);
+	}
+
+	/**
+	* \brief Кол-во ячеек, перерисовка которых отложена в этом кадре (из-за ограничения)
+	* \return Число ячеек
+	*/
+	GLuint ShadowAtlas::getStaleTileCount() const
+	{
+		return this->staleTileCount_;
+	}
+
+	/**
+	* \brief Получить ID фрейм-буфера атласа
+	* \return Число-идентификатор
+	*/
+	GLuint ShadowAtlas::getFrameBufferId() const
+	{
+		return this->frameBufferId_;
+	}
+
+	/**
+	* \brief Получить ID текстуры атласа
+	* \return Число-идентификатор
+	*/
+	GLuint ShadowAtlas::getTextureId() const
+	{
+		return this->textureId_;
+	}
+
+	/**
+	* \brief Получить размер атласа
+	* \return Размер стороны (в текселях)
+	*/
+	GLuint ShadowAtlas::getSize() const
+	{
+		return this->size_;
+	}
+
+	/**
+	* \brief Создание атласа карт теней
+	* \param size Размер атласа (в текселях)
+	* \param minTileSize Минимальный размер ячейки
+	* \param maxTileSize Максимальный размер ячейки
+	* \return Умный указатель на атлас
+	*/
+	ShadowAtlasPtr MakeShadowAtlas(GLuint size, GLuint minTileSize, GLuint maxTileSize)
+	{
+		return std::make_shared<ShadowAtlas>(size, minTileSize, maxTileSize);
+	}
+}
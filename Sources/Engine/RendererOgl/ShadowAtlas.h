@@ -0,0 +1,218 @@
+﻿#pragma once
+
+#include <vector>
+#include <map>
+#include <memory>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Light.h"
+#include "StaticMesh.h"
+
+namespace ogl
+{
+	/**
+	 * \brief Ячейка атласа карт теней
+	 * \details Прожектор занимает одну ячейку, точечный источник - шесть (по ячейке на грань куба)
+	 */
+	struct ShadowAtlasTile
+	{
+		glm::uvec2 position;       // Положение в атласе (в текселях)
+		GLuint size;               // Размер стороны (в текселях)
+		GLuint level;              // Уровень размера (0 - максимальный размер ячейки)
+		glm::mat4 matrix;          // Матрица вида-проекции для текущего положения источника
+		glm::mat4 renderedMatrix;  // Матрица, с которой было нарисовано содержимое ячейки
+		bool rendered;             // Есть ли в ячейке содержимое
+		bool dirty;                // Требуется ли перерисовка содержимого
+
+		/**
+		 * \brief Получить область ячейки в текстурных координатах атласа
+		 * \param atlasSize Размер атласа
+		 * \return Вектор (xy - сдвиг, zw - масштаб)
+		 */
+		glm::vec4 getRect(GLuint atlasSize) const
+		{
+			return glm::vec4(glm::vec2(this->position), glm::vec2(static_cast<GLfloat>(this->size))) / static_cast<GLfloat>(atlasSize);
+		}
+	};
+
+	/**
+	 * \brief Атлас карт теней
+	 * \details Карты теней множества прожекторов и точечных источников упаковываются в одну большую текстуру глубины.
+	 * Размер ячеек зависит от размера области действия источника на экране. Ячейки неподвижных источников, в области
+	 * действия которых не двигались объекты, не перерисовываются. Кол-во перерисовываемых за кадр ячеек ограничено
+	 */
+	class ShadowAtlas
+	{
+	private:
+		GLuint frameBufferId_;        // ID фрейм-буфера
+		GLuint textureId_;            // ID текстуры глубины
+		GLuint size_;                 // Размер атласа (в текселях)
+		GLuint maxTileSize_;          // Максимальный размер ячейки
+		GLuint levelCount_;           // Кол-во уровней размера ячеек (каждый следующий уровень в 2 раза меньше)
+
+		/**
+		 * \brief Свободные ячейки каждого уровня
+		 * \details Выделение ячеек организовано по принципу "близнецов" - ячейка делится на 4 меньших, освобожденные соседние
+		 * ячейки объединяются обратно (это позволяет избежать фрагментации атласа)
+		 */
+		std::vector<std::vector<glm::uvec2>> freeCells_;
+
+		/**
+		 * \brief Ячейки источника и его важность в текущем кадре
+		 */
+		struct Entry {
+			std::vector<ShadowAtlasTile> tiles;
+			GLfloat importance;
+			bool present;
+		};
+
+		std::map<const Light*, Entry> entries_;                    // Ячейки источников
+		std::map<const StaticMesh*, BoundingBox> lastBounds_;      // Ограничивающие объемы мешей в предыдущем кадре
+		std::vector<ShadowAtlasTile*> pendingTiles_;               // Ячейки, которые нужно нарисовать в этом кадре
+		GLuint staleTileCount_;                                    // Ячейки, перерисовка которых отложена из-за ограничения
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		ShadowAtlas(const ShadowAtlas& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const ShadowAtlas& other) = delete;
+
+		/**
+		 * \brief Получить размер ячейки уровня
+		 * \param level Уровень
+		 * \return Размер стороны (в текселях)
+		 */
+		GLuint getCellSize(GLuint level) const;
+
+		/**
+		 * \brief Выделить ячейку
+		 * \details Если свободных ячеек уровня нет - делится ячейка большего уровня
+		 * \param level Уровень
+		 * \param position Указатель на положение выделенной ячейки
+		 * \return Удалось ли выделить
+		 */
+		bool allocateCell(GLuint level, glm::uvec2* position);
+
+		/**
+		 * \brief Освободить ячейку
+		 * \details Если все 4 ячейки одной родительской свободны - они объединяются
+		 * \param level Уровень
+		 * \param position Положение ячейки
+		 */
+		void freeCell(GLuint level, const glm::uvec2& position);
+
+		/**
+		 * \brief Освободить все ячейки источника
+		 * \param entry Запись источника
+		 */
+		void freeTiles(Entry* entry);
+
+		/**
+		 * \brief Выделить ячейки источнику
+		 * \details Если ячеек нужного уровня не хватает - пробуются меньшие уровни
+		 * \param entry Запись источника
+		 * \param count Кол-во ячеек
+		 * \param level Желаемый уровень
+		 * \return Удалось ли выделить
+		 */
+		bool allocateTiles(Entry* entry, GLuint count, GLuint level);
+
+		/**
+		 * \brief Подсчитать матрицы вида-проекции ячеек источника
+		 * \param light Источник
+		 * \param matrices Массив для записи матриц (1 для прожектора, 6 для точечного источника)
+		 */
+		static void calculateMatrices(const Light& light, std::vector<glm::mat4>* matrices);
+
+	public:
+		/**
+		 * \brief Конструктор
+		 * \param size Размер атласа (в текселях)
+		 * \param minTileSize Минимальный размер ячейки
+		 * \param maxTileSize Максимальный размер ячейки
+		 */
+		ShadowAtlas(GLuint size = 4096, GLuint minTileSize = 128, GLuint maxTileSize = 1024);
+
+		/**
+		 * \brief Деструктор
+		 * \details Уничтожает OpenGL объекты
+		 */
+		~ShadowAtlas();
+
+		/**
+		 * \brief Обновить распределение ячеек и выбрать ячейки для перерисовки
+		 * \details Должно вызываться раз в кадр, после обновления состояния положения источников и мешей
+		 * \param lights Источники освещения (учитываются прожекторы и точечные источники, отбрасывающие тени)
+		 * \param meshes Статические меши сцены
+		 * \param view Матрица вида камеры
+		 * \param projection Матрица проекции камеры
+		 * \param viewportHeight Высота области вида (в пикселях)
+		 * \param budget Максимальное кол-во перерисовываемых за кадр ячеек
+		 */
+		void update(const std::vector<LightPtr>& lights, const std::vector<StaticMeshPtr>& meshes, const glm::mat4& view, const glm::mat4& projection, GLuint viewportHeight, GLuint budget);
+
+		/**
+		 * \brief Получить ячейки, которые нужно нарисовать в этом кадре
+		 * \return Массив указателей на ячейки
+		 */
+		const std::vector<ShadowAtlasTile*>& getPendingTiles() const;
+
+		/**
+		 * \brief Отметить ячейку как нарисованную
+		 * \param tile Ячейка
+		 */
+		static void markRendered(ShadowAtlasTile* tile);
+
+		/**
+		 * \brief Получить ячейки источника
+		 * \param light Источник
+		 * \return Указатель на массив ячеек (nullptr, если источнику ячейки не выделены)
+		 */
+		const std::vector<ShadowAtlasTile>* getTiles(const Light* light) const;
+
+		/**
+		 * \brief Кол-во ячеек, перерисовка которых отложена в этом кадре (из-за ограничения)
+		 * \return Число ячеек
+		 */
+		GLuint getStaleTileCount() const;
+
+		/**
+		 * \brief Получить ID фрейм-буфера атласа
+		 * \return Число-идентификатор
+		 */
+		GLuint getFrameBufferId() const;
+
+		/**
+		 * \brief Получить ID текстуры атласа
+		 * \return Число-идентификатор
+		 */
+		GLuint getTextureId() const;
+
+		/**
+		 * \brief Получить размер атласа
+		 * \return Размер стороны (в текселях)
+		 */
+		GLuint getSize() const;
+	};
+
+	/**
+	 * \brief Тип для умного указателя на атлас
+	 */
+	typedef std::shared_ptr<ShadowAtlas> ShadowAtlasPtr;
+
+	/**
+	 * \brief Создание атласа карт теней
+	 * \param size Размер атласа (в текселях)
+	 * \param minTileSize Минимальный размер ячейки
+	 * \param maxTileSize Максимальный размер ячейки
+	 * \return Умный указатель на атлас
+	 */
+	ShadowAtlasPtr MakeShadowAtlas(GLuint size = 4096, GLuint minTileSize = 128, GLuint maxTileSize = 1024);
+}
@@ -0,0 +1,328 @@
+﻿#include "ShadowVolume.h"
+#include "RenderStats.h"
+#include "GpuMemory.h"
+#include <thread>
+#include <functional>
+#include <stdexcept>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE__)
+#define OGL_SHADOW_VOLUME_SSE
+#include <xmmintrin.h>
+#endif
+
+// Минимальное кол-во полигонов на один поток (меньшие объемы работы нет смысла распараллеливать)
+#define SHADOW_VOLUME_TRIANGLES_PER_THREAD 8192
+
+namespace ogl
+{
+	/**
+	* \brief Проинициализирован ли GLEW
+	*/
+	extern bool _isGlewInitialised;
+
+	/**
+	* \brief Вытянуть вершину в бесконечность по направлению от источника
+	* \param position Положение вершины
+	* \param lightLocal Положение источника (w = 0 для направленного источника - тогда это вектор к источнику)
+	* \return Вершина в однородных координатах (w = 0)
+	*/
+	static inline glm::vec4 extrude(const glm::vec3& position, const glm::vec4& lightLocal)
+	{
+		return lightLocal.w == 0.0f ? glm::vec4(-glm::vec3(lightLocal), 0.0f) : glm::vec4(position - glm::vec3(lightLocal), 0.0f);
+	}
+
+	/**
+	* \brief Определить какие полигоны обращены к источнику
+	* \details Полигоны обрабатываются пакетами по 4 (SSE), если инструкции доступны
+	* \param caster Данные геометрии
+	* \param lightLocal Положение источника в пространстве модели (w = 0 для направленного источника - тогда это вектор к источнику)
+	* \param begin Первый полигон (кратен 4)
+	* \param end Полигон, следующий за последним
+	* \param facing Массив для записи результата (1 - обращен к источнику)
+	*/
+	void ShadowVolume::calculateFacing(const ShadowCasterData& caster, const glm::vec4& lightLocal, size_t begin, size_t end, GLubyte* facing)
+	{
+		// Полигон обращен к источнику, если dot(n, 3*L - (v0+v1+v2)) > 0, т.е. 3*dot(n,L) - w*dot(n,v0+v1+v2) > 0
+		// Для направленного источника (w = 0) остается только знак dot(n,L), где L - вектор к источнику
+		GLfloat lx = lightLocal.x * 3.0f;
+		GLfloat ly = lightLocal.y * 3.0f;
+		GLfloat lz = lightLocal.z * 3.0f;
+		GLfloat lw = lightLocal.w;
+
+		size_t i = begin;
+
+#ifdef OGL_SHADOW_VOLUME_SSE
+		// Массивы данных дополнены до кратности 4, поэтому можно читать пакетами без проверки границ
+		__m128 vlx = _mm_set1_ps(lx);
+		__m128 vly = _mm_set1_ps(ly);
+		__m128 vlz = _mm_set1_ps(lz);
+		__m128 vlw = _mm_set1_ps(lw);
+		__m128 zero = _mm_setzero_ps();
+
+		for (; i + 4 <= end; i += 4)
+		{
+			__m128 d = _mm_mul_ps(_mm_loadu_ps(&caster.normalX[i]), vlx);
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(&caster.normalY[i]), vly));
+			d = _mm_add_ps(d, _mm_mul_ps(_mm_loadu_ps(&caster.normalZ[i]), vlz));
+			d = _mm_sub_ps(d, _mm_mul_ps(_mm_loadu_ps(&caster.centroidDot[i]), vlw));
+
+			// Маска результатов сравнения (по биту на полигон)
+			int mask = _mm_movemask_ps(_mm_cmpgt_ps(d, zero));
+			facing[i + 0] = static_cast<GLubyte>(mask & 1);
+			facing[i + 1] = static_cast<GLubyte>((mask >> 1) & 1);
+			facing[i + 2] = static_cast<GLubyte>((mask >> 2) & 1);
+			facing[i + 3] = static_cast<GLubyte>((mask >> 3) & 1);
+		}
+#endif
+
+		// Оставшиеся полигоны (или все, если SSE недоступен)
+		for (; i < end; i++)
+		{
+			GLfloat d = caster.normalX[i] * lx + caster.normalY[i] * ly + caster.normalZ[i] * lz - caster.centroidDot[i] * lw;
+			facing[i] = d > 0.0f ? 1 : 0;
+		}
+	}
+
+	/**
+	* \brief Построить боковые стороны объема для диапазона ребер
+	* \param caster Данные геометрии
+	* \param lightLocal Положение источника в пространстве модели
+	* \param facing Обращенность полигонов к источнику
+	* \param begin Первое ребро
+	* \param end Ребро, следующее за последним
+	* \param vertices Массив для добавления вершин
+	*/
+	void ShadowVolume::buildSides(const ShadowCasterData& caster, const glm::vec4& lightLocal, const GLubyte* facing, size_t begin, size_t end, std::vector<glm::vec4>* vertices)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			const AdjacencyEdge& edge = caster.edges[i];
+
+			// Обращенность полигонов по обе стороны ребра (граничное ребро считается смежным с необращенным полигоном)
+			bool facing0 = facing[edge.triangle0] != 0;
+			bool facing1 = edge.triangle1 >= 0 && facing[edge.triangle1] != 0;
+
+			// Ребро не является силуэтным
+			if (facing0 == facing1) continue;
+
+			// Ребро ориентируется по обходу обращенного к источнику полигона (у смежного полигона обход ребра обратный)
+			const glm::vec3& a = caster.positions[facing0 ? edge.v0 : edge.v1];
+			const glm::vec3& b = caster.positions[facing0 ? edge.v1 : edge.v0];
+			glm::vec4 aExtruded = extrude(a, lightLocal);
+			glm::vec4 bExtruded = extrude(b, lightLocal);
+
+			// Квад боковой стороны (так же, как в геометрическом шейдере теневых объемов)
+			vertices->push_back(glm::vec4(a, 1.0f));
+			vertices->push_back(aExtruded);
+			vertices->push_back(glm::vec4(b, 1.0f));
+			vertices->push_back(glm::vec4(b, 1.0f));
+			vertices->push_back(aExtruded);
+			vertices->push_back(bExtruded);
+		}
+	}
+
+	/**
+	* \brief Построить крышки объема для диапазона полигонов
+	* \param caster Данные геометрии
+	* \param lightLocal Положение источника в пространстве модели
+	* \param facing Обращенность полигонов к источнику
+	* \param begin Первый полигон
+	* \param end Полигон, следующий за последним
+	* \param vertices Массив для добавления вершин
+	*/
+	void ShadowVolume::buildCaps(const ShadowCasterData& caster, const glm::vec4& lightLocal, const GLubyte* facing, size_t begin, size_t end, std::vector<glm::vec4>* vertices)
+	{
+		for (size_t i = begin; i < end; i++)
+		{
+			if (!facing[i]) continue;
+
+			const glm::vec3& v0 = caster.positions[caster.triangles[i * 3 + 0]];
+			const glm::vec3& v1 = caster.positions[caster.triangles[i * 3 + 1]];
+			const glm::vec3& v2 = caster.positions[caster.triangles[i * 3 + 2]];
+
+			// Передняя крышка - сам полигон
+			vertices->push_back(glm::vec4(v0, 1.0f));
+			vertices->push_back(glm::vec4(v1, 1.0f));
+			vertices->push_back(glm::vec4(v2, 1.0f));
+
+			// Задняя крышка - полигон, вытянутый в бесконечность (с обратным обходом)
+			vertices->push_back(extrude(v0, lightLocal));
+			vertices->push_back(extrude(v2, lightLocal));
+			vertices->push_back(extrude(v1, lightLocal));
+		}
+	}
+
+	/**
+	* \brief Конструктор
+	* \details Создает пустой объем (OpenGL объекты создаются сразу, данные загружаются при построении)
+	*/
+	ShadowVolume::ShadowVolume() :
+		vaoId_(0),
+		vboId_(0),
+		vboCapacity_(0),
+		sidesVertexCount_(0),
+		capsVertexCount_(0)
+	{
+		// Инициализация GLEW
+		if (!_isGlewInitialised) {
+			glewExperimental = GL_TRUE;
+			_isGlewInitialised = glewInit() == GLEW_OK;
+		}
+
+		if (!_isGlewInitialised) {
+			throw std::runtime_error("OpenGL:ShadowVolume: Glew is not initialised");
+		}
+
+		// Создать VAO и VBO
+		glGenVertexArrays(1, &vaoId_);
+		glGenBuffers(1, &vboId_);
+
+		// Работаем с VAO
+		glBindVertexArray(vaoId_);
+		glBindBuffer(GL_ARRAY_BUFFER, vboId_);
+
+		// Аттрибут "положение" (однородные координаты)
+		glVertexAttribPointer(0, 4, GL_FLOAT, GL_FALSE, sizeof(glm::vec4), nullptr);
+		glEnableVertexAttribArray(0);
+
+		// Завершаем работу с VAO
+		glBindVertexArray(0);
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	/**
+	* \brief Деструктор
+	* \details Уничтожает OpenGL объекты (VAO, VBO)
+	*/
+	ShadowVolume::~ShadowVolume()
+	{
+		if (this->vboId_) glDeleteBuffers(1, &vboId_);
+		if (this->vaoId_) glDeleteVertexArrays(1, &vaoId_);
+		GpuMemory::get().release(GPU_MEMORY_DYNAMIC_BUFFERS, static_cast<GLuint64>(this->vboCapacity_) * sizeof(glm::vec4));
+	}
+
+	/**
+	* \brief Построить теневой объем и загрузить его в видео-память
+	* \details Поиск силуэтных ребер ведется на CPU, при большом кол-ве полигонов - в нескольких потоках
+	* \param caster Данные геометрии (см. StaticGeometryResource::getShadowCasterData)
+	* \param lightLocal Положение источника в пространстве модели (w = 0 для направленного источника - тогда это вектор к источнику)
+	*/
+	void ShadowVolume::build(const ShadowCasterData& caster, const glm::vec4& lightLocal)
+	{
+		size_t triangleCount = caster.getTriangleCount();
+		size_t edgeCount = caster.edges.size();
+
+		// Кол-во потоков зависит от объема работы (не более чем кол-во аппаратных потоков)
+		size_t threadCount = glm::max<size_t>(1, glm::min<size_t>(std::thread::hardware_concurrency(), triangleCount / SHADOW_VOLUME_TRIANGLES_PER_THREAD));
+
+		// Обращенность полигонов к источнику (массив дополнен до кратности 4, как и данные геометрии)
+		this->facing_.resize(caster.normalX.size());
+		GLubyte* facing = this->facing_.data();
+
+		this->vertices_.clear();
+		this->sidesVertexCount_ = 0;
+		this->capsVertexCount_ = 0;
+
+		if (threadCount == 1)
+		{
+			// Однопоточный вариант - все этапы по порядку
+			ShadowVolume::calculateFacing(caster, lightLocal, 0, triangleCount, facing);
+			ShadowVolume::buildSides(caster, lightLocal, facing, 0, edgeCount, &(this->vertices_));
+			this->sidesVertexCount_ = static_cast<GLuint>(this->vertices_.size());
+			ShadowVolume::buildCaps(caster, lightLocal, facing, 0, triangleCount, &(this->vertices_));
+		}
+		else
+		{
+			std::vector<std::thread> threads;
+			std::vector<std::vector<glm::vec4>> sides(threadCount);
+			std::vector<std::vector<glm::vec4>> caps(threadCount);
+
+			// Диапазоны полигонов для потоков (границы кратны 4, чтобы пакеты не пересекались)
+			size_t trianglesPerThread = ((triangleCount / threadCount) + 3) & ~static_cast<size_t>(3);
+			size_t edgesPerThread = (edgeCount + threadCount - 1) / threadCount;
+
+			// Этап 1 - обращенность полигонов (каждый поток пишет в свой диапазон)
+			for (size_t t = 0; t < threadCount; t++)
+			{
+				size_t begin = glm::min(t * trianglesPerThread, triangleCount);
+				size_t end = t + 1 == threadCount ? triangleCount : glm::min(begin + trianglesPerThread, triangleCount);
+				threads.emplace_back(&ShadowVolume::calculateFacing, std::cref(caster), std::cref(lightLocal), begin, end, facing);
+			}
+			for (auto& thread : threads) thread.join();
+			threads.clear();
+
+			// Этап 2 - боковые стороны и крышки (каждый поток заполняет свои массивы)
+			for (size_t t = 0; t < threadCount; t++)
+			{
+				size_t edgeBegin = glm::min(t * edgesPerThread, edgeCount);
+				size_t edgeEnd = glm::min(edgeBegin + edgesPerThread, edgeCount);
+				size_t triangleBegin = glm::min(t * trianglesPerThread, triangleCount);
+				size_t triangleEnd = t + 1 == threadCount ? triangleCount : glm::min(triangleBegin + trianglesPerThread, triangleCount);
+
+				threads.emplace_back([&, t, edgeBegin, edgeEnd, triangleBegin, triangleEnd]()
+				{
+					ShadowVolume::buildSides(caster, lightLocal, facing, edgeBegin, edgeEnd, &(sides[t]));
+					ShadowVolume::buildCaps(caster, lightLocal, facing, triangleBegin, triangleEnd, &(caps[t]));
+				});
+			}
+			for (auto& thread : threads) thread.join();
+
+			// Собрать результаты потоков (сначала все боковые стороны, затем все крышки)
+			for (auto& part : sides) this->vertices_.insert(this->vertices_.end(), part.begin(), part.end());
+			this->sidesVertexCount_ = static_cast<GLuint>(this->vertices_.size());
+			for (auto& part : caps) this->vertices_.insert(this->vertices_.end(), part.begin(), part.end());
+		}
+
+		this->capsVertexCount_ = static_cast<GLuint>(this->vertices_.size()) - this->sidesVertexCount_;
+
+		// Загрузить вершины в буфер (память буфера выделяется заново только если текущей не хватает)
+		glBindBuffer(GL_ARRAY_BUFFER, this->vboId_);
+		if (this->vertices_.size() > this->vboCapacity_) {
+			GpuMemory::get().allocate(GPU_MEMORY_DYNAMIC_BUFFERS, (this->vertices_.size() - this->vboCapacity_) * sizeof(glm::vec4));
+			this->vboCapacity_ = static_cast<GLuint>(this->vertices_.size());
+			glBufferData(GL_ARRAY_BUFFER, this->vboCapacity_ * sizeof(glm::vec4), this->vertices_.data(), GL_DYNAMIC_DRAW);
+		}
+		else if (!this->vertices_.empty()) {
+			glBufferSubData(GL_ARRAY_BUFFER, 0, this->vertices_.size() * sizeof(glm::vec4), this->vertices_.data());
+		}
+		OGL_STATS_ADD(bytesUploaded, this->vertices_.size() * sizeof(glm::vec4));
+		glBindBuffer(GL_ARRAY_BUFFER, 0);
+	}
+
+	/**
+	* \brief Получить ID OpenGL объекта VAO (Vertex array object)
+	* \return Число-идентификатор
+	*/
+	GLuint ShadowVolume::getVaoId() const
+	{
+		return this->vaoId_;
+	}
+
+	/**
+	* \brief Получить кол-во вершин боковых сторон объема
+	* \return Число вершин
+	*/
+	GLuint ShadowVolume::getSidesVertexCount() const
+	{
+		return this->sidesVertexCount_;
+	}
+
+	/**
+	* \brief Получить кол-во вершин крышек объема
+	* \details Вершины крышек в буфере следуют сразу за вершинами боковых сторон
+	* \return Число вершин
+	*/
+	GLuint ShadowVolume::getCapsVertexCount() const
+	{
+		return this->capsVertexCount_;
+	}
+
+	/**
+	* \brief Создание теневого объема
+	* \return Умный указатель на объем
+	*/
+	ShadowVolumePtr MakeShadowVolume()
+	{
+		return std::make_shared<ShadowVolume>();
+	}
+}
@@ -0,0 +1,126 @@
+﻿#pragma once
+
+#include <vector>
+#include <memory>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+#include "Types.h"
+
+namespace ogl
+{
+	/**
+	 * \brief Теневой объем, построенный на CPU
+	 * \details Содержит полигоны теневого объема одной части меша для одного источника освещения (в пространстве модели).
+	 * Вершины хранятся в однородных координатах (w = 0 у вершин, вытянутых в бесконечность). В начале буфера идут
+	 * боковые стороны объема, затем крышки, что позволяет рисовать только боковые стороны в методе Z-pass
+	 */
+	class ShadowVolume
+	{
+	private:
+		GLuint vaoId_;               // ID объекта массива вершин (VAO)
+		GLuint vboId_;               // ID объекта вершинного буфера (VBO)
+		GLuint vboCapacity_;         // Кол-во вершин, под которое выделена память буфера
+		GLuint sidesVertexCount_;    // Кол-во вершин боковых сторон объема
+		GLuint capsVertexCount_;     // Кол-во вершин крышек объема
+
+		std::vector<glm::vec4> vertices_; // Вершины объема (переиспользуемый массив, во избежании лишних выделений памяти)
+		std::vector<GLubyte> facing_;     // Обращенность полигонов к источнику (переиспользуемый массив)
+
+		/**
+		* \brief Запрет копирования через инициализацию
+		* \param other Ссылка на копируемый объекта
+		*/
+		ShadowVolume(const ShadowVolume& other) = delete;
+
+		/**
+		* \brief Запрект копирования через присваивание
+		* \param other Ссылка на копируемый объекта
+		*/
+		void operator=(const ShadowVolume& other) = delete;
+
+		/**
+		 * \brief Определить какие полигоны обращены к источнику
+		 * \details Полигоны обрабатываются пакетами по 4 (SSE), если инструкции доступны
+		 * \param caster Данные геометрии
+		 * \param lightLocal Положение источника в пространстве модели (w = 0 для направленного источника - тогда это вектор к источнику)
+		 * \param begin Первый полигон (кратен 4)
+		 * \param end Полигон, следующий за последним
+		 * \param facing Массив для записи результата (1 - обращен к источнику)
+		 */
+		static void calculateFacing(const ShadowCasterData& caster, const glm::vec4& lightLocal, size_t begin, size_t end, GLubyte* facing);
+
+		/**
+		 * \brief Построить боковые стороны объема для диапазона ребер
+		 * \param caster Данные геометрии
+		 * \param lightLocal Положение источника в пространстве модели
+		 * \param facing Обращенность полигонов к источнику
+		 * \param begin Первое ребро
+		 * \param end Ребро, следующее за последним
+		 * \param vertices Массив для добавления вершин
+		 */
+		static void buildSides(const ShadowCasterData& caster, const glm::vec4& lightLocal, const GLubyte* facing, size_t begin, size_t end, std::vector<glm::vec4>* vertices);
+
+		/**
+		 * \brief Построить крышки объема для диапазона полигонов
+		 * \param caster Данные геометрии
+		 * \param lightLocal Положение источника в пространстве модели
+		 * \param facing Обращенность полигонов к источнику
+		 * \param begin Первый полигон
+		 * \param end Полигон, следующий за последним
+		 * \param vertices Массив для добавления вершин
+		 */
+		static void buildCaps(const ShadowCasterData& caster, const glm::vec4& lightLocal, const GLubyte* facing, size_t begin, size_t end, std::vector<glm::vec4>* vertices);
+
+	public:
+		/**
+		 * \brief Конструктор
+		 * \details Создает пустой объем (OpenGL объекты создаются сразу, данные загружаются при построении)
+		 */
+		ShadowVolume();
+
+		/**
+		 * \brief Деструктор
+		 * \details Уничтожает OpenGL объекты (VAO, VBO)
+		 */
+		~ShadowVolume();
+
+		/**
+		 * \brief Построить теневой объем и загрузить его в видео-память
+		 * \details Поиск силуэтных ребер ведется на CPU, при большом кол-ве полигонов - в нескольких потоках
+		 * \param caster Данные геометрии (см. StaticGeometryResource::getShadowCasterData)
+		 * \param lightLocal Положение источника в пространстве модели (w = 0 для направленного источника - тогда это вектор к источнику)
+		 */
+		void build(const ShadowCasterData& caster, const glm::vec4& lightLocal);
+
+		/**
+		 * \brief Получить ID OpenGL объекта VAO (Vertex array object)
+		 * \return Число-идентификатор
+		 */
+		GLuint getVaoId() const;
+
+		/**
+		 * \brief Получить кол-во вершин боковых сторон объема
+		 * \return Число вершин
+		 */
+		GLuint getSidesVertexCount() const;
+
+		/**
+		 * \brief Получить кол-во вершин крышек объема
+		 * \details Вершины крышек в буфере следуют сразу за вершинами боковых сторон
+		 * \return Число вершин
+		 */
+		GLuint getCapsVertexCount() const;
+	};
+
+	/**
+	 * \brief Тип для умного указателя на теневой объем
+	 */
+	typedef std::shared_ptr<ShadowVolume> ShadowVolumePtr;
+
+	/**
+	 * \brief Создание теневого объема
+	 * \return Умный указатель на объем
+	 */
+	ShadowVolumePtr MakeShadowVolume();
+}
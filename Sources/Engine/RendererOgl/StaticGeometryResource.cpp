@@ -1,4 +1,7 @@
 ﻿#include "StaticGeometryResource.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "GpuMemory.h"
 #include <map>
 #include <algorithm>
 #include <iterator>
@@ -240,6 +243,85 @@ namespace ogl
 		return resultIndices;
 	}
 
+	/**
+	* \brief Сформировать данные для построения теневых объемов на CPU
+	* \details Списки полигонов и ребер строятся по индексам геометрии со смежностями (результат buildAdjacency)
+	* \param vertices Вершины (включая фантомные)
+	* \param adjacentIndices Индексы геометрии со смежностями (по 6 на полигон)
+	* \param data Указатель на структуру для заполнения
+	*/
+	void StaticGeometryResource::buildShadowCasterData(const std::vector<Vertex>& vertices, const std::vector<glm::uint32>& adjacentIndices, ShadowCasterData* data)
+	{
+		// Кол-во полигонов и кол-во полигонов с учетом дополнения до кратности 4 (для пакетной обработки)
+		size_t triangleCount = adjacentIndices.size() / 6;
+		size_t paddedCount = (triangleCount + 3) & ~static_cast<size_t>(3);
+
+		// Положения вершин
+		data->positions.resize(vertices.size());
+		for (size_t i = 0; i < vertices.size(); i++) {
+			data->positions[i] = vertices[i].position;
+		}
+
+		data->triangles.resize(triangleCount * 3);
+		data->edges.clear();
+		data->normalX.assign(paddedCount, 0.0f);
+		data->normalY.assign(paddedCount, 0.0f);
+		data->normalZ.assign(paddedCount, 0.0f);
+		data->centroidDot.assign(paddedCount, 0.0f);
+
+		// Ассоциативный массив для поиска уже добавленных ребер (пара индексов вершин - индекс ребра)
+		std::map<std::pair<glm::uint32, glm::uint32>, size_t> edgeMap;
+
+		// Пройтись по всем полигонам
+		for (size_t t = 0; t < triangleCount; t++)
+		{
+			// Индексы полигона со смежностями (основные вершины - четные, смежные - нечетные)
+			const glm::uint32* adjacent = &adjacentIndices[t * 6];
+
+			// Основные вершины полигона
+			data->triangles[t * 3 + 0] = adjacent[0];
+			data->triangles[t * 3 + 1] = adjacent[2];
+			data->triangles[t * 3 + 2] = adjacent[4];
+
+			// Нормаль полигона (в том же виде, что и в шейдере теневых объемов) и ее произведение на сумму вершин
+			glm::vec3 v0 = vertices[adjacent[0]].position;
+			glm::vec3 v1 = vertices[adjacent[2]].position;
+			glm::vec3 v2 = vertices[adjacent[4]].position;
+			glm::vec3 normal = glm::cross(v2 - v0, v1 - v0);
+			data->normalX[t] = normal.x;
+			data->normalY[t] = normal.y;
+			data->normalZ[t] = normal.z;
+			data->centroidDot[t] = glm::dot(normal, v0 + v1 + v2);
+
+			// Пройтись по ребрам полигона
+			for (unsigned int i = 0; i < 3; i++)
+			{
+				glm::uint32 i0 = adjacent[i * 2];
+				glm::uint32 i1 = adjacent[(i * 2 + 2) % 6];
+
+				// Если смежная вершина фантомная - ребро граничное, оно не может быть общим с другим полигоном
+				if (vertices[adjacent[i * 2 + 1]].phantom) {
+					data->edges.push_back({ i0, i1, static_cast<glm::i32>(t), -1 });
+					continue;
+				}
+
+				// Найти ребро среди ранее добавленных (ключ не зависит от порядка обхода)
+				auto key = std::make_pair(glm::min(i0, i1), glm::max(i0, i1));
+				auto it = edgeMap.find(key);
+
+				// Если ребро уже добавлено другим полигоном и смежный полигон ему еще не задан - это он
+				if (it != edgeMap.end() && data->edges[it->second].triangle1 < 0) {
+					data->edges[it->second].triangle1 = static_cast<glm::i32>(t);
+				}
+				// Иначе добавить новое ребро
+				else {
+					edgeMap[key] = data->edges.size();
+					data->edges.push_back({ i0, i1, static_cast<glm::i32>(t), -1 });
+				}
+			}
+		}
+	}
+
 	/**
 	* \brief Конструктор
 	* \param vertices Массив вершин
@@ -261,6 +343,8 @@ namespace ogl
 			throw std::runtime_error("OpenGL:StaticGeometryResource: Glew is not initialised");
 		}
 
+		OGL_PROFILE_ZONE("geometry-upload");
+
 		// Скопировать в хранимые массивы
 		this->storedVertices_ = vertices;
 		this->storedIndices_ = indices;
@@ -272,6 +356,16 @@ namespace ogl
 		// Используются ли индексы
 		this->indexed_ = indices.size() > 0;
 
+		// Посчитать ограничивающий объем (до добавления фантомных вершин, они не являются частью геометрии)
+		this->bounds_ = { glm::vec3(0.0f), glm::vec3(0.0f) };
+		if (!this->storedVertices_.empty()) {
+			this->bounds_ = { this->storedVertices_[0].position, this->storedVertices_[0].position };
+			for (const Vertex& vertex : this->storedVertices_) {
+				this->bounds_.min = glm::min(this->bounds_.min, vertex.position);
+				this->bounds_.max = glm::max(this->bounds_.max, vertex.position);
+			}
+		}
+
 		// Если нужно посчитать нормали
 		if (calcNormals || calcTangents) {
 			// Для индексированной геометрии
@@ -283,6 +377,21 @@ namespace ogl
 		// Массив индексов геометрии со смежностями
 		std::vector<GLuint> adjacentIndices;
 
+		// Если нужно строить смежные полигоны
+		if(adjacency){
+			adjacentIndices = StaticGeometryResource::buildAdjacency(&(this->storedVertices_), this->storedIndices_);
+			this->indexCount_ = adjacentIndices.size();
+			this->vertexCount_ = this->storedVertices_.size();
+
+			// Данные для построения теневых объемов на CPU (геометрия со смежностями может отбрасывать тени)
+			StaticGeometryResource::buildShadowCasterData(this->storedVertices_, adjacentIndices, &(this->shadowCasterData_));
+		}
+
+		// Учет памяти (при превышении бюджета буферы не создаются)
+		this->memorySize_ = static_cast<GLuint64>(this->storedVertices_.size()) * (sizeof(Vertex) + sizeof(glm::vec3));
+		if (indexed_) this->memorySize_ += static_cast<GLuint64>(this->indexCount_) * sizeof(GLuint);
+		GpuMemory::get().allocate(GPU_MEMORY_GEOMETRY, this->memorySize_);
+
 		// Регистрация VAO, VBO, EBO
 		glGenVertexArrays(1, &vaoId_);
 		glGenBuffers(1, &vboId_);
@@ -294,23 +403,33 @@ namespace ogl
 		// Работаем с VAO
 		glBindVertexArray(vaoId_);
 
-		// Если нужно строить смежные полигоны
-		if(adjacency){
-			adjacentIndices = StaticGeometryResource::buildAdjacency(&(this->storedVertices_), this->storedIndices_);
-			this->indexCount_ = adjacentIndices.size();
-			this->vertexCount_ = this->storedVertices_.size();
-		}
-
 		// Работаем с буфером вершин, помещаем в него данные
 		glBindBuffer(GL_ARRAY_BUFFER, vboId_);
 		glBufferData(GL_ARRAY_BUFFER, this->storedVertices_.size() * sizeof(Vertex), this->storedVertices_.data(), GL_STATIC_DRAW);
+		OGL_STATS_ADD(bytesUploaded, this->storedVertices_.size() * sizeof(Vertex));
 
 		// Работаем с буфером индексов, помещаем в него данные
 		if (indexed_) {
 			glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboId_);
 			glBufferData(GL_ELEMENT_ARRAY_BUFFER, (adjacency ? adjacentIndices.size() : this->storedIndices_.size()) * sizeof(GLuint), adjacency ? adjacentIndices.data() : storedIndices_.data(), GL_STATIC_DRAW);
+			OGL_STATS_ADD(bytesUploaded, (adjacency ? adjacentIndices.size() : this->storedIndices_.size()) * sizeof(GLuint));
+		}
+
+		// Буфер только с положениями вершин (проходы глубины читают 12 байт на вершину вместо целой вершины)
+		std::vector<glm::vec3> positions(this->storedVertices_.size());
+		for (size_t i = 0; i < this->storedVertices_.size(); i++) {
+			positions[i] = this->storedVertices_[i].position;
 		}
 
+		glGenVertexArrays(1, &positionVaoId_);
+		glGenBuffers(1, &positionVboId_);
+		glBindBuffer(GL_ARRAY_BUFFER, positionVboId_);
+		glBufferData(GL_ARRAY_BUFFER, positions.size() * sizeof(glm::vec3), positions.data(), GL_STATIC_DRAW);
+		OGL_STATS_ADD(bytesUploaded, positions.size() * sizeof(glm::vec3));
+
+		// Вернуть основной буфер вершин (атрибуты основного VAO описываются ниже)
+		glBindBuffer(GL_ARRAY_BUFFER, vboId_);
+
 		// Если хранить в опертивной памяти данные вершин не нужно - очистить
 		if (!storeData) {
 			this->storedVertices_.clear();
@@ -391,6 +510,14 @@ namespace ogl
 
 		// Завершаем работу с VAO
 		glBindVertexArray(0);
+
+		// VAO только с положениями (индексы общие с основным VAO)
+		glBindVertexArray(positionVaoId_);
+		glBindBuffer(GL_ARRAY_BUFFER, positionVboId_);
+		glVertexAttribPointer(0, 3, GL_FLOAT, GL_FALSE, sizeof(glm::vec3), nullptr);
+		glEnableVertexAttribArray(0);
+		if (indexed_) glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, eboId_);
+		glBindVertexArray(0);
 	}
 
 	/**
@@ -399,9 +526,12 @@ namespace ogl
 	*/
 	StaticGeometryResource::~StaticGeometryResource()
 	{
+		if (this->positionVboId_) glDeleteBuffers(1, &positionVboId_);
+		if (this->positionVaoId_) glDeleteVertexArrays(1, &positionVaoId_);
 		if (this->vboId_) glDeleteBuffers(1, &vboId_);
 		if (this->eboId_) glDeleteBuffers(1, &eboId_);
 		if (this->vaoId_) glDeleteBuffers(1, &vaoId_);
+		GpuMemory::get().release(GPU_MEMORY_GEOMETRY, this->memorySize_);
 	}
 
 	/**
@@ -458,6 +588,16 @@ namespace ogl
 		return this->eboId_;
 	}
 
+	/**
+	* \brief Получить ID VAO только с положениями вершин
+	* \details Использует тот же EBO, что и основной VAO. Предназначен для проходов, где нужна только глубина
+	* \return Число-идентификатор
+	*/
+	GLuint StaticGeometryResource::getPositionVaoId() const
+	{
+		return this->positionVaoId_;
+	}
+
 	/**
 	* \brief Получить массив хранимых вершин
 	* \return Константная ссылка на массив
@@ -467,6 +607,36 @@ namespace ogl
 		return this->storedVertices_;
 	}
 
+	/**
+	* \brief Получить ограничивающий объем геометрии
+	* \details Объем считается в пространстве модели (без учета матрицы модели меша)
+	* \return Константная ссылка на структуру объема
+	*/
+	const BoundingBox& StaticGeometryResource::getBounds() const
+	{
+		return this->bounds_;
+	}
+
+	/**
+	* \brief Получить данные для построения теневых объемов на CPU
+	* \details Данные есть только у геометрии построенной со смежностями, у остальной они пусты
+	* \return Константная ссылка на структуру
+	*/
+	const ShadowCasterData& StaticGeometryResource::getShadowCasterData() const
+	{
+		return this->shadowCasterData_;
+	}
+
+	/**
+	* \brief Получить объем памяти GPU
+	* \details Буферы вершин (с фантомными вершинами), индексов (со смежностями) и положений вершин
+	* \return Кол-во байт
+	*/
+	GLuint64 StaticGeometryResource::getMemorySize() const
+	{
+		return this->memorySize_;
+	}
+
 	/**
 	* \brief Создание ресурса
 	* \param vertices Вершины
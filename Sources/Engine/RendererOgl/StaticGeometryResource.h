@@ -17,12 +17,20 @@ namespace ogl
 		GLuint vaoId_;               // ID объекта массива вершин (VAO)
 		GLuint vboId_;               // ID объекта вершинного буфера (VBO)
 		GLuint eboId_;               // ID объекта индексного/элементного буфера (EBO)
+		GLuint positionVaoId_;       // ID VAO только с положениями вершин (для проходов глубины)
+		GLuint positionVboId_;       // ID VBO только с положениями вершин (плотно упакованные vec3)
 
 		GLuint vertexCount_;         // Кол-во вершин
 		GLuint indexCount_;          // Кол-во индексов
 
 		bool indexed_;               // Рисовать как индексированную геометрию
 
+		GLuint64 memorySize_;        // Объем буферов в памяти GPU (байт)
+
+		BoundingBox bounds_;         // Ограничивающий объем (в пространстве модели)
+
+		ShadowCasterData shadowCasterData_; // Данные для построения теневых объемов на CPU (только для геометрии со смежностями)
+
 		// На случай, если нужен будет доступ к уже загруженой в видео-память геометрии
 		// дубликат массива вершин и индексов может храниться в следующих массивах
 
@@ -39,7 +47,10 @@ namespace ogl
 		* \brief Запрект копирования через присваивание
 		* \param other Ссылка на копируемый объекта
 		*/
-		void StaticGeometryResource::operator=(const StaticGeometryResource& other) = delete;
+		void operator=(const StaticGeometryResource& other) = delete;
+
+	public:
+		// Обработка геометрии на CPU (контекст OpenGL не нужен - доступна инструментам импорта и замерам)
 
 		/**
 		 * \brief Пересчитать нормали и тенгенты вершин индексированной геометрии
@@ -74,7 +85,14 @@ namespace ogl
 		*/
 		static std::vector<glm::uint32> buildAdjacency(std::vector<Vertex>* vertices, const std::vector<glm::uint32>& indices);
 
-	public:
+		/**
+		 * \brief Сформировать данные для построения теневых объемов на CPU
+		 * \details Списки полигонов и ребер строятся по индексам геометрии со смежностями (результат buildAdjacency)
+		 * \param vertices Вершины (включая фантомные)
+		 * \param adjacentIndices Индексы геометрии со смежностями (по 6 на полигон)
+		 * \param data Указатель на структуру для заполнения
+		 */
+		static void buildShadowCasterData(const std::vector<Vertex>& vertices, const std::vector<glm::uint32>& adjacentIndices, ShadowCasterData* data);
 
 		/**
 		 * \brief Конструктор
@@ -129,11 +147,39 @@ namespace ogl
 		 */
 		GLuint getEboId() const;
 
+		/**
+		 * \brief Получить ID VAO только с положениями вершин
+		 * \details Использует тот же EBO, что и основной VAO. Предназначен для проходов, где нужна только глубина
+		 * \return Число-идентификатор
+		 */
+		GLuint getPositionVaoId() const;
+
 		/**
 		 * \brief Получить массив хранимых вершин
 		 * \return Константная ссылка на массив
 		 */
 		const std::vector<Vertex>& getStoredVertices() const;
+
+		/**
+		 * \brief Получить ограничивающий объем геометрии
+		 * \details Объем считается в пространстве модели (без учета матрицы модели меша)
+		 * \return Константная ссылка на структуру объема
+		 */
+		const BoundingBox& getBounds() const;
+
+		/**
+		 * \brief Получить данные для построения теневых объемов на CPU
+		 * \details Данные есть только у геометрии построенной со смежностями, у остальной они пусты
+		 * \return Константная ссылка на структуру
+		 */
+		const ShadowCasterData& getShadowCasterData() const;
+
+		/**
+		 * \brief Получить объем памяти GPU
+		 * \details Буферы вершин (с фантомными вершинами), индексов (со смежностями) и положений вершин
+		 * \return Кол-во байт
+		 */
+		GLuint64 getMemorySize() const;
 	};
 
 	/**
@@ -1,4 +1,5 @@
 ﻿#include "StaticMesh.h"
+#include "TransformStore.h"
 #include <glm/gtc/matrix_transform.hpp>
 
 namespace ogl
@@ -14,6 +15,11 @@ namespace ogl
 		position(glm::vec3(0.0f, 0.0f, 0.0f)),
 		scale(glm::vec3(1.0f, 1.0f, 1.0f))
 	{
+		// Начальное состояние положения (до первого обновления состояния меш считается измененным)
+		this->lastTransform_ = { this->origin, this->rotation, this->position, this->scale };
+		this->transformChanged_ = true;
+		this->modelMatrixValid_ = false;
+
 		this->parts_.push_back(part);
 	}
 
@@ -28,6 +34,11 @@ namespace ogl
 		position(glm::vec3(0.0f, 0.0f, 0.0f)),
 		scale(glm::vec3(1.0f, 1.0f, 1.0f))
 	{
+		// Начальное состояние положения (до первого обновления состояния меш считается измененным)
+		this->lastTransform_ = { this->origin, this->rotation, this->position, this->scale };
+		this->transformChanged_ = true;
+		this->modelMatrixValid_ = false;
+
 		this->parts_ = parts;
 	}
 
@@ -93,10 +104,65 @@ namespace ogl
 	*/
 	glm::mat4 StaticMesh::getModelMatrix() const
 	{
-		return glm::translate(glm::mat4(1), this->origin) * 
-			this->getTranslationMatrix() * 
-			this->getRotationMatrix4x4() * 
-			this->getScaleMatrix() * 
-			glm::translate(glm::mat4(1), -this->origin);
+		if (!this->isModelMatrixCurrent())
+		{
+			this->modelMatrix_ = TransformStore::composeMatrix(this->origin, this->rotation, this->position, this->scale);
+			this->modelTransform_ = { this->origin, this->rotation, this->position, this->scale };
+			this->modelMatrixValid_ = true;
+		}
+
+		return this->modelMatrix_;
+	}
+
+	/**
+	* \brief Задать матрицу модели, рассчитанную для текущего положения
+	* \param matrix Матрица (см. TransformStore)
+	*/
+	void StaticMesh::setModelMatrix(const glm::mat4& matrix)
+	{
+		this->modelMatrix_ = matrix;
+		this->modelTransform_ = { this->origin, this->rotation, this->position, this->scale };
+		this->modelMatrixValid_ = true;
+	}
+
+	/**
+	* \brief Совпадает ли текущее положение с тем, для которого рассчитана матрица модели
+	* \return Да или нет
+	*/
+	bool StaticMesh::isModelMatrixCurrent() const
+	{
+		return this->modelMatrixValid_ &&
+			this->modelTransform_.origin == this->origin &&
+			this->modelTransform_.rotation == this->rotation &&
+			this->modelTransform_.position == this->position &&
+			this->modelTransform_.scale == this->scale;
+	}
+
+	/**
+	* \brief Обновить состояние положения
+	* \details Сравнивает текущие параметры положения с параметрами на момент предыдущего вызова.
+	* Рендерер вызывает метод один раз за кадр, что позволяет не пересчитывать зависящие от положения данные
+	* \return Изменилось ли положение с момента предыдущего вызова
+	*/
+	bool StaticMesh::updateTransformState()
+	{
+		this->transformChanged_ =
+			this->lastTransform_.origin != this->origin ||
+			this->lastTransform_.rotation != this->rotation ||
+			this->lastTransform_.position != this->position ||
+			this->lastTransform_.scale != this->scale;
+
+		this->lastTransform_ = { this->origin, this->rotation, this->position, this->scale };
+		return this->transformChanged_;
+	}
+
+	/**
+	* \brief Изменилось ли положение при последнем обновлении состояния
+	* \details Сразу после создания меша считается, что положение изменилось
+	* \return Да или нет
+	*/
+	bool StaticMesh::isTransformChanged() const
+	{
+		return this->transformChanged_;
 	}
 }
@@ -17,6 +17,39 @@ namespace ogl
 	private:
 		std::vector<StaticMeshPart> parts_;  // Части
 
+		/**
+		 * \brief Параметры положения на момент последнего обновления состояния
+		 * \details Используется для определения того, было ли изменено положение меша (см. updateTransformState)
+		 */
+		struct {
+			glm::vec3 origin;
+			glm::vec3 rotation;
+			glm::vec3 position;
+			glm::vec3 scale;
+		} lastTransform_;
+
+		bool transformChanged_;              // Изменилось ли положение при последнем обновлении состояния
+
+		/**
+		 * \brief Параметры положения, для которых рассчитана хранимая матрица модели
+		 * \details Поля положения открыты, поэтому признаком устаревания матрицы служит их отличие от этих параметров
+		 */
+		mutable struct {
+			glm::vec3 origin;
+			glm::vec3 rotation;
+			glm::vec3 position;
+			glm::vec3 scale;
+		} modelTransform_;
+
+		mutable glm::mat4 modelMatrix_;      // Матрица модели (пересчитывается при запросе, если положение изменилось)
+		mutable bool modelMatrixValid_;      // Рассчитана ли матрица модели
+
+		/**
+		 * \brief Совпадает ли текущее положение с тем, для которого рассчитана матрица модели
+		 * \return Да или нет
+		 */
+		bool isModelMatrixCurrent() const;
+
 	public:
 		bool isRendering;   // Рендерится ли меш
 
@@ -74,10 +107,32 @@ namespace ogl
 
 		/**
 		 * \brief Получить матрицу модели
-		 * \details Результат перемножения всех матриц с учетом локального центра
+		 * \details Результат перемножения всех матриц с учетом локального центра. Матрица хранится и пересчитывается
+		 * только при изменении положения (рендерер пересчитывает матрицы всех измененных мешей пакетом раз за кадр)
 		 * \return Матрица
 		 */
 		glm::mat4 getModelMatrix() const;
+
+		/**
+		 * \brief Задать матрицу модели, рассчитанную для текущего положения
+		 * \param matrix Матрица (см. TransformStore)
+		 */
+		void setModelMatrix(const glm::mat4& matrix);
+
+		/**
+		 * \brief Обновить состояние положения
+		 * \details Сравнивает текущие параметры положения с параметрами на момент предыдущего вызова.
+		 * Рендерер вызывает метод один раз за кадр, что позволяет не пересчитывать зависящие от положения данные
+		 * \return Изменилось ли положение с момента предыдущего вызова
+		 */
+		bool updateTransformState();
+
+		/**
+		 * \brief Изменилось ли положение при последнем обновлении состояния
+		 * \details Сразу после создания меша считается, что положение изменилось
+		 * \return Да или нет
+		 */
+		bool isTransformChanged() const;
 	};
 
 	/**
@@ -43,6 +43,9 @@ namespace ogl
 		this->bumpTexture = defaultParams;
 		this->displacementTexture = defaultParams;
 
+		// Полноценный paralax mapping по умолчанию
+		this->parallaxQuality = ParallaxQuality::PARALLAX_OCCLUSION;
+
 		// Назначить параметры материала по умолчанию
 		this->material = defaults::GetMaterialSetings(defaults::DefaultMaterialType::DEFAULT);
 	}
@@ -55,4 +58,22 @@ namespace ogl
 	{
 		return this->geometry_;
 	}
+
+	/**
+	* \brief Получить маску определений препроцессора для варианта шейдера геометрии
+	* \details Биты соответствуют установленным текстурам (MESH_DEFINE_SPECULAR_MAP, MESH_DEFINE_BUMP_MAP,
+	* MESH_DEFINE_DISPLACEMENT_MAP) и качеству paralax mapping'а (MESH_DEFINE_PARALLAX_OFFSET_ONLY)
+	* \return Маска определений
+	*/
+	GLuint StaticMeshPart::getShaderDefineMask() const
+	{
+		GLuint mask = 0;
+		if (this->specularTexture.resource != nullptr) mask |= MESH_DEFINE_SPECULAR_MAP;
+		if (this->bumpTexture.resource != nullptr) mask |= MESH_DEFINE_BUMP_MAP;
+		if (this->displacementTexture.resource != nullptr) {
+			mask |= MESH_DEFINE_DISPLACEMENT_MAP;
+			if (this->parallaxQuality == ParallaxQuality::PARALLAX_OFFSET) mask |= MESH_DEFINE_PARALLAX_OFFSET_ONLY;
+		}
+		return mask;
+	}
 }
@@ -1,14 +1,30 @@
 ﻿#pragma once
 
 #include <glm/glm.hpp>
+#include <vector>
+#include <string>
 
 #include "TextureResource.h"
 #include "ShaderResource.h"
 #include "StaticGeometryResource.h"
 #include "Types.h"
 
+#define MESH_DEFINE_SPECULAR_MAP 0x01
+#define MESH_DEFINE_BUMP_MAP 0x02
+#define MESH_DEFINE_DISPLACEMENT_MAP 0x04
+#define MESH_DEFINE_PARALLAX_OFFSET_ONLY 0x08
+
 namespace ogl
 {
+	/**
+	 * \brief Качество paralax-mapping'а части меша
+	 */
+	enum ParallaxQuality
+	{
+		PARALLAX_OFFSET = 0,    // Простое смещение (одна выборка из карты высот, для удаленных и второстепенных частей)
+		PARALLAX_OCCLUSION = 1  // Поиск пересечения по слоям (кол-во слоев зависит от угла обзора и расстояния)
+	};
+
 	/**
 	* \brief Параметры текстуры
 	* \details Описывает масштаб, сдаиг, поворот
@@ -47,6 +63,7 @@ namespace ogl
 		TextureParameters specularTexture;     // Параметры specular текстуры
 		TextureParameters bumpTexture;         // Параметры bump текстуры
 		TextureParameters displacementTexture; // Параметры displacement текстуры (paralax mapping)
+		ParallaxQuality parallaxQuality;       // Качество paralax mapping'а (учитывается только при наличии displacement текстуры)
 
 		/**
 		 * \brief Конструктор
@@ -64,5 +81,13 @@ namespace ogl
 		 * \return Умный указатель на ресурс
 		 */
 		StaticGeometryResourcePtr getGeometry() const;
+
+		/**
+		 * \brief Получить маску определений препроцессора для варианта шейдера геометрии
+		 * \details Биты соответствуют установленным текстурам (MESH_DEFINE_SPECULAR_MAP, MESH_DEFINE_BUMP_MAP,
+		 * MESH_DEFINE_DISPLACEMENT_MAP) и качеству paralax mapping'а (MESH_DEFINE_PARALLAX_OFFSET_ONLY)
+		 * \return Маска определений
+		 */
+		GLuint getShaderDefineMask() const;
 	};
 }
\ No newline at end of file
@@ -1,4 +1,7 @@
 ﻿#include "TextureCubicResource.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "GpuMemory.h"
 #include <stdexcept>
 
 namespace ogl
@@ -26,10 +29,19 @@ namespace ogl
 			throw std::runtime_error("OpenGL:TextureCubicResource: Glew is not initialised");
 		}
 
+		OGL_PROFILE_ZONE("cubemap-upload");
+
 		if(facesData.size() < 6){
 			throw std::runtime_error("OpenGL:TextureCubicResource: Wrong data provided. Cubic texture has 6 faces");
 		}
 
+		// Учет памяти (при превышении бюджета текстура не создается)
+		GLuint64 memorySize = 0;
+		for (unsigned int i = 0; i < 6; i++) {
+			memorySize += GpuMemoryTextureSize(facesData[i].width, facesData[i].height, facesData[i].bpp, this->mipmaps_);
+		}
+		GpuMemory::get().allocate(GPU_MEMORY_CUBEMAPS, memorySize);
+
 		// Генерация идентификатора текстуры
 		glGenTextures(1, &id_);
 		// Привязываемся к текстуре по идентификатору (работаем с текустурой)
@@ -74,6 +86,7 @@ namespace ogl
 				GL_TEXTURE_CUBE_MAP_POSITIVE_X + i,
 				0, format, facesData[i].width, facesData[i].height, 0, format, GL_UNSIGNED_BYTE, facesData[i].textureData
 			);
+			OGL_STATS_ADD(bytesUploaded, static_cast<GLuint64>(facesData[i].width) * facesData[i].height * facesData[i].bpp);
 		}
 
 		// Генерация мип-мапов (если нужно)
@@ -91,6 +104,7 @@ namespace ogl
 	TextureCubicResource::~TextureCubicResource()
 	{
 		glDeleteTextures(1, &id_);
+		GpuMemory::get().release(GPU_MEMORY_CUBEMAPS, this->getMemorySize());
 	}
 
 	/**
@@ -132,6 +146,19 @@ namespace ogl
 		return this->faces_[faceIndex].bpp;
 	}
 
+	/**
+	 * \brief Получить объем памяти GPU
+	 * \return Кол-во байт (все грани с цепочками мип-уровней)
+	 */
+	GLuint64 TextureCubicResource::getMemorySize() const
+	{
+		GLuint64 memorySize = 0;
+		for (const TextureCubicFace& face : this->faces_) {
+			memorySize += GpuMemoryTextureSize(face.width, face.height, face.bpp, this->mipmaps_);
+		}
+		return memorySize;
+	}
+
 	/**
 	 * \brief Создание ресурса
 	 * \param facesData Данные для каждой стороны куба
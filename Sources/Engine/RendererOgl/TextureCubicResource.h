@@ -1,6 +1,6 @@
 ﻿#pragma once
 
-#include <gl/glew.h>
+#include <GL/glew.h>
 #include <memory>
 #include <vector>
 
@@ -50,7 +50,7 @@ namespace ogl
 		 * \brief Запрект копирования через присваивание
 		 * \param other Ссылка на копируемый объекта
 		 */
-		void TextureCubicResource::operator=(const TextureCubicResource& other) = delete;
+		void operator=(const TextureCubicResource& other) = delete;
 
 	public:
 
@@ -92,6 +92,12 @@ namespace ogl
 		 * \return Целое число
 		 */
 		GLuint getBpp(GLuint faceIndex) const;
+
+		/**
+		 * \brief Получить объем памяти GPU
+		 * \return Кол-во байт (все грани с цепочками мип-уровней)
+		 */
+		GLuint64 getMemorySize() const;
 	};
 
 	/**
@@ -1,4 +1,7 @@
 ﻿#include "TextureResource.h"
+#include "Profiler.h"
+#include "RenderStats.h"
+#include "GpuMemory.h"
 #include <stdexcept>
 
 namespace ogl
@@ -8,6 +11,28 @@ namespace ogl
 	*/
 	extern bool _isGlewInitialised;
 
+	/**
+	* \brief Размер одной компоненты пикселя
+	* \param type Тип компонент (GL_UNSIGNED_BYTE, GL_FLOAT)
+	* \return Кол-во байт
+	*/
+	static GLuint ComponentSize(GLuint type)
+	{
+		switch (type)
+		{
+		case GL_FLOAT:
+		case GL_INT:
+		case GL_UNSIGNED_INT:
+			return 4;
+		case GL_HALF_FLOAT:
+		case GL_SHORT:
+		case GL_UNSIGNED_SHORT:
+			return 2;
+		default:
+			return 1;
+		}
+	}
+
 	/**
 	* \brief Конструктор
 	* \param textureData Байты текстуры (массив цветов)
@@ -21,7 +46,8 @@ namespace ogl
 		width_(width),
 		height_(height),
 		bpp_(bpp),
-		mipmaps_(generateMipmaps)
+		mipmaps_(generateMipmaps),
+		type_(type)
 	{
 		// Инициализация GLEW
 		if (!_isGlewInitialised) {
@@ -33,6 +59,11 @@ namespace ogl
 			throw std::runtime_error("OpenGL:TextureResource: Glew is not initialised");
 		}
 
+		OGL_PROFILE_ZONE("texture-upload");
+
+		// Учет памяти (при превышении бюджета текстура не создается)
+		GpuMemory::get().allocate(GPU_MEMORY_TEXTURES, this->getMemorySize());
+
 		// Генерация идентификатора текстуры
 		glGenTextures(1, &(this->id_));
 		// Привязываемся к текстуре по идентификатору (работаем с текустурой)
@@ -44,21 +75,17 @@ namespace ogl
 		glTexParameteri(GL_TEXTURE_2D, GL_TEXTURE_MAG_FILTER, GL_LINEAR);
 
 		// Определить подходящий вормат (так-себе подход)
-		GLuint format;
-		switch (this->bpp_)
-		{
-		case 3:
-			format = GL_RGB;
-			break;
-		case 4:
-			format = GL_RGBA;
-			break;
-		default:
-			format = GL_RGB;
+		GLuint format = this->getFormat();
+
+		// Вещественные данные хранятся без потери точности (иначе драйвер выбирает 8 бит на компоненту)
+		GLuint internalFormat = format;
+		if (type == GL_FLOAT) {
+			internalFormat = format == GL_RGBA ? GL_RGBA32F : GL_RGB32F;
 		}
 
 		// Устанавливаем данные тексткры (загрузка в текстурную память)
-		glTexImage2D(GL_TEXTURE_2D, 0, format, this->width_, this->height_, 0, format, type, textureData);
+		glTexImage2D(GL_TEXTURE_2D, 0, internalFormat, this->width_, this->height_, 0, format, type, textureData);
+		OGL_STATS_ADD(bytesUploaded, static_cast<GLuint64>(this->width_) * this->height_ * this->bpp_ * ComponentSize(type));
 
 		// Генерация мип-мапов (если нужно)
 		if (this->mipmaps_) {
@@ -75,6 +102,7 @@ namespace ogl
 	TextureResource::~TextureResource()
 	{
 		glDeleteTextures(1, &id_);
+		GpuMemory::get().release(GPU_MEMORY_TEXTURES, this->getMemorySize());
 	}
 
 	/**
@@ -113,6 +141,63 @@ namespace ogl
 		return this->bpp_;
 	}
 
+	/**
+	* \brief Используется ли авто-генерация мип-мапов
+	* \return Да или нет
+	*/
+	bool TextureResource::hasMipmaps() const
+	{
+		return this->mipmaps_;
+	}
+
+	/**
+	* \brief Получить тип компонент
+	* \return GL_UNSIGNED_BYTE или GL_FLOAT
+	*/
+	GLuint TextureResource::getType() const
+	{
+		return this->type_;
+	}
+
+	/**
+	* \brief Получить формат пикселей (по кол-ву компонент)
+	* \return GL_RGB или GL_RGBA
+	*/
+	GLuint TextureResource::getFormat() const
+	{
+		return this->bpp_ == 4 ? GL_RGBA : GL_RGB;
+	}
+
+	/**
+	* \brief Получить размер пикселя в памяти (по формату и типу компонент)
+	* \return Кол-во байт
+	*/
+	GLuint TextureResource::getPixelSize() const
+	{
+		return TextureResource::calculatePixelSize(this->getFormat(), this->type_);
+	}
+
+	/**
+	* \brief Рассчитать размер пикселя в памяти
+	* \param format Формат пикселей (GL_RGB, GL_RGBA)
+	* \param type Тип компонент (GL_UNSIGNED_BYTE, GL_FLOAT)
+	* \return Кол-во байт
+	*/
+	GLuint TextureResource::calculatePixelSize(GLuint format, GLuint type)
+	{
+		return (format == GL_RGBA ? 4 : 3) * ComponentSize(type);
+	}
+
+	/**
+	* \brief Получить объем памяти GPU
+	* \return Кол-во байт (с цепочкой мип-уровней)
+	* \details Одинаков при создании и удалении текстуры (зависит только от параметров, заданных в конструкторе)
+	*/
+	GLuint64 TextureResource::getMemorySize() const
+	{
+		return GpuMemoryTextureSize(this->width_, this->height_, this->getPixelSize(), this->mipmaps_);
+	}
+
 	/**
 	* \brief Создание ресурса
 	* \param textureData Байты текстуры (массив цветов)
@@ -1,6 +1,6 @@
 ﻿#pragma once
 
-#include <gl/glew.h>
+#include <GL/glew.h>
 #include <memory>
 
 namespace ogl
@@ -17,6 +17,7 @@ namespace ogl
 		GLuint height_; // Высота
 		GLuint bpp_;    // Байт на пиксель
 		bool mipmaps_;  // Используется ли авто-генерация мип-мапов
+		GLuint type_;   // Тип компонент (GL_UNSIGNED_BYTE, GL_FLOAT)
 
 		/**
 		* \brief Запрет копирования через инициализацию
@@ -28,7 +29,7 @@ namespace ogl
 		* \brief Запрект копирования через присваивание
 		* \param other Ссылка на копируемый объекта
 		*/
-		void TextureResource::operator=(const TextureResource& other) = delete;
+		void operator=(const TextureResource& other) = delete;
 
 	public:
 
@@ -71,6 +72,45 @@ namespace ogl
 		 * \return Целое число
 		 */
 		GLuint getBpp() const;
+
+		/**
+		 * \brief Используется ли авто-генерация мип-мапов
+		 * \return Да или нет
+		 */
+		bool hasMipmaps() const;
+
+		/**
+		 * \brief Получить тип компонент
+		 * \return GL_UNSIGNED_BYTE или GL_FLOAT
+		 */
+		GLuint getType() const;
+
+		/**
+		 * \brief Получить формат пикселей (по кол-ву компонент)
+		 * \return GL_RGB или GL_RGBA
+		 */
+		GLuint getFormat() const;
+
+		/**
+		 * \brief Получить размер пикселя в памяти (по формату и типу компонент)
+		 * \return Кол-во байт
+		 */
+		GLuint getPixelSize() const;
+
+		/**
+		 * \brief Рассчитать размер пикселя в памяти
+		 * \param format Формат пикселей (GL_RGB, GL_RGBA)
+		 * \param type Тип компонент (GL_UNSIGNED_BYTE, GL_FLOAT)
+		 * \return Кол-во байт
+		 */
+		static GLuint calculatePixelSize(GLuint format, GLuint type);
+
+		/**
+		 * \brief Получить объем памяти GPU
+		 * \return Кол-во байт (с цепочкой мип-уровней)
+		 * \details Одинаков при создании и удалении текстуры (зависит только от параметров, заданных в конструкторе)
+		 */
+		GLuint64 getMemorySize() const;
 	};
 
 	/**
@@ -1,5 +1,5 @@
 ﻿#include "Tools.h"
-#include <gl/glew.h>
+#include <GL/glew.h>
 #include <stdexcept>
 
 namespace ogl
@@ -9,6 +9,8 @@ namespace ogl
 	 */
 	bool _isGlewInitialised = false;
 
+#ifdef _WIN32
+
 	/**
 	* \brief Создать OpenGL контекст для отрисовки на окне
 	* \param hWnd Окно
@@ -95,4 +97,5 @@ namespace ogl
 				wglSwapIntervalEXT(sync);
 		}
 	}
+#endif
 }
@@ -1,4 +1,6 @@
 ﻿#pragma once
+
+#ifdef _WIN32
 #include <Windows.h>
 
 namespace ogl
@@ -22,3 +24,4 @@ namespace ogl
 	*/
 	void EnableVSync(bool sync);
 }
+#endif
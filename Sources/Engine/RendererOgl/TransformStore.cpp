@@ -0,0 +1,384 @@
+﻿#include "TransformStore.h"
+#include <cmath>
+#include <algorithm>
+#include <glm/gtc/constants.hpp>
+
+#if defined(__AVX2__)
+#define OGL_TRANSFORM_STORE_AVX
+#include <immintrin.h>
+#endif
+
+#if defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2) || defined(__SSE2__)
+#define OGL_TRANSFORM_STORE_SSE
+#include <emmintrin.h>
+#endif
+
+namespace ogl
+{
+	/**
+	* \brief Указатели на массивы хранилища (для пакетного пересчета)
+	*/
+	struct TransformArrays
+	{
+		const GLfloat* origin[3];
+		const GLfloat* rotation[3];
+		const GLfloat* position[3];
+		const GLfloat* scale[3];
+		GLubyte* dirty;
+		glm::mat4* matrices;
+	};
+
+#ifdef OGL_TRANSFORM_STORE_SSE
+	/**
+	* \brief Операции над пакетом из 4 чисел (SSE2)
+	*/
+	struct TransformOps4
+	{
+		typedef __m128 Value;
+		typedef __m128i Integer;
+		static const size_t WIDTH = 4;
+
+		static inline Value load(const GLfloat* p) { return _mm_loadu_ps(p); }
+		static inline void store(GLfloat* p, Value v) { _mm_storeu_ps(p, v); }
+		static inline Value set(GLfloat v) { return _mm_set1_ps(v); }
+		static inline Value add(Value a, Value b) { return _mm_add_ps(a, b); }
+		static inline Value sub(Value a, Value b) { return _mm_sub_ps(a, b); }
+		static inline Value mul(Value a, Value b) { return _mm_mul_ps(a, b); }
+		static inline Value bitAnd(Value a, Value b) { return _mm_and_ps(a, b); }
+		static inline Value bitAndNot(Value a, Value b) { return _mm_andnot_ps(a, b); }
+		static inline Value bitXor(Value a, Value b) { return _mm_xor_ps(a, b); }
+		static inline Value select(Value mask, Value a, Value b) { return _mm_or_ps(_mm_and_ps(mask, a), _mm_andnot_ps(mask, b)); }
+		static inline Integer truncate(Value v) { return _mm_cvttps_epi32(v); }
+		static inline Value toFloat(Integer v) { return _mm_cvtepi32_ps(v); }
+		static inline Value asFloat(Integer v) { return _mm_castsi128_ps(v); }
+		static inline Integer setInt(int v) { return _mm_set1_epi32(v); }
+		static inline Integer addInt(Integer a, Integer b) { return _mm_add_epi32(a, b); }
+		static inline Integer subInt(Integer a, Integer b) { return _mm_sub_epi32(a, b); }
+		static inline Integer andInt(Integer a, Integer b) { return _mm_and_si128(a, b); }
+		static inline Integer andNotInt(Integer a, Integer b) { return _mm_andnot_si128(a, b); }
+		static inline Integer equalInt(Integer a, Integer b) { return _mm_cmpeq_epi32(a, b); }
+		static inline Integer shiftToSign(Integer v) { return _mm_slli_epi32(v, 29); }
+	};
+#endif
+
+#ifdef OGL_TRANSFORM_STORE_AVX
+	/**
+	* \brief Операции над пакетом из 8 чисел (AVX2)
+	*/
+	struct TransformOps8
+	{
+		typedef __m256 Value;
+		typedef __m256i Integer;
+		static const size_t WIDTH = 8;
+
+		static inline Value load(const GLfloat* p) { return _mm256_loadu_ps(p); }
+		static inline void store(GLfloat* p, Value v) { _mm256_storeu_ps(p, v); }
+		static inline Value set(GLfloat v) { return _mm256_set1_ps(v); }
+		static inline Value add(Value a, Value b) { return _mm256_add_ps(a, b); }
+		static inline Value sub(Value a, Value b) { return _mm256_sub_ps(a, b); }
+		static inline Value mul(Value a, Value b) { return _mm256_mul_ps(a, b); }
+		static inline Value bitAnd(Value a, Value b) { return _mm256_and_ps(a, b); }
+		static inline Value bitAndNot(Value a, Value b) { return _mm256_andnot_ps(a, b); }
+		static inline Value bitXor(Value a, Value b) { return _mm256_xor_ps(a, b); }
+		static inline Value select(Value mask, Value a, Value b) { return _mm256_blendv_ps(b, a, mask); }
+		static inline Integer truncate(Value v) { return _mm256_cvttps_epi32(v); }
+		static inline Value toFloat(Integer v) { return _mm256_cvtepi32_ps(v); }
+		static inline Value asFloat(Integer v) { return _mm256_castsi256_ps(v); }
+		static inline Integer setInt(int v) { return _mm256_set1_epi32(v); }
+		static inline Integer addInt(Integer a, Integer b) { return _mm256_add_epi32(a, b); }
+		static inline Integer subInt(Integer a, Integer b) { return _mm256_sub_epi32(a, b); }
+		static inline Integer andInt(Integer a, Integer b) { return _mm256_and_si256(a, b); }
+		static inline Integer andNotInt(Integer a, Integer b) { return _mm256_andnot_si256(a, b); }
+		static inline Integer equalInt(Integer a, Integer b) { return _mm256_cmpeq_epi32(a, b); }
+		static inline Integer shiftToSign(Integer v) { return _mm256_slli_epi32(v, 29); }
+	};
+#endif
+
+	/**
+	* \brief Синус и косинус пакета углов
+	* \details Приведение к диапазону [-pi/4, pi/4] и минимаксные полиномы (как в Cephes), точность ~1e-7 для |x| < 8192
+	* \param x Углы (радианы)
+	* \param sine Синусы
+	* \param cosine Косинусы
+	*/
+	template <typename Ops>
+	static inline void SinCos(typename Ops::Value x, typename Ops::Value* sine, typename Ops::Value* cosine)
+	{
+		typedef typename Ops::Value Value;
+		typedef typename Ops::Integer Integer;
+
+		// Знак синуса берется от аргумента, дальше работаем с модулем
+		Value signMask = Ops::set(-0.0f);
+		Value signSine = Ops::bitAnd(x, signMask);
+		x = Ops::bitAndNot(signMask, x);
+
+		// Номер октанта (округленный до четного) и признаки смены знака и выбора полинома
+		Integer octant = Ops::truncate(Ops::mul(x, Ops::set(4.0f / glm::pi<GLfloat>())));
+		octant = Ops::andInt(Ops::addInt(octant, Ops::setInt(1)), Ops::setInt(~1));
+		Value y = Ops::toFloat(octant);
+
+		Value swapSignSine = Ops::asFloat(Ops::shiftToSign(Ops::andInt(octant, Ops::setInt(4))));
+		Value signCosine = Ops::asFloat(Ops::shiftToSign(Ops::andNotInt(Ops::subInt(octant, Ops::setInt(2)), Ops::setInt(4))));
+		Value polynomialMask = Ops::asFloat(Ops::equalInt(Ops::andInt(octant, Ops::setInt(2)), Ops::setInt(0)));
+		signSine = Ops::bitXor(signSine, swapSignSine);
+
+		// x - y * pi/4 (константа разложена на три части для точности)
+		x = Ops::add(x, Ops::mul(y, Ops::set(-0.78515625f)));
+		x = Ops::add(x, Ops::mul(y, Ops::set(-2.4187564849853515625e-4f)));
+		x = Ops::add(x, Ops::mul(y, Ops::set(-3.77489497744594108e-8f)));
+		Value z = Ops::mul(x, x);
+
+		// Полином косинуса
+		Value yc = Ops::set(2.443315711809948e-5f);
+		yc = Ops::add(Ops::mul(yc, z), Ops::set(-1.388731625493765e-3f));
+		yc = Ops::add(Ops::mul(yc, z), Ops::set(4.166664568298827e-2f));
+		yc = Ops::mul(Ops::mul(yc, z), z);
+		yc = Ops::sub(yc, Ops::mul(z, Ops::set(0.5f)));
+		yc = Ops::add(yc, Ops::set(1.0f));
+
+		// Полином синуса
+		Value ys = Ops::set(-1.9515295891e-4f);
+		ys = Ops::add(Ops::mul(ys, z), Ops::set(8.3321608736e-3f));
+		ys = Ops::add(Ops::mul(ys, z), Ops::set(-1.6666654611e-1f));
+		ys = Ops::add(Ops::mul(Ops::mul(ys, z), x), x);
+
+		*sine = Ops::bitXor(Ops::select(polynomialMask, ys, yc), signSine);
+		*cosine = Ops::bitXor(Ops::select(polynomialMask, yc, ys), signCosine);
+	}
+
+	/**
+	* \brief Пересчитать измененные записи пакетами
+	* \param arrays Массивы хранилища
+	* \param begin Первая запись
+	* \param end Запись, следующая за последней
+	* \param updated Счетчик пересчитанных матриц (дополняется)
+	* \return Первая необработанная запись (остаток, не кратный размеру пакета)
+	*/
+	template <typename Ops>
+	static size_t UpdateBatches(const TransformArrays& arrays, size_t begin, size_t end, size_t* updated)
+	{
+		typedef typename Ops::Value Value;
+		const Value toRadians = Ops::set(glm::pi<GLfloat>() / 180.0f);
+
+		// Столбцы 3*4 части матриц пакета (последняя строка матрицы модели постоянна)
+		GLfloat columns[12][Ops::WIDTH];
+
+		size_t i = begin;
+		for (; i + Ops::WIDTH <= end; i += Ops::WIDTH)
+		{
+			// Пакет без измененных записей пропускается
+			bool dirty = false;
+			for (size_t k = 0; k < Ops::WIDTH; k++) dirty |= arrays.dirty[i + k] != 0;
+			if (!dirty) continue;
+
+			Value sx, cx, sy, cy, sz, cz;
+			SinCos<Ops>(Ops::mul(Ops::load(arrays.rotation[0] + i), toRadians), &sx, &cx);
+			SinCos<Ops>(Ops::mul(Ops::load(arrays.rotation[1] + i), toRadians), &sy, &cy);
+			SinCos<Ops>(Ops::mul(Ops::load(arrays.rotation[2] + i), toRadians), &sz, &cz);
+
+			Value scaleX = Ops::load(arrays.scale[0] + i);
+			Value scaleY = Ops::load(arrays.scale[1] + i);
+			Value scaleZ = Ops::load(arrays.scale[2] + i);
+
+			// Столбцы Rz * Ry * Rx, умноженные на масштаб
+			Value szsy = Ops::mul(sz, sy);
+			Value czsy = Ops::mul(cz, sy);
+			Value m00 = Ops::mul(Ops::mul(cz, cy), scaleX);
+			Value m01 = Ops::mul(Ops::mul(sz, cy), scaleX);
+			Value m02 = Ops::mul(Ops::sub(Ops::set(0.0f), sy), scaleX);
+			Value m10 = Ops::mul(Ops::sub(Ops::mul(czsy, sx), Ops::mul(sz, cx)), scaleY);
+			Value m11 = Ops::mul(Ops::add(Ops::mul(szsy, sx), Ops::mul(cz, cx)), scaleY);
+			Value m12 = Ops::mul(Ops::mul(cy, sx), scaleY);
+			Value m20 = Ops::mul(Ops::add(Ops::mul(czsy, cx), Ops::mul(sz, sx)), scaleZ);
+			Value m21 = Ops::mul(Ops::sub(Ops::mul(szsy, cx), Ops::mul(cz, sx)), scaleZ);
+			Value m22 = Ops::mul(Ops::mul(cy, cx), scaleZ);
+
+			// Сдвиг: origin + position - (R * S) * origin
+			Value ox = Ops::load(arrays.origin[0] + i);
+			Value oy = Ops::load(arrays.origin[1] + i);
+			Value oz = Ops::load(arrays.origin[2] + i);
+			Value tx = Ops::sub(Ops::add(ox, Ops::load(arrays.position[0] + i)), Ops::add(Ops::add(Ops::mul(m00, ox), Ops::mul(m10, oy)), Ops::mul(m20, oz)));
+			Value ty = Ops::sub(Ops::add(oy, Ops::load(arrays.position[1] + i)), Ops::add(Ops::add(Ops::mul(m01, ox), Ops::mul(m11, oy)), Ops::mul(m21, oz)));
+			Value tz = Ops::sub(Ops::add(oz, Ops::load(arrays.position[2] + i)), Ops::add(Ops::add(Ops::mul(m02, ox), Ops::mul(m12, oy)), Ops::mul(m22, oz)));
+
+			Ops::store(columns[0], m00); Ops::store(columns[1], m01); Ops::store(columns[2], m02);
+			Ops::store(columns[3], m10); Ops::store(columns[4], m11); Ops::store(columns[5], m12);
+			Ops::store(columns[6], m20); Ops::store(columns[7], m21); Ops::store(columns[8], m22);
+			Ops::store(columns[9], tx); Ops::store(columns[10], ty); Ops::store(columns[11], tz);
+
+			// Запись матриц только измененных записей пакета
+			for (size_t k = 0; k < Ops::WIDTH; k++)
+			{
+				if (arrays.dirty[i + k] == 0) continue;
+
+				glm::mat4& matrix = arrays.matrices[i + k];
+				matrix[0] = glm::vec4(columns[0][k], columns[1][k], columns[2][k], 0.0f);
+				matrix[1] = glm::vec4(columns[3][k], columns[4][k], columns[5][k], 0.0f);
+				matrix[2] = glm::vec4(columns[6][k], columns[7][k], columns[8][k], 0.0f);
+				matrix[3] = glm::vec4(columns[9][k], columns[10][k], columns[11][k], 1.0f);
+				arrays.dirty[i + k] = 0;
+				(*updated)++;
+			}
+		}
+
+		return i;
+	}
+
+	/**
+	* \brief Конструктор
+	*/
+	TransformStore::TransformStore() :
+		count_(0),
+		dirtyCount_(0)
+	{}
+
+	/**
+	* \brief Изменить кол-во записей
+	* \param count Кол-во записей (новые записи - единичное положение, помечены измененными)
+	*/
+	void TransformStore::resize(size_t count)
+	{
+		if (count == this->count_) return;
+
+		std::vector<GLfloat>* zeroes[] = { &originX_, &originY_, &originZ_, &rotationX_, &rotationY_, &rotationZ_, &positionX_, &positionY_, &positionZ_ };
+		for (std::vector<GLfloat>* component : zeroes) component->resize(count, 0.0f);
+
+		std::vector<GLfloat>* ones[] = { &scaleX_, &scaleY_, &scaleZ_ };
+		for (std::vector<GLfloat>* component : ones) component->resize(count, 1.0f);
+
+		this->dirty_.resize(count, 1);
+		this->matrices_.resize(count, glm::mat4(1.0f));
+
+		this->count_ = count;
+		this->dirtyCount_ = static_cast<size_t>(std::count(this->dirty_.begin(), this->dirty_.end(), 1));
+	}
+
+	/**
+	* \brief Кол-во записей
+	* \return Целое число
+	*/
+	size_t TransformStore::size() const
+	{
+		return this->count_;
+	}
+
+	/**
+	* \brief Установить положение записи
+	* \param index Индекс записи
+	* \param origin Локальный центр
+	* \param rotation Поворот по осям (градусы)
+	* \param position Положение
+	* \param scale Масштаб
+	* \return Отличается ли положение от хранимого (запись помечена измененной)
+	*/
+	bool TransformStore::set(size_t index, const glm::vec3& origin, const glm::vec3& rotation, const glm::vec3& position, const glm::vec3& scale)
+	{
+		bool changed =
+			this->originX_[index] != origin.x || this->originY_[index] != origin.y || this->originZ_[index] != origin.z ||
+			this->rotationX_[index] != rotation.x || this->rotationY_[index] != rotation.y || this->rotationZ_[index] != rotation.z ||
+			this->positionX_[index] != position.x || this->positionY_[index] != position.y || this->positionZ_[index] != position.z ||
+			this->scaleX_[index] != scale.x || this->scaleY_[index] != scale.y || this->scaleZ_[index] != scale.z;
+
+		if (!changed) return false;
+
+		this->originX_[index] = origin.x; this->originY_[index] = origin.y; this->originZ_[index] = origin.z;
+		this->rotationX_[index] = rotation.x; this->rotationY_[index] = rotation.y; this->rotationZ_[index] = rotation.z;
+		this->positionX_[index] = position.x; this->positionY_[index] = position.y; this->positionZ_[index] = position.z;
+		this->scaleX_[index] = scale.x; this->scaleY_[index] = scale.y; this->scaleZ_[index] = scale.z;
+
+		if (this->dirty_[index] == 0) {
+			this->dirty_[index] = 1;
+			this->dirtyCount_++;
+		}
+
+		return true;
+	}
+
+	/**
+	* \brief Пересчитать матрицы измененных записей
+	* \param simd Использовать SIMD инструкции (false - только скалярный путь, для сравнения)
+	* \return Кол-во пересчитанных матриц
+	*/
+	size_t TransformStore::update(bool simd)
+	{
+		if (this->dirtyCount_ == 0) return 0;
+
+		size_t updated = 0;
+		size_t i = 0;
+
+		if (simd)
+		{
+			TransformArrays arrays = {
+				{ this->originX_.data(), this->originY_.data(), this->originZ_.data() },
+				{ this->rotationX_.data(), this->rotationY_.data(), this->rotationZ_.data() },
+				{ this->positionX_.data(), this->positionY_.data(), this->positionZ_.data() },
+				{ this->scaleX_.data(), this->scaleY_.data(), this->scaleZ_.data() },
+				this->dirty_.data(),
+				this->matrices_.data()
+			};
+
+#ifdef OGL_TRANSFORM_STORE_AVX
+			i = UpdateBatches<TransformOps8>(arrays, i, this->count_, &updated);
+#endif
+#ifdef OGL_TRANSFORM_STORE_SSE
+			i = UpdateBatches<TransformOps4>(arrays, i, this->count_, &updated);
+#endif
+		}
+
+		// Остаток (или все записи, если SIMD недоступен)
+		for (; i < this->count_; i++)
+		{
+			if (this->dirty_[i] == 0) continue;
+
+			this->matrices_[i] = TransformStore::composeMatrix(
+				{ this->originX_[i], this->originY_[i], this->originZ_[i] },
+				{ this->rotationX_[i], this->rotationY_[i], this->rotationZ_[i] },
+				{ this->positionX_[i], this->positionY_[i], this->positionZ_[i] },
+				{ this->scaleX_[i], this->scaleY_[i], this->scaleZ_[i] });
+
+			this->dirty_[i] = 0;
+			updated++;
+		}
+
+		this->dirtyCount_ = 0;
+		return updated;
+	}
+
+	/**
+	* \brief Получить матрицу модели
+	* \param index Индекс записи
+	* \return Матрица (рассчитанная последним вызовом update)
+	*/
+	const glm::mat4& TransformStore::getMatrix(size_t index) const
+	{
+		return this->matrices_[index];
+	}
+
+	/**
+	* \brief Рассчитать матрицу модели одной записи (скалярный путь)
+	* \param origin Локальный центр
+	* \param rotation Поворот по осям (градусы)
+	* \param position Положение
+	* \param scale Масштаб
+	* \return Матрица
+	*/
+	glm::mat4 TransformStore::composeMatrix(const glm::vec3& origin, const glm::vec3& rotation, const glm::vec3& position, const glm::vec3& scale)
+	{
+		GLfloat sx = std::sin(glm::radians(rotation.x)), cx = std::cos(glm::radians(rotation.x));
+		GLfloat sy = std::sin(glm::radians(rotation.y)), cy = std::cos(glm::radians(rotation.y));
+		GLfloat sz = std::sin(glm::radians(rotation.z)), cz = std::cos(glm::radians(rotation.z));
+
+		// Столбцы Rz * Ry * Rx, умноженные на масштаб
+		glm::vec3 column0 = glm::vec3(cz * cy, sz * cy, -sy) * scale.x;
+		glm::vec3 column1 = glm::vec3(cz * sy * sx - sz * cx, sz * sy * sx + cz * cx, cy * sx) * scale.y;
+		glm::vec3 column2 = glm::vec3(cz * sy * cx + sz * sx, sz * sy * cx - cz * sx, cy * cx) * scale.z;
+		glm::vec3 translation = origin + position - (column0 * origin.x + column1 * origin.y + column2 * origin.z);
+
+		glm::mat4 result;
+		result[0] = glm::vec4(column0, 0.0f);
+		result[1] = glm::vec4(column1, 0.0f);
+		result[2] = glm::vec4(column2, 0.0f);
+		result[3] = glm::vec4(translation, 1.0f);
+		return result;
+	}
+}
@@ -0,0 +1,87 @@
+﻿#pragma once
+
+#include <vector>
+#include <GL/glew.h>
+#include <glm/glm.hpp>
+
+namespace ogl
+{
+	/**
+	 * \brief Хранилище положений мешей в виде структуры массивов
+	 * \details Каждая компонента положения (локальный центр, поворот в градусах, сдвиг, масштаб) хранится в своем
+	 * массиве. Установка положения помечает запись измененной только если значения отличаются от хранимых, update()
+	 * пересчитывает матрицы модели только измененных записей. Пересчет выполняется пакетами по 8 (AVX2) или 4 (SSE2)
+	 * записи - синусы и косинусы углов считаются полиномами для всего пакета сразу, остаток обрабатывается по одной.
+	 * Матрица совпадает с StaticMesh::getModelMatrix: T(origin) * T(position) * Rz * Ry * Rx * S * T(-origin)
+	 */
+	class TransformStore
+	{
+	private:
+		std::vector<GLfloat> originX_, originY_, originZ_;           // Локальные центры
+		std::vector<GLfloat> rotationX_, rotationY_, rotationZ_;     // Повороты (градусы)
+		std::vector<GLfloat> positionX_, positionY_, positionZ_;     // Положения
+		std::vector<GLfloat> scaleX_, scaleY_, scaleZ_;              // Масштабы
+		std::vector<GLubyte> dirty_;                                 // Признаки изменения (1 - матрицу нужно пересчитать)
+		std::vector<glm::mat4> matrices_;                            // Матрицы модели
+		size_t count_;                                               // Кол-во записей
+		size_t dirtyCount_;                                          // Кол-во измененных записей
+
+	public:
+		/**
+		 * \brief Конструктор
+		 */
+		TransformStore();
+
+		/**
+		 * \brief Деструктор
+		 */
+		~TransformStore() = default;
+
+		/**
+		 * \brief Изменить кол-во записей
+		 * \param count Кол-во записей (новые записи - единичное положение, помечены измененными)
+		 */
+		void resize(size_t count);
+
+		/**
+		 * \brief Кол-во записей
+		 * \return Целое число
+		 */
+		size_t size() const;
+
+		/**
+		 * \brief Установить положение записи
+		 * \param index Индекс записи
+		 * \param origin Локальный центр
+		 * \param rotation Поворот по осям (градусы)
+		 * \param position Положение
+		 * \param scale Масштаб
+		 * \return Отличается ли положение от хранимого (запись помечена измененной)
+		 */
+		bool set(size_t index, const glm::vec3& origin, const glm::vec3& rotation, const glm::vec3& position, const glm::vec3& scale);
+
+		/**
+		 * \brief Пересчитать матрицы измененных записей
+		 * \param simd Использовать SIMD инструкции (false - только скалярный путь, для сравнения)
+		 * \return Кол-во пересчитанных матриц
+		 */
+		size_t update(bool simd = true);
+
+		/**
+		 * \brief Получить матрицу модели
+		 * \param index Индекс записи
+		 * \return Матрица (рассчитанная последним вызовом update)
+		 */
+		const glm::mat4& getMatrix(size_t index) const;
+
+		/**
+		 * \brief Рассчитать матрицу модели одной записи (скалярный путь)
+		 * \param origin Локальный центр
+		 * \param rotation Поворот по осям (градусы)
+		 * \param position Положение
+		 * \param scale Масштаб
+		 * \return Матрица
+		 */
+		static glm::mat4 composeMatrix(const glm::vec3& origin, const glm::vec3& rotation, const glm::vec3& position, const glm::vec3& scale);
+	};
+}
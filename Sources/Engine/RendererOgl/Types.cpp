@@ -1,4 +1,5 @@
 ﻿#include "Types.h"
+#include <algorithm>
 
 namespace ogl
 {
@@ -85,4 +86,25 @@ namespace ogl
 	{
 		return std::find(this->indices.begin(), this->indices.end(), index) != this->indices.end();
 	}
+
+	/**
+	* \brief Получить ограничивающий объем после трансформации
+	* \param matrix Матрица трансформации (например, матрица модели)
+	* \return Новый ограничивающий объем, содержащий все трансформированные углы исходного
+	*/
+	BoundingBox BoundingBox::transformed(const glm::mat4& matrix) const
+	{
+		// Центр и половина размеров исходного объема
+		glm::vec3 center = (this->min + this->max) * 0.5f;
+		glm::vec3 extents = (this->max - this->min) * 0.5f;
+
+		// Новый центр - просто трансформированный старый
+		glm::vec3 newCenter = glm::vec3(matrix * glm::vec4(center, 1.0f));
+
+		// Новые половины размеров - сумма модулей проекций осей (без перебора всех 8 углов)
+		glm::mat3 absMatrix(glm::abs(glm::vec3(matrix[0])), glm::abs(glm::vec3(matrix[1])), glm::abs(glm::vec3(matrix[2])));
+		glm::vec3 newExtents = absMatrix * extents;
+
+		return{ newCenter - newExtents, newCenter + newExtents };
+	}
 }
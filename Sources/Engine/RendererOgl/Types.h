@@ -1,6 +1,6 @@
 ﻿#pragma once
 
-#include <gl/glew.h>
+#include <GL/glew.h>
 #include <glm/glm.hpp>
 #include <vector>
 
@@ -98,6 +98,58 @@ namespace ogl
 		GLuint samples;                   // Кол-во семплов (используется при мульти-семплинге)
 	};
 
+	/**
+	 * \brief Ограничивающий объем (axis aligned bounding box)
+	 * \details Используется для грубых проверок видимости и пересечений (например, с областью отсечения камеры)
+	 */
+	struct BoundingBox
+	{
+		glm::vec3 min;  // Минимальная точка
+		glm::vec3 max;  // Максимальная точка
+
+		/**
+		 * \brief Получить ограничивающий объем после трансформации
+		 * \param matrix Матрица трансформации (например, матрица модели)
+		 * \return Новый ограничивающий объем, содержащий все трансформированные углы исходного
+		 */
+		BoundingBox transformed(const glm::mat4& matrix) const;
+	};
+
+	/**
+	 * \brief Ребро геометрии со смежностями
+	 * \details Хранит индексы вершин ребра (в порядке обхода первого полигона) и индексы полигонов, которым ребро принадлежит
+	 */
+	struct AdjacencyEdge
+	{
+		glm::uint32 v0;        // Первая вершина ребра
+		glm::uint32 v1;        // Вторая вершина ребра
+		glm::i32 triangle0;    // Полигон, которому принадлежит ребро
+		glm::i32 triangle1;    // Смежный полигон (-1 если ребро граничное, т.е. смежной стороной является фантомная вершина)
+	};
+
+	/**
+	 * \brief Данные геометрии, необходимые для построения теневых объемов на CPU
+	 * \details Формируются из геометрии со смежностями. Данные для проверки обращенности полигонов к источнику хранятся
+	 * в виде структуры массивов (дополненных до кратности 4), что позволяет проверять по несколько полигонов за раз
+	 */
+	struct ShadowCasterData
+	{
+		std::vector<glm::vec3> positions;    // Положения вершин (индексация совпадает с индексацией геометрии)
+		std::vector<glm::uint32> triangles;  // Индексы полигонов (по 3 на полигон)
+		std::vector<AdjacencyEdge> edges;    // Уникальные ребра с информацией о смежных полигонах
+
+		std::vector<GLfloat> normalX;        // Компонента X (не нормализованной) нормали полигона
+		std::vector<GLfloat> normalY;        // Компонента Y (не нормализованной) нормали полигона
+		std::vector<GLfloat> normalZ;        // Компонента Z (не нормализованной) нормали полигона
+		std::vector<GLfloat> centroidDot;    // Скалярное произведение нормали и суммы вершин полигона
+
+		/**
+		 * \brief Кол-во полигонов
+		 * \return Целое число
+		 */
+		size_t getTriangleCount() const { return triangles.size() / 3; }
+	};
+
 	/**
 	 * \brief Коэфициенты маппинга текстры
 	 */
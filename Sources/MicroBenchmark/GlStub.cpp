@@ -0,0 +1,70 @@
+﻿#include "GlStub.h"
+
+namespace ogl
+{
+	/**
+	* \brief Проинициализирован ли GLEW
+	*/
+	extern bool _isGlewInitialised;
+}
+
+// Последний выданный ID объекта
+static GLuint _lastObjectId = 0;
+
+// Объем переданных в буферы данных
+static size_t _uploadedBytes = 0;
+
+static void GLAPIENTRY StubGenObjects(GLsizei n, GLuint* ids)
+{
+	for (GLsizei i = 0; i < n; i++) ids[i] = ++_lastObjectId;
+}
+
+static void GLAPIENTRY StubDeleteObjects(GLsizei, const GLuint*)
+{}
+
+static void GLAPIENTRY StubBindVertexArray(GLuint)
+{}
+
+static void GLAPIENTRY StubBindBuffer(GLenum, GLuint)
+{}
+
+static void GLAPIENTRY StubBufferData(GLenum, GLsizeiptr size, const void*, GLenum)
+{
+	_uploadedBytes += static_cast<size_t>(size);
+}
+
+static void GLAPIENTRY StubVertexAttribPointer(GLuint, GLint, GLenum, GLboolean, GLsizei, const void*)
+{}
+
+static void GLAPIENTRY StubEnableVertexAttribArray(GLuint)
+{}
+
+/**
+* \brief Подменить функции OpenGL, используемые ресурсами геометрии, заглушками
+* \details Указатели функций GLEW заменяются функциями, которые только выдают ID объектов и считают объем
+* "загруженных" данных. Позволяет создавать ресурсы геометрии без контекста и мерить только работу CPU
+*/
+void InstallGlStub()
+{
+	__glewGenVertexArrays = StubGenObjects;
+	__glewDeleteVertexArrays = StubDeleteObjects;
+	__glewBindVertexArray = StubBindVertexArray;
+	__glewGenBuffers = StubGenObjects;
+	__glewDeleteBuffers = StubDeleteObjects;
+	__glewBindBuffer = StubBindBuffer;
+	__glewBufferData = StubBufferData;
+	__glewVertexAttribPointer = StubVertexAttribPointer;
+	__glewEnableVertexAttribArray = StubEnableVertexAttribArray;
+
+	// Ресурсы не должны пытаться инициализировать GLEW (контекста нет)
+	ogl::_isGlewInitialised = true;
+}
+
+/**
+* \brief Объем данных, переданных в буферы с момента установки заглушек
+* \return Кол-во байт
+*/
+size_t GetStubUploadedBytes()
+{
+	return _uploadedBytes;
+}
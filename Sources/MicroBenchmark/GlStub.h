@@ -0,0 +1,16 @@
+﻿#pragma once
+
+#include <GL/glew.h>
+
+/**
+ * \brief Подменить функции OpenGL, используемые ресурсами геометрии, заглушками
+ * \details Указатели функций GLEW заменяются функциями, которые только выдают ID объектов и считают объем
+ * "загруженных" данных. Позволяет создавать ресурсы геометрии без контекста и мерить только работу CPU
+ */
+void InstallGlStub();
+
+/**
+ * \brief Объем данных, переданных в буферы с момента установки заглушек
+ * \return Кол-во байт
+ */
+size_t GetStubUploadedBytes();
@@ -0,0 +1,89 @@
+﻿#include "MemoryStats.h"
+
+#include <new>
+#include <atomic>
+#include <cstdlib>
+
+#ifdef _WIN32
+#include <Windows.h>
+#include <Psapi.h>
+#pragma comment(lib, "psapi.lib")
+#else
+#include <sys/resource.h>
+#endif
+
+// Счетчики (атомарные - драйвер и стандартная библиотека могут выделять память из других потоков)
+static std::atomic<size_t> _allocationCount(0);
+static std::atomic<size_t> _allocationBytes(0);
+
+/**
+* \brief Выделение памяти с подсчетом
+* \param size Размер
+* \return Указатель на память
+*/
+static void* CountedAlloc(size_t size)
+{
+	_allocationCount++;
+	_allocationBytes += size;
+
+	void* pointer = malloc(size > 0 ? size : 1);
+	if (pointer == nullptr) throw std::bad_alloc();
+	return pointer;
+}
+
+void* operator new(size_t size)
+{
+	return CountedAlloc(size);
+}
+
+void* operator new[](size_t size)
+{
+	return CountedAlloc(size);
+}
+
+void operator delete(void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer) noexcept
+{
+	free(pointer);
+}
+
+void operator delete(void* pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+void operator delete[](void* pointer, size_t) noexcept
+{
+	free(pointer);
+}
+
+/**
+* \brief Текущие значения счетчиков выделений
+* \return Счетчики
+*/
+AllocationCounters GetAllocationCounters()
+{
+	return { _allocationCount.load(), _allocationBytes.load() };
+}
+
+/**
+* \brief Пиковый объем резидентной памяти процесса (peak RSS / peak working set)
+* \return Кол-во байт
+*/
+size_t GetPeakResidentMemory()
+{
+#ifdef _WIN32
+	PROCESS_MEMORY_COUNTERS counters = {};
+	GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+	return static_cast<size_t>(counters.PeakWorkingSetSize);
+#else
+	// ru_maxrss - в килобайтах
+	struct rusage usage = {};
+	getrusage(RUSAGE_SELF, &usage);
+	return static_cast<size_t>(usage.ru_maxrss) * 1024;
+#endif
+}
@@ -0,0 +1,25 @@
+﻿#pragma once
+
+#include <cstddef>
+
+/**
+ * \brief Счетчики выделений памяти
+ * \details Считаются все вызовы глобального operator new в процессе (он замещается в MemoryStats.cpp)
+ */
+struct AllocationCounters
+{
+	size_t count;   // Кол-во выделений
+	size_t bytes;   // Объем выделенной памяти (байт)
+};
+
+/**
+ * \brief Текущие значения счетчиков выделений
+ * \return Счетчики
+ */
+AllocationCounters GetAllocationCounters();
+
+/**
+ * \brief Пиковый объем резидентной памяти процесса (peak RSS / peak working set)
+ * \return Кол-во байт
+ */
+size_t GetPeakResidentMemory();
@@ -0,0 +1,92 @@
+﻿#include "MeshGenerator.h"
+
+#include <cstdio>
+#include <cmath>
+#include <stdexcept>
+
+/**
+* \brief Создать индексированную сетку (волнистая поверхность) с заданным кол-вом треугольников
+* \param triangles Желаемое кол-во треугольников (фактическое - ближайшее вида 2*n*n)
+* \return Геометрия
+*/
+SyntheticMesh MakeGridMesh(size_t triangles)
+{
+	size_t cells = static_cast<size_t>(std::sqrt(static_cast<double>(triangles) / 2.0) + 0.5);
+	if (cells < 1) cells = 1;
+
+	SyntheticMesh mesh;
+	mesh.vertices.reserve((cells + 1) * (cells + 1));
+	mesh.indices.reserve(cells * cells * 6);
+
+	for (size_t z = 0; z <= cells; z++)
+	{
+		for (size_t x = 0; x <= cells; x++)
+		{
+			GLfloat u = static_cast<GLfloat>(x) / static_cast<GLfloat>(cells);
+			GLfloat v = static_cast<GLfloat>(z) / static_cast<GLfloat>(cells);
+			GLfloat height = std::sin(u * 20.0f) * std::cos(v * 20.0f) * 0.05f;
+
+			ogl::Vertex vertex = {};
+			vertex.position = { u * 2.0f - 1.0f, height, v * 2.0f - 1.0f };
+			vertex.color = { 1.0f, 1.0f, 1.0f };
+			vertex.uv = { u, v };
+			vertex.normal = { 0.0f, 1.0f, 0.0f };
+			mesh.vertices.push_back(vertex);
+		}
+	}
+
+	for (size_t z = 0; z < cells; z++)
+	{
+		for (size_t x = 0; x < cells; x++)
+		{
+			GLuint current = static_cast<GLuint>(z * (cells + 1) + x);
+			GLuint next = static_cast<GLuint>(current + cells + 1);
+			mesh.indices.insert(mesh.indices.end(), { current, next + 1, current + 1, current, next, next + 1 });
+		}
+	}
+
+	return mesh;
+}
+
+/**
+* \brief Развернуть индексированную геометрию в не индексированную (по 3 вершины на треугольник)
+* \param mesh Индексированная геометрия
+* \return Массив вершин
+*/
+std::vector<ogl::Vertex> MakeNonIndexed(const SyntheticMesh& mesh)
+{
+	std::vector<ogl::Vertex> vertices;
+	vertices.reserve(mesh.indices.size());
+	for (GLuint index : mesh.indices) vertices.push_back(mesh.vertices[index]);
+	return vertices;
+}
+
+/**
+* \brief Записать геометрию в .obj файл (формат граней vp/vt/vn)
+* \param mesh Геометрия
+* \param path Путь к файлу
+* \return Размер файла (байт)
+*/
+size_t WriteObjFile(const SyntheticMesh& mesh, const std::string& path)
+{
+	FILE* file = fopen(path.c_str(), "wb");
+	if (file == nullptr) {
+		throw std::runtime_error("MicroBenchmark: Can't write file " + path);
+	}
+
+	for (const ogl::Vertex& v : mesh.vertices) fprintf(file, "v %.6f %.6f %.6f\n", v.position.x, v.position.y, v.position.z);
+	for (const ogl::Vertex& v : mesh.vertices) fprintf(file, "vt %.6f %.6f\n", v.uv.x, v.uv.y);
+	for (const ogl::Vertex& v : mesh.vertices) fprintf(file, "vn %.6f %.6f %.6f\n", v.normal.x, v.normal.y, v.normal.z);
+
+	for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3)
+	{
+		GLuint a = mesh.indices[i] + 1;
+		GLuint b = mesh.indices[i + 1] + 1;
+		GLuint c = mesh.indices[i + 2] + 1;
+		fprintf(file, "f %u/%u/%u %u/%u/%u %u/%u/%u\n", a, a, a, b, b, b, c, c, c);
+	}
+
+	long size = ftell(file);
+	fclose(file);
+	return static_cast<size_t>(size);
+}
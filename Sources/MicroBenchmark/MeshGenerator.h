@@ -0,0 +1,49 @@
+﻿#pragma once
+
+#include <vector>
+#include <string>
+
+#include "../Engine/RendererOgl/Types.h"
+
+/**
+ * \brief Синтетическая геометрия для замеров
+ */
+struct SyntheticMesh
+{
+	std::vector<ogl::Vertex> vertices;   // Вершины
+	std::vector<GLuint> indices;         // Индексы (по 3 на треугольник)
+
+	/**
+	 * \brief Кол-во треугольников
+	 * \return Кол-во треугольников
+	 */
+	size_t getTriangleCount() const { return this->indices.size() / 3; }
+
+	/**
+	 * \brief Объем вершин и индексов
+	 * \return Кол-во байт
+	 */
+	size_t getByteSize() const { return this->vertices.size() * sizeof(ogl::Vertex) + this->indices.size() * sizeof(GLuint); }
+};
+
+/**
+ * \brief Создать индексированную сетку (волнистая поверхность) с заданным кол-вом треугольников
+ * \param triangles Желаемое кол-во треугольников (фактическое - ближайшее вида 2*n*n)
+ * \return Геометрия
+ */
+SyntheticMesh MakeGridMesh(size_t triangles);
+
+/**
+ * \brief Развернуть индексированную геометрию в не индексированную (по 3 вершины на треугольник)
+ * \param mesh Индексированная геометрия
+ * \return Массив вершин
+ */
+std::vector<ogl::Vertex> MakeNonIndexed(const SyntheticMesh& mesh);
+
+/**
+ * \brief Записать геометрию в .obj файл (формат граней vp/vt/vn)
+ * \param mesh Геометрия
+ * \param path Путь к файлу
+ * \return Размер файла (байт)
+ */
+size_t WriteObjFile(const SyntheticMesh& mesh, const std::string& path);
@@ -0,0 +1,426 @@
+﻿#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <chrono>
+#include <functional>
+#include <cstdio>
+#include <cstdlib>
+
+#include "../Engine/RendererOgl/StaticGeometryResource.h"
+#include "../Engine/RendererOgl/StaticMesh.h"
+#include "../Engine/RendererOgl/TransformStore.h"
+#include "../Engine/Tools/ObjLoader.h"
+
+#include "GlStub.h"
+#include "MemoryStats.h"
+#include "MeshGenerator.h"
+
+#define TRANSFORM_BENCHMARK_MESHES 100000
+
+/**
+ * \brief Параметры запуска
+ */
+struct MicroBenchmarkOptions
+{
+	std::vector<size_t> sizes;     // Размеры геометрии (кол-во треугольников)
+	size_t quadraticLimit;         // Максимальный размер для ядер с квадратичной сложностью
+	double minTime;                // Минимальное суммарное время замера ядра (мс)
+	std::string tempDir;           // Каталог для сгенерированных .obj файлов
+	std::string csvPath;           // Файл результата (пусто - не сохранять)
+	std::string baselinePath;      // Файл базового результата (пусто - не сравнивать)
+	double tolerance;              // Допустимое ухудшение относительно базового результата (доля)
+};
+
+/**
+ * \brief Результат замера ядра на одном размере
+ */
+struct KernelResult
+{
+	std::string kernel;            // Название ядра
+	size_t items;                  // Кол-во обработанных элементов за вызов (треугольников или вызовов)
+	size_t iterations;             // Кол-во вызовов
+	double msPerCall;              // Время вызова (мс, минимальное из вызовов)
+	double itemsPerSecond;         // Пропускная способность (элементов в секунду)
+	double mbPerSecond;            // Пропускная способность (МБ входных данных в секунду)
+	double allocationsPerCall;     // Кол-во выделений памяти на вызов
+	double kbPerCall;              // Объем выделенной памяти на вызов (КБ)
+	double peakRssMb;              // Пиковый объем памяти процесса после замера (МБ)
+};
+
+/**
+ * \brief Замерить ядро
+ * \param name Название
+ * \param items Кол-во элементов за вызов
+ * \param bytes Объем входных данных за вызов (байт)
+ * \param minTime Минимальное суммарное время (мс)
+ * \param prepare Подготовка входных данных перед вызовом (не измеряется)
+ * \param run Вызов ядра
+ * \return Результат
+ * \details Вызовы повторяются, пока суммарное время меньше minTime (не более 1000 раз). Время - минимальное
+ * из вызовов (наименее подверженное шуму), выделения памяти - среднее
+ */
+KernelResult Measure(const std::string& name, size_t items, size_t bytes, double minTime, const std::function<void()>& prepare, const std::function<void()>& run)
+{
+	double total = 0.0;
+	double best = 0.0;
+	size_t iterations = 0;
+	AllocationCounters allocated = {};
+
+	while ((total < minTime && iterations < 1000) || iterations == 0)
+	{
+		prepare();
+
+		AllocationCounters before = GetAllocationCounters();
+		auto start = std::chrono::high_resolution_clock::now();
+		run();
+		auto end = std::chrono::high_resolution_clock::now();
+		AllocationCounters after = GetAllocationCounters();
+
+		double time = std::chrono::duration<double, std::milli>(end - start).count();
+		best = iterations == 0 ? time : std::min(best, time);
+		total += time;
+		allocated.count += after.count - before.count;
+		allocated.bytes += after.bytes - before.bytes;
+		iterations++;
+	}
+
+	KernelResult result = {};
+	result.kernel = name;
+	result.items = items;
+	result.iterations = iterations;
+	result.msPerCall = best;
+	result.itemsPerSecond = best > 0.0 ? static_cast<double>(items) / (best / 1000.0) : 0.0;
+	result.mbPerSecond = best > 0.0 ? (static_cast<double>(bytes) / (1024.0 * 1024.0)) / (best / 1000.0) : 0.0;
+	result.allocationsPerCall = static_cast<double>(allocated.count) / static_cast<double>(iterations);
+	result.kbPerCall = static_cast<double>(allocated.bytes) / 1024.0 / static_cast<double>(iterations);
+	result.peakRssMb = static_cast<double>(GetPeakResidentMemory()) / (1024.0 * 1024.0);
+
+	printf("%-28s %10zu %6zu %12.3f %12.2f %10.1f %12.1f %12.1f %10.1f\n",
+		result.kernel.c_str(), result.items, result.iterations, result.msPerCall, result.itemsPerSecond / 1000000.0,
+		result.mbPerSecond, result.allocationsPerCall, result.kbPerCall, result.peakRssMb);
+	fflush(stdout);
+
+	return result;
+}
+
+/**
+ * \brief Замерить все ядра на геометрии одного размера
+ * \param triangles Кол-во треугольников
+ * \param options Параметры запуска
+ * \param results Массив результатов (дополняется)
+ */
+void RunKernels(size_t triangles, const MicroBenchmarkOptions& options, std::vector<KernelResult>& results)
+{
+	SyntheticMesh mesh = MakeGridMesh(triangles);
+	size_t count = mesh.getTriangleCount();
+	size_t meshBytes = mesh.getByteSize();
+
+	// З А Г Р У З К А  .O B J
+
+	std::string objPath = options.tempDir + "microbenchmark_" + std::to_string(count) + ".obj";
+	size_t fileSize = WriteObjFile(mesh, objPath);
+
+	ObjLoader loader;
+	results.push_back(Measure("ObjLoader::LoadFromFile", count, fileSize, options.minTime,
+		[&]() { loader.Clear(); },
+		[&]() { loader.LoadFromFile(objPath); }));
+
+	// Поиск повторяющихся вершин выполняется линейным поиском - на больших файлах замер занял бы часы
+	if (triangles <= options.quadraticLimit) {
+		results.push_back(Measure("ObjLoader::MakeOglResource", count, meshBytes, options.minTime,
+			[]() {},
+			[&]() { loader.MakeOglRendererResource(false, false, false); }));
+	}
+
+	loader.Clear();
+	remove(objPath.c_str());
+
+	// Н О Р М А Л И  И  С М Е Ж Н О С Т И
+
+	std::vector<ogl::Vertex> vertices;
+	results.push_back(Measure("recalcNormalsForIndexed", count, meshBytes, options.minTime,
+		[&]() { vertices = mesh.vertices; },
+		[&]() { ogl::StaticGeometryResource::recalcNormalsForIndexed(&vertices, mesh.indices, true); }));
+
+	std::vector<ogl::Vertex> nonIndexed = MakeNonIndexed(mesh);
+	results.push_back(Measure("recalcNormalsForNonIndexed", count, nonIndexed.size() * sizeof(ogl::Vertex), options.minTime,
+		[&]() { vertices = nonIndexed; },
+		[&]() { ogl::StaticGeometryResource::recalcNormalsForNonIndexed(&vertices, true); }));
+	nonIndexed.clear();
+	nonIndexed.shrink_to_fit();
+
+	results.push_back(Measure("buildAdjacency", count, meshBytes, options.minTime,
+		[&]() { vertices = mesh.vertices; },
+		[&]() { ogl::StaticGeometryResource::buildAdjacency(&vertices, mesh.indices); }));
+
+	vertices.clear();
+	vertices.shrink_to_fit();
+
+	// П О Л И Г О Н Ы  И  М А Т Р И Ц Ы
+
+	// Результат суммируется, чтобы компилятор не выбросил вычисления
+	volatile GLfloat sink = 0.0f;
+
+	ogl::Polygon polygon;
+	polygon.vertices.resize(3);
+	results.push_back(Measure("Polygon::calculateUVTangent", count, count * 3 * sizeof(ogl::Vertex), options.minTime,
+		[]() {},
+		[&]() {
+			GLfloat sum = 0.0f;
+			for (size_t i = 0; i + 2 < mesh.indices.size(); i += 3) {
+				polygon.vertices[0] = mesh.vertices[mesh.indices[i]];
+				polygon.vertices[1] = mesh.vertices[mesh.indices[i + 1]];
+				polygon.vertices[2] = mesh.vertices[mesh.indices[i + 2]];
+				sum += polygon.calculateUVTangent().x;
+			}
+			sink = sink + sum;
+		}));
+
+	// Матрица модели - по вызову на треугольник (меняется вращение, чтобы вызовы не были одинаковыми)
+	ogl::StaticMesh staticMesh(ogl::StaticMeshPart(nullptr));
+	staticMesh.origin = { 0.5f, 0.0f, 0.5f };
+	staticMesh.position = { 1.0f, 2.0f, 3.0f };
+	staticMesh.scale = { 2.0f, 2.0f, 2.0f };
+	results.push_back(Measure("StaticMesh::getModelMatrix", count, count * sizeof(glm::mat4), options.minTime,
+		[]() {},
+		[&]() {
+			GLfloat sum = 0.0f;
+			for (size_t i = 0; i < count; i++) {
+				staticMesh.rotation.y = static_cast<GLfloat>(i % 360);
+				sum += staticMesh.getModelMatrix()[3][0];
+			}
+			sink = sink + sum;
+		}));
+}
+
+/**
+ * \brief Замерить пересчет матриц модели большого кол-ва мешей
+ * \param options Параметры запуска
+ * \param results Массив результатов (дополняется)
+ * \details Сравниваются пересчет каждой матрицы отдельно, хранимые матрицы без изменений и пакетный пересчет
+ * хранилища (все записи или 1% измененных, скалярный и SIMD путь)
+ */
+void RunTransformKernels(const MicroBenchmarkOptions& options, std::vector<KernelResult>& results)
+{
+	const size_t count = TRANSFORM_BENCHMARK_MESHES;
+	volatile GLfloat sink = 0.0f;
+
+	// Меши с различными положениями (одна часть без геометрии - для матриц она не нужна)
+	std::vector<ogl::StaticMesh> meshes(count, ogl::StaticMesh(ogl::StaticMeshPart(nullptr)));
+	for (size_t i = 0; i < count; i++) {
+		meshes[i].origin = { 0.5f, 0.0f, 0.5f };
+		meshes[i].rotation = { static_cast<GLfloat>(i % 360), static_cast<GLfloat>((i * 7) % 360), static_cast<GLfloat>((i * 13) % 360) };
+		meshes[i].position = { static_cast<GLfloat>(i % 1000), 0.0f, static_cast<GLfloat>(i / 1000) };
+		meshes[i].scale = { 1.0f, 2.0f, 1.0f };
+	}
+
+	// Каждая матрица рассчитывается заново (положения меняются перед каждым вызовом)
+	GLfloat offset = 0.0f;
+	results.push_back(Measure("getModelMatrix moved", count, count * sizeof(glm::mat4), options.minTime,
+		[&]() {
+			offset += 1.0f;
+			for (ogl::StaticMesh& mesh : meshes) mesh.position.y = offset;
+		},
+		[&]() {
+			GLfloat sum = 0.0f;
+			for (const ogl::StaticMesh& mesh : meshes) sum += mesh.getModelMatrix()[3][1];
+			sink = sink + sum;
+		}));
+
+	// Положения не меняются - матрицы берутся из мешей
+	results.push_back(Measure("getModelMatrix cached", count, count * sizeof(glm::mat4), options.minTime,
+		[]() {},
+		[&]() {
+			GLfloat sum = 0.0f;
+			for (const ogl::StaticMesh& mesh : meshes) sum += mesh.getModelMatrix()[3][1];
+			sink = sink + sum;
+		}));
+
+	// Пакетный пересчет хранилища (изменения вносятся при подготовке, замеряется только пересчет)
+	ogl::TransformStore store;
+	store.resize(count);
+
+	const size_t dirtyStep[] = { 1, 100 };
+	const char* names[2][2] = {
+		{ "TransformStore all scalar", "TransformStore all SIMD" },
+		{ "TransformStore 1% scalar", "TransformStore 1% SIMD" }
+	};
+
+	for (size_t d = 0; d < 2; d++)
+	{
+		for (size_t simd = 0; simd < 2; simd++)
+		{
+			results.push_back(Measure(names[d][simd], count, count * sizeof(glm::mat4), options.minTime,
+				[&]() {
+					offset += 1.0f;
+					for (size_t i = 0; i < count; i += dirtyStep[d]) {
+						store.set(i, meshes[i].origin, meshes[i].rotation, meshes[i].position + glm::vec3(0.0f, offset, 0.0f), meshes[i].scale);
+					}
+				},
+				[&]() {
+					sink = sink + static_cast<GLfloat>(store.update(simd != 0));
+				}));
+		}
+	}
+}
+
+/**
+ * \brief Сохранить результаты в CSV
+ * \param path Путь к файлу
+ * \param results Результаты
+ */
+void WriteCsv(const std::string& path, const std::vector<KernelResult>& results)
+{
+	std::ofstream file(path);
+	if (file.fail()) {
+		throw std::runtime_error("MicroBenchmark: Can't write file " + path);
+	}
+
+	file << "kernel,items,iterations,ms_per_call,items_per_s,mb_per_s,allocs_per_call,kb_per_call,peak_rss_mb\n";
+	for (const KernelResult& r : results) {
+		file << r.kernel << "," << r.items << "," << r.iterations << "," << r.msPerCall << "," << r.itemsPerSecond << ","
+			<< r.mbPerSecond << "," << r.allocationsPerCall << "," << r.kbPerCall << "," << r.peakRssMb << "\n";
+	}
+}
+
+/**
+ * \brief Сравнить с результатами, сохраненными ранее (WriteCsv)
+ * \param path Путь к файлу базовых результатов
+ * \param results Результаты
+ * \param tolerance Допустимое ухудшение (доля)
+ * \return Есть ли ухудшение времени или кол-ва выделений памяти
+ */
+bool IsRegressed(const std::string& path, const std::vector<KernelResult>& results, double tolerance)
+{
+	std::ifstream file(path);
+	if (file.fail()) {
+		throw std::runtime_error("MicroBenchmark: Can't read baseline " + path);
+	}
+
+	// Ключ - ядро и размер, значение - время и кол-во выделений
+	std::map<std::string, std::pair<double, double>> baseline;
+	std::string line;
+	std::getline(file, line);
+
+	while (std::getline(file, line))
+	{
+		std::vector<std::string> fields;
+		std::stringstream stream(line);
+		std::string field;
+		while (std::getline(stream, field, ',')) fields.push_back(field);
+		if (fields.size() < 7) continue;
+
+		baseline[fields[0] + "/" + fields[1]] = { atof(fields[3].c_str()), atof(fields[6].c_str()) };
+	}
+
+	bool regressed = false;
+	for (const KernelResult& r : results)
+	{
+		auto it = baseline.find(r.kernel + "/" + std::to_string(r.items));
+		if (it == baseline.end()) continue;
+
+		if (r.msPerCall > it->second.first * (1.0 + tolerance)) {
+			printf("Regression: %s (%zu) %.3f ms, baseline %.3f ms\n", r.kernel.c_str(), r.items, r.msPerCall, it->second.first);
+			regressed = true;
+		}
+
+		// Кол-во выделений не зависит от машины - любое увеличение считается ухудшением
+		if (r.allocationsPerCall > it->second.second + 0.5) {
+			printf("Regression: %s (%zu) %.1f allocations, baseline %.1f\n", r.kernel.c_str(), r.items, r.allocationsPerCall, it->second.second);
+			regressed = true;
+		}
+	}
+
+	return regressed;
+}
+
+/**
+ * \brief Разбор параметров запуска
+ * \param argc Кол-во аргументов
+ * \param argv Аргументы
+ * \param options Параметры (заполняются)
+ * \return Удалось ли разобрать параметры
+ */
+bool ParseOptions(int argc, char* argv[], MicroBenchmarkOptions& options)
+{
+	options.sizes = { 1000, 10000, 100000, 1000000, 10000000 };
+	options.quadraticLimit = 100000;
+	options.minTime = 200.0;
+	options.tolerance = 0.1;
+
+	size_t maxTriangles = 10000000;
+
+	for (int i = 1; i + 1 < argc; i += 2)
+	{
+		std::string name = argv[i];
+		std::string value = argv[i + 1];
+
+		if (name == "--max-triangles") maxTriangles = static_cast<size_t>(atof(value.c_str()));
+		else if (name == "--quadratic-limit") options.quadraticLimit = static_cast<size_t>(atof(value.c_str()));
+		else if (name == "--min-time") options.minTime = atof(value.c_str());
+		else if (name == "--temp") options.tempDir = value;
+		else if (name == "--csv") options.csvPath = value;
+		else if (name == "--baseline") options.baselinePath = value;
+		else if (name == "--tolerance") options.tolerance = atof(value.c_str());
+		else return false;
+	}
+
+	if (argc % 2 == 0) return false;
+
+	std::vector<size_t> sizes;
+	for (size_t size : options.sizes) {
+		if (size <= maxTriangles) sizes.push_back(size);
+	}
+	options.sizes = sizes;
+
+	return true;
+}
+
+/**
+ * \brief Точка входа
+ * \param argc Кол-во аргументов запуска
+ * \param argv Аргументы запуска (строки)
+ * \return Код завершения (0 - успех, 1 - ошибка, 2 - ухудшение относительно базовых результатов)
+ */
+int main(int argc, char* argv[])
+{
+	MicroBenchmarkOptions options;
+	if (!ParseOptions(argc, argv, options)) {
+		std::cout <<
+			"Usage: MicroBenchmark [--max-triangles N] [--quadratic-limit N] [--min-time MS]\n"
+			"                      [--temp DIR] [--csv FILE] [--baseline FILE] [--tolerance F]\n";
+		return 1;
+	}
+
+	try
+	{
+		// Ресурсы геометрии создаются без контекста - загрузка в видеопамять заменена заглушками
+		InstallGlStub();
+
+		printf("%-28s %10s %6s %12s %12s %10s %12s %12s %10s\n",
+			"kernel", "items", "iters", "ms/call", "Mitems/s", "MB/s", "allocs/call", "KB/call", "peakRSS MB");
+
+		std::vector<KernelResult> results;
+		for (size_t size : options.sizes) {
+			RunKernels(size, options, results);
+		}
+
+		RunTransformKernels(options, results);
+
+		if (!options.csvPath.empty()) WriteCsv(options.csvPath, results);
+
+		if (!options.baselinePath.empty() && IsRegressed(options.baselinePath, results, options.tolerance)) {
+			return 2;
+		}
+
+		return 0;
+	}
+	catch (std::exception const &ex)
+	{
+		std::cout << ex.what() << std::endl;
+		return 1;
+	}
+}